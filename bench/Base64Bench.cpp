@@ -0,0 +1,100 @@
+// Compares Qt's Base64 and PNG paths with the ones used for embedded images.
+// Build with -DQT_EDITOR_BUILD_BENCHMARKS=ON and run ./base64_bench
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QBuffer>
+#include <QDebug>
+#include <cstdio>
+
+#include "utils/Base64.h"
+#include "utils/ImageCodec.h"
+
+// Runs 'fn' a few times and reports the best run as MB/s over 'bytes'.
+template <typename Fn>
+static void report(const char *name, qint64 bytes, Fn fn) {
+    qint64 best = -1;
+    for (int run = 0; run < 5; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        qint64 ns = timer.nsecsElapsed();
+        if (best < 0 || ns < best) best = ns;
+    }
+    double mbPerSec = (bytes / (1024.0 * 1024.0)) / (best / 1e9);
+    std::printf("%-32s %10.2f ms %10.1f MB/s\n", name, best / 1e6, mbPerSec);
+}
+
+// A screenshot-like test image: flat regions, gradients and some text.
+static QImage makeScreenshot(int w, int h) {
+    QImage image(w, h, QImage::Format_ARGB32_Premultiplied);
+    image.fill(QColor("#282a36"));
+    QPainter p(&image);
+    for (int y = 0; y < h; y += 18) {
+        p.setPen(QColor::fromHsv((y * 7) % 360, 120, 230));
+        p.drawText(10, y + 14, QString("int line_%1 = compute(%2); // some code").arg(y).arg(y * 3));
+    }
+    QLinearGradient g(0, 0, w, 0);
+    g.setColorAt(0, Qt::black);
+    g.setColorAt(1, Qt::white);
+    p.fillRect(QRect(w / 2, 0, w / 2, h / 4), g);
+    return image;
+}
+
+int main(int argc, char *argv[]) {
+    QGuiApplication app(argc, argv);
+
+    std::printf("Base64 kernel: %s\n\n", Base64::activeKernel());
+
+    // --- Base64 on 64 MB of random bytes ---
+    QByteArray raw(64 * 1024 * 1024, Qt::Uninitialized);
+    QRandomGenerator rng(42);
+    rng.fillRange(reinterpret_cast<quint32 *>(raw.data()), raw.size() / 4);
+
+    QByteArray qtEncoded, ourEncoded, decoded;
+    report("QByteArray::toBase64", raw.size(), [&] { qtEncoded = raw.toBase64(); });
+    report("Base64::encode", raw.size(), [&] { ourEncoded = Base64::encode(raw); });
+    report("QByteArray::fromBase64", qtEncoded.size(), [&] { decoded = QByteArray::fromBase64(qtEncoded); });
+    report("Base64::decode", ourEncoded.size(), [&] { decoded = Base64::decode(ourEncoded); });
+
+    if (qtEncoded != ourEncoded || decoded != raw) {
+        std::printf("MISMATCH between Qt and vectorized Base64!\n");
+        return 1;
+    }
+
+    // --- PNG encode of a 1920x1080 screenshot ---
+    std::printf("\n");
+    QImage shot = makeScreenshot(1920, 1080);
+    qint64 pixelBytes = shot.sizeInBytes();
+
+    QByteArray png;
+    report("QImage::save PNG (default)", pixelBytes, [&] {
+        png.clear();
+        QBuffer buffer(&png);
+        buffer.open(QIODevice::WriteOnly);
+        shot.save(&buffer, "PNG");
+    });
+    std::printf("%-32s %10lld bytes\n", "  size", (long long)png.size());
+
+    for (int level : {0, 1, 3}) {
+        ImageCodec::Options opts;
+        opts.pngCompressionLevel = level;
+        ImageCodec::setOptions(opts);
+        QByteArray fast;
+        QByteArray name = "ImageCodec PNG level " + QByteArray::number(level);
+        report(name.constData(), pixelBytes, [&] { fast = ImageCodec::encode(shot, QString(), nullptr); });
+        std::printf("%-32s %10lld bytes\n", "  size", (long long)fast.size());
+    }
+
+    ImageCodec::Options webp;
+    webp.format = ImageCodec::WebpLossless;
+    ImageCodec::setOptions(webp);
+    QString mime;
+    QByteArray lossless;
+    report("ImageCodec WebP lossless", pixelBytes, [&] { lossless = ImageCodec::encode(shot, QString(), &mime); });
+    std::printf("%-32s %10lld bytes (%s)\n", "  size", (long long)lossless.size(), qPrintable(mime));
+
+    return 0;
+}
@@ -0,0 +1,337 @@
+// One benchmark per editor_core subsystem, so a regression anywhere below the
+// widgets shows up in a single run. The output follows Google Benchmark's
+// console and JSON formats (same flag names too), which lets its compare.py
+// diff two builds. Build with -DQT_EDITOR_BUILD_BENCHMARKS=ON and run
+//   QT_QPA_PLATFORM=offscreen ./core_bench [--benchmark_filter=<regex>]
+//       [--benchmark_min_time=<seconds>] [--benchmark_out=<file.json>]
+#include <QGuiApplication>
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThread>
+#include <cstdio>
+#include <functional>
+#include <memory>
+
+#include "Grammar.h"
+#include "Highlighter.h"
+#include "LanguageRegistry.h"
+#include "LineIndex.h"
+#include "RichHtmlWriter.h"
+#include "ThemeRegistry.h"
+#include "UndoHistory.h"
+#include "utils/Base64.h"
+#include "utils/DiffHelpers.h"
+#include "utils/TextCodec.h"
+#include "utils/TextSearch.h"
+
+// =========================================================
+// Harness
+// =========================================================
+
+namespace {
+
+struct Benchmark {
+    QString name;
+    qint64 bytesPerIteration; // 0 = no throughput column
+    std::function<void()> run;
+};
+
+struct Result {
+    QString name;
+    qint64 iterations;
+    double nsPerIteration;
+    double bytesPerSecond;
+};
+
+// Like Google Benchmark: grow the iteration count until one batch takes at
+// least 'minTime' seconds, then report the time of that batch per iteration
+Result measure(const Benchmark &bench, double minTime) {
+    qint64 iterations = 1;
+    for (;;) {
+        QElapsedTimer timer;
+        timer.start();
+        for (qint64 i = 0; i < iterations; ++i) bench.run();
+        const qint64 ns = qMax<qint64>(1, timer.nsecsElapsed());
+
+        if (ns >= minTime * 1e9 || iterations >= 1000000000) {
+            const double perIteration = double(ns) / iterations;
+            const double bytesPerSecond = bench.bytesPerIteration * 1e9 / perIteration;
+            return Result{bench.name, iterations, perIteration, bytesPerSecond};
+        }
+
+        // Aim 40% past the target so the next batch is very likely the last
+        const double factor = qBound(2.0, minTime * 1.4e9 / ns, 10.0);
+        iterations = qint64(iterations * factor) + 1;
+    }
+}
+
+void printResult(const Result &result) {
+    std::printf("%-40s %14.0f ns %12lld", qPrintable(result.name), result.nsPerIteration,
+                static_cast<long long>(result.iterations));
+    if (result.bytesPerSecond > 0) {
+        std::printf(" bytes_per_second=%.1fM/s", result.bytesPerSecond / (1024.0 * 1024.0));
+    }
+    std::printf("\n");
+}
+
+bool writeJson(const QString &path, const QVector<Result> &results) {
+    QJsonObject context;
+    context["executable"] = QCoreApplication::applicationFilePath();
+    context["host_name"] = QSysInfo::machineHostName();
+    context["num_cpus"] = QThread::idealThreadCount();
+    context["library_build_type"] =
+#ifdef QT_NO_DEBUG
+        "release";
+#else
+        "debug";
+#endif
+    context["text_search_kernel"] = TextSearch::activeKernel();
+    context["text_codec_kernel"] = TextCodec::activeKernel();
+    context["base64_kernel"] = Base64::activeKernel();
+
+    QJsonArray benchmarks;
+    for (const Result &result : results) {
+        QJsonObject entry;
+        entry["name"] = result.name;
+        entry["run_name"] = result.name;
+        entry["run_type"] = "iteration";
+        entry["iterations"] = result.iterations;
+        entry["real_time"] = result.nsPerIteration;
+        entry["cpu_time"] = result.nsPerIteration;
+        entry["time_unit"] = "ns";
+        if (result.bytesPerSecond > 0) entry["bytes_per_second"] = result.bytesPerSecond;
+        benchmarks.append(entry);
+    }
+
+    QJsonObject root;
+    root["context"] = context;
+    root["benchmarks"] = benchmarks;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    file.write(QJsonDocument(root).toJson());
+    return true;
+}
+
+// =========================================================
+// Inputs
+// =========================================================
+
+// C++-like source with comments, strings and nesting, 'size' characters
+QString makeSource(qsizetype size, quint32 seed) {
+    static const char *const lines[] = {
+        "namespace editor {",
+        "/* Block comment spanning",
+        "   two lines */",
+        "static int compute(const QString &label, int index) {",
+        "    // Line comment with a keyword: return",
+        "    auto value = label.indexOf(\"needle\", index) + 0x2A;",
+        "    for (int i = 0; i < value; ++i) total += i * 3.5f;",
+        "    if (value > 10) { return value; } else { return -1; }",
+        "    const char *raw = R\"(raw \"string\")\";",
+        "}",
+        "} // namespace editor",
+    };
+    const int count = int(sizeof(lines) / sizeof(lines[0]));
+
+    QString text;
+    text.reserve(size + 128);
+    QRandomGenerator rng(seed);
+    while (text.size() < size) {
+        text += QString(int(rng.bounded(4)) * 4, QLatin1Char(' '));
+        text += QLatin1String(lines[rng.bounded(count)]);
+        text += QLatin1Char('\n');
+    }
+    text.truncate(size);
+    return text;
+}
+
+// A copy of 'lines' with roughly one line in 'every' changed, inserted or dropped
+QStringList editLines(const QStringList &lines, int every) {
+    QStringList edited;
+    QRandomGenerator rng(3);
+    for (const QString &line : lines) {
+        switch (rng.bounded(every * 3)) {
+        case 0: edited << line + QStringLiteral(" // edited"); break;
+        case 1: edited << line << QStringLiteral("int inserted = 0;"); break;
+        case 2: break;
+        default: edited << line; break;
+        }
+    }
+    return edited;
+}
+
+} // namespace
+
+// =========================================================
+// Benchmarks
+// =========================================================
+
+int main(int argc, char *argv[]) {
+    QGuiApplication app(argc, argv);
+
+    QRegularExpression filter;
+    double minTime = 0.5;
+    QString outPath;
+    for (const QString &arg : app.arguments().mid(1)) {
+        if (arg.startsWith("--benchmark_filter=")) {
+            filter.setPattern(arg.section('=', 1));
+        } else if (arg.startsWith("--benchmark_min_time=")) {
+            minTime = arg.section('=', 1).remove(QLatin1Char('s')).toDouble();
+        } else if (arg.startsWith("--benchmark_out=")) {
+            outPath = arg.section('=', 1);
+        } else {
+            std::fprintf(stderr, "Unknown argument %s\n", qPrintable(arg));
+            return 2;
+        }
+    }
+    if (!filter.isValid()) {
+        std::fprintf(stderr, "Invalid filter: %s\n", qPrintable(filter.errorString()));
+        return 2;
+    }
+
+    const QString source = makeSource(1024 * 1024, 7);
+    const QByteArray sourceUtf8 = source.toUtf8();
+    const QString bigSource = makeSource(16 * 1024 * 1024, 9);
+    const QByteArray bigUtf8 = bigSource.toUtf8();
+    const Grammar *cpp = LanguageRegistry::instance()->grammar("cpp");
+    const Theme *theme = ThemeRegistry::instance()->currentTheme();
+    if (!cpp) {
+        std::fprintf(stderr, "The cpp grammar did not load\n");
+        return 1;
+    }
+
+    QVector<Benchmark> benchmarks;
+
+    // --- Diff (Paste with Diff, reload) ---
+    {
+        const QStringList oldLines = makeSource(64 * 1024, 5).split(QLatin1Char('\n'));
+        const QStringList newLines = editLines(oldLines, 20);
+        benchmarks.append({QString("BM_DiffHelpers_computeDiff/%1").arg(oldLines.size()), 0, [=] {
+            const QVector<DiffHelpers::DiffHunk> hunks = DiffHelpers::computeDiff(oldLines, newLines);
+            Q_UNUSED(hunks);
+        }});
+    }
+
+    // --- Lexing & highlighting ---
+    {
+        const QStringList lines = source.split(QLatin1Char('\n'));
+        benchmarks.append({"BM_Grammar_tokenize/cpp", sourceUtf8.size(), [=] {
+            QVector<Grammar::Token> tokens;
+            Grammar::LexState state;
+            for (const QString &line : lines) state = cpp->tokenize(line, state, &tokens);
+        }});
+
+        auto document = std::make_shared<QTextDocument>();
+        document->setPlainText(source.left(256 * 1024));
+        // Owned by the document
+        Highlighter *highlighter = new Highlighter(document.get(), cpp, theme);
+        benchmarks.append({"BM_Highlighter_rehighlight/cpp", document->characterCount(), [=] {
+            highlighter->rehighlight();
+        }});
+    }
+
+    // --- Buffer ---
+    {
+        // Typing into a document with undo recorded, then undoing all of it
+        benchmarks.append({"BM_UndoHistory_typeAndUndo/4096", 0, [=] {
+            QTextDocument document;
+            document.setPlainText(source.left(64 * 1024));
+            UndoHistory history(&document);
+            QTextCursor cursor(&document);
+            cursor.setPosition(32 * 1024);
+            for (int i = 0; i < 4096; ++i) {
+                cursor.insertText(QString(QLatin1Char(i % 64 == 63 ? '\n' : 'a' + i % 26)));
+            }
+            while (history.undo() >= 0) {}
+        }});
+
+        benchmarks.append({"BM_TextSearch_findAll/16M", bigSource.size() * 2, [=] {
+            QVector<int> positions;
+            TextSearch::findAll(bigSource, u"compute", 0, bigSource.size(), Qt::CaseSensitive, &positions);
+        }});
+        benchmarks.append({"BM_TextSearch_findAll/16M/caseInsensitive", bigSource.size() * 2, [=] {
+            QVector<int> positions;
+            TextSearch::findAll(bigSource, u"Compute", 0, bigSource.size(), Qt::CaseInsensitive, &positions);
+        }});
+
+        // The log viewer's line index over an in-memory "file"
+        benchmarks.append({"BM_LineIndex_scan/16M", bigUtf8.size(), [=] {
+            QByteArray bytes = bigUtf8;
+            QBuffer buffer(&bytes);
+            buffer.open(QIODevice::ReadOnly);
+            LineIndex::Batch batch;
+            LineIndex::scan(&buffer, 0, bytes.size(), 0, &batch, nullptr);
+        }});
+    }
+
+    // --- File formats ---
+    {
+        benchmarks.append({"BM_TextCodec_decode/utf8/16M", bigUtf8.size(), [=] {
+            TextCodec::Format format;
+            const QString text = TextCodec::decode(bigUtf8, &format);
+            Q_UNUSED(text);
+        }});
+
+        TextCodec::Format crlf;
+        crlf.lineEnding = TextCodec::CRLF;
+        benchmarks.append({"BM_TextCodec_encode/crlf/16M", bigUtf8.size(), [=] {
+            const QByteArray bytes = TextCodec::encode(bigSource, crlf);
+            Q_UNUSED(bytes);
+        }});
+
+        QByteArray binary(12 * 1024 * 1024, Qt::Uninitialized);
+        QRandomGenerator(1).fillRange(reinterpret_cast<quint32 *>(binary.data()), binary.size() / 4);
+        const QByteArray encoded = Base64::encode(binary);
+        benchmarks.append({"BM_Base64_encode/12M", binary.size(), [=] { Base64::encode(binary); }});
+        benchmarks.append({"BM_Base64_decode/16M", encoded.size(), [=] { Base64::decode(encoded); }});
+
+        // Rich text saving: styled paragraphs and lists, no images
+        auto rich = std::make_shared<QTextDocument>();
+        QString html;
+        for (int i = 0; i < 2000; ++i) {
+            html += QString("<h2>Section %1</h2><p>Plain, <b>bold</b>, <i>italic</i> and "
+                            "<a href=\"https://example.com/%1\">linked</a> text.</p>"
+                            "<ul><li>First item</li><li>Second item</li></ul>").arg(i);
+        }
+        rich->setHtml(html);
+        benchmarks.append({"BM_RichHtmlWriter_write/2000", 0, [=] {
+            QBuffer buffer;
+            buffer.open(QIODevice::WriteOnly);
+            RichHtmlWriter(rich.get()).write(&buffer);
+        }});
+    }
+
+    // =========================================================
+    // Run
+    // =========================================================
+
+    std::printf("Kernels: TextSearch %s, TextCodec %s, Base64 %s\n", TextSearch::activeKernel(),
+                TextCodec::activeKernel(), Base64::activeKernel());
+    std::printf("%s\n", QByteArray(80, '-').constData());
+    std::printf("%-40s %17s %12s\n", "Benchmark", "Time", "Iterations");
+    std::printf("%s\n", QByteArray(80, '-').constData());
+
+    QVector<Result> results;
+    for (const Benchmark &bench : std::as_const(benchmarks)) {
+        if (!filter.pattern().isEmpty() && !filter.match(bench.name).hasMatch()) continue;
+        results.append(measure(bench, minTime));
+        printResult(results.last());
+        std::fflush(stdout);
+    }
+
+    if (!outPath.isEmpty() && !writeJson(outPath, results)) {
+        std::fprintf(stderr, "Could not write %s\n", qPrintable(outPath));
+        return 1;
+    }
+    return 0;
+}
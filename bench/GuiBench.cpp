@@ -0,0 +1,506 @@
+// Scripted editing session on the real widgets, to find the hotspots the
+// micro-benchmarks can't see (layout, painting, signal fan-out).
+//
+// Generated files of increasing size are opened through EditorArea::openFile
+// and put through the same script: type, scroll, paste with diff, save (and
+// resize embedded images for rich text). Each action records its wall time,
+// the time spent in paint events and the allocations made (counted by
+// MemoryAccounting). Results can be written as JSON and compared with an
+// earlier run; actions that got slower, allocate more or scale worse with
+// file size are flagged and the exit code is 1.
+// Build with -DQT_EDITOR_BUILD_BENCHMARKS=ON and run
+//   QT_QPA_PLATFORM=offscreen ./gui_bench [--sizes=1000,10000,100000]
+//       [--out=<file.json>] [--baseline=<file.json>] [--tolerance=0.25]
+#include <QApplication>
+#include <QBuffer>
+#include <QClipboard>
+#include <QDialog>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QProcess>
+#include <QPushButton>
+#include <QRandomGenerator>
+#include <QScrollBar>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTimer>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+
+#include "EditorArea.h"
+#include "CodeEditor.h"
+#include "RichTextEditor.h"
+#include "CustomRichTextBoard.h"
+#include "ImageResizeWidget.h"
+#include "MemoryAccounting.h"
+
+// =========================================================
+// Paint Timing
+// =========================================================
+
+// Every QPaintEvent goes through notify(), so timing it here covers all
+// widgets (editor, gutter, minimap, ...) without touching their code
+class BenchApplication : public QApplication {
+public:
+    using QApplication::QApplication;
+
+    qint64 paintNs = 0;
+    int paints = 0;
+
+    bool notify(QObject *receiver, QEvent *event) override {
+        if (event->type() != QEvent::Paint || m_inPaint) return QApplication::notify(receiver, event);
+
+        m_inPaint = true;
+        QElapsedTimer timer;
+        timer.start();
+        const bool result = QApplication::notify(receiver, event);
+        paintNs += timer.nsecsElapsed();
+        ++paints;
+        m_inPaint = false;
+        return result;
+    }
+
+private:
+    bool m_inPaint = false;
+};
+
+namespace {
+
+// =========================================================
+// Measurement
+// =========================================================
+
+struct Sample {
+    QString action;  // "type", "scroll", ...
+    QString kind;    // "code" or "rich"
+    int size;        // Lines (code) or images (rich)
+    int ops;         // Keystrokes, pages, ... in this action
+    double wallMs;
+    double paintMs;
+    int paints;
+    quint64 allocations;
+    quint64 allocatedBytes;
+
+    QString name() const { return QString("%1/%2/%3").arg(action, kind).arg(size); }
+};
+
+// Runs the event loop until nothing is pending (posted events, layout and
+// the paints they trigger). Timers that haven't expired are not waited for.
+void settle() {
+    for (int i = 0; i < 3; ++i) {
+        QCoreApplication::sendPostedEvents();
+        QCoreApplication::processEvents(QEventLoop::AllEvents);
+    }
+}
+
+// Times 'fn' plus the event processing it causes
+template <typename Fn>
+Sample measure(BenchApplication &app, const QString &action, const QString &kind, int size, int ops, Fn fn) {
+    settle();
+    app.paintNs = 0;
+    app.paints = 0;
+    const MemoryAccounting::Counters before = MemoryAccounting::total();
+
+    QElapsedTimer timer;
+    timer.start();
+    fn();
+    settle();
+
+    Sample sample;
+    sample.action = action;
+    sample.kind = kind;
+    sample.size = size;
+    sample.ops = ops;
+    sample.wallMs = timer.nsecsElapsed() / 1e6;
+    sample.paintMs = app.paintNs / 1e6;
+    sample.paints = app.paints;
+    const MemoryAccounting::Counters after = MemoryAccounting::total();
+    sample.allocations = quint64(after.allocations - before.allocations);
+    sample.allocatedBytes = quint64(after.allocatedBytes - before.allocatedBytes);
+
+    std::printf("%-28s %10.2f %10.2f %7d %11llu %10.1f %10.3f\n", qPrintable(sample.name()), sample.wallMs,
+                sample.paintMs, sample.paints, static_cast<unsigned long long>(sample.allocations),
+                sample.allocatedBytes / (1024.0 * 1024.0), sample.wallMs / qMax(1, ops));
+    std::fflush(stdout);
+    return sample;
+}
+
+// =========================================================
+// Generated Files
+// =========================================================
+
+QString makeSourceLines(int lines, quint32 seed) {
+    static const char *const templates[] = {
+        "namespace editor {",
+        "/* Block comment spanning",
+        "   two lines */",
+        "static int compute(const QString &label, int index) {",
+        "    // Line comment with a keyword: return",
+        "    auto value = label.indexOf(\"needle\", index) + 0x2A;",
+        "    for (int i = 0; i < value; ++i) total += i * 3.5f;",
+        "    if (value > 10) { return value; } else { return -1; }",
+        "}",
+        "} // namespace editor",
+    };
+    const int count = int(sizeof(templates) / sizeof(templates[0]));
+
+    QString text;
+    QRandomGenerator rng(seed);
+    for (int i = 0; i < lines; ++i) {
+        text += QString(int(rng.bounded(4)) * 4, QLatin1Char(' '));
+        text += QLatin1String(templates[rng.bounded(count)]);
+        text += QLatin1Char('\n');
+    }
+    return text;
+}
+
+// Paragraphs with an embedded PNG every few of them, as saved by the editor
+QByteArray makeRichHtml(int images) {
+    QImage image(640, 480, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, 640, 480);
+    gradient.setColorAt(0, QColor("#bd93f9"));
+    gradient.setColorAt(1, QColor("#8be9fd"));
+    painter.fillRect(image.rect(), gradient);
+    painter.end();
+
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    const QByteArray uri = "data:image/png;base64," + png.toBase64();
+
+    QByteArray html = "<html><body>\n";
+    for (int i = 0; i < images; ++i) {
+        html += "<p><img src=\"" + uri + "\" width=\"320\" height=\"240\"></p>\n";
+        for (int p = 0; p < 4; ++p) {
+            html += "<p>Paragraph " + QByteArray::number(i * 4 + p) +
+                    " with <b>bold</b> and <i>italic</i> text around the images.</p>\n";
+        }
+    }
+    html += "</body></html>\n";
+    return html;
+}
+
+bool writeFile(const QString &path, const QByteArray &bytes) {
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size();
+}
+
+// =========================================================
+// Scripts
+// =========================================================
+
+void typeText(QWidget *target, const QString &text) {
+    for (const QChar ch : text) {
+        const int key = ch == QLatin1Char('\n') ? int(Qt::Key_Return) : int(ch.toUpper().unicode());
+        const QString keyText = ch == QLatin1Char('\n') ? QString("\r") : QString(ch);
+        QKeyEvent press(QEvent::KeyPress, key, Qt::NoModifier, keyText);
+        QKeyEvent release(QEvent::KeyRelease, key, Qt::NoModifier, keyText);
+        QCoreApplication::sendEvent(target, &press);
+        QCoreApplication::sendEvent(target, &release);
+        // One paint per keystroke, as when typing for real
+        QCoreApplication::processEvents();
+    }
+}
+
+void scrollPages(QAbstractScrollArea *area, int pages) {
+    QScrollBar *bar = area->verticalScrollBar();
+    for (int i = 0; i < pages && bar->value() < bar->maximum(); ++i) {
+        bar->setValue(bar->value() + bar->pageStep());
+        QCoreApplication::processEvents();
+    }
+}
+
+// Clicks "Replace" in the modal DiffViewDialog as soon as it is shown
+void acceptDiffDialogLater() {
+    QTimer::singleShot(0, [] {
+        QWidget *dialog = QApplication::activeModalWidget();
+        if (!dialog) {
+            acceptDiffDialogLater();
+            return;
+        }
+        for (QPushButton *button : dialog->findChildren<QPushButton *>()) {
+            if (button->text() == "Replace") {
+                button->click();
+                return;
+            }
+        }
+        if (auto *other = qobject_cast<QDialog *>(dialog)) other->reject();
+    });
+}
+
+QVector<Sample> runCode(BenchApplication &app, EditorArea *area, const QString &dir, int lines) {
+    QVector<Sample> samples;
+    const QString path = QString("%1/generated_%2.cpp").arg(dir).arg(lines);
+    writeFile(path, makeSourceLines(lines, quint32(lines)).toUtf8());
+
+    samples << measure(app, "open", "code", lines, 1, [&] { area->openFile(path); });
+    auto *editor = qobject_cast<CodeEditor *>(area->currentEditor());
+    if (!editor) {
+        std::fprintf(stderr, "%s did not open in a CodeEditor\n", qPrintable(path));
+        return samples;
+    }
+    editor->setFocus();
+
+    // Typing in the middle of the file
+    editor->goToLine(lines / 2);
+    const QString typed = QString("int typed = compute(\"x\", 1);\n").repeated(8);
+    samples << measure(app, "type", "code", lines, typed.size(), [&] { typeText(editor, typed); });
+
+    editor->goToLine(1);
+    samples << measure(app, "scroll", "code", lines, 100, [&] { scrollPages(editor, 100); });
+
+    // Paste with diff over 200 lines, clipboard holding an edited copy
+    QTextCursor cursor(editor->document()->findBlockByNumber(lines / 4));
+    cursor.movePosition(QTextCursor::Down, QTextCursor::KeepAnchor, 200);
+    editor->setTextCursor(cursor);
+    QString incoming = cursor.selectedText().replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    incoming.replace("value", "result");
+    QApplication::clipboard()->setText(incoming);
+    samples << measure(app, "paste_diff", "code", lines, 1, [&] {
+        acceptDiffDialogLater();
+        QMetaObject::invokeMethod(editor, "onPasteWithDiff");
+    });
+
+    samples << measure(app, "save", "code", lines, 1, [&] { area->saveCurrentFile(); });
+    samples << measure(app, "close", "code", lines, 1, [&] { area->closeCurrentFile(); });
+    return samples;
+}
+
+QVector<Sample> runRich(BenchApplication &app, EditorArea *area, const QString &dir, int images) {
+    QVector<Sample> samples;
+    const QString path = QString("%1/generated_%2.html").arg(dir).arg(images);
+    writeFile(path, makeRichHtml(images));
+
+    samples << measure(app, "open", "rich", images, 1, [&] { area->openFile(path); });
+    auto *rich = qobject_cast<RichTextEditor *>(area->currentEditor());
+    CustomRichTextBoard *board = rich ? rich->findChild<CustomRichTextBoard *>() : nullptr;
+    if (!board) {
+        std::fprintf(stderr, "%s did not open in a RichTextEditor\n", qPrintable(path));
+        return samples;
+    }
+
+    samples << measure(app, "scroll", "rich", images, 50, [&] { scrollPages(board, 50); });
+
+    // Click the first image, then drag its handle: one size per mouse move
+    board->verticalScrollBar()->setValue(0);
+    settle();
+    QTextCursor image(board->document());
+    image.setPosition(board->document()->firstBlock().position());
+    const QRect caret = board->cursorRect(image);
+    const QPoint inside(caret.left() + 20, caret.bottom() - 20);
+    QMouseEvent press(QEvent::MouseButtonPress, inside, board->viewport()->mapToGlobal(inside), Qt::LeftButton,
+                      Qt::LeftButton, Qt::NoModifier);
+    QCoreApplication::sendEvent(board->viewport(), &press);
+
+    ImageResizeWidget *handles = rich->findChild<ImageResizeWidget *>();
+    if (handles && handles->isVisible()) {
+        samples << measure(app, "resize_image", "rich", images, 40, [&] {
+            for (int step = 0; step < 40; ++step) {
+                emit handles->resizeRequested(QSize(320 - step * 4, 240 - step * 3));
+                QCoreApplication::processEvents();
+            }
+            emit handles->resizeFinished();
+        });
+    } else {
+        std::fprintf(stderr, "resize_image/rich/%d skipped: the image was not selected\n", images);
+    }
+
+    samples << measure(app, "save", "rich", images, 1, [&] { area->saveCurrentFile(); });
+    samples << measure(app, "close", "rich", images, 1, [&] { area->closeCurrentFile(); });
+    return samples;
+}
+
+// =========================================================
+// Reporting
+// =========================================================
+
+// How an action's wall time grows with the file: 1.0 is linear, 2.0 quadratic.
+// Taken between the smallest and the largest size of the run.
+QHash<QString, double> scalingExponents(const QVector<Sample> &samples) {
+    QHash<QString, const Sample *> smallest, largest;
+    for (const Sample &sample : samples) {
+        const QString key = sample.action + "/" + sample.kind;
+        if (!smallest.contains(key) || sample.size < smallest[key]->size) smallest[key] = &sample;
+        if (!largest.contains(key) || sample.size > largest[key]->size) largest[key] = &sample;
+    }
+
+    QHash<QString, double> exponents;
+    for (auto it = smallest.constBegin(); it != smallest.constEnd(); ++it) {
+        const Sample *low = it.value();
+        const Sample *high = largest.value(it.key());
+        if (high->size <= low->size || low->wallMs <= 0.0 || high->wallMs <= 0.0) continue;
+        exponents.insert(it.key(), std::log(high->wallMs / low->wallMs) / std::log(double(high->size) / low->size));
+    }
+    return exponents;
+}
+
+QJsonObject toJson(const QVector<Sample> &samples, const QHash<QString, double> &exponents) {
+    QJsonArray actions;
+    for (const Sample &sample : samples) {
+        QJsonObject entry;
+        entry["name"] = sample.name();
+        entry["ops"] = sample.ops;
+        entry["wall_ms"] = sample.wallMs;
+        entry["paint_ms"] = sample.paintMs;
+        entry["paints"] = sample.paints;
+        entry["allocations"] = qint64(sample.allocations);
+        entry["allocated_bytes"] = qint64(sample.allocatedBytes);
+        actions.append(entry);
+    }
+
+    QJsonObject scaling;
+    for (auto it = exponents.constBegin(); it != exponents.constEnd(); ++it) scaling[it.key()] = it.value();
+
+    QJsonObject root;
+    root["qt_version"] = qVersion();
+    root["platform"] = QGuiApplication::platformName();
+    root["actions"] = actions;
+    root["scaling"] = scaling;
+    return root;
+}
+
+// Prints what got worse than in 'baseline' and returns how many regressed.
+// Times below 'floorMs' are too noisy to compare.
+int compareWithBaseline(const QJsonObject &current, const QJsonObject &baseline, double tolerance) {
+    static constexpr double floorMs = 2.0;
+    static constexpr double exponentSlack = 0.25;
+
+    QHash<QString, QJsonObject> before;
+    for (const QJsonValue &value : baseline["actions"].toArray()) {
+        before.insert(value["name"].toString(), value.toObject());
+    }
+
+    int regressions = 0;
+    std::printf("\nCompared with the baseline (tolerance %.0f%%):\n", tolerance * 100);
+    for (const QJsonValue &value : current["actions"].toArray()) {
+        const QString name = value["name"].toString();
+        if (!before.contains(name)) continue;
+        const QJsonObject old = before.value(name);
+
+        const double wall = value["wall_ms"].toDouble();
+        const double oldWall = old["wall_ms"].toDouble();
+        if (wall > floorMs && wall > oldWall * (1.0 + tolerance)) {
+            std::printf("  SLOWER      %-28s %10.2f ms -> %10.2f ms\n", qPrintable(name), oldWall, wall);
+            ++regressions;
+        }
+
+        const double allocations = value["allocations"].toDouble();
+        const double oldAllocations = old["allocations"].toDouble();
+        if (allocations > 100 && allocations > oldAllocations * (1.0 + tolerance)) {
+            std::printf("  ALLOCATES   %-28s %10.0f    -> %10.0f\n", qPrintable(name), oldAllocations, allocations);
+            ++regressions;
+        }
+    }
+
+    const QJsonObject scaling = current["scaling"].toObject();
+    const QJsonObject oldScaling = baseline["scaling"].toObject();
+    for (auto it = scaling.constBegin(); it != scaling.constEnd(); ++it) {
+        if (!oldScaling.contains(it.key())) continue;
+        const double exponent = it.value().toDouble();
+        const double oldExponent = oldScaling[it.key()].toDouble();
+        if (exponent > oldExponent + exponentSlack) {
+            std::printf("  SCALES      %-28s n^%.2f -> n^%.2f\n", qPrintable(it.key()), oldExponent, exponent);
+            ++regressions;
+        }
+    }
+
+    if (regressions == 0) std::printf("  no regressions\n");
+    return regressions;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    BenchApplication app(argc, argv);
+
+    // Allocation counts come from the MemoryAccounting hook, which is decided
+    // on before main(): run again with it switched on
+    if (!MemoryAccounting::isEnabled() && !qEnvironmentVariableIsSet("QT_EDITOR_MEMORY_ACCOUNTING")) {
+        qputenv("QT_EDITOR_MEMORY_ACCOUNTING", "1");
+        return QProcess::execute(app.applicationFilePath(), app.arguments().mid(1));
+    }
+
+    // Saving writes undo histories to the app data dir; keep those out of the user's
+    QStandardPaths::setTestModeEnabled(true);
+
+    QList<int> sizes = {1000, 10000, 100000};
+    QList<int> imageCounts = {4, 40};
+    QString outPath;
+    QString baselinePath;
+    double tolerance = 0.25;
+    for (const QString &arg : app.arguments().mid(1)) {
+        const QString value = arg.section('=', 1);
+        if (arg.startsWith("--sizes=")) {
+            sizes.clear();
+            for (const QString &size : value.split(',')) sizes << size.toInt();
+        } else if (arg.startsWith("--images=")) {
+            imageCounts.clear();
+            for (const QString &count : value.split(',')) imageCounts << count.toInt();
+        } else if (arg.startsWith("--out=")) {
+            outPath = value;
+        } else if (arg.startsWith("--baseline=")) {
+            baselinePath = value;
+        } else if (arg.startsWith("--tolerance=")) {
+            tolerance = value.toDouble();
+        } else {
+            std::fprintf(stderr, "Unknown argument %s\n", qPrintable(arg));
+            return 2;
+        }
+    }
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        std::fprintf(stderr, "Could not create a temporary directory\n");
+        return 1;
+    }
+
+    // A window the size of a typical laptop screen, painted like the real app
+    EditorArea area;
+    area.resize(1280, 800);
+    area.show();
+    settle();
+
+    std::printf("%-28s %10s %10s %7s %11s %10s %10s\n", "action", "wall ms", "paint ms", "paints", "allocs",
+                "alloc MB", "ms/op");
+    QVector<Sample> samples;
+    for (int lines : std::as_const(sizes)) samples += runCode(app, &area, dir.path(), lines);
+    for (int images : std::as_const(imageCounts)) samples += runRich(app, &area, dir.path(), images);
+
+    const QHash<QString, double> exponents = scalingExponents(samples);
+    std::printf("\nScaling (wall time ~ n^k):\n");
+    for (auto it = exponents.constBegin(); it != exponents.constEnd(); ++it) {
+        std::printf("  %-20s k = %.2f\n", qPrintable(it.key()), it.value());
+    }
+
+    const QJsonObject results = toJson(samples, exponents);
+    if (!outPath.isEmpty()) {
+        QFile out(outPath);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            std::fprintf(stderr, "Could not write %s\n", qPrintable(outPath));
+            return 1;
+        }
+        out.write(QJsonDocument(results).toJson());
+    }
+
+    if (!baselinePath.isEmpty()) {
+        QFile in(baselinePath);
+        if (!in.open(QIODevice::ReadOnly)) {
+            std::fprintf(stderr, "Could not read %s\n", qPrintable(baselinePath));
+            return 1;
+        }
+        const QJsonObject baseline = QJsonDocument::fromJson(in.readAll()).object();
+        if (compareWithBaseline(results, baseline, tolerance) > 0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Compares loading text through QTextStream and QString::fromUtf8 with the
+// TextCodec fast paths. Build with -DQT_EDITOR_BUILD_BENCHMARKS=ON and run
+// ./text_codec_bench
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QBuffer>
+#include <QTextStream>
+#include <QRandomGenerator>
+#include <cstdio>
+
+#include "utils/TextCodec.h"
+
+// Runs 'fn' a few times and reports the best run as MB/s over 'bytes'.
+template <typename Fn>
+static void report(const char *name, qint64 bytes, Fn fn) {
+    qint64 best = -1;
+    for (int run = 0; run < 5; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        qint64 ns = timer.nsecsElapsed();
+        if (best < 0 || ns < best) best = ns;
+    }
+    double mbPerSec = (bytes / (1024.0 * 1024.0)) / (best / 1e9);
+    std::printf("%-32s %10.2f ms %10.1f MB/s\n", name, best / 1e6, mbPerSec);
+}
+
+// ASCII source-like lines joined with 'newline'
+static QByteArray makeSource(qsizetype size, const char *newline) {
+    QByteArray text;
+    text.reserve(size + 128);
+    QRandomGenerator rng(11);
+    while (text.size() < size) {
+        text += QByteArray(int(rng.bounded(12)), ' ');
+        text += "auto value = compute(index, \"label\"); // note";
+        text += newline;
+    }
+    text.truncate(size);
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    std::printf("TextCodec kernel: %s\n\n", TextCodec::activeKernel());
+
+    const qsizetype size = 128 * 1024 * 1024;
+    const QByteArray lf = makeSource(size, "\n");
+    const QByteArray crlf = makeSource(size, "\r\n");
+    QByteArray utf8 = lf;
+    utf8.replace("note", "n\xC3\xB6te"); // One non-ASCII character per line
+
+    QString text;
+    TextCodec::Format format;
+
+    report("QTextStream::readAll (LF)", lf.size(), [&] {
+        QBuffer buffer(const_cast<QByteArray *>(&lf));
+        buffer.open(QIODevice::ReadOnly | QIODevice::Text);
+        text = QTextStream(&buffer).readAll();
+    });
+    report("QString::fromUtf8 (LF)", lf.size(), [&] { text = QString::fromUtf8(lf); });
+    report("TextCodec::decode (LF)", lf.size(), [&] { text = TextCodec::decode(lf, &format); });
+    report("TextCodec::decode (CRLF)", crlf.size(), [&] { text = TextCodec::decode(crlf, &format); });
+    if (format.lineEnding != TextCodec::CRLF || text.contains(QLatin1Char('\r'))) {
+        std::printf("CRLF was not detected or not normalized!\n");
+        return 1;
+    }
+    report("TextCodec::decode (UTF-8)", utf8.size(), [&] { text = TextCodec::decode(utf8, &format); });
+    if (text != QString::fromUtf8(utf8)) {
+        std::printf("MISMATCH between QString::fromUtf8 and TextCodec::decode!\n");
+        return 1;
+    }
+
+    // Round trip
+    const QString crlfText = TextCodec::decode(crlf, &format);
+    QByteArray written;
+    report("TextCodec::encode (CRLF)", crlf.size(), [&] { written = TextCodec::encode(crlfText, format); });
+    if (written != crlf) {
+        std::printf("CRLF round trip changed the bytes!\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Compares Qt's substring counting with the vectorized TextSearch kernels.
+// Build with -DQT_EDITOR_BUILD_BENCHMARKS=ON and run ./text_search_bench
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <cstdio>
+
+#include "utils/TextSearch.h"
+
+// Runs 'fn' a few times and reports the best run as MB/s over 'bytes'.
+template <typename Fn>
+static void report(const char *name, qint64 bytes, Fn fn) {
+    qint64 best = -1;
+    for (int run = 0; run < 5; ++run) {
+        QElapsedTimer timer;
+        timer.start();
+        fn();
+        qint64 ns = timer.nsecsElapsed();
+        if (best < 0 || ns < best) best = ns;
+    }
+    double mbPerSec = (bytes / (1024.0 * 1024.0)) / (best / 1e9);
+    std::printf("%-32s %10.2f ms %10.1f MB/s\n", name, best / 1e6, mbPerSec);
+}
+
+// Source-code-like text: identifiers, spaces and newlines, with the needle
+// planted every few kilobytes
+static QByteArray makeText(qsizetype size, const QByteArray &needle) {
+    static const char kWords[][12] = {"int", "return", "value", "const", "auto", "std::vector",
+                                      "if", "for", "while", "QString", "nullptr", "i++"};
+    QByteArray text;
+    text.reserve(size);
+    QRandomGenerator rng(7);
+    while (text.size() < size) {
+        text += kWords[rng.bounded(12)];
+        text += rng.bounded(8) == 0 ? '\n' : ' ';
+        if (rng.bounded(600) == 0) text += needle + ' ';
+    }
+    text.truncate(size);
+    return text;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    std::printf("TextSearch kernel: %s\n\n", TextSearch::activeKernel());
+
+    // --- 8-bit text (memory-mapped files), 500 MB ---
+    const QByteArray needle = "computeLayout";
+    const QByteArray bytes = makeText(500 * 1024 * 1024, needle);
+
+    qsizetype qtCount = 0, ourCount = 0, foldedCount = 0;
+    report("QByteArray::count", bytes.size(), [&] { qtCount = bytes.count(needle); });
+    report("TextSearch::count", bytes.size(), [&] { ourCount = TextSearch::count(bytes, needle); });
+    report("TextSearch::count (no case)", bytes.size(), [&] {
+        foldedCount = TextSearch::count(bytes, "COMPUTElayout", Qt::CaseInsensitive);
+    });
+
+    if (qtCount != ourCount || ourCount != foldedCount) {
+        std::printf("MISMATCH: Qt %lld, ours %lld, case-insensitive %lld\n",
+                    (long long)qtCount, (long long)ourCount, (long long)foldedCount);
+        return 1;
+    }
+    std::printf("%-32s %10lld\n\n", "  matches", (long long)ourCount);
+
+    // --- UTF-16 text (documents), 128M characters ---
+    const QString text = QString::fromLatin1(bytes.left(128 * 1024 * 1024));
+    const QString word = QString::fromLatin1(needle);
+    const qint64 textBytes = text.size() * qint64(sizeof(QChar));
+
+    qtCount = ourCount = 0;
+    report("QString::count", textBytes, [&] { qtCount = text.count(word); });
+    report("TextSearch::findAll", textBytes, [&] {
+        ourCount = TextSearch::findAll(text, word, 0, text.size(), Qt::CaseSensitive, nullptr);
+    });
+
+    if (qtCount != ourCount) {
+        std::printf("MISMATCH: Qt %lld, ours %lld\n", (long long)qtCount, (long long)ourCount);
+        return 1;
+    }
+    std::printf("%-32s %10lld\n", "  matches", (long long)ourCount);
+    return 0;
+}
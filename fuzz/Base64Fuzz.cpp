@@ -0,0 +1,26 @@
+// libFuzzer target for Base64::decode (embedded images in untrusted HTML).
+// Build with -DQT_EDITOR_BUILD_FUZZERS=ON (Clang) and run ./base64_fuzz
+#include <QByteArray>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "utils/Base64.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    const char *in = reinterpret_cast<const char *>(data);
+
+    // Exactly the documented room, so AddressSanitizer sees any write past it
+    const size_t bound = Base64::decodedSizeBound(size);
+    std::unique_ptr<char[]> out(new char[bound ? bound : 1]);
+    const size_t written = Base64::decode(in, size, out.get());
+    if (written > bound) std::abort();
+
+    // Whatever the input, encoding it and decoding that gives it back
+    const QByteArray raw = QByteArray::fromRawData(in, qsizetype(size));
+    const QByteArray encoded = Base64::encode(raw);
+    if (encoded != raw.toBase64()) std::abort();
+    if (Base64::decode(encoded) != raw) std::abort();
+    return 0;
+}
@@ -0,0 +1,25 @@
+// libFuzzer target for LineIndex::read (the log viewer's session cache).
+// Build with -DQT_EDITOR_BUILD_FUZZERS=ON (Clang) and run ./line_index_fuzz
+#include <QByteArray>
+#include <QDataStream>
+#include <cstdint>
+#include <cstdlib>
+
+#include "LineIndex.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    const QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(data), qsizetype(size));
+    QDataStream in(bytes);
+
+    LineIndex index;
+    if (!index.read(in)) return 0;
+
+    // An accepted index only ever points inside the indexed bytes
+    for (qint64 line : {qint64(0), index.lineCount() / 2, index.lineCount() - 1, index.lineCount() + 5000}) {
+        qint64 checkpointLine = 0;
+        qint64 offset = 0;
+        index.checkpointFor(line, &checkpointLine, &offset);
+        if (offset < 0 || offset > index.indexedBytes() || checkpointLine > index.newlineCount()) std::abort();
+    }
+    return 0;
+}
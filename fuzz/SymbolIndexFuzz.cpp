@@ -0,0 +1,18 @@
+// libFuzzer target for reading the symbol index cache file (it comes from
+// disk and may be damaged or from another build).
+// Build with -DQT_EDITOR_BUILD_FUZZERS=ON (Clang) and run ./symbol_index_fuzz
+#include <QByteArray>
+#include <cstdint>
+
+#include "SymbolIndex.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    // A copy, so the records are as aligned as a mapped or read file's
+    const QByteArray bytes(reinterpret_cast<const char *>(data), qsizetype(size));
+    const SymbolIndex::Model model = SymbolIndex::parseIndex(bytes);
+
+    for (auto it = model.constBegin(); it != model.constEnd(); ++it) {
+        for (const SymbolIndex::Symbol &symbol : it->symbols) SymbolIndex::kindName(symbol.kind);
+    }
+    return 0;
+}
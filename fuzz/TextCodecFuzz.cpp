@@ -0,0 +1,29 @@
+// libFuzzer target for TextCodec::decode (any bytes a file can hold).
+// Build with -DQT_EDITOR_BUILD_FUZZERS=ON (Clang) and run ./text_codec_fuzz
+#include <QByteArray>
+#include <QString>
+#include <cstdint>
+#include <cstdlib>
+
+#include "utils/TextCodec.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    const QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(data), qsizetype(size));
+
+    TextCodec::Format format;
+    const QString text = TextCodec::decode(bytes, &format);
+
+    // Line breaks always come back as '\n'
+    if (text.contains(QLatin1Char('\r'))) std::abort();
+
+    // Saving may fail to represent the text (Latin-1) but must not crash
+    bool ok = false;
+    TextCodec::encode(text, format, &ok);
+
+    // The vector kernels agree with a plain loop
+    const char *chars = bytes.constData();
+    qsizetype ascii = 0;
+    while (ascii < bytes.size() && uchar(chars[ascii]) < 0x80) ++ascii;
+    if (TextCodec::asciiPrefixLength(chars, bytes.size()) != ascii) std::abort();
+    return 0;
+}
@@ -1,4 +1,7 @@
 #include "MainWindow.h"
+#include "SymbolIndex.h"
+
+#include <QDir>
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     setWindowTitle("Dummy Editor");
@@ -20,10 +23,66 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     // 4. Wiring (The Logic)
     // Connect Sidebar -> Editor
     connect(m_sidebar, &ProjectSidebar::fileClicked, this, &MainWindow::onFileClicked);
+    connect(m_sidebar, &ProjectSidebar::filesOpenRequested, m_editorArea, &EditorArea::openFileList);
 
     setupMenu();
 }
 
+bool MainWindow::event(QEvent *event) {
+    const bool result = QMainWindow::event(event);
+    if (event->type() == QEvent::Paint && !m_firstPaintSeen) {
+        m_firstPaintSeen = true;
+        StartupTimeline::mark("first paint");
+        // Once the event loop is idle again, i.e. the frame is on screen
+        QTimer::singleShot(0, this, &MainWindow::startDeferredInit);
+    }
+    return result;
+}
+
+// Everything here used to run in the constructor, before the window could
+// show: the file system model, scanning for themes and parsing the current
+// one. The theme is read on a worker; startup counts as done when it's in.
+void MainWindow::startDeferredInit() {
+    m_sidebar->populate();
+    StartupTimeline::mark("sidebar");
+
+    // Definitions of the project in the sidebar, for hover, go to definition
+    // and symbol search. Last run's index is usable at once; the rescan that
+    // catches up with changes runs in the background. Set before any tab
+    // opens: it is also the root the language servers are started in.
+    SymbolIndex::instance()->setRoot(QDir::currentPath());
+
+    // Last run's tabs; only the one in front is read from disk now
+    Session session;
+    if (session.load(Session::defaultPath())) m_editorArea->restoreSession(session);
+    m_sessionRestored = true;
+    const QStringList queued = m_queuedFiles;
+    m_queuedFiles.clear();
+    openFiles(queued);
+    StartupTimeline::mark("session");
+
+    ThemeRegistry *registry = ThemeRegistry::instance();
+    connect(registry, &ThemeRegistry::themeLoaded, this, [this]() {
+        if (StartupTimeline::isFinished()) return;
+        StartupTimeline::mark("theme");
+        StartupTimeline::finish();
+    });
+    registry->preloadCurrentTheme();
+}
+
+void MainWindow::openFiles(const QStringList &files) {
+    if (!m_sessionRestored) {
+        m_queuedFiles += files;
+        return;
+    }
+    m_editorArea->openFileList(files);
+
+    // Forwarded from another invocation: that's where the user is looking
+    if (isMinimized()) showNormal();
+    raise();
+    activateWindow();
+}
+
 void MainWindow::onFileClicked(const QString &filePath) {
     m_editorArea->openFile(filePath);
 }
@@ -32,6 +91,62 @@ void MainWindow::onSaveAction() {
     m_editorArea->saveCurrentFile();
 }
 
+void MainWindow::onGoToLineAction() {
+    m_editorArea->goToLine();
+}
+
+void MainWindow::onFindAction() {
+    m_editorArea->showFindBar(false);
+}
+
+void MainWindow::onReplaceAction() {
+    m_editorArea->showFindBar(true);
+}
+
+void MainWindow::onSymbolSearchAction() {
+    if (!m_symbolSearch) {
+        m_symbolSearch = new SymbolSearchDialog(this);
+        connect(m_symbolSearch, &SymbolSearchDialog::symbolActivated, m_editorArea, &EditorArea::showLocation);
+    }
+    m_symbolSearch->reset();
+    m_symbolSearch->show();
+    m_symbolSearch->raise();
+    m_symbolSearch->activateWindow();
+}
+
+void MainWindow::onMemoryAction() {
+    if (!m_memoryPanel) m_memoryPanel = new MemoryPanel(m_editorArea, this);
+    m_memoryPanel->show();
+    m_memoryPanel->raise();
+    m_memoryPanel->activateWindow();
+}
+
+void MainWindow::closeEvent(QCloseEvent *event) {
+    if (m_sessionRestored && !m_editorArea->session().save(Session::defaultPath())) {
+        qWarning() << "Could not save the session to" << Session::defaultPath();
+    }
+    QMainWindow::closeEvent(event);
+}
+
+void MainWindow::populateThemeMenu() {
+    if (!m_themeMenu->isEmpty()) return;
+    QActionGroup *themeGroup = new QActionGroup(this);
+
+    ThemeRegistry *registry = ThemeRegistry::instance();
+    QStringList names = registry->themeNames();
+    names.sort();
+    for (const QString &name : names) {
+        QAction *act = m_themeMenu->addAction(name);
+        act->setCheckable(true);
+        act->setChecked(name == registry->currentThemeName());
+        themeGroup->addAction(act);
+        connect(act, &QAction::triggered, this, [name]() {
+            ThemeRegistry::instance()->setCurrentTheme(name);
+        });
+    }
+    if (names.isEmpty()) m_themeMenu->addAction("(no themes found)")->setEnabled(false);
+}
+
 void MainWindow::setupMenu() {
     QMenu *fileMenu = menuBar()->addMenu("&File");
 
@@ -44,4 +159,40 @@ void MainWindow::setupMenu() {
     
     // Note: Open/New file are now handled by the Sidebar, 
     // but you could add global menu items calling m_sidebar methods if you made them public.
+
+    QMenu *editMenu = menuBar()->addMenu("&Edit");
+
+    QAction *goToLineAct = new QAction("&Go to Line...", this);
+    goToLineAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_G));
+    connect(goToLineAct, &QAction::triggered, this, &MainWindow::onGoToLineAction);
+
+    QAction *findAct = new QAction("&Find...", this);
+    findAct->setShortcut(QKeySequence::Find);
+    connect(findAct, &QAction::triggered, this, &MainWindow::onFindAction);
+
+    QAction *replaceAct = new QAction("&Replace...", this);
+    replaceAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_H));
+    connect(replaceAct, &QAction::triggered, this, &MainWindow::onReplaceAction);
+
+    editMenu->addAction(findAct);
+    editMenu->addAction(replaceAct);
+    editMenu->addSeparator();
+    editMenu->addAction(goToLineAct);
+
+    QAction *symbolAct = new QAction("Go to &Symbol in Workspace...", this);
+    symbolAct->setShortcut(QKeySequence(Qt::CTRL | Qt::Key_T));
+    connect(symbolAct, &QAction::triggered, this, &MainWindow::onSymbolSearchAction);
+    editMenu->addAction(symbolAct);
+
+    // View > Theme: one checkable entry per theme file found on disk, listed
+    // when the menu is first opened (the disk scan is not startup work).
+    // Themes are parsed on first selection, and every open editor follows the switch.
+    QMenu *viewMenu = menuBar()->addMenu("&View");
+    m_themeMenu = viewMenu->addMenu("&Theme");
+    connect(m_themeMenu, &QMenu::aboutToShow, this, &MainWindow::populateThemeMenu);
+
+    // View > Memory: heap per subsystem and estimates per tab (see MemoryPanel)
+    viewMenu->addSeparator();
+    QAction *memoryAct = viewMenu->addAction("&Memory...");
+    connect(memoryAct, &QAction::triggered, this, &MainWindow::onMemoryAction);
 }
\ No newline at end of file
@@ -6,10 +6,17 @@
 #include <QSplitter>
 #include <QMenuBar>
 #include <QKeySequence>
+#include <QActionGroup>
+#include <QTimer>
+#include <QCloseEvent>
 
 #include "WelcomeWidget.h"
 #include "Highlighter.h"
 #include "CodeEditor.h"
+#include "ThemeRegistry.h"
+#include "MemoryPanel.h"
+#include "SymbolSearchDialog.h"
+#include "StartupTimeline.h"
 
 // We inherit from QMainWindow, not QWidget.
 // QMainWindow gives us a layout with a Menu Bar, Toolbar, and "Central Widget" area.
@@ -19,14 +26,40 @@ class MainWindow : public QMainWindow {
 public:
     explicit MainWindow(QWidget *parent = nullptr);
 
+public slots:
+    // Files from the command line or from another invocation (SingleInstance).
+    // Until the session is restored they are queued, so they open in front of it.
+    void openFiles(const QStringList &files);
+
+protected:
+    // Catches the first paint, to start the deferred part of startup
+    bool event(QEvent *event) override;
+    // Saves the session (open tabs) for the next start
+    void closeEvent(QCloseEvent *event) override;
+
 private slots:
     void onFileClicked(const QString &filePath);
     void onSaveAction();
+    void onGoToLineAction();
+    void onFindAction();
+    void onReplaceAction();
+    void onSymbolSearchAction();
+    void onMemoryAction();
+
+    // Startup work that doesn't need to happen before the first frame
+    void startDeferredInit();
 
 private:
     void setupMenu();
+    void populateThemeMenu();
 
     // Components
     ProjectSidebar *m_sidebar;
     EditorArea *m_editorArea;
+    MemoryPanel *m_memoryPanel = nullptr; // Created on first use
+    SymbolSearchDialog *m_symbolSearch = nullptr; // Created on first use
+    QMenu *m_themeMenu = nullptr;         // Filled when first opened
+    bool m_firstPaintSeen = false;
+    bool m_sessionRestored = false;       // Don't overwrite a session we haven't read
+    QStringList m_queuedFiles;            // openFiles() before the session was restored
 };
\ No newline at end of file
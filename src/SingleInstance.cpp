@@ -0,0 +1,85 @@
+#include "SingleInstance.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDebug>
+
+namespace {
+
+constexpr qint64 kMaxMessageBytes = 1024 * 1024; // Anything longer isn't from us
+constexpr int kProbeTimeoutMs = 200;              // For a running editor to accept
+
+} // namespace
+
+QString SingleInstance::serverName() {
+    QByteArray user = qgetenv("USER");
+    if (user.isEmpty()) user = qgetenv("USERNAME");
+    const QByteArray key = QCryptographicHash::hash(user + '\0' + QDir::homePath().toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex().left(16);
+    return QStringLiteral("qt_editor-") + QString::fromLatin1(key);
+}
+
+bool SingleInstance::forward(const QStringList &files, int timeoutMs) {
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(timeoutMs)) return false;
+
+    QJsonObject message;
+    message["files"] = QJsonArray::fromStringList(files);
+    socket.write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+    if (!socket.waitForBytesWritten(timeoutMs)) return false;
+
+    socket.disconnectFromServer();
+    if (socket.state() != QLocalSocket::UnconnectedState) socket.waitForDisconnected(timeoutMs);
+    return true;
+}
+
+SingleInstance::SingleInstance(QObject *parent) : QObject(parent) {
+    m_server = new QLocalServer(this);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &SingleInstance::onNewConnection);
+}
+
+bool SingleInstance::listen() {
+    const QString name = serverName();
+    if (m_server->listen(name)) return true;
+
+    // The name is taken. If an editor still answers on it (one that started
+    // since our forward(), or was too busy to accept in time) it stays the
+    // running one; only a socket nobody answers on is stale
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(kProbeTimeoutMs)) {
+            probe.disconnectFromServer();
+            return false;
+        }
+
+        QLocalServer::removeServer(name);
+        if (m_server->listen(name)) return true;
+    }
+    qWarning() << "SingleInstance: could not listen on" << name << m_server->errorString();
+    return false;
+}
+
+void SingleInstance::onNewConnection() {
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            if (!socket->canReadLine()) {
+                if (socket->bytesAvailable() > kMaxMessageBytes) socket->abort();
+                return;
+            }
+
+            const QJsonDocument doc = QJsonDocument::fromJson(socket->readLine());
+            QStringList files;
+            for (const QJsonValue &value : doc["files"].toArray()) files << value.toString();
+            emit filesReceived(files);
+        });
+    }
+}
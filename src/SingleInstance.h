@@ -0,0 +1,39 @@
+#pragma once
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+
+// One editor per user. The first instance listens on a local socket (a Unix
+// domain socket, or a named pipe on Windows); later invocations hand it
+// their file arguments and exit before a QApplication is ever created.
+//
+// The message is one line of JSON: {"files": ["/abs/path", ...]}. An empty
+// list just brings the running editor to the front.
+class SingleInstance : public QObject {
+    Q_OBJECT
+
+public:
+    // Per user, so two users on one machine don't open files in each other's editor
+    static QString serverName();
+
+    // Sends 'files' (absolute paths) to a running editor. Returns false if
+    // none answered within 'timeoutMs'. Needs a QCoreApplication.
+    static bool forward(const QStringList &files, int timeoutMs = 500);
+
+    explicit SingleInstance(QObject *parent = nullptr);
+
+    // Starts accepting forwarded files. A socket left behind by an editor
+    // that crashed is removed first. Returns false if another editor is
+    // listening (or listening failed).
+    bool listen();
+
+signals:
+    void filesReceived(const QStringList &files);
+
+private slots:
+    void onNewConnection();
+
+private:
+    QLocalServer *m_server;
+};
@@ -1,10 +1,24 @@
 #include "CodeEditor.h"
+#include "Highlighter.h"
+#include "ThemeRegistry.h"
+#include "DocumentStructure.h"
+#include "BlockData.h"
+#include "Minimap.h"
+#include "UndoHistory.h"
+#include "FindBar.h"
+#include "MemoryAccounting.h"
+#include "SymbolIndex.h"
+#include "LspClient.h"
+#include "utils/TextSearch.h"
+#include "utils/DiffHelpers.h"
+
+#include <QScrollBar>
 
 // =========================================================
 // CodeEditor Implementation
 // =========================================================
 
-CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent) {
+CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent), m_multiCursor(document()) {
     // Enable Mouse Tracking so we get mouseMoveEvent even without clicking
     setMouseTracking(true);
 
@@ -15,7 +29,7 @@ CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent) {
 
     // Setup the Timer
     m_hoverTimer = new QTimer(this);
-    m_hoverTimer->setInterval(3000); // 3 seconds
+    m_hoverTimer->setInterval(500); // Lookups are instant, only the hover has to settle
     m_hoverTimer->setSingleShot(true);
     connect(m_hoverTimer, &QTimer::timeout, this, &CodeEditor::onHoverTimerTimeout);
 
@@ -32,14 +46,35 @@ CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent) {
     connect(this, &QPlainTextEdit::cursorPositionChanged,
             [this](){ lineNumberArea->update(); }); // Highlight current line number
 
+    connect(this, &QPlainTextEdit::cursorPositionChanged,
+            this, &CodeEditor::updateBracketMatch);
+
+    connect(this, &QPlainTextEdit::cursorPositionChanged,
+            this, &CodeEditor::revealCursorBlock);
+
+    // Secondary carets follow edits they didn't make (undo, replace, ...)
+    connect(document(), &QTextDocument::contentsChange, this, [this](int position, int removed, int added) {
+        m_multiCursor.documentChanged(position, removed, added);
+    });
+
+    // Secondary selections are only materialized for the lines on screen
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, [this]() {
+        if (!m_multiCursor.isEmpty()) updateCaretSelections();
+    });
+
     // // Connect updateRequest to handle scrolling smoothly
     // connect(this, &QPlainTextEdit::updateRequest, this, &CodeEditor::updateLineNumberArea);
 
     updateLineNumberAreaWidth(0);
 
+    // Follow View > Theme switches
+    connect(ThemeRegistry::instance(), &ThemeRegistry::currentThemeChanged,
+            this, &CodeEditor::setTheme);
+
     // Default styling for line numbers (fallback)
     m_lineNumberColor = Qt::gray;
     m_lineNumberBgColor = QColor("#282a36"); // Dracula bg
+    m_bracketMatchColor = QColor(98, 114, 164, 110); // Dracula comment, translucent
     
     // Allow scrolling the current line to the center
     // This gives you the "Scroll Beyond Last Line" feel natively.
@@ -54,25 +89,69 @@ CodeEditor::CodeEditor(QWidget *parent) : QPlainTextEdit(parent) {
     // });
 }
 
-void CodeEditor::setTheme(const QHash<QString, QColor> &theme) {
-    // Apply theme colors to the editor
-    QString bg = theme.value("background").name();
-    QString fg = theme.value("foreground").name();
-    this->setStyleSheet(QString("background-color: %1; color: %2;").arg(bg, fg));
+void CodeEditor::setTheme(const Theme *theme) {
+    m_theme = theme;
 
-    // Also update tooltip theme
+    // Tooltip restyles itself lazily
     if (m_customTooltip) {
         m_customTooltip->applyTheme(theme);
     }
 
+    // Background tabs wait for showEvent, so switching themes with many
+    // open files doesn't rehighlight all of them at once.
+    if (isVisible()) applyPendingTheme();
+}
+
+void CodeEditor::applyPendingTheme() {
+    if (!m_theme || m_theme->id == m_appliedThemeId) return;
+    m_appliedThemeId = m_theme->id;
+
+    // A palette is much cheaper than a style sheet (no CSS parse/polish per editor)
+    setPalette(m_theme->editorPalette);
+
     // Store colors for Line Numbers
-    m_lineNumberBgColor = theme.value("background");
-    m_lineNumberColor = theme.value("comment"); // Use comment color for line numbers
+    m_lineNumberBgColor = m_theme->color("background");
+    m_lineNumberColor = m_theme->color("comment"); // Use comment color for line numbers
+
+    m_bracketMatchColor = m_theme->color("comment");
+    m_bracketMatchColor.setAlpha(110);
+    updateBracketMatch();
+
+    // Freshly created highlighters already use this theme; only re-run on a switch
+    if (m_highlighter && m_highlighter->theme() != m_theme) {
+        m_highlighter->setTheme(m_theme);
+        m_highlighter->rehighlight();
+    }
+    if (m_minimap) m_minimap->applyTheme(m_theme);
 
     // Force repaint of line numbers with new colors
     if (lineNumberArea) lineNumberArea->update();
 }
 
+void CodeEditor::showEvent(QShowEvent *e) {
+    applyPendingTheme();
+    QPlainTextEdit::showEvent(e);
+}
+
+void CodeEditor::setHighlighter(Highlighter *highlighter) {
+    m_highlighter = highlighter;
+
+    delete m_minimap;
+    m_minimap = highlighter ? new Minimap(this, highlighter) : nullptr;
+    updateLineNumberAreaWidth(0);
+}
+
+void CodeEditor::setDocumentStructure(DocumentStructure *structure) {
+    m_structure = structure;
+    if (m_structure) {
+        // New fold ranges change which gutter markers are drawn
+        connect(m_structure, &DocumentStructure::structureChanged,
+                lineNumberArea, QOverload<>::of(&QWidget::update));
+    }
+    updateLineNumberAreaWidth(0);
+    updateBracketMatch();
+}
+
 void CodeEditor::wheelEvent(QWheelEvent *e) {
     // Zoom when Ctrl is held
     if (QApplication::keyboardModifiers() == Qt::ControlModifier) {
@@ -91,6 +170,7 @@ void CodeEditor::wheelEvent(QWheelEvent *e) {
 }
 
 void CodeEditor::resizeEvent(QResizeEvent *e) {
+    MemoryAccounting::Scope scope(MemoryAccounting::Layouts);
     QPlainTextEdit::resizeEvent(e);
 
     QRect cr = contentsRect();
@@ -106,12 +186,20 @@ void CodeEditor::resizeEvent(QResizeEvent *e) {
     //     setViewportMargins(leftMargin, 0, 0, bottomMargin);
     // }
 
-    // Only set the LEFT margin for line numbers.
-    setViewportMargins(leftMargin, 0, 0, 0);
+    // LEFT margin for line numbers, RIGHT margin for the minimap.
+    setViewportMargins(leftMargin, 0, m_minimap ? Minimap::kWidth : 0, 0);
 
     // Position the line number widget
     // It stays on the left edge, full height of the CONTENT rect (ignoring bottom margin)
     lineNumberArea->setGeometry(QRect(cr.left(), cr.top(), leftMargin, cr.height()));
+
+    // The minimap sits between the text and the vertical scroll bar
+    if (m_minimap) {
+        QRect vr = viewport()->geometry();
+        m_minimap->setGeometry(QRect(vr.right() + 1, vr.top(), Minimap::kWidth, vr.height()));
+    }
+
+    positionFindBar();
 }
 
 
@@ -126,6 +214,12 @@ void CodeEditor::mouseMoveEvent(QMouseEvent *e) {
     } else {
         m_hoverTimer->stop();
     }
+    cancelHoverRequest(); // The answer would be about another spot
+
+    if (m_boxSelecting && (e->buttons() & Qt::LeftButton)) {
+        updateBoxSelection(e->pos());
+        return;
+    }
 
     QPlainTextEdit::mouseMoveEvent(e);
 }
@@ -136,6 +230,42 @@ void CodeEditor::keyPressEvent(QKeyEvent *e) {
         qDebug() << "CTRL Pressed - Starting Hover Timer";
         m_hoverTimer->start();
     }
+
+    // Multi-cursor commands, and every edit while there are several carets
+    if (handleMultiCursorKey(e)) {
+        e->accept();
+        return;
+    }
+
+    if (e->key() == Qt::Key_F12 && e->modifiers() == Qt::NoModifier) {
+        goToDefinition();
+        e->accept();
+        return;
+    }
+
+    // Undo/Redo go to our own history when there is one
+    if (m_undoHistory && (e->matches(QKeySequence::Undo) || e->matches(QKeySequence::Redo))) {
+        if (e->matches(QKeySequence::Undo)) undoStep();
+        else redoStep();
+        e->accept();
+        return;
+    }
+
+    // F3 / Shift+F3 step through the matches while the find bar is open,
+    // Escape closes it
+    if (m_findBar && m_findBar->isVisible()) {
+        if (e->key() == Qt::Key_F3) {
+            if (e->modifiers() & Qt::ShiftModifier) m_findBar->findPrevious();
+            else m_findBar->findNext();
+            e->accept();
+            return;
+        }
+        if (e->key() == Qt::Key_Escape) {
+            m_findBar->dismiss();
+            e->accept();
+            return;
+        }
+    }
     QPlainTextEdit::keyPressEvent(e);
 }
 
@@ -143,6 +273,7 @@ void CodeEditor::keyReleaseEvent(QKeyEvent *e) {
     // Stop hover timer when Ctrl is released
     if (e->key() == Qt::Key_Control) {
         m_hoverTimer->stop();
+        cancelHoverRequest();
     }
     QPlainTextEdit::keyReleaseEvent(e);
 }
@@ -151,16 +282,99 @@ void CodeEditor::leaveEvent(QEvent *e) {
     // Stop hover timer when mouse leaves
     qDebug() << "Mouse Left - Stopping Hover Timer";
     m_hoverTimer->stop();
+    cancelHoverRequest();
     QPlainTextEdit::leaveEvent(e);
 }
 
 void CodeEditor::onHoverTimerTimeout() {
-    qDebug() << "Hover Timer Timeout occurred";
     // Verify Ctrl is still down then show tooltip
-    if (QGuiApplication::queryKeyboardModifiers() & Qt::ControlModifier) {
-        qDebug() << "CTRL is still held - showing tooltip";
-        m_customTooltip->showTip(QCursor::pos(), "Hello world\n(Click X to close)");
+    if (!(QGuiApplication::queryKeyboardModifiers() & Qt::ControlModifier)) return;
+
+    const QPoint globalPos = QCursor::pos();
+    const QPoint pos = viewport()->mapFromGlobal(globalPos);
+    if (!viewport()->rect().contains(pos)) return;
+    const QTextCursor cursor = cursorForPosition(pos);
+    const QString name = identifierAt(cursor);
+    if (name.isEmpty()) return;
+
+    // The language server knows types and documentation; the project's
+    // symbol index is the fallback when there is none or it has nothing
+    LspClient *client = m_lsp ? m_lsp->client() : nullptr;
+    if (client && !client->isFailed()) {
+        cancelHoverRequest();
+        m_lsp->flush(); // The server must see what's on screen
+        m_hoverRequest = client->hover(
+            m_lsp->filePath(), m_lsp->version(), cursor.blockNumber(), cursor.positionInBlock(), this,
+            [this, globalPos, name](const QString &text) {
+                m_hoverRequest = -1;
+                if (!(QGuiApplication::queryKeyboardModifiers() & Qt::ControlModifier)) return; // Too late
+                if (text.isEmpty()) showSymbolTip(globalPos, name);
+                else m_customTooltip->showTip(globalPos, text);
+            });
+        if (m_hoverRequest >= 0) return;
+    }
+    showSymbolTip(globalPos, name);
+}
+
+void CodeEditor::cancelHoverRequest() {
+    if (m_hoverRequest > 0 && m_lsp && m_lsp->client()) m_lsp->client()->cancel(m_hoverRequest);
+    m_hoverRequest = -1;
+}
+
+void CodeEditor::showSymbolTip(const QPoint &globalPos, const QString &name) {
+    // Every definition of that name in the project (overloads, one per
+    // platform, ...), the first few of them
+    constexpr int kMaxShown = 5;
+    const QVector<SymbolIndex::Symbol> symbols = SymbolIndex::instance()->definitions(name);
+    if (symbols.isEmpty()) return;
+
+    const QString root = SymbolIndex::instance()->root();
+    QStringList parts;
+    for (int i = 0; i < symbols.size() && i < kMaxShown; ++i) {
+        const SymbolIndex::Symbol &symbol = symbols.at(i);
+        QString file = symbol.filePath;
+        if (file.startsWith(root + '/')) file = file.mid(root.size() + 1);
+        parts << QString("%1 %2\n%3\n%4:%5").arg(QString::fromLatin1(SymbolIndex::kindName(symbol.kind)), symbol.name,
+                                                symbol.detail, file).arg(symbol.line + 1);
     }
+    if (symbols.size() > kMaxShown) parts << QString("(%1 more)").arg(symbols.size() - kMaxShown);
+    m_customTooltip->showTip(globalPos, parts.join("\n\n") + "\n\nCtrl+Click or F12: go to definition");
+}
+
+// ---------------------------------
+// Go to Definition
+// ---------------------------------
+
+QString CodeEditor::identifierAt(const QTextCursor &cursor) const {
+    const QString text = cursor.block().text();
+    auto isWordChar = [&text](int i) {
+        const QChar c = text.at(i);
+        return c.isLetterOrNumber() || c == QLatin1Char('_');
+    };
+
+    int start = cursor.positionInBlock();
+    int end = start;
+    while (start > 0 && isWordChar(start - 1)) --start;
+    while (end < text.size() && isWordChar(end)) ++end;
+    if (start == end || text.at(start).isDigit()) return QString();
+    return text.mid(start, end - start);
+}
+
+void CodeEditor::goToDefinition() {
+    goToDefinitionOf(identifierAt(textCursor()));
+}
+
+bool CodeEditor::goToDefinitionOf(const QString &name) {
+    if (name.isEmpty()) return false;
+    const QVector<SymbolIndex::Symbol> symbols = SymbolIndex::instance()->definitions(name);
+    if (symbols.isEmpty()) return false;
+
+    // Several definitions: the hover tooltip lists them, this takes the first
+    const SymbolIndex::Symbol &target = symbols.first();
+    m_hoverTimer->stop();
+    m_customTooltip->hide();
+    emit definitionRequested(target.filePath, target.line, target.column);
+    return true;
 }
 
 // ---------------------------------
@@ -174,15 +388,20 @@ int CodeEditor::lineNumberAreaWidth() {
         max /= 10;
         ++digits;
     }
-    // Width of character '9' in current font + padding
-    int space = 15 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+    // Width of character '9' in current font + padding + fold markers
+    int space = 15 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits + foldMarkerWidth();
     return space;
 }
 
+int CodeEditor::foldMarkerWidth() const {
+    // Only documents with a structure model can fold
+    return m_structure ? fontMetrics().height() : 0;
+}
+
 
 void CodeEditor::updateLineNumberAreaWidth(int /*newBlockCount*/) {
     // We just trigger a margin update, the resizeEvent handles the rest
-    setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+    setViewportMargins(lineNumberAreaWidth(), 0, m_minimap ? Minimap::kWidth : 0, 0);
 }
 
 void CodeEditor::updateLineNumberArea(const QRect &rect, int dy) {
@@ -201,37 +420,695 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event) {
     // Fill background
     painter.fillRect(event->rect(), m_lineNumberBgColor);
 
+    const int currentBlockNumber = textCursor().blockNumber();
+    const int foldWidth = foldMarkerWidth();
+    const int numberRight = lineNumberArea->width() - foldWidth - 5;
+    const int lineHeight = fontMetrics().height();
+
+    QFont normalFont = font();
+    QFont boldFont = font();
+    boldFont.setBold(true);
+
     // Iterate over visible blocks
     QTextBlock block = firstVisibleBlock();
-    int blockNumber = block.blockNumber();
     int top = (int) blockBoundingGeometry(block).translated(contentOffset()).top();
     int bottom = top + (int) blockBoundingRect(block).height();
 
     // Loop until past the paint event area
     while (block.isValid() && top <= event->rect().bottom()) {
-        if (block.isVisible() && bottom >= event->rect().top()) {
+        if (bottom >= event->rect().top()) {
+            // blockNumber() is a tree lookup; we can't count along because
+            // folded regions are skipped below
+            const int blockNumber = block.blockNumber();
             QString number = QString::number(blockNumber + 1);
             
-            // Highlight current line number
-            bool isCurrentLine = (textCursor().blockNumber() == blockNumber);
+            // Highlight current line number (bold font)
+            bool isCurrentLine = (currentBlockNumber == blockNumber);
             painter.setPen(isCurrentLine ? Qt::white : m_lineNumberColor);
-            
-            // Bold font for current line
-            QFont f = font();
-            if (isCurrentLine) f.setBold(true);
-            painter.setFont(f);
+            painter.setFont(isCurrentLine ? boldFont : normalFont);
+
+            painter.drawText(0, top, numberRight, lineHeight, Qt::AlignRight, number);
 
-            painter.drawText(0, top, lineNumberArea->width() - 5, fontMetrics().height(),
-                             Qt::AlignRight, number);
+            // Fold marker: a triangle pointing right (folded) or down (open)
+            auto *data = static_cast<BlockData *>(block.userData());
+            const bool folded = data && data->folded;
+            if (foldWidth > 0 && (folded || m_structure->foldRangeAt(blockNumber).startBlock >= 0)) {
+                const QRectF box(numberRight + 5, top, foldWidth, lineHeight);
+                const qreal r = lineHeight / 5.0;
+                const QPointF c = box.center();
+                QPolygonF triangle;
+                if (folded) {
+                    triangle << QPointF(c.x() - r * 0.6, c.y() - r) << QPointF(c.x() + r * 0.8, c.y())
+                             << QPointF(c.x() - r * 0.6, c.y() + r);
+                } else {
+                    triangle << QPointF(c.x() - r, c.y() - r * 0.6) << QPointF(c.x() + r, c.y() - r * 0.6)
+                             << QPointF(c.x(), c.y() + r * 0.8);
+                }
+                painter.setRenderHint(QPainter::Antialiasing, true);
+                painter.setPen(Qt::NoPen);
+                painter.setBrush(m_lineNumberColor);
+                painter.drawPolygon(triangle);
+                painter.setRenderHint(QPainter::Antialiasing, false);
+            }
         }
 
-        block = block.next();
+        block = nextVisibleBlock(block);
         top = bottom;
         bottom = top + (int) blockBoundingRect(block).height();
-        ++blockNumber;
     }
 }
 
+void CodeEditor::lineNumberAreaMousePressEvent(QMouseEvent *event) {
+    // Clicks on the fold marker column toggle the fold of that line
+    const int foldWidth = foldMarkerWidth();
+    if (foldWidth == 0 || event->pos().x() < lineNumberArea->width() - foldWidth) return;
+
+    // The gutter shares the viewport's vertical coordinates
+    QTextBlock block = cursorForPosition(QPoint(0, event->pos().y())).block();
+    toggleFold(block);
+}
+
+// ---------------------------------
+// Folding
+// ---------------------------------
+
+QTextBlock CodeEditor::nextVisibleBlock(const QTextBlock &block) const {
+    QTextBlock next = block.next();
+    if (next.isValid() && !next.isVisible()) {
+        // Hidden blocks have a line count of 0, so the block that owns the line
+        // after this one is the next visible block. This is one lookup in the
+        // document's block tree, however many blocks the fold hides.
+        next = document()->findBlockByLineNumber(block.firstLineNumber() + qMax(1, block.lineCount()));
+    }
+    return next;
+}
+
+void CodeEditor::relayoutBlocks(const QTextBlock &first, const QTextBlock &last) {
+    // Makes the layout pick up the new visibility and line counts, which also
+    // resizes the document (scroll bar range)
+    const int from = first.position();
+    document()->markContentsDirty(from, last.position() + last.length() - from);
+    viewport()->update();
+    lineNumberArea->update();
+}
+
+void CodeEditor::rehighlightPending(const QVector<QTextBlock> &blocks) {
+    if (!m_highlighter) return;
+    for (const QTextBlock &block : blocks) {
+        m_highlighter->rehighlightBlock(block);
+    }
+}
+
+bool CodeEditor::foldBlock(const QTextBlock &header) {
+    if (!m_structure || !header.isValid() || !header.isVisible()) return false;
+
+    DocumentStructure::FoldRange range = m_structure->foldRangeAt(header.blockNumber());
+    if (range.startBlock < 0) return false;
+
+    auto *data = static_cast<BlockData *>(header.userData());
+    if (!data) return false; // Never highlighted, so it has no fold range yet
+    if (data->folded) return true;
+
+    const int count = range.endBlock - range.startBlock;
+    QTextBlock block = header.next();
+    QTextBlock last = header;
+    for (int i = 0; i < count && block.isValid(); ++i) {
+        block.setVisible(false);
+        block.setLineCount(0);
+        last = block;
+        block = block.next();
+    }
+    data->folded = true;
+    data->foldedBlocks = count;
+
+    relayoutBlocks(header, last);
+
+    // Keep the cursor out of hidden text
+    if (!textCursor().block().isVisible()) {
+        QTextCursor cursor = textCursor();
+        cursor.setPosition(header.position() + header.length() - 1);
+        setTextCursor(cursor);
+    }
+    return true;
+}
+
+bool CodeEditor::unfoldBlock(const QTextBlock &header) {
+    auto *data = header.isValid() ? static_cast<BlockData *>(header.userData()) : nullptr;
+    if (!data || !data->folded) return false;
+    data->folded = false;
+
+    // The hidden run ends at the next visible block. Nested folds inside it
+    // stay closed, so their own hidden blocks are stepped over.
+    const QTextBlock end = nextVisibleBlock(header);
+    QVector<QTextBlock> pending;
+    QTextBlock block = header.next();
+    QTextBlock last = header;
+    while (block.isValid() && block != end) {
+        block.setVisible(true);
+        block.setLineCount(1); // Corrected by the relayout below
+        last = block;
+
+        auto *blockData = static_cast<BlockData *>(block.userData());
+        if (blockData && blockData->formatsPending) pending.append(block);
+
+        if (blockData && blockData->folded) {
+            for (int i = 0; i < blockData->foldedBlocks && block.next().isValid() && block.next() != end; ++i) {
+                block = block.next();
+            }
+        }
+        block = block.next();
+    }
+
+    relayoutBlocks(header, last);
+    rehighlightPending(pending);
+    return true;
+}
+
+void CodeEditor::toggleFold(const QTextBlock &header) {
+    if (!unfoldBlock(header)) foldBlock(header);
+}
+
+void CodeEditor::ensureBlockVisible(QTextBlock block) {
+    // A hidden block's first line number is where its fold header's lines end,
+    // so the header is one lookup away. Nested folds take one round each.
+    for (int depth = 0; block.isValid() && !block.isVisible() && depth < 256; ++depth) {
+        QTextBlock header = document()->findBlockByLineNumber(block.firstLineNumber() - 1);
+        if (!unfoldBlock(header)) {
+            // Fold bookkeeping out of sync with the document: show just this block
+            block.setVisible(true);
+            block.setLineCount(1);
+            relayoutBlocks(block, block);
+            auto *data = static_cast<BlockData *>(block.userData());
+            if (data && data->formatsPending) rehighlightPending({block});
+            break;
+        }
+    }
+}
+
+void CodeEditor::revealCursorBlock() {
+    QTextBlock block = textCursor().block();
+    if (!block.isVisible()) ensureBlockVisible(block);
+}
+
+void CodeEditor::foldAll() {
+    if (!m_structure || m_structure->foldRanges().isEmpty()) return;
+
+    // One pass over the document: ranges are sorted by start block, and a
+    // block is hidden while it lies inside any range opened above it
+    const QVector<DocumentStructure::FoldRange> &ranges = m_structure->foldRanges();
+    int next = 0;
+    int hideUntil = -1;
+    int number = 0;
+    for (QTextBlock block = document()->begin(); block.isValid(); block = block.next(), ++number) {
+        if (number <= hideUntil && block.isVisible()) {
+            block.setVisible(false);
+            block.setLineCount(0);
+        }
+
+        while (next < ranges.size() && ranges[next].startBlock < number) ++next;
+        if (next < ranges.size() && ranges[next].startBlock == number) {
+            auto *data = static_cast<BlockData *>(block.userData());
+            if (data) {
+                data->folded = true;
+                data->foldedBlocks = ranges[next].endBlock - number;
+                hideUntil = qMax(hideUntil, ranges[next].endBlock);
+            }
+        }
+    }
+
+    relayoutBlocks(document()->begin(), document()->lastBlock());
+
+    // Park the cursor on the header of the fold that swallowed it
+    QTextBlock cursorBlock = textCursor().block();
+    if (!cursorBlock.isVisible()) {
+        QTextBlock header = document()->findBlockByLineNumber(cursorBlock.firstLineNumber() - 1);
+        QTextCursor cursor = textCursor();
+        cursor.setPosition(header.position() + header.length() - 1);
+        setTextCursor(cursor);
+    }
+}
+
+void CodeEditor::unfoldAll() {
+    QVector<QTextBlock> pending;
+    for (QTextBlock block = document()->begin(); block.isValid(); block = block.next()) {
+        auto *data = static_cast<BlockData *>(block.userData());
+        if (data) data->folded = false;
+        if (!block.isVisible()) {
+            block.setVisible(true);
+            block.setLineCount(1);
+            if (data && data->formatsPending) pending.append(block);
+        }
+    }
+    relayoutBlocks(document()->begin(), document()->lastBlock());
+    rehighlightPending(pending);
+}
+
+void CodeEditor::goToLine(int lineNumber) {
+    // findBlockByNumber is a tree lookup, not a walk from the top
+    QTextBlock block = document()->findBlockByNumber(lineNumber - 1);
+    if (!block.isValid()) block = document()->lastBlock();
+
+    ensureBlockVisible(block);
+
+    QTextCursor cursor(block);
+    setTextCursor(cursor);
+    centerCursor();
+    setFocus();
+}
+
+// ---------------------------------
+// Bracket Matching
+// ---------------------------------
+
+void CodeEditor::updateBracketMatch() {
+    m_bracketSelections.clear();
+
+    if (m_structure) {
+        int pos = textCursor().position();
+
+        // The bracket right after the cursor wins over the one right before it
+        for (int candidate : {pos, pos - 1}) {
+            if (candidate < 0) continue;
+            int match = m_structure->matchingBracket(candidate);
+            if (match < 0) continue;
+
+            for (int p : {candidate, match}) {
+                QTextEdit::ExtraSelection selection;
+                selection.format.setBackground(m_bracketMatchColor);
+                selection.cursor = QTextCursor(document());
+                selection.cursor.setPosition(p);
+                selection.cursor.setPosition(p + 1, QTextCursor::KeepAnchor);
+                m_bracketSelections.append(selection);
+            }
+            break;
+        }
+    }
+
+    updateExtraSelections();
+}
+
+void CodeEditor::updateExtraSelections() {
+    // Later entries are drawn on top: search hits < bracket match < carets
+    setExtraSelections(m_searchSelections + m_bracketSelections + m_caretSelections);
+}
+
+// ---------------------------------
+// Find / Replace
+// ---------------------------------
+
+void CodeEditor::showFindBar(bool withReplace) {
+    if (!m_findBar) m_findBar = new FindBar(this);
+    m_findBar->open(withReplace);
+}
+
+void CodeEditor::positionFindBar() {
+    if (!m_findBar || !m_findBar->isVisible()) return;
+
+    // Top right corner of the text area, clear of the minimap and scroll bar
+    const QRect vr = viewport()->geometry();
+    const int width = qMin(m_findBar->sizeHint().width(), vr.width());
+    m_findBar->setGeometry(vr.right() - width - 8, vr.top(), width, m_findBar->sizeHint().height());
+}
+
+void CodeEditor::setSearchSelections(const QList<QTextEdit::ExtraSelection> &selections) {
+    m_searchSelections = selections;
+    updateExtraSelections();
+}
+
+// ---------------------------------
+// Multi-cursor
+// ---------------------------------
+
+MultiCursor::Caret CodeEditor::primaryCaret() const {
+    QTextCursor cursor = textCursor();
+    return MultiCursor::Caret{cursor.anchor(), cursor.position()};
+}
+
+void CodeEditor::applyCarets(const MultiCursor::Caret &primary) {
+    QTextCursor cursor(document());
+    cursor.setPosition(primary.anchor);
+    cursor.setPosition(primary.position, QTextCursor::KeepAnchor);
+    setTextCursor(cursor);
+
+    updateCaretSelections();
+    viewport()->update();
+}
+
+void CodeEditor::clearExtraCursors() {
+    if (m_multiCursor.isEmpty()) return;
+    m_multiCursor.clear();
+    updateCaretSelections();
+    viewport()->update();
+}
+
+int CodeEditor::tabWidthInColumns() const {
+    const qreal space = fontMetrics().horizontalAdvance(QLatin1Char(' '));
+    return qMax(1, qRound(tabStopDistance() / qMax<qreal>(1.0, space)));
+}
+
+int CodeEditor::columnAtPoint(const QPoint &pos) const {
+    // Columns may lie past the end of a line, so they come from the x
+    // coordinate rather than from a cursor position
+    const qreal space = qMax<qreal>(1.0, fontMetrics().horizontalAdvance(QLatin1Char(' ')));
+    const qreal x = pos.x() - contentOffset().x() - document()->documentMargin();
+    return qMax(0, qRound(x / space));
+}
+
+void CodeEditor::visibleRange(int *from, int *to) const {
+    QTextBlock last = cursorForPosition(QPoint(viewport()->width() - 1, viewport()->height() - 1)).block();
+    *from = firstVisibleBlock().position();
+    *to = last.position() + last.length();
+}
+
+void CodeEditor::updateCaretSelections() {
+    m_caretSelections.clear();
+
+    if (!m_multiCursor.isEmpty()) {
+        // The carets are sorted, so the ones on screen are a contiguous slice
+        int from = 0;
+        int to = 0;
+        int first = 0;
+        int last = 0;
+        visibleRange(&from, &to);
+        m_multiCursor.indexRange(from, to, &first, &last);
+
+        const QVector<MultiCursor::Caret> &carets = m_multiCursor.carets();
+        for (int i = first; i < last; ++i) {
+            if (!carets[i].hasSelection()) continue;
+            QTextEdit::ExtraSelection selection;
+            selection.format.setBackground(palette().highlight());
+            selection.format.setForeground(palette().highlightedText());
+            selection.cursor = QTextCursor(document());
+            selection.cursor.setPosition(carets[i].anchor);
+            selection.cursor.setPosition(carets[i].position, QTextCursor::KeepAnchor);
+            m_caretSelections.append(selection);
+        }
+    }
+
+    updateExtraSelections();
+}
+
+void CodeEditor::paintEvent(QPaintEvent *e) {
+    // Blocks are laid out lazily, when they are first painted
+    MemoryAccounting::Scope scope(MemoryAccounting::Layouts);
+    QPlainTextEdit::paintEvent(e);
+    if (m_multiCursor.isEmpty()) return;
+
+    // Only the carets on screen are looked at, however many there are
+    int from = 0;
+    int to = 0;
+    int first = 0;
+    int last = 0;
+    visibleRange(&from, &to);
+    m_multiCursor.indexRange(from, to, &first, &last);
+
+    QPainter painter(viewport());
+    QTextCursor probe(document());
+    const QVector<MultiCursor::Caret> &carets = m_multiCursor.carets();
+    for (int i = first; i < last; ++i) {
+        probe.setPosition(carets[i].position);
+        if (!probe.block().isVisible()) continue;
+        QRect r = cursorRect(probe);
+        painter.fillRect(r.x(), r.y(), qMax(1, cursorWidth()), r.height(), palette().text());
+    }
+}
+
+void CodeEditor::mousePressEvent(QMouseEvent *e) {
+    if (e->button() == Qt::LeftButton && (e->modifiers() & Qt::AltModifier)) {
+        if (e->modifiers() & Qt::ShiftModifier) {
+            // Alt+Shift+Drag: box selection anchored here
+            m_boxSelecting = true;
+            m_boxAnchorBlock = cursorForPosition(e->pos()).blockNumber();
+            m_boxAnchorColumn = columnAtPoint(e->pos());
+            updateBoxSelection(e->pos());
+        } else {
+            // Alt+Click: the clicked spot becomes the primary caret, the old
+            // primary stays as a secondary one
+            QVector<MultiCursor::Caret> carets = m_multiCursor.carets();
+            carets.append(primaryCaret());
+            const int pos = cursorForPosition(e->pos()).position();
+            MultiCursor::Caret primary{pos, pos};
+            m_multiCursor.setCarets(carets, &primary);
+            applyCarets(primary);
+        }
+        e->accept();
+        return;
+    }
+
+    // Ctrl+Click: go to the definition of the clicked identifier
+    if (e->button() == Qt::LeftButton && (e->modifiers() & Qt::ControlModifier)
+        && goToDefinitionOf(identifierAt(cursorForPosition(e->pos())))) {
+        e->accept();
+        return;
+    }
+
+    // A plain click goes back to a single caret, and ends the typing group
+    if (e->button() == Qt::LeftButton) clearExtraCursors();
+    if (m_undoHistory) m_undoHistory->breakCoalescing();
+    QPlainTextEdit::mousePressEvent(e);
+}
+
+void CodeEditor::mouseReleaseEvent(QMouseEvent *e) {
+    if (m_boxSelecting) {
+        m_boxSelecting = false;
+        e->accept();
+        return;
+    }
+    QPlainTextEdit::mouseReleaseEvent(e);
+}
+
+void CodeEditor::updateBoxSelection(const QPoint &pos) {
+    const QTextBlock current = cursorForPosition(pos).block();
+    const int column = columnAtPoint(pos);
+    const int tabWidth = tabWidthInColumns();
+
+    const int firstNumber = qMin(m_boxAnchorBlock, current.blockNumber());
+    const int lastPosition = document()->findBlockByNumber(qMax(m_boxAnchorBlock, current.blockNumber())).position();
+
+    // One caret per (unfolded) line; the line under the mouse is the primary
+    QVector<MultiCursor::Caret> carets;
+    MultiCursor::Caret primary;
+    for (QTextBlock block = document()->findBlockByNumber(firstNumber);
+         block.isValid() && block.position() <= lastPosition; block = nextVisibleBlock(block)) {
+        MultiCursor::Caret caret{MultiCursor::positionAtColumn(block, m_boxAnchorColumn, tabWidth),
+                                 MultiCursor::positionAtColumn(block, column, tabWidth)};
+        if (block == current) primary = caret;
+        else carets.append(caret);
+    }
+
+    m_multiCursor.setCarets(carets, &primary);
+    applyCarets(primary);
+}
+
+void CodeEditor::addCaretVertically(int direction) {
+    MultiCursor::Caret primary = primaryCaret();
+    QVector<MultiCursor::Caret> carets = m_multiCursor.carets();
+
+    // Grow the column from its outermost caret, at the primary caret's column
+    int edge = primary.position;
+    for (const MultiCursor::Caret &caret : std::as_const(carets)) {
+        edge = direction < 0 ? qMin(edge, caret.position) : qMax(edge, caret.position);
+    }
+    const int tabWidth = tabWidthInColumns();
+    const int column = MultiCursor::columnAt(textCursor().block(), primary.position, tabWidth);
+
+    QTextBlock block = document()->findBlock(edge);
+    do {
+        block = direction < 0 ? block.previous() : block.next();
+    } while (block.isValid() && !block.isVisible());
+    if (!block.isValid()) return;
+
+    const int pos = MultiCursor::positionAtColumn(block, column, tabWidth);
+    carets.append(MultiCursor::Caret{pos, pos});
+    m_multiCursor.setCarets(carets, &primary);
+    applyCarets(primary);
+}
+
+void CodeEditor::addNextOccurrence() {
+    QTextCursor cursor = textCursor();
+    if (!cursor.hasSelection()) {
+        // First press selects the word, like most editors
+        cursor.select(QTextCursor::WordUnderCursor);
+        setTextCursor(cursor);
+        return;
+    }
+
+    // Search after the most recently added caret (the primary), wrapping around
+    const QString needle = cursor.selectedText();
+    QTextCursor found = document()->find(needle, cursor.selectionEnd(), QTextDocument::FindCaseSensitively);
+    if (found.isNull()) found = document()->find(needle, 0, QTextDocument::FindCaseSensitively);
+    if (found.isNull()) return;
+
+    QVector<MultiCursor::Caret> carets = m_multiCursor.carets();
+    carets.append(primaryCaret());
+    MultiCursor::Caret primary{found.selectionStart(), found.selectionEnd()};
+    m_multiCursor.setCarets(carets, &primary); // A match that already has a caret is merged
+    applyCarets(primary);
+}
+
+void CodeEditor::selectAllOccurrences() {
+    QTextCursor cursor = textCursor();
+    if (!cursor.hasSelection()) cursor.select(QTextCursor::WordUnderCursor);
+
+    const QString needle = cursor.selectedText();
+    if (needle.isEmpty()) return;
+
+    // One vectorized scan of the raw text; its positions are document positions
+    const QString text = document()->toRawText();
+    QVector<int> positions;
+    TextSearch::findAll(text, needle, 0, text.size(), Qt::CaseSensitive, &positions);
+
+    QVector<MultiCursor::Caret> carets;
+    for (int at : std::as_const(positions)) {
+        if (at != cursor.selectionStart()) carets.append(MultiCursor::Caret{at, at + int(needle.size())});
+    }
+
+    MultiCursor::Caret primary{cursor.anchor(), cursor.position()};
+    m_multiCursor.setCarets(carets, &primary);
+    applyCarets(primary);
+}
+
+bool CodeEditor::handleMultiCursorKey(QKeyEvent *e) {
+    const Qt::KeyboardModifiers mods = e->modifiers() & ~Qt::KeypadModifier;
+
+    // Commands that create carets
+    if (e->key() == Qt::Key_D && mods == Qt::ControlModifier) {
+        addNextOccurrence();
+        return true;
+    }
+    if (e->key() == Qt::Key_L && mods == (Qt::ControlModifier | Qt::ShiftModifier)) {
+        selectAllOccurrences();
+        return true;
+    }
+    if ((e->key() == Qt::Key_Up || e->key() == Qt::Key_Down) && mods == (Qt::AltModifier | Qt::ShiftModifier)) {
+        addCaretVertically(e->key() == Qt::Key_Up ? -1 : 1);
+        return true;
+    }
+
+    if (m_multiCursor.isEmpty()) return false;
+
+    switch (e->key()) {
+    case Qt::Key_Control:
+    case Qt::Key_Shift:
+    case Qt::Key_Alt:
+    case Qt::Key_Meta:
+        return false;
+    case Qt::Key_Escape:
+        clearExtraCursors();
+        return true;
+    default:
+        break;
+    }
+
+    MultiCursor::Caret primary = primaryCaret();
+
+    if (e->matches(QKeySequence::Undo) || e->matches(QKeySequence::Redo)) {
+        // Undo restores text, not carets; continue with the restored primary
+        clearExtraCursors();
+        return false;
+    }
+    if (e->matches(QKeySequence::Copy) || e->matches(QKeySequence::Cut)) {
+        QApplication::clipboard()->setText(m_multiCursor.selectedTexts(primary).join(QLatin1Char('\n')));
+        if (e->matches(QKeySequence::Cut)) m_multiCursor.insert(&primary, QStringList{QString()});
+        applyCarets(primary);
+        return true;
+    }
+    if (e->matches(QKeySequence::Paste)) {
+        QString clip = QApplication::clipboard()->text();
+        clip.replace("\r\n", "\n");
+        // One line per caret when the counts match (a multi-caret copy), else the whole text each
+        QStringList lines = clip.split(QLatin1Char('\n'));
+        if (lines.size() != m_multiCursor.carets().size() + 1) lines = QStringList{clip};
+        m_multiCursor.insert(&primary, lines);
+        applyCarets(primary);
+        return true;
+    }
+
+    const QTextCursor::MoveMode mode = mods.testFlag(Qt::ShiftModifier) ? QTextCursor::KeepAnchor : QTextCursor::MoveAnchor;
+    const bool word = mods.testFlag(Qt::ControlModifier);
+    switch (e->key()) {
+    case Qt::Key_Backspace:
+    case Qt::Key_Delete:
+        m_multiCursor.erase(&primary, e->key() == Qt::Key_Delete);
+        applyCarets(primary);
+        return true;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        m_multiCursor.insert(&primary, QStringList{QStringLiteral("\n")});
+        applyCarets(primary);
+        return true;
+    case Qt::Key_Left:
+        m_multiCursor.move(&primary, word ? QTextCursor::WordLeft : QTextCursor::Left, mode);
+        applyCarets(primary);
+        return true;
+    case Qt::Key_Right:
+        m_multiCursor.move(&primary, word ? QTextCursor::WordRight : QTextCursor::Right, mode);
+        applyCarets(primary);
+        return true;
+    case Qt::Key_Up:
+        m_multiCursor.move(&primary, QTextCursor::Up, mode);
+        applyCarets(primary);
+        return true;
+    case Qt::Key_Down:
+        m_multiCursor.move(&primary, QTextCursor::Down, mode);
+        applyCarets(primary);
+        return true;
+    case Qt::Key_Home:
+        m_multiCursor.move(&primary, QTextCursor::StartOfLine, mode);
+        applyCarets(primary);
+        return true;
+    case Qt::Key_End:
+        m_multiCursor.move(&primary, QTextCursor::EndOfLine, mode);
+        applyCarets(primary);
+        return true;
+    default:
+        break;
+    }
+
+    // Typing: the same text at every caret, as one edit block
+    const QString text = e->text();
+    if (!text.isEmpty() && !(mods & (Qt::ControlModifier | Qt::AltModifier))
+        && (text.at(0).isPrint() || text.at(0) == QLatin1Char('\t'))) {
+        m_multiCursor.insert(&primary, QStringList{text});
+        applyCarets(primary);
+        return true;
+    }
+
+    // Anything else (Ctrl+A, ...) is a single-caret command
+    clearExtraCursors();
+    return false;
+}
+
+// ---------------------------------
+// Undo History
+// ---------------------------------
+
+void CodeEditor::undoStep() {
+    if (!m_undoHistory) {
+        undo();
+        return;
+    }
+    int position = m_undoHistory->undo();
+    if (position < 0) return;
+
+    QTextCursor cursor = textCursor();
+    cursor.setPosition(position);
+    setTextCursor(cursor);
+}
+
+void CodeEditor::redoStep() {
+    if (!m_undoHistory) {
+        redo();
+        return;
+    }
+    int position = m_undoHistory->redo();
+    if (position < 0) return;
+
+    QTextCursor cursor = textCursor();
+    cursor.setPosition(position);
+    setTextCursor(cursor);
+}
+
 // ---------------------------------
 // Paste with Diff Logic
 // ---------------------------------
@@ -241,6 +1118,22 @@ void CodeEditor::contextMenuEvent(QContextMenuEvent *e) {
     // Build standard context menu
     QMenu *menu = createStandardContextMenu();
 
+    // The standard Undo/Redo entries talk to the document's undo stack, which
+    // is switched off when we keep our own history
+    if (m_undoHistory) {
+        for (QAction *action : menu->actions()) {
+            if (action->objectName() == QLatin1String("edit-undo")) {
+                action->disconnect();
+                action->setEnabled(m_undoHistory->canUndo());
+                connect(action, &QAction::triggered, this, &CodeEditor::undoStep);
+            } else if (action->objectName() == QLatin1String("edit-redo")) {
+                action->disconnect();
+                action->setEnabled(m_undoHistory->canRedo());
+                connect(action, &QAction::triggered, this, &CodeEditor::redoStep);
+            }
+        }
+    }
+
     // Add custom "Paste with Diff" action
     menu->addSeparator();
     
@@ -253,6 +1146,24 @@ void CodeEditor::contextMenuEvent(QContextMenuEvent *e) {
     
     connect(diffAction, &QAction::triggered, this, &CodeEditor::onPasteWithDiff);
 
+    // Go to Definition (of the identifier under the mouse)
+    menu->addSeparator();
+    const QString name = identifierAt(cursorForPosition(viewport()->mapFromGlobal(e->globalPos())));
+    QAction *definitionAction = menu->addAction("Go to Definition");
+    definitionAction->setShortcut(QKeySequence(Qt::Key_F12));
+    definitionAction->setEnabled(!name.isEmpty() && !SymbolIndex::instance()->definitions(name).isEmpty());
+    connect(definitionAction, &QAction::triggered, this, [this, name]() { goToDefinitionOf(name); });
+
+    // Folding
+    if (m_structure) {
+        menu->addSeparator();
+        QAction *foldAllAction = menu->addAction("Fold All");
+        foldAllAction->setEnabled(!m_structure->foldRanges().isEmpty());
+        connect(foldAllAction, &QAction::triggered, this, &CodeEditor::foldAll);
+        QAction *unfoldAllAction = menu->addAction("Unfold All");
+        connect(unfoldAllAction, &QAction::triggered, this, &CodeEditor::unfoldAll);
+    }
+
     // Show menu then clean up
     menu->exec(e->globalPos());
     delete menu;
@@ -294,6 +1205,55 @@ void CodeEditor::onPasteWithDiff() {
 }
 
 
+// Applies the hunks back to front so the positions of earlier ones stay
+// valid. Lines are blocks; a line's text is followed by a newline unless it
+// is the last one, so hunks that reach the end of the document take the
+// newline before them instead.
+int CodeEditor::reloadText(const QString &text) {
+    QString current = document()->toRawText();
+    current.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+    const QStringList oldLines = current.split(QLatin1Char('\n'));
+    const QStringList newLines = text.split(QLatin1Char('\n'));
+
+    const QVector<DiffHelpers::LineHunk> hunks = DiffHelpers::computeHunks(oldLines, newLines);
+    if (hunks.isEmpty()) return 0;
+
+    const int end = document()->characterCount() - 1;
+    auto lineStart = [this, end](int line) {
+        const QTextBlock block = document()->findBlockByNumber(line);
+        return block.isValid() ? block.position() : end;
+    };
+
+    QTextCursor cursor(document());
+    cursor.beginEditBlock();
+    for (int i = hunks.size() - 1; i >= 0; --i) {
+        const DiffHelpers::LineHunk &hunk = hunks.at(i);
+        const QStringList lines = newLines.mid(hunk.newStart, hunk.newCount);
+
+        int from = lineStart(hunk.oldStart);
+        int to = 0;
+        QString replacement;
+        if (hunk.oldStart + hunk.oldCount < oldLines.size()) {
+            to = lineStart(hunk.oldStart + hunk.oldCount);
+            for (const QString &line : lines) replacement += line + QLatin1Char('\n');
+        } else {
+            // Through the end of the document (and so of the new text, too)
+            to = end;
+            if (hunk.oldStart > 0) {
+                if (hunk.oldStart < oldLines.size()) --from; // Take the newline of the line before
+                if (!lines.isEmpty()) replacement = QLatin1Char('\n');
+            }
+            replacement += lines.join(QLatin1Char('\n'));
+        }
+
+        cursor.setPosition(from);
+        cursor.setPosition(to, QTextCursor::KeepAnchor);
+        cursor.insertText(replacement);
+    }
+    cursor.endEditBlock();
+    return hunks.size();
+}
+
 
 // =========================================================
 // LineNumberArea Implementation
@@ -307,4 +1267,8 @@ QSize LineNumberArea::sizeHint() const {
 
 void LineNumberArea::paintEvent(QPaintEvent *event) {
     codeEditor->lineNumberAreaPaintEvent(event);
+}
+
+void LineNumberArea::mousePressEvent(QMouseEvent *event) {
+    codeEditor->lineNumberAreaMousePressEvent(event);
 }
\ No newline at end of file
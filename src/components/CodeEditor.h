@@ -14,28 +14,108 @@
 
 #include <QPainter>
 #include <QTextBlock>
+#include <QPointer>
 
 #include "CommonTooltip.h"
 #include "DiffViewDialog.h"
+#include "MultiCursor.h"
+#include "LspDocument.h"
+#include "utils/TextCodec.h"
+
+struct Theme;
+class Highlighter;
+class DocumentStructure;
+class Minimap;
+class UndoHistory;
+class FindBar;
 
 class CodeEditor : public QPlainTextEdit {
     Q_OBJECT
 public:
     explicit CodeEditor(QWidget *parent = nullptr);
 
-    // Method to set theme
-    void setTheme(const QHash<QString, QColor> &theme);
+    // Method to set theme. Hidden editors only remember it and apply it
+    // (palette + rehighlight) when they are next shown.
+    void setTheme(const Theme *theme);
+
+    // The highlighter attached to our document, re-themed together with us.
+    // Also adds the minimap, which is drawn from the highlighter's summaries.
+    void setHighlighter(Highlighter *highlighter);
+
+    // Compact undo history that replaces the document's own undo stack, may be null
+    void setUndoHistory(UndoHistory *history) { m_undoHistory = history; }
+    UndoHistory *undoHistory() const { return m_undoHistory; }
+    void undoStep();
+    void redoStep();
+
+    // Encoding and line endings the file was read with; saving writes them back
+    void setFileFormat(const TextCodec::Format &format) { m_fileFormat = format; }
+    const TextCodec::Format &fileFormat() const { return m_fileFormat; }
+
+    // Turns the text into 'text' (the file as it is on disk now) by replacing
+    // only the lines that differ, in one edit block: cursor, scroll position,
+    // undo history and the highlighting of untouched lines are kept.
+    // Returns the number of hunks applied (0 if nothing changed).
+    int reloadText(const QString &text);
+
+    // Structural model of the document (folds, brackets, outline), may be null
+    void setDocumentStructure(DocumentStructure *structure);
+    DocumentStructure *documentStructure() const { return m_structure; }
 
     // Helper to be called by LineNumberArea
     void lineNumberAreaPaintEvent(QPaintEvent *event);
+    void lineNumberAreaMousePressEvent(QMouseEvent *event);
     int lineNumberAreaWidth();
 
+    // --- Folding ---
+    // Folded lines are hidden blocks (no layout, no line count), so scrolling,
+    // painting and line lookups skip them in O(log n) via QTextDocument's
+    // block map. Fold ranges come from the DocumentStructure.
+    void toggleFold(const QTextBlock &header);
+    void foldAll();
+    void unfoldAll();
+
+    // Moves the cursor to a 1-based line, opening any fold that hides it
+    void goToLine(int lineNumber);
+
+    // --- Multi-cursor ---
+    // Alt+Click adds a caret, Alt+Shift+Drag selects a box (one caret per line),
+    // Alt+Shift+Up/Down adds a caret above/below, Escape goes back to one.
+    void addNextOccurrence();    // Ctrl+D
+    void selectAllOccurrences(); // Ctrl+Shift+L
+    void clearExtraCursors();
+    bool hasExtraCursors() const { return !m_multiCursor.isEmpty(); }
+
+    // --- Find / Replace ---
+    void showFindBar(bool withReplace); // Ctrl+F / Ctrl+H
+    void positionFindBar();
+    // Match highlights, set by the FindBar for the lines on screen only
+    void setSearchSelections(const QList<QTextEdit::ExtraSelection> &selections);
+
+    // Document range [from, to) of the blocks on screen
+    void visibleRange(int *from, int *to) const;
+
+    // Language server sync of our document (child of the document), may be
+    // null. Ctrl-hover asks the server first.
+    void setLanguageDocument(LspDocument *document) { m_lsp = document; }
+    LspDocument *languageDocument() const { return m_lsp; }
+
+    // --- Symbols (SymbolIndex) ---
+    // Jumps to the definition of the identifier at the cursor (F12, Ctrl+Click)
+    void goToDefinition();
+
+signals:
+    // A definition in 'filePath' (maybe this file) should be shown; line is 0-based
+    void definitionRequested(const QString &filePath, int line, int column);
+
 protected:
     // We override the mouse wheel event
     void wheelEvent(QWheelEvent *e) override;
 
-    // Overrides for the Hover feature
+    // Overrides for the Hover feature (and multi-cursor mouse handling)
     void mouseMoveEvent(QMouseEvent *e) override;
+    void mousePressEvent(QMouseEvent *e) override;
+    void mouseReleaseEvent(QMouseEvent *e) override;
     void keyPressEvent(QKeyEvent *e) override;
     void keyReleaseEvent(QKeyEvent *e) override;
     void leaveEvent(QEvent *e) override;
@@ -46,6 +126,12 @@ protected:
     // Override resize event to handle margins + line numbers
     void resizeEvent(QResizeEvent *e) override;
 
+    // Applies a theme switch that happened while we were hidden
+    void showEvent(QShowEvent *e) override;
+
+    // Draws the secondary carets on top of the text
+    void paintEvent(QPaintEvent *e) override;
+
 private slots:
     void onHoverTimerTimeout();
 
@@ -56,13 +142,74 @@ private slots:
     void updateLineNumberAreaWidth(int newBlockCount);
     void updateLineNumberArea(const QRect &rect, int dy);
 
+    // Highlight the bracket at the cursor and its partner
+    void updateBracketMatch();
+
+    // Opens the folds around the cursor if it moved into hidden text
+    void revealCursorBlock();
+
 private:
+    void applyPendingTheme();
+
+    // All extra selections (search matches, bracket match, ...) are merged here
+    void updateExtraSelections();
+
+    // Folding helpers
+    int foldMarkerWidth() const;
+    bool foldBlock(const QTextBlock &header);
+    bool unfoldBlock(const QTextBlock &header);
+    void ensureBlockVisible(QTextBlock block);
+    QTextBlock nextVisibleBlock(const QTextBlock &block) const;
+    void relayoutBlocks(const QTextBlock &first, const QTextBlock &last);
+    void rehighlightPending(const QVector<QTextBlock> &blocks);
+
+    // Multi-cursor helpers
+    bool handleMultiCursorKey(QKeyEvent *e);
+    MultiCursor::Caret primaryCaret() const;
+    void applyCarets(const MultiCursor::Caret &primary);
+    void addCaretVertically(int direction);
+    void updateBoxSelection(const QPoint &pos);
+    void updateCaretSelections();
+    int columnAtPoint(const QPoint &pos) const;
+    int tabWidthInColumns() const;
+
+    // Hover tooltips
+    void showSymbolTip(const QPoint &globalPos, const QString &name);
+    void cancelHoverRequest();
+
+    // Identifier ([A-Za-z0-9_]) around the cursor's position, empty if none
+    QString identifierAt(const QTextCursor &cursor) const;
+    bool goToDefinitionOf(const QString &name);
+
     QTimer *m_hoverTimer;
     CommonTooltip *m_customTooltip;
+    QPointer<LspDocument> m_lsp;
+    int m_hoverRequest = -1; // LspClient request id of the hover in flight
 
     QWidget *lineNumberArea;
     QColor m_lineNumberColor; // To store theme color for line numbers
     QColor m_lineNumberBgColor;
+
+    Highlighter *m_highlighter = nullptr;
+    const Theme *m_theme = nullptr;
+    int m_appliedThemeId = 0;
+
+    Minimap *m_minimap = nullptr;
+    UndoHistory *m_undoHistory = nullptr;
+    TextCodec::Format m_fileFormat;
+
+    DocumentStructure *m_structure = nullptr;
+    QList<QTextEdit::ExtraSelection> m_bracketSelections;
+    QColor m_bracketMatchColor;
+
+    MultiCursor m_multiCursor;
+    QList<QTextEdit::ExtraSelection> m_caretSelections; // On-screen secondary selections only
+    bool m_boxSelecting = false;
+    int m_boxAnchorBlock = 0;
+    int m_boxAnchorColumn = 0;
+
+    FindBar *m_findBar = nullptr; // Created on first use
+    QList<QTextEdit::ExtraSelection> m_searchSelections;
 };
 
 // Helper widget to paint the line numbers
@@ -74,6 +221,7 @@ public:
 
 protected:
     void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
 
 private:
     CodeEditor *codeEditor;
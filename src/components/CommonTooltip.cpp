@@ -1,4 +1,5 @@
 #include "CommonTooltip.h"
+#include "ThemeRegistry.h"
 
 CommonTooltip::CommonTooltip(QWidget *parent) : QWidget(parent) 
 {
@@ -62,6 +63,7 @@ CommonTooltip::CommonTooltip(QWidget *parent) : QWidget(parent)
     // -- Content --
     m_contentLabel = new QLabel(this);
     m_contentLabel->setWordWrap(true);
+    m_contentLabel->setTextFormat(Qt::PlainText); // Shows code, which may look like HTML
     m_contentLabel->setAlignment(Qt::AlignLeft | Qt::AlignTop);
 
     // Add layouts
@@ -77,6 +79,12 @@ CommonTooltip::CommonTooltip(QWidget *parent) : QWidget(parent)
 }
 
 void CommonTooltip::showTip(const QPoint &pos, const QString &text) {
+    // Apply a theme change we were told about while hidden
+    if (m_pendingTheme && m_pendingTheme->id != m_appliedThemeId) {
+        setStyleSheet(m_pendingTheme->tooltipStyleSheet);
+        m_appliedThemeId = m_pendingTheme->id;
+    }
+
     m_contentLabel->setText(text);
     qDebug() << "CommonTooltip::showTip at" << pos << "with text:" << text;
     // Resize to fit content, but limit max width if needed
@@ -89,35 +97,12 @@ void CommonTooltip::showTip(const QPoint &pos, const QString &text) {
     raise(); // Bring to front
 }
 
-void CommonTooltip::applyTheme(const QHash<QString, QColor> &theme) {
-    // Extract colors (fallback to defaults if missing)
-    QString bg = theme.value("background", QColor("#252526")).name();
-    QString fg = theme.value("foreground", QColor("#cccccc")).name();
-    QString border = theme.value("comment", QColor("#454545")).name(); // Using 'comment' color for borders
+void CommonTooltip::applyTheme(const Theme *theme) {
+    m_pendingTheme = theme;
 
-    // Re-apply stylesheet with dynamic colors
-    setStyleSheet(QString(R"(
-        CommonTooltip {
-            background-color: %1;
-            border: 1px solid %3;
-            border-radius: 4px;
-        }
-        QLabel {
-            color: %2;
-            font-family: Consolas, "Courier New", monospace;
-            font-size: 12px;
-            padding: 4px;
-        }
-        QPushButton {
-            background: transparent;
-            color: %3; /* Use border color for the X initially */
-            border: none;
-            font-weight: bold;
-            border-radius: 2px;
-        }
-        QPushButton:hover {
-            background-color: #c51b25;
-            color: white;
-        }
-    )").arg(bg, fg, border));
-}
\ No newline at end of file
+    // Already on screen: restyle right away
+    if (isVisible() && theme && theme->id != m_appliedThemeId) {
+        setStyleSheet(theme->tooltipStyleSheet);
+        m_appliedThemeId = theme->id;
+    }
+}
@@ -8,6 +8,8 @@
 #include <QHash> 
 #include <QColor>
 
+struct Theme;
+
 class CommonTooltip : public QWidget {
     Q_OBJECT
 public:
@@ -16,10 +18,14 @@ public:
     // Set content and show the tooltip at a global screen position
     void showTip(const QPoint &pos, const QString &text);
 
-    // Method to receive theme colors
-    void applyTheme(const QHash<QString, QColor> &theme);
+    // Method to receive the theme. The style sheet is only applied the next
+    // time the tooltip is shown, most tooltips never are.
+    void applyTheme(const Theme *theme);
 
 private:
     QLabel *m_contentLabel;
     QPushButton *m_closeButton;
+
+    const Theme *m_pendingTheme = nullptr;
+    int m_appliedThemeId = 0;
 };
\ No newline at end of file
@@ -1,4 +1,9 @@
 #include "CustomRichTextBoard.h"
+#include "ImageCropDialog.h"
+#include "utils/ImageCodec.h"
+#include "LazyImageStore.h"
+#include "MemoryAccounting.h"
+#include <QPixmap>
 
 CustomRichTextBoard::CustomRichTextBoard(QWidget *parent) : QTextEdit(parent) {
 }
@@ -12,6 +17,7 @@ bool CustomRichTextBoard::canInsertFromMimeData(const QMimeData *source) const {
 // Takes a QImage, scales it, converts it to Base64, and wraps it in an HTML `<img>` tag.
 QString CustomRichTextBoard::processImage(const QImage &image) {
     if (image.isNull()) return "";
+    MemoryAccounting::Scope scope(MemoryAccounting::Images);
 
     // // Define a fixed width for all pasted images to ensure consistency.
     // const int fixedWidth = 500;
@@ -26,16 +32,12 @@ QString CustomRichTextBoard::processImage(const QImage &image) {
     // Scale the image to the fixed width while preserving its aspect ratio.
     QImage finalImg = image.scaledToWidth(targetWidth, Qt::SmoothTransformation);
 
-    // Convert the image data into a Base64 string for embedding in HTML.
-    QByteArray byteArray;
-    QBuffer buffer(&byteArray);
-    buffer.open(QIODevice::WriteOnly);
-    finalImg.save(&buffer, "PNG"); // Save in PNG format.
-    QString base64 = byteArray.toBase64();
+    // Encode it (fast PNG level, vectorized Base64) for embedding in HTML.
+    QString dataUri = ImageCodec::toDataUri(finalImg);
 
     // Return the complete HTML tag with the embedded image data.
-    return QString("<img src=\"data:image/png;base64,%1\" width=\"%2\" height=\"%3\" />")
-           .arg(base64)
+    return QString("<img src=\"%1\" width=\"%2\" height=\"%3\" />")
+           .arg(dataUri)
            .arg(finalImg.width())
            .arg(finalImg.height());
 }
@@ -61,6 +63,30 @@ void CustomRichTextBoard::mousePressEvent(QMouseEvent *e) {
     QTextEdit::mousePressEvent(e);
 }
 
+// Called by the document the first time it needs a resource it doesn't have cached.
+// Cropped images are stored as "<original>#crop=x,y,w,h", so we fetch the original
+// from the document and hand back a view into its pixels instead of a re-encoded copy.
+QVariant CustomRichTextBoard::loadResource(int type, const QUrl &name) {
+    // Lazily loaded images (and their crops) come from RichTextEditor's resource
+    // provider. Answering here would make QTextDocument cache them for good.
+    if (name.scheme() == LazyImageStore::scheme()) return QVariant();
+
+    if (type == QTextDocument::ImageResource && name.hasFragment()) {
+        QString baseName;
+        QRect crop;
+        if (ImageCropDialog::parseCropResourceName(name.toString(), &baseName, &crop)) {
+            QVariant base = document()->resource(type, QUrl(baseName));
+            QImage source = base.userType() == QMetaType::QPixmap
+                          ? base.value<QPixmap>().toImage()
+                          : base.value<QImage>();
+            if (!source.isNull()) {
+                return ImageCropDialog::croppedView(source, crop);
+            }
+        }
+    }
+    return QTextEdit::loadResource(type, name);
+}
+
 // Handles the actual insertion of data from the clipboard.
 void CustomRichTextBoard::insertFromMimeData(const QMimeData *source) {
     if (source->hasImage()) {
@@ -78,6 +104,13 @@ void CustomRichTextBoard::insertFromMimeData(const QMimeData *source) {
     }
 }
 
+// Builds the clipboard / drag data for the selection with the images inlined.
+QMimeData *CustomRichTextBoard::createMimeDataFromSelection() const {
+    QMimeData *data = QTextEdit::createMimeDataFromSelection();
+    if (m_htmlExporter && data->hasHtml()) data->setHtml(m_htmlExporter(data->html()));
+    return data;
+}
+
 /*
 // This slot is triggered to resize the image currently under the text cursor.
 void CustomRichTextBoard::resizeImageAtCursor() {
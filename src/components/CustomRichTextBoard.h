@@ -12,6 +12,7 @@
 #include <QContextMenuEvent>
 #include <QMenu>
 #include <QMouseEvent>
+#include <functional>
 
 
 
@@ -21,17 +22,29 @@ class CustomRichTextBoard : public QTextEdit {
 public:
     explicit CustomRichTextBoard(QWidget *parent = nullptr);
 
+    // Turns document HTML into self-contained HTML (real data: URIs instead
+    // of "lazy-image:N" and "#crop=" names). Applied to what is copied or
+    // dragged out, which other tabs and applications can't resolve otherwise.
+    using HtmlExporter = std::function<QString(const QString &html)>;
+    void setHtmlExporter(HtmlExporter exporter) { m_htmlExporter = std::move(exporter); }
+
 protected:
     // This function is called whenever the user presses Ctrl+V
     bool canInsertFromMimeData(const QMimeData *source) const override;
     void insertFromMimeData(const QMimeData *source) override;
+    QMimeData *createMimeDataFromSelection() const override;
 
     void mousePressEvent(QMouseEvent *e) override;
 
+    // Resolves "#crop=" image names to a view of the original resource
+    QVariant loadResource(int type, const QUrl &name) override;
+
 private slots:
     // void resizeImageAtCursor();
 
 private:
     // Helper to generate HTML with width limit
     QString processImage(const QImage &img);
+
+    HtmlExporter m_htmlExporter;
 };
\ No newline at end of file
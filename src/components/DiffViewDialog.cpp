@@ -1,4 +1,5 @@
 #include "DiffViewDialog.h"
+#include "MemoryAccounting.h"
 
 DiffViewDialog::DiffViewDialog(const QString &original, const QString &incoming, QWidget *parent)
     : QDialog(parent), m_originalText(original), m_incomingText(incoming), m_action(ActionCancel)
@@ -108,6 +109,8 @@ void DiffViewDialog::setupUI() {
 
 
 void DiffViewDialog::computeDiff() {
+    MemoryAccounting::Scope scope(MemoryAccounting::Diff);
+
     // Prepare Data by splitting into lines
     QStringList linesLeft = m_originalText.split('\n');
     QStringList linesRight = m_incomingText.split('\n');
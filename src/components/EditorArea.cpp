@@ -1,5 +1,33 @@
 #include "EditorArea.h"
 
+#include "MemoryAccounting.h"
+#include "SymbolIndex.h"
+#include "LspClient.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QScrollBar>
+#include <QThreadPool>
+#include <climits>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+namespace {
+
+// Asks the kernel to start reading the whole file into the page cache now
+void adviseWillNeed(const QString &filePath) {
+#ifdef Q_OS_LINUX
+    QFile file(filePath);
+    if (file.open(QIODevice::ReadOnly)) posix_fadvise(file.handle(), 0, 0, POSIX_FADV_WILLNEED);
+#else
+    Q_UNUSED(filePath);
+#endif
+}
+
+} // namespace
+
 // EditorArea constructor: sets up the main editing view of the application.
 EditorArea::EditorArea(QWidget *parent) : QWidget(parent) {
     // Use a vertical layout to arrange widgets.
@@ -26,20 +54,25 @@ EditorArea::EditorArea(QWidget *parent) : QWidget(parent) {
     m_tabs->setDocumentMode(true); // Use a flatter, modern look suitable for document editors.
     // Connect the tabCloseRequested signal to our custom slot to handle closing tabs.
     connect(m_tabs, &QTabWidget::tabCloseRequested, this, &EditorArea::onCloseTab);
+    connect(m_tabs, &QTabWidget::currentChanged, this, &EditorArea::onCurrentChanged);
     m_stack->addWidget(m_tabs);
 
     // Add the main stack to the layout.
     layout->addWidget(m_stack);
-    
-    // Load the color theme from JSON so it's ready for syntax highlighting.
-    loadTheme();
+
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &EditorArea::onFileChanged);
+    m_reloadTimer = new QTimer(this);
+    m_reloadTimer->setSingleShot(true);
+    m_reloadTimer->setInterval(kReloadDelayMs);
+    connect(m_reloadTimer, &QTimer::timeout, this, &EditorArea::reloadChangedFiles);
+
+    // The color theme is owned by ThemeRegistry, which parses each theme file
+    // once and hands every editor the same prepared formats and palette.
 }
 
 // Opens a file in a new tab.
 void EditorArea::openFile(const QString &filePath) {
-    QFileInfo info(filePath);
-    QString fileName = info.fileName(); // Extract just the filename for the tab title.
-
     // Check if the file is already open to prevent duplicates.
     for (int i = 0; i < m_tabs->count(); ++i) {
         // We store the full file path in the tab's tooltip.
@@ -50,22 +83,139 @@ void EditorArea::openFile(const QString &filePath) {
     }
 
     // If not open, create a new editor widget.
+    QWidget *editorWidget = createEditor(filePath);
+    if (!editorWidget) return;
+
+    // Add the newly created editor to a new tab.
+    int index = m_tabs->addTab(editorWidget, QFileInfo(filePath).fileName());
+    m_tabs->setTabToolTip(index, filePath); // Store the full path for later reference.
+    m_tabs->setCurrentIndex(index);         // Make the new tab active.
+
+    // If this is the first file, switch the view from the welcome screen to the tabs.
+    m_stack->setCurrentWidget(m_tabs);
+}
+
+// Opens several files at once (multi-select in the sidebar, the command
+// line). Reading and decoding run on the thread pool, all files at the same
+// time; the GUI thread only builds the editors. Tabs appear as files arrive,
+// in the order given, and the first new one is brought to the front.
+void EditorArea::openFileList(const QStringList &filePaths) {
+    auto batch = std::make_shared<FileBatch>();
+    const QStringList open = openFiles();
+    for (const QString &filePath : filePaths) {
+        if (!open.contains(filePath) && !batch->paths.contains(filePath)) batch->paths << filePath;
+    }
+    if (batch->paths.isEmpty()) {
+        if (!filePaths.isEmpty()) openFile(filePaths.first()); // Already open: just switch to it
+        return;
+    }
+    batch->results.resize(batch->paths.size());
+    batch->arrived.resize(batch->paths.size());
+
+    // Readahead first (the pool runs tasks in order): the disk gets every
+    // request at once instead of one per free worker
+    const QStringList paths = batch->paths;
+    QThreadPool::globalInstance()->start([paths]() {
+        for (const QString &filePath : paths) adviseWillNeed(filePath);
+    });
+
+    QPointer<EditorArea> guard(this);
+    for (int i = 0; i < paths.size(); ++i) {
+        const QString filePath = paths.at(i);
+        QThreadPool::globalInstance()->start([guard, batch, i, filePath]() {
+            LoadedFile loaded = loadFile(filePath);
+            QMetaObject::invokeMethod(qApp, [guard, batch, i, loaded]() {
+                if (guard) guard->onFileLoaded(batch, i, loaded);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void EditorArea::onFileLoaded(const std::shared_ptr<FileBatch> &batch, int i, const LoadedFile &loaded) {
+    batch->results[i] = loaded;
+    batch->arrived[i] = true;
+
+    // Keep the tab order: a file waits for the ones before it
+    while (batch->next < batch->paths.size() && batch->arrived.at(batch->next)) {
+        const LoadedFile file = batch->results.at(batch->next);
+        batch->results[batch->next] = LoadedFile(); // The document has its own copy
+        ++batch->next;
+
+        if (!file.ok) {
+            batch->failed << QFileInfo(file.path).fileName();
+            continue;
+        }
+        if (!openFiles().contains(file.path)) {
+            QWidget *editor = createEditor(file);
+            int index = m_tabs->addTab(editor, QFileInfo(file.path).fileName());
+            m_tabs->setTabToolTip(index, file.path);
+            if (!batch->shown) {
+                batch->shown = true;
+                m_tabs->setCurrentIndex(index);
+                m_stack->setCurrentWidget(m_tabs);
+            }
+        }
+    }
+
+    if (batch->next == batch->paths.size() && !batch->failed.isEmpty()) {
+        QMessageBox::warning(this, "Error", "Could not open:\n" + batch->failed.join('\n'));
+        batch->failed.clear();
+    }
+}
+
+// Reads and decodes a file. Runs on worker threads, so it touches no widgets.
+EditorArea::LoadedFile EditorArea::loadFile(const QString &filePath) {
+    LoadedFile loaded;
+    loaded.path = filePath;
+
+    // Huge files (multi-GB logs) get a read-only, memory-mapped viewer instead
+    // of an editable document; nothing to read here.
+    if (QFileInfo(filePath).size() >= LogViewer::kSizeThreshold) {
+        loaded.isLog = true;
+        loaded.ok = true;
+        return loaded;
+    }
+
+    // Load the file content from disk. Raw bytes: TextCodec detects the
+    // encoding and line endings (and remembers them for saving).
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return loaded;
+    loaded.content = TextCodec::decode(file.readAll(), &loaded.format);
+    file.close();
+
+    loaded.fingerprint = Session::Fingerprint::of(filePath);
+    loaded.ok = true;
+    return loaded;
+}
+
+// Reads a file and builds the editor for it: a LogViewer, RichTextEditor or
+// CodeEditor. Returns null (after telling the user) if it can't be read.
+QWidget *EditorArea::createEditor(const QString &filePath) {
+    const LoadedFile loaded = loadFile(filePath);
+    if (!loaded.ok) {
+        QMessageBox::warning(this, "Error", "Could not open file.");
+        return nullptr;
+    }
+    return createEditor(loaded);
+}
+
+// Builds the editor for a file that has been read already (GUI thread).
+QWidget *EditorArea::createEditor(const LoadedFile &loaded) {
+    const QString &filePath = loaded.path;
+    if (loaded.isLog) return new LogViewer(filePath, this);
+
     QWidget *editorWidget = nullptr;
     QTextDocument *doc = nullptr;
 
     // --- BRANCHING LOGIC ---
     bool isRichText = filePath.endsWith(".html") || filePath.endsWith(".myformat");
     
-    // Load the file content from disk.
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, "Error", "Could not open file.");
-        return;
-    }
+    // Block and format objects of the new document (its text is QString data,
+    // which isn't counted; highlighting and layout have scopes of their own)
+    MemoryAccounting::Scope memoryScope(MemoryAccounting::Documents);
 
-    QTextStream in(&file);
-    QString content = in.readAll();
-    file.close();
+    const QString &content = loaded.content;
+    const TextCodec::Format &format = loaded.format;
 
     if (isRichText) {
         RichTextEditor *rich = new RichTextEditor(this);
@@ -88,7 +238,7 @@ void EditorArea::openFile(const QString &filePath) {
         
         rich->setInitialPageSize(pageSizeIndex);
         rich->setHtml(htmlContent);
-        rich->setTheme(m_themeColors);
+        rich->setTheme(ThemeRegistry::instance()->currentTheme());
         doc = rich->document();
         editorWidget = rich;
 
@@ -97,23 +247,52 @@ void EditorArea::openFile(const QString &filePath) {
         CodeEditor *code = new CodeEditor(this);
         // Setup the editor (Font, Theme, Highlighter) BEFORE setting the text.
         // This ensures the document layout calculates the correct line heights immediately.
-        setupEditor(code, filePath); // Apply Dracula theme
+        setupEditor(code, filePath, content); // Apply theme + language grammar
         code->setPlainText(content);
+        code->setFileFormat(format);
+
+        // Compact, memory-bounded undo; picks up last session's history if the
+        // file hasn't changed since
+        UndoHistory *history = new UndoHistory(code->document());
+        history->load(UndoHistory::historyPathFor(filePath));
+        code->setUndoHistory(history);
         doc = code->document();
         editorWidget = code;
+
+        // Reloaded in place when changed by someone else
+        m_knownVersions.insert(filePath, loaded.fingerprint);
+        m_watcher->addPath(filePath);
+
+        // Language server, if one is configured for the language: one per
+        // language for the whole project (files outside it get their folder)
+        const QString languageId = LanguageRegistry::instance()->languageIdForFile(filePath);
+        QString root = SymbolIndex::instance()->root();
+        if (root.isEmpty() || !filePath.startsWith(root + '/')) root = QFileInfo(filePath).absolutePath();
+        if (LspClient *client = languageId.isEmpty() ? nullptr : LspClient::clientFor(languageId, root)) {
+            code->setLanguageDocument(new LspDocument(code->document(), client, filePath, languageId));
+        }
     }
 
-    // Add the newly created editor to a new tab.
-    int index = m_tabs->addTab(editorWidget, fileName);
-    m_tabs->setTabToolTip(index, filePath); // Store the full path for later reference.
-    m_tabs->setCurrentIndex(index);         // Make the new tab active.
-    
     // Connect a signal to detect when the user modifies the text.
     // This is used to show a "*" indicator for unsaved changes.
     connect(doc, &QTextDocument::contentsChanged, this, &EditorArea::onTextModified);
+    return editorWidget;
+}
 
-    // If this is the first file, switch the view from the welcome screen to the tabs.
-    m_stack->setCurrentWidget(m_tabs);
+void EditorArea::showLocation(const QString &filePath, int line, int column) {
+    openFile(filePath);
+    QWidget *editor = editorFor(filePath);
+    if (auto *viewer = qobject_cast<LogViewer*>(editor)) {
+        viewer->goToLine(line + 1);
+        return;
+    }
+    auto *code = qobject_cast<CodeEditor*>(editor);
+    if (!code) return;
+
+    code->goToLine(line + 1);
+    QTextCursor cursor = code->textCursor();
+    cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, qMin(column, cursor.block().length() - 1));
+    code->setTextCursor(cursor);
 }
 
 // Saves the content of the currently active tab to its file.
@@ -122,32 +301,76 @@ void EditorArea::saveCurrentFile() {
     QWidget *current = m_tabs->currentWidget();
     if (!current) return; // No tab is open.
 
+    if (qobject_cast<LogViewer*>(current)) return; // Read-only
+
     QString filePath = m_tabs->tabToolTip(m_tabs->currentIndex());
 
-    // Write the editor's content back to the file.
+    // Write the editor's content back to the file. Code is written in binary
+    // mode, TextCodec puts the original line endings back.
+    auto *code = qobject_cast<CodeEditor*>(current);
+
+    // Code is encoded before the file is opened (and truncated), so a save
+    // the user turns down below leaves the file as it was
+    QByteArray codeBytes;
+    if (code) {
+        // Raw text: toPlainText() would also turn non-breaking spaces into spaces
+        QString text = code->document()->toRawText();
+        text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+
+        bool lossless = true;
+        codeBytes = TextCodec::encode(text, code->fileFormat(), &lossless);
+        if (!lossless) {
+            // Latin-1 can't hold what was typed; UTF-8 can, but that changes
+            // the file's encoding on disk, so the user decides
+            TextCodec::Format format = code->fileFormat();
+            const auto answer = QMessageBox::question(
+                this, "Change Encoding",
+                QString("%1 contains characters that %2 can't represent.\n"
+                        "Save it as UTF-8 instead?")
+                    .arg(QFileInfo(filePath).fileName(), TextCodec::encodingName(format)));
+            if (answer != QMessageBox::Yes) return;
+
+            format.encoding = TextCodec::Utf8;
+            format.bom = false;
+            code->setFileFormat(format);
+            codeBytes = TextCodec::encode(text, format);
+        }
+    }
+
     QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (!file.open(code ? QIODevice::WriteOnly : QIODevice::WriteOnly | QIODevice::Text)) {
         QMessageBox::warning(this, "Error", "Could not save file.");
         return;
     }
     
-    QTextStream out(&file);
-    
     // --- POLYMORPHIC SAVE ---
     if (auto *rich = qobject_cast<RichTextEditor*>(current)) {
         // For our custom format, prepend the page size metadata.
         if (filePath.endsWith(".myformat")) {
             int sizeIndex = rich->currentPageSizeIndex();
-            out << "<!-- pageSize: " << sizeIndex << " -->\n";
+            file.write(QString("<!-- pageSize: %1 -->\n").arg(sizeIndex).toUtf8());
+        }
+        // Streamed block by block; no giant intermediate HTML string.
+        if (!rich->writeHtml(&file)) {
+            QMessageBox::warning(this, "Error", "Could not save file.");
+            return;
         }
-        out << rich->toHtml();
 
-    } else if (auto *code = qobject_cast<CodeEditor*>(current)) {
-        out << code->toPlainText();
+    } else if (code) {
+        file.write(codeBytes);
     }
 
     file.close();
     
+    // Keep the undo history for the next session, keyed to what was just written
+    if (code && code->undoHistory()) code->undoHistory()->save(UndoHistory::historyPathFor(filePath));
+
+    // Our own write is not an external change
+    if (code) m_knownVersions.insert(filePath, Session::Fingerprint::of(filePath));
+
+    // Its definitions may have changed
+    if (code) SymbolIndex::instance()->updateFile(filePath);
+
     // Remove the "*" from the tab title to indicate that the file is saved.
     QString title = m_tabs->tabText(m_tabs->currentIndex());
     if (title.endsWith("*")) {
@@ -155,10 +378,173 @@ void EditorArea::saveCurrentFile() {
     }
 }
 
+// Jumps to a line in the current code editor (folded lines are opened).
+void EditorArea::goToLine() {
+    // Log viewers count lines in 64 bits, the dialog only goes up to INT_MAX
+    if (auto *viewer = qobject_cast<LogViewer*>(m_tabs->currentWidget())) {
+        bool ok = false;
+        int lineCount = int(qMin<qint64>(viewer->lineCount(), INT_MAX));
+        QString suffix = viewer->isIndexing() ? QString(" (still counting)") : QString();
+        int line = QInputDialog::getInt(this, "Go to Line", QString("Line (1 - %1%2):").arg(lineCount).arg(suffix),
+                                        1, 1, INT_MAX, 1, &ok);
+        if (ok) viewer->goToLine(line);
+        return;
+    }
+
+    auto *editor = qobject_cast<CodeEditor*>(m_tabs->currentWidget());
+    if (!editor) return; // Rich text has no lines to go to.
+
+    bool ok = false;
+    int lineCount = editor->document()->blockCount();
+    int current = editor->textCursor().blockNumber() + 1;
+    int line = QInputDialog::getInt(this, "Go to Line", QString("Line (1 - %1):").arg(lineCount),
+                                    current, 1, lineCount, 1, &ok);
+    if (ok) editor->goToLine(line);
+}
+
+// Opens the find bar of the current code editor.
+void EditorArea::showFindBar(bool withReplace) {
+    auto *editor = qobject_cast<CodeEditor*>(m_tabs->currentWidget());
+    if (editor) editor->showFindBar(withReplace);
+}
+
+QStringList EditorArea::openFiles() const {
+    QStringList files;
+    for (int i = 0; i < m_tabs->count(); ++i) files << m_tabs->tabToolTip(i);
+    return files;
+}
+
+QWidget *EditorArea::editorFor(const QString &filePath) const {
+    for (int i = 0; i < m_tabs->count(); ++i) {
+        if (m_tabs->tabToolTip(i) != filePath) continue;
+        QWidget *widget = m_tabs->widget(i);
+        return m_pendingTabs.contains(widget) ? nullptr : widget;
+    }
+    return nullptr;
+}
+
+// ---------------------------------
+// Session
+// ---------------------------------
+
+void EditorArea::restoreSession(const Session &session) {
+    // Placeholders cost a tab and an empty widget; no file is read for them
+    m_switchingTabs = true;
+    int current = -1;
+    for (int i = 0; i < session.tabs.size(); ++i) {
+        const Session::Tab &tab = session.tabs.at(i);
+        if (!QFileInfo::exists(tab.path) || openFiles().contains(tab.path)) continue;
+
+        QWidget *placeholder = new QWidget(this);
+        m_pendingTabs.insert(placeholder, tab);
+        int index = m_tabs->addTab(placeholder, QFileInfo(tab.path).fileName());
+        m_tabs->setTabToolTip(index, tab.path);
+        if (i == session.current || current < 0) current = index;
+    }
+    m_switchingTabs = false;
+    if (current < 0) return;
+
+    m_stack->setCurrentWidget(m_tabs);
+    m_tabs->setCurrentIndex(current);
+    hydrateTab(current); // In case it already was the current tab
+}
+
+Session EditorArea::session() const {
+    Session session;
+    session.current = m_tabs->currentIndex();
+
+    for (int i = 0; i < m_tabs->count(); ++i) {
+        QWidget *widget = m_tabs->widget(i);
+        if (m_pendingTabs.contains(widget)) {
+            // Never looked at this run: keep what was restored
+            session.tabs.append(m_pendingTabs.value(widget));
+            continue;
+        }
+
+        Session::Tab tab;
+        tab.path = m_tabs->tabToolTip(i);
+        tab.fingerprint = Session::Fingerprint::of(tab.path);
+
+        if (auto *code = qobject_cast<CodeEditor*>(widget)) {
+            QTextCursor cursor = code->textCursor();
+            tab.cursor = cursor.position();
+            tab.anchor = cursor.anchor();
+            tab.scroll = code->verticalScrollBar()->value();
+        } else if (auto *log = qobject_cast<LogViewer*>(widget)) {
+            tab.topLine = log->topLine();
+            // A partial index is fine too, the next run picks up from its end
+            if (log->lineIndex().indexedBytes() > 0) {
+                Session::saveLineIndex(tab.path, tab.fingerprint, log->lineIndex());
+            }
+        }
+        session.tabs.append(tab);
+    }
+    return session;
+}
+
+void EditorArea::onCurrentChanged(int index) {
+    if (!m_switchingTabs && index >= 0) hydrateTab(index);
+}
+
+// Replaces a placeholder with the real editor, at the same position.
+void EditorArea::hydrateTab(int index) {
+    QWidget *placeholder = m_tabs->widget(index);
+    if (!m_pendingTabs.contains(placeholder)) return;
+    const Session::Tab state = m_pendingTabs.take(placeholder);
+
+    QWidget *editor = createEditor(state.path);
+
+    m_switchingTabs = true;
+    m_tabs->removeTab(index);
+    if (editor) {
+        m_tabs->insertTab(index, editor, QFileInfo(state.path).fileName());
+        m_tabs->setTabToolTip(index, state.path);
+        m_tabs->setCurrentIndex(index);
+    }
+    m_switchingTabs = false;
+    delete placeholder;
+
+    if (editor) {
+        applyTabState(editor, state);
+    } else if (m_tabs->count() == 0) {
+        m_stack->setCurrentWidget(m_welcome);
+    } else {
+        hydrateTab(m_tabs->currentIndex()); // The tab that took its place
+    }
+}
+
+// Puts the cursor and scroll position back, unless the file changed since.
+void EditorArea::applyTabState(QWidget *editor, const Session::Tab &state) {
+    const Session::Fingerprint fingerprint = Session::Fingerprint::of(state.path);
+    if (!state.fingerprint.isValid() || fingerprint != state.fingerprint) return;
+
+    if (auto *code = qobject_cast<CodeEditor*>(editor)) {
+        const int last = code->document()->characterCount() - 1;
+        QTextCursor cursor(code->document());
+        cursor.setPosition(qBound(0, state.anchor, last));
+        cursor.setPosition(qBound(0, state.cursor, last), QTextCursor::KeepAnchor);
+        code->setTextCursor(cursor);
+        code->verticalScrollBar()->setValue(state.scroll);
+    } else if (auto *log = qobject_cast<LogViewer*>(editor)) {
+        // Skips the scan of everything the last run already indexed
+        LineIndex index;
+        if (Session::loadLineIndex(state.path, fingerprint, &index)) log->restoreIndex(index);
+        if (state.topLine > 0) log->goToLine(state.topLine + 1);
+    }
+}
+
+// Closes the current tab (no unsaved-changes check yet, like the tab's 'x').
+void EditorArea::closeCurrentFile() {
+    if (m_tabs->count() > 0) onCloseTab(m_tabs->currentIndex());
+}
+
 // Slot called when a tab's close button is clicked.
 void EditorArea::onCloseTab(int index) {
     // TODO: Check for unsaved changes here before closing.
     QWidget *widget = m_tabs->widget(index);
+    m_pendingTabs.remove(widget);
+    const QString filePath = m_tabs->tabToolTip(index);
+    if (m_knownVersions.remove(filePath)) m_watcher->removePath(filePath);
     m_tabs->removeTab(index);
     delete widget; // Important: free the memory of the closed editor.
 
@@ -170,6 +556,7 @@ void EditorArea::onCloseTab(int index) {
 
 // Slot called when the content of an editor changes.
 void EditorArea::onTextModified() {
+    if (m_reloading) return; // Not the user's edit, and maybe not the current tab
     int index = m_tabs->currentIndex();
     QString title = m_tabs->tabText(index);
     // Add a "*" to the end of the tab title if it's not already there.
@@ -179,17 +566,23 @@ void EditorArea::onTextModified() {
 }
 
 // Applies theme colors and sets up syntax highlighting for a new editor.
-void EditorArea::setupEditor(CodeEditor *editor, const QString &filePath) {
-    // Apply base theme colors (background and foreground) using a stylesheet.
-    // Use the proper setter which handles the Editor AND the Tooltip
-    editor->setTheme(m_themeColors);
+void EditorArea::setupEditor(CodeEditor *editor, const QString &filePath, const QString &content) {
+    const Theme *theme = ThemeRegistry::instance()->currentTheme();
 
     // Set up syntax highlighter, but only for plain text code files.
     bool isRichText = filePath.endsWith(".html") || filePath.endsWith(".myformat");
     if (!isRichText) {
-        // The Highlighter is a custom class that applies colors to patterns in the text.
-        // It's parented to the editor's document, so it's cleaned up automatically.
-        new Highlighter(editor->document(), m_themeColors);
+        // Pick the language by extension (or by sniffing the first line). The grammar
+        // is compiled once per language and shared; plain text gets no highlighter.
+        const Grammar *grammar = LanguageRegistry::instance()->grammarForFile(filePath, content);
+        if (grammar) {
+            // The Highlighter is a custom class that applies colors to tokens in the text.
+            // It's parented to the editor's document, so it's cleaned up automatically.
+            editor->setHighlighter(new Highlighter(editor->document(), grammar, theme));
+
+            // Folding, bracket matching and outline, fed by the highlighter's block summaries
+            editor->setDocumentStructure(new DocumentStructure(editor->document(), grammar));
+        }
         
         // Use a monospaced font for code.
         QFont font("Consolas", 11);
@@ -200,28 +593,69 @@ void EditorArea::setupEditor(CodeEditor *editor, const QString &filePath) {
         QFont font("Arial", 12);
         editor->setFont(font);
     }
+
+    // Ctrl+Click / F12 on an identifier
+    connect(editor, &CodeEditor::definitionRequested, this, &EditorArea::showLocation);
+
+    // Apply base theme colors (background and foreground) using the palette.
+    // Use the proper setter which handles the Editor AND the Tooltip
+    editor->setTheme(theme);
 }
 
-// Loads color definitions from a JSON theme file.
-void EditorArea::loadTheme() {
-    // Note: This assumes the dracula.json file is in the application's working directory.
-    std::string themePath = "dracula.json";
-    QFile file(themePath.c_str());
-    if (file.open(QIODevice::ReadOnly)) {
-        // Parse the JSON file.
-        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-        QJsonObject obj = doc.object();
-        
-        // Store the colors in a map for easy lookup.
-        m_themeColors["background"] = QColor(obj["background"].toString());
-        m_themeColors["foreground"] = QColor(obj["foreground"].toString());
-        m_themeColors["keyword"] = QColor(obj["keyword"].toString());
-        m_themeColors["type"] = QColor(obj["type"].toString());
-        m_themeColors["string"] = QColor(obj["string"].toString());
-        m_themeColors["comment"] = QColor(obj["comment"].toString());
-    } else {
-        // If the theme can't be loaded, use simple black-on-white defaults.
-        m_themeColors["background"] = Qt::white;
-        m_themeColors["foreground"] = Qt::black;
+// ---------------------------------
+// External changes
+// ---------------------------------
+
+void EditorArea::onFileChanged(const QString &filePath) {
+    m_changedFiles.insert(filePath);
+    m_reloadTimer->start(); // Restarted by every change, fires once things settle
+}
+
+void EditorArea::reloadChangedFiles() {
+    const QSet<QString> changed = m_changedFiles;
+    m_changedFiles.clear();
+    for (const QString &filePath : changed) {
+        if (!m_knownVersions.contains(filePath)) continue; // Closed in the meantime
+
+        // Written by replacing the file (rename over it): the watch went with
+        // the old inode
+        if (!QFileInfo::exists(filePath)) continue; // Deleted; keep the buffer
+        if (!m_watcher->files().contains(filePath)) m_watcher->addPath(filePath);
+
+        const Session::Fingerprint fingerprint = Session::Fingerprint::of(filePath);
+        if (fingerprint == m_knownVersions.value(filePath)) continue; // Our own save
+
+        if (auto *code = qobject_cast<CodeEditor*>(editorFor(filePath))) reloadFile(code, filePath);
+        m_knownVersions.insert(filePath, fingerprint);
     }
-}
\ No newline at end of file
+}
+
+// Brings the editor up to date with the file by applying only the lines
+// that differ. Unsaved changes are replaced too, but only if the user agrees
+// (and as one undo step, so they can be had back).
+void EditorArea::reloadFile(CodeEditor *editor, const QString &filePath) {
+    const int index = m_tabs->indexOf(editor);
+    if (m_tabs->tabText(index).endsWith("*")) {
+        const auto answer = QMessageBox::question(
+            this, "File Changed",
+            QString("%1 was changed on disk.\nReload it and replace your unsaved changes?\n"
+                    "(Undo brings them back.)").arg(QFileInfo(filePath).fileName()));
+        if (answer != QMessageBox::Yes) return;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    TextCodec::Format format;
+    const QString text = TextCodec::decode(file.readAll(), &format);
+    file.close();
+
+    m_reloading = true;
+    editor->reloadText(text);
+    m_reloading = false;
+    editor->setFileFormat(format);
+
+    // The buffer is the file again
+    const QString title = m_tabs->tabText(index);
+    if (title.endsWith("*")) m_tabs->setTabText(index, title.chopped(1));
+    SymbolIndex::instance()->updateFile(filePath);
+}
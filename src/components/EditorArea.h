@@ -5,6 +5,10 @@
 #include <QTabWidget>
 #include <QStackedWidget>
 #include <QHash>
+#include <memory>
+#include <QSet>
+#include <QTimer>
+#include <QFileSystemWatcher>
 
 #include <QVBoxLayout>
 #include <QFile>
@@ -14,11 +18,18 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QDebug>
+#include <QInputDialog>
 
 #include "WelcomeWidget.h"
 #include "CodeEditor.h"
 #include "Highlighter.h"
+#include "LanguageRegistry.h"
+#include "DocumentStructure.h"
+#include "UndoHistory.h"
 #include "RichTextEditor.h"
+#include "LogViewer.h"
+#include "ThemeRegistry.h"
+#include "Session.h"
 
 
 class EditorArea : public QWidget {
@@ -29,20 +40,87 @@ public:
     
     // Public Actions
     void openFile(const QString &filePath);
+    // Opens many files, reading them concurrently (tabs appear as they arrive)
+    void openFileList(const QStringList &filePaths);
+    // Opens 'filePath' with the cursor at a 0-based line and column (go to
+    // definition, workspace symbols)
+    void showLocation(const QString &filePath, int line, int column);
     void saveCurrentFile();
+    void goToLine(); // Asks for a line number in the current code editor
+    void showFindBar(bool withReplace); // Find (Ctrl+F) / Replace (Ctrl+H) in the current code editor
+    void closeCurrentFile();
+
+    // The CodeEditor, RichTextEditor or LogViewer of the current tab, or null
+    QWidget *currentEditor() const { return m_tabs->currentWidget(); }
+
+    // Paths of the open tabs, in tab order, and the editor showing one of them
+    // (null for a restored tab that hasn't been selected yet)
+    QStringList openFiles() const;
+    QWidget *editorFor(const QString &filePath) const;
+
+    // --- Session ---
+    // Reopens the tabs of a previous run. Only the tab in front is loaded
+    // right away; the others are placeholders that read their file when they
+    // are first selected.
+    void restoreSession(const Session &session);
+    // The open tabs with their cursor and scroll positions. Also refreshes
+    // the cached line index of log tabs.
+    Session session() const;
 
 private slots:
     void onCloseTab(int index);
+    void onCurrentChanged(int index); // Loads restored tabs on first selection
     void onTextModified(); // To add "*" to tab title
 
+    // Files changed on disk: collected for a moment, then reloaded in place
+    void onFileChanged(const QString &filePath);
+    void reloadChangedFiles();
+
 private:
-    void loadTheme(); // Helper to load dracula.json
-    void setupEditor(CodeEditor *editor, const QString &filePath);
+    // A file read and decoded by loadFile(), ready for its editor
+    struct LoadedFile {
+        QString path;
+        QString content;
+        TextCodec::Format format;
+        Session::Fingerprint fingerprint;
+        bool isLog = false; // Too big to load; gets a LogViewer
+        bool ok = false;
+    };
+
+    // One openFileList() call; only touched on the GUI thread
+    struct FileBatch {
+        QStringList paths;
+        QVector<LoadedFile> results;
+        QVector<bool> arrived;
+        int next = 0;          // First path without a tab yet
+        bool shown = false;    // The first tab was brought to the front
+        QStringList failed;
+    };
+
+    static LoadedFile loadFile(const QString &filePath);
+    void onFileLoaded(const std::shared_ptr<FileBatch> &batch, int i, const LoadedFile &loaded);
+    QWidget *createEditor(const QString &filePath);
+    QWidget *createEditor(const LoadedFile &loaded);
+    void setupEditor(CodeEditor *editor, const QString &filePath, const QString &content);
+    void hydrateTab(int index);
+    void applyTabState(QWidget *editor, const Session::Tab &state);
+    void reloadFile(CodeEditor *editor, const QString &filePath);
 
     QStackedWidget *m_stack;
     QTabWidget *m_tabs;
     WelcomeWidget *m_welcome;
 
-    // Theme Data (Cached so we can apply to new tabs)
-    QHash<QString, QColor> m_themeColors;
+    // Placeholder widget -> what to restore into it
+    QHash<QWidget *, Session::Tab> m_pendingTabs;
+    bool m_switchingTabs = false; // Tabs are being added/replaced, don't hydrate
+
+    // Code tabs are watched for changes made outside the editor. Editors and
+    // build tools often write a file several times in a row, so changes are
+    // coalesced for kReloadDelayMs before anything is read.
+    static constexpr int kReloadDelayMs = 200;
+    QFileSystemWatcher *m_watcher;
+    QTimer *m_reloadTimer;
+    QSet<QString> m_changedFiles;
+    QHash<QString, Session::Fingerprint> m_knownVersions; // What we last read or wrote
+    bool m_reloading = false;
 };
\ No newline at end of file
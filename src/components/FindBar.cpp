@@ -0,0 +1,301 @@
+#include "FindBar.h"
+#include "CodeEditor.h"
+
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QGuiApplication>
+#include <algorithm>
+
+// =========================================================
+// FindBar Implementation
+// =========================================================
+
+FindBar::FindBar(CodeEditor *editor)
+    : QWidget(editor), m_editor(editor)
+{
+    setAutoFillBackground(true);
+    hide();
+
+    m_search = new DocumentSearch(editor->document(), this);
+
+    auto makeToggle = [this](const QString &text, const QString &tip) {
+        QToolButton *button = new QToolButton(this);
+        button->setText(text);
+        button->setToolTip(tip);
+        button->setCheckable(true);
+        button->setAutoRaise(true);
+        connect(button, &QToolButton::toggled, this, &FindBar::onQueryEdited);
+        return button;
+    };
+    auto makeButton = [this](const QString &text, const QString &tip) {
+        QToolButton *button = new QToolButton(this);
+        button->setText(text);
+        button->setToolTip(tip);
+        button->setAutoRaise(true);
+        return button;
+    };
+
+    // Row 1: find field, options, match count, navigation
+    m_findEdit = new QLineEdit(this);
+    m_findEdit->setPlaceholderText("Find");
+    m_findEdit->setMinimumWidth(200);
+    m_caseButton = makeToggle("Aa", "Match Case");
+    m_wordButton = makeToggle("W", "Match Whole Word");
+    m_regexButton = makeToggle(".*", "Use Regular Expression");
+    m_status = new QLabel(this);
+    m_status->setMinimumWidth(80);
+    QToolButton *previousButton = makeButton("↑", "Previous Match (Shift+Enter)");
+    QToolButton *nextButton = makeButton("↓", "Next Match (Enter)");
+    QToolButton *closeButton = makeButton("×", "Close (Escape)");
+
+    QHBoxLayout *findRow = new QHBoxLayout;
+    findRow->setSpacing(2);
+    findRow->addWidget(m_findEdit);
+    findRow->addWidget(m_caseButton);
+    findRow->addWidget(m_wordButton);
+    findRow->addWidget(m_regexButton);
+    findRow->addWidget(m_status);
+    findRow->addWidget(previousButton);
+    findRow->addWidget(nextButton);
+    findRow->addWidget(closeButton);
+
+    // Row 2: replace field and actions (hidden for plain Find)
+    m_replaceRow = new QWidget(this);
+    m_replaceEdit = new QLineEdit(m_replaceRow);
+    m_replaceEdit->setPlaceholderText("Replace");
+    QToolButton *replaceButton = makeButton("Replace", "Replace (Enter)");
+    QToolButton *replaceAllButton = makeButton("All", "Replace All");
+
+    QHBoxLayout *replaceRow = new QHBoxLayout(m_replaceRow);
+    replaceRow->setContentsMargins(0, 0, 0, 0);
+    replaceRow->setSpacing(2);
+    replaceRow->addWidget(m_replaceEdit);
+    replaceRow->addWidget(replaceButton);
+    replaceRow->addWidget(replaceAllButton);
+    replaceRow->addStretch();
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(6, 4, 6, 4);
+    layout->setSpacing(4);
+    layout->addLayout(findRow);
+    layout->addWidget(m_replaceRow);
+
+    connect(m_findEdit, &QLineEdit::textChanged, this, &FindBar::onQueryEdited);
+    connect(m_findEdit, &QLineEdit::returnPressed, this, [this]() {
+        if (QGuiApplication::keyboardModifiers() & Qt::ShiftModifier) findPrevious();
+        else findNext();
+    });
+    connect(m_replaceEdit, &QLineEdit::returnPressed, this, &FindBar::replaceCurrent);
+    connect(previousButton, &QToolButton::clicked, this, &FindBar::findPrevious);
+    connect(nextButton, &QToolButton::clicked, this, &FindBar::findNext);
+    connect(closeButton, &QToolButton::clicked, this, &FindBar::dismiss);
+    connect(replaceButton, &QToolButton::clicked, this, &FindBar::replaceCurrent);
+    connect(replaceAllButton, &QToolButton::clicked, this, &FindBar::replaceAll);
+
+    connect(m_search, &DocumentSearch::resultsChanged, this, &FindBar::onResultsChanged);
+
+    // Highlights follow scrolling and editing, refreshed once per event loop pass
+    m_highlightTimer = new QTimer(this);
+    m_highlightTimer->setSingleShot(true);
+    m_highlightTimer->setInterval(0);
+    connect(m_highlightTimer, &QTimer::timeout, this, &FindBar::updateHighlights);
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged,
+            m_highlightTimer, QOverload<>::of(&QTimer::start));
+    connect(editor->document(), &QTextDocument::contentsChanged,
+            m_highlightTimer, QOverload<>::of(&QTimer::start));
+    connect(editor, &QPlainTextEdit::cursorPositionChanged, this, &FindBar::updateStatus);
+}
+
+void FindBar::open(bool withReplace) {
+    m_replaceRow->setVisible(withReplace);
+
+    // Seed with a single-line selection, like most editors
+    QTextCursor cursor = m_editor->textCursor();
+    const QString selected = cursor.selectedText();
+    if (!selected.isEmpty() && !selected.contains(QChar::ParagraphSeparator)) {
+        m_findEdit->blockSignals(true);
+        m_findEdit->setText(selected);
+        m_findEdit->blockSignals(false);
+    }
+    m_searchOrigin = cursor.selectionStart();
+
+    const bool wasVisible = isVisible();
+    show();
+    raise();
+    resize(sizeHint());
+    m_editor->positionFindBar();
+
+    if (withReplace && !m_findEdit->text().isEmpty()) {
+        m_replaceEdit->setFocus();
+        m_replaceEdit->selectAll();
+    } else {
+        m_findEdit->setFocus();
+        m_findEdit->selectAll();
+    }
+
+    // A hidden bar keeps no query (so edits don't start searches); restore it
+    if (!wasVisible || !selected.isEmpty()) onQueryEdited();
+}
+
+void FindBar::dismiss() {
+    hide();
+    m_jumpPending = false;
+    m_search->setQuery(DocumentSearch::Query());
+    m_editor->setSearchSelections({});
+    m_editor->setFocus();
+}
+
+void FindBar::keyPressEvent(QKeyEvent *event) {
+    if (event->key() == Qt::Key_Escape) {
+        dismiss();
+        event->accept();
+        return;
+    }
+    QWidget::keyPressEvent(event);
+}
+
+// ---------------------------------
+// Searching
+// ---------------------------------
+
+void FindBar::onQueryEdited() {
+    if (!isVisible()) return;
+
+    DocumentSearch::Query query;
+    query.pattern = m_findEdit->text();
+    query.caseSensitive = m_caseButton->isChecked();
+    query.wholeWord = m_wordButton->isChecked();
+    query.regex = m_regexButton->isChecked();
+    m_search->setQuery(query);
+
+    // Incremental search: the first match from where the bar was opened. If
+    // it's on screen we have it right away, otherwise once the workers are done.
+    m_jumpPending = !query.pattern.isEmpty();
+    int from = 0;
+    int to = 0;
+    m_editor->visibleRange(&from, &to);
+    for (const DocumentSearch::Match &match : m_search->matchesIn(qMax(from, m_searchOrigin), to)) {
+        selectMatch(match);
+        m_jumpPending = false;
+        break;
+    }
+
+    updateHighlights();
+    updateStatus();
+}
+
+void FindBar::onResultsChanged() {
+    if (m_jumpPending) {
+        m_jumpPending = false;
+        DocumentSearch::Match match;
+        if (m_search->nextMatch(m_searchOrigin, false, &match)) selectMatch(match);
+    }
+    updateHighlights();
+    updateStatus();
+}
+
+void FindBar::findNext() {
+    DocumentSearch::Match match;
+    if (m_search->nextMatch(m_editor->textCursor().selectionEnd(), false, &match)) {
+        selectMatch(match);
+        m_searchOrigin = match.position;
+    }
+}
+
+void FindBar::findPrevious() {
+    DocumentSearch::Match match;
+    if (m_search->nextMatch(m_editor->textCursor().selectionStart(), true, &match)) {
+        selectMatch(match);
+        m_searchOrigin = match.position;
+    }
+}
+
+void FindBar::selectMatch(const DocumentSearch::Match &match) {
+    QTextCursor cursor(m_editor->document());
+    cursor.setPosition(match.position);
+    cursor.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+    m_editor->setTextCursor(cursor); // Also opens a fold hiding the match
+}
+
+bool FindBar::isCurrentMatch(const DocumentSearch::Match &match) const {
+    const QTextCursor cursor = m_editor->textCursor();
+    return cursor.selectionStart() == match.position
+        && cursor.selectionEnd() == match.position + match.length;
+}
+
+// ---------------------------------
+// Display
+// ---------------------------------
+
+void FindBar::updateHighlights() {
+    if (!isVisible()) return;
+
+    int from = 0;
+    int to = 0;
+    m_editor->visibleRange(&from, &to);
+
+    QColor color = m_editor->palette().highlight().color();
+    color.setAlpha(90);
+
+    QList<QTextEdit::ExtraSelection> selections;
+    for (const DocumentSearch::Match &match : m_search->matchesIn(from, to)) {
+        QTextEdit::ExtraSelection selection;
+        selection.format.setBackground(color);
+        selection.cursor = QTextCursor(m_editor->document());
+        selection.cursor.setPosition(match.position);
+        selection.cursor.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+        selections.append(selection);
+    }
+    m_editor->setSearchSelections(selections);
+}
+
+void FindBar::updateStatus() {
+    if (!isVisible()) return;
+
+    m_status->setToolTip(m_search->errorString());
+    if (m_findEdit->text().isEmpty()) {
+        m_status->clear();
+    } else if (!m_search->errorString().isEmpty()) {
+        m_status->setText("Invalid pattern");
+    } else if (!m_search->isFinished()) {
+        m_status->setText("…");
+    } else if (m_search->matches().isEmpty()) {
+        m_status->setText("No results");
+    } else {
+        const QVector<DocumentSearch::Match> &matches = m_search->matches();
+        const int start = m_editor->textCursor().selectionStart();
+        auto it = std::lower_bound(matches.constBegin(), matches.constEnd(), start,
+                                   [](const DocumentSearch::Match &m, int pos) { return m.position < pos; });
+        if (it != matches.constEnd() && isCurrentMatch(*it)) {
+            m_status->setText(QString("%1 of %2").arg(it - matches.constBegin() + 1).arg(matches.size()));
+        } else {
+            m_status->setText(QString("%1 results").arg(matches.size()));
+        }
+    }
+}
+
+// ---------------------------------
+// Replacing
+// ---------------------------------
+
+void FindBar::replaceCurrent() {
+    // Replace the selected match (if the selection is one), then move on
+    const QTextCursor cursor = m_editor->textCursor();
+    if (cursor.hasSelection()) {
+        for (const DocumentSearch::Match &match : m_search->matchesIn(cursor.selectionStart(), cursor.selectionStart() + 1)) {
+            if (!isCurrentMatch(match)) continue;
+            QTextCursor edit = cursor;
+            edit.insertText(m_search->replacementFor(match, m_replaceEdit->text()));
+            m_editor->setTextCursor(edit);
+            break;
+        }
+    }
+    findNext();
+}
+
+void FindBar::replaceAll() {
+    const int count = m_search->replaceAll(m_replaceEdit->text());
+    m_status->setText(count ? QString("Replaced %1").arg(count) : QString("No results"));
+}
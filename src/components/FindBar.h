@@ -0,0 +1,63 @@
+#pragma once
+#include <QWidget>
+#include <QLineEdit>
+#include <QToolButton>
+#include <QLabel>
+#include <QTimer>
+
+#include "DocumentSearch.h"
+
+class CodeEditor;
+
+// Find / replace panel floating over the top right corner of a CodeEditor.
+//
+// Matches are highlighted as you type, but only the ones on screen are
+// turned into extra selections (refreshed on scroll), so a query with a
+// million hits costs no more to display than one with ten. Counting and
+// collecting all matches is left to DocumentSearch's workers.
+class FindBar : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit FindBar(CodeEditor *editor);
+
+    // Shows the bar, seeded with the selected text, and focuses the find field
+    void open(bool withReplace);
+    void dismiss(); // Hides the bar and its highlights, focus goes back to the editor
+
+    void findNext();
+    void findPrevious();
+
+protected:
+    void keyPressEvent(QKeyEvent *event) override;
+
+private slots:
+    void onQueryEdited();
+    void onResultsChanged();
+    void updateHighlights();
+    void replaceCurrent();
+    void replaceAll();
+
+private:
+    void selectMatch(const DocumentSearch::Match &match);
+    bool isCurrentMatch(const DocumentSearch::Match &match) const;
+    void updateStatus();
+
+    CodeEditor *m_editor;
+    DocumentSearch *m_search;
+
+    QLineEdit *m_findEdit;
+    QLineEdit *m_replaceEdit;
+    QToolButton *m_caseButton;
+    QToolButton *m_wordButton;
+    QToolButton *m_regexButton;
+    QLabel *m_status;
+    QWidget *m_replaceRow;
+
+    // Coalesces the highlight refreshes of one event loop pass (scroll + edit)
+    QTimer *m_highlightTimer;
+
+    // Where the cursor was when the bar opened; incremental search starts here
+    int m_searchOrigin = 0;
+    bool m_jumpPending = false; // Select the first match once the results are in
+};
@@ -4,6 +4,7 @@
 #include <QPainter>
 #include <QMouseEvent>
 #include <QApplication>
+#include <QRegion>
 
 // ============================================================================
 // CropPreviewWidget Implementation
@@ -17,7 +18,24 @@ CropPreviewWidget::CropPreviewWidget(QWidget *parent)
 
 void CropPreviewWidget::setImage(const QImage &image) {
     m_image = image;
+    updateLayout();
     
+    // Initialize crop rect to full image
+    m_cropRect = m_imageRect;
+    
+    update();
+}
+
+// Recomputes where the image sits inside the widget and rebuilds the cached
+// preview pixmap. This is the only place the full-resolution image is scaled;
+// paintEvent just blits the pixmap, so dragging the crop handles stays cheap.
+void CropPreviewWidget::updateLayout() {
+    if (m_image.isNull()) {
+        m_imageRect = QRect();
+        m_preview = QPixmap();
+        return;
+    }
+
     // Calculate scaled image rect to fit widget
     QSize scaledSize = m_image.size();
     scaledSize.scale(size(), Qt::KeepAspectRatio);
@@ -25,11 +43,59 @@ void CropPreviewWidget::setImage(const QImage &image) {
     int x = (width() - scaledSize.width()) / 2;
     int y = (height() - scaledSize.height()) / 2;
     m_imageRect = QRect(QPoint(x, y), scaledSize);
-    
-    // Initialize crop rect to full image
-    m_cropRect = m_imageRect;
-    
-    update();
+
+    // Scale once at device resolution so the preview stays sharp on HiDPI screens.
+    const qreal dpr = devicePixelRatioF();
+    m_preview = QPixmap::fromImage(m_image.scaled(scaledSize * dpr, Qt::KeepAspectRatio,
+                                                  Qt::SmoothTransformation));
+    m_preview.setDevicePixelRatio(dpr);
+}
+
+void CropPreviewWidget::resizeEvent(QResizeEvent *event) {
+    QWidget::resizeEvent(event);
+
+    // Keep the crop anchored to the same image pixels while the preview rescales.
+    QRect imageCrop = imageCropRect();
+    updateLayout();
+    if (!imageCrop.isEmpty()) {
+        m_cropRect = constrainRect(mapFromImage(imageCrop));
+    }
+}
+
+// Converts a rect in widget coordinates to source image pixels.
+QRect CropPreviewWidget::mapToImage(const QRect &rect) const {
+    if (m_imageRect.isEmpty()) return QRect();
+
+    qreal scaleX = (qreal)m_image.width() / m_imageRect.width();
+    qreal scaleY = (qreal)m_image.height() / m_imageRect.height();
+    QRectF mapped((rect.x() - m_imageRect.x()) * scaleX,
+                  (rect.y() - m_imageRect.y()) * scaleY,
+                  rect.width() * scaleX,
+                  rect.height() * scaleY);
+    return mapped.toRect().intersected(m_image.rect());
+}
+
+// Converts a rect in source image pixels to widget coordinates.
+QRect CropPreviewWidget::mapFromImage(const QRect &rect) const {
+    if (m_image.isNull()) return QRect();
+
+    qreal scaleX = (qreal)m_imageRect.width() / m_image.width();
+    qreal scaleY = (qreal)m_imageRect.height() / m_image.height();
+    QRectF mapped(m_imageRect.x() + rect.x() * scaleX,
+                  m_imageRect.y() + rect.y() * scaleY,
+                  rect.width() * scaleX,
+                  rect.height() * scaleY);
+    return mapped.toRect();
+}
+
+QRect CropPreviewWidget::imageCropRect() const {
+    // A crop covering the whole preview maps to the whole image (avoids rounding off a pixel).
+    if (m_cropRect == m_imageRect) return m_image.rect();
+    return mapToImage(m_cropRect);
+}
+
+void CropPreviewWidget::setImageCropRect(const QRect &rect) {
+    setCropRect(mapFromImage(rect));
 }
 
 void CropPreviewWidget::setCropRect(const QRect &rect) {
@@ -194,32 +260,16 @@ void CropPreviewWidget::paintEvent(QPaintEvent *event) {
     // Fill background
     painter.fillRect(rect(), Qt::gray);
     
-    if (m_image.isNull()) return;
+    if (m_preview.isNull()) return;
     
-    // Draw scaled image
-    painter.drawImage(m_imageRect, m_image);
+    // Draw the cached, screen-resolution preview
+    painter.drawPixmap(m_imageRect.topLeft(), m_preview);
     
-    // Draw dimmed overlay outside crop area
-    painter.fillRect(m_imageRect, QColor(0, 0, 0, 100));
-    
-    // Clear the crop area
-    painter.setCompositionMode(QPainter::CompositionMode_Clear);
-    painter.fillRect(m_cropRect, Qt::transparent);
-    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
-    
-    // Draw the non-dimmed crop area
-    QRect sourceCropRect = m_cropRect.translated(-m_imageRect.topLeft());
-    qreal scaleX = (qreal)m_image.width() / m_imageRect.width();
-    qreal scaleY = (qreal)m_image.height() / m_imageRect.height();
-    
-    QRect imageSourceRect(
-        sourceCropRect.x() * scaleX,
-        sourceCropRect.y() * scaleY,
-        sourceCropRect.width() * scaleX,
-        sourceCropRect.height() * scaleY
-    );
-    
-    painter.drawImage(m_cropRect, m_image, imageSourceRect);
+    // Dim only the area outside the crop, so the image is drawn once per frame
+    QRegion outside = QRegion(m_imageRect).subtracted(QRegion(m_cropRect));
+    for (const QRect &r : outside) {
+        painter.fillRect(r, QColor(0, 0, 0, 100));
+    }
     
     // Draw crop rectangle border
     painter.setPen(QPen(Qt::white, 2, Qt::DashLine));
@@ -247,11 +297,16 @@ void CropPreviewWidget::paintEvent(QPaintEvent *event) {
 // ImageCropDialog Implementation
 // ============================================================================
 
-ImageCropDialog::ImageCropDialog(const QImage &image, QWidget *parent)
+ImageCropDialog::ImageCropDialog(const QImage &image, const QRect &initialCrop, QWidget *parent)
     : QDialog(parent), m_originalImage(image) {
     setWindowTitle("Crop Image");
     setModal(true);
     setupUI();
+
+    // Reopening a cropped image starts from its current crop (crops are reversible)
+    if (!initialCrop.isEmpty()) {
+        m_previewWidget->setImageCropRect(initialCrop);
+    }
 }
 
 void ImageCropDialog::setupUI() {
@@ -268,10 +323,10 @@ void ImageCropDialog::setupUI() {
     mainLayout->addWidget(m_infoLabel);
     
     // Update info when crop rect changes
-    connect(m_previewWidget, &CropPreviewWidget::cropRectChanged, this, [this](const QRect &rect) {
-        QRect imageRect = m_previewWidget->cropRect();
+    connect(m_previewWidget, &CropPreviewWidget::cropRectChanged, this, [this](const QRect &) {
+        QRect imageRect = m_previewWidget->imageCropRect();
         m_infoLabel->setText(QString("Crop Area: %1 x %2")
-                            .arg(rect.width()).arg(rect.height()));
+                            .arg(imageRect.width()).arg(imageRect.height()));
     });
     
     // Button layout
@@ -310,27 +365,65 @@ void ImageCropDialog::onCancel() {
 }
 
 void ImageCropDialog::onResetCrop() {
-    m_previewWidget->setImage(m_originalImage);
+    m_previewWidget->setCropRect(m_previewWidget->rect());
 }
 
 QImage ImageCropDialog::croppedImage() const {
-    QRect cropRect = m_previewWidget->cropRect();
-    QRect imageRect = m_previewWidget->rect();
-    
-    // Calculate the actual crop rectangle in image coordinates
-    qreal scaleX = (qreal)m_originalImage.width() / imageRect.width();
-    qreal scaleY = (qreal)m_originalImage.height() / imageRect.height();
-    
-    QRect actualCropRect(
-        cropRect.x() * scaleX,
-        cropRect.y() * scaleY,
-        cropRect.width() * scaleX,
-        cropRect.height() * scaleY
-    );
-    
-    return m_originalImage.copy(actualCropRect);
+    return croppedView(m_originalImage, cropRect());
 }
 
 QRect ImageCropDialog::cropRect() const {
-    return m_previewWidget->cropRect();
+    return m_previewWidget->imageCropRect();
+}
+
+// ============================================================================
+// Non-destructive crop helpers
+// ============================================================================
+
+QString ImageCropDialog::cropResourceName(const QString &baseName, const QRect &rect) {
+    return QString("%1#crop=%2,%3,%4,%5")
+           .arg(baseName)
+           .arg(rect.x()).arg(rect.y())
+           .arg(rect.width()).arg(rect.height());
+}
+
+bool ImageCropDialog::parseCropResourceName(const QString &name, QString *baseName, QRect *rect) {
+    int hash = name.lastIndexOf(QLatin1String("#crop="));
+    if (hash < 0) return false;
+
+    QStringList parts = name.mid(hash + 6).split(',');
+    if (parts.size() != 4) return false;
+
+    QRect parsed(parts[0].toInt(), parts[1].toInt(), parts[2].toInt(), parts[3].toInt());
+    if (parsed.isEmpty()) return false;
+
+    if (baseName) *baseName = name.left(hash);
+    if (rect) *rect = parsed;
+    return true;
+}
+
+// Keeps the source image alive for as long as a view into its pixels exists.
+static void releaseCropSource(void *info) {
+    delete static_cast<QImage *>(info);
+}
+
+QImage ImageCropDialog::croppedView(const QImage &image, const QRect &rect) {
+    QRect bounded = rect.intersected(image.rect());
+    if (image.isNull() || bounded.isEmpty()) return QImage();
+    if (bounded == image.rect()) return image;
+
+    // Sub-byte formats can't be addressed at an arbitrary x offset, fall back to a copy.
+    if (image.depth() < 8) return image.copy(bounded);
+
+    // Point a new header at the first cropped pixel and reuse the source stride.
+    // The cleanup function owns a shallow copy of the source, so the shared
+    // pixel buffer outlives the document resource that produced it.
+    QImage *source = new QImage(image);
+    const uchar *bits = source->constBits()
+                      + bounded.y() * source->bytesPerLine()
+                      + bounded.x() * (source->depth() / 8);
+    QImage view(bits, bounded.width(), bounded.height(), source->bytesPerLine(),
+                source->format(), releaseCropSource, source);
+    view.setDevicePixelRatio(image.devicePixelRatio());
+    return view;
 }
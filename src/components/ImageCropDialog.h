@@ -1,6 +1,7 @@
 #pragma once
 #include <QDialog>
 #include <QImage>
+#include <QPixmap>
 #include <QRect>
 #include <QPushButton>
 #include <QLabel>
@@ -15,11 +16,16 @@ public:
     void setCropRect(const QRect &rect);
     QRect cropRect() const { return m_cropRect; }
 
+    // The same crop expressed in source image pixels
+    QRect imageCropRect() const;
+    void setImageCropRect(const QRect &rect);
+
 signals:
     void cropRectChanged(const QRect &rect);
 
 protected:
     void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
     void mouseReleaseEvent(QMouseEvent *event) override;
@@ -41,8 +47,12 @@ private:
     DragMode getDragMode(const QPoint &pos);
     void updateCursor(const QPoint &pos);
     QRect constrainRect(const QRect &rect);
+    void updateLayout();
+    QRect mapToImage(const QRect &rect) const;
+    QRect mapFromImage(const QRect &rect) const;
 
     QImage m_image;
+    QPixmap m_preview; // Screen-resolution copy of m_image, rebuilt only on resize
     QRect m_cropRect;
     QPoint m_dragStart;
     DragMode m_dragMode;
@@ -54,10 +64,21 @@ class ImageCropDialog : public QDialog {
     Q_OBJECT
 
 public:
-    explicit ImageCropDialog(const QImage &image, QWidget *parent = nullptr);
+    // initialCrop is in image pixels; an empty rect starts with the full image
+    explicit ImageCropDialog(const QImage &image, const QRect &initialCrop = QRect(),
+                             QWidget *parent = nullptr);
     
     QImage croppedImage() const;
-    QRect cropRect() const;
+    QRect cropRect() const; // In source image pixels
+
+    // --- Non-destructive crop helpers ---
+    // A crop is recorded in the image format's resource name as a "#crop=x,y,w,h"
+    // fragment on the original resource, so the source pixels are never touched.
+    static QString cropResourceName(const QString &baseName, const QRect &rect);
+    static bool parseCropResourceName(const QString &name, QString *baseName, QRect *rect);
+
+    // Returns a QImage that shares the source's pixel buffer (no copy) for 8+ bpp formats.
+    static QImage croppedView(const QImage &image, const QRect &rect);
 
 private slots:
     void onApply();
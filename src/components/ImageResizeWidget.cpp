@@ -241,6 +241,7 @@ void ImageResizeWidget::onHandleDragged(QPoint delta, ResizeHandle::Position pos
 void ImageResizeWidget::onHandleDragFinished() {
     // Emit the final size
     emit resizeRequested(m_imageRect.size());
+    emit resizeFinished();
 }
 
 QRect ImageResizeWidget::calculateNewRect(const QRect &current, QPoint delta, 
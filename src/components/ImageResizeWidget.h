@@ -59,6 +59,9 @@ public:
 
 signals:
     void resizeRequested(QSize newSize);
+    // The handle was released; the resizeRequested() calls since the press
+    // were one gesture
+    void resizeFinished();
 
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -0,0 +1,340 @@
+#include "LogViewer.h"
+#include "ThemeRegistry.h"
+#include "utils/TextSearch.h"
+
+#include <QCoreApplication>
+#include <QContextMenuEvent>
+#include <QKeyEvent>
+#include <QMenu>
+#include <QPainter>
+#include <QPointer>
+#include <QScrollBar>
+#include <QTextOption>
+#include <QThreadPool>
+#include <QDebug>
+#include <climits>
+
+// =========================================================
+// LogViewer Implementation
+// =========================================================
+
+LogViewer::LogViewer(const QString &filePath, QWidget *parent)
+    : QAbstractScrollArea(parent), m_file(filePath)
+{
+    // Same face as the code editors
+    QFont font("Consolas", 11);
+    font.setStyleHint(QFont::Monospace);
+    setFont(font);
+
+    if (!m_file.open(QIODevice::ReadOnly) || !remap(m_file.size())) {
+        qWarning() << "LogViewer: could not map" << filePath << m_file.errorString();
+    }
+
+    // Appends don't reliably reach QFileSystemWatcher on every platform, and a
+    // size check once a second is next to free
+    m_pollTimer = new QTimer(this);
+    m_pollTimer->setInterval(1000);
+    connect(m_pollTimer, &QTimer::timeout, this, &LogViewer::pollFile);
+    m_pollTimer->start();
+
+    setTheme(ThemeRegistry::instance()->currentTheme());
+    connect(ThemeRegistry::instance(), &ThemeRegistry::currentThemeChanged, this, &LogViewer::setTheme);
+
+    startIndexing();
+}
+
+LogViewer::~LogViewer() {
+    if (m_cancel) *m_cancel = true;
+    if (m_map) m_file.unmap(m_map);
+}
+
+void LogViewer::setTheme(const Theme *theme) {
+    m_background = theme ? theme->color("background", QColor("#282a36")) : QColor("#282a36");
+    m_foreground = theme ? theme->color("foreground", QColor("#f8f8f2")) : QColor("#f8f8f2");
+    m_gutterBackground = m_background;
+    m_gutterForeground = theme ? theme->color("comment", Qt::gray) : QColor(Qt::gray);
+    m_markColor = m_gutterForeground;
+    m_markColor.setAlpha(60);
+    viewport()->update();
+}
+
+// ---------------------------------
+// Mapping & Indexing
+// ---------------------------------
+
+bool LogViewer::remap(qint64 size) {
+    if (m_map) m_file.unmap(m_map);
+    m_map = size > 0 ? m_file.map(0, size) : nullptr;
+    m_mappedSize = m_map ? size : 0;
+    return m_map || size == 0;
+}
+
+void LogViewer::startIndexing() {
+    if (m_indexing || m_index.indexedBytes() >= m_mappedSize) return;
+    m_indexing = true;
+
+    m_cancel = std::make_shared<std::atomic<bool>>(false);
+    std::shared_ptr<std::atomic<bool>> cancel = m_cancel;
+    const QString path = m_file.fileName();
+    const qint64 from = m_index.indexedBytes();
+    const qint64 to = m_mappedSize;
+    const qint64 newlines = m_index.newlineCount();
+    const int generation = m_generation;
+    QPointer<LogViewer> guard(this);
+
+    QThreadPool::globalInstance()->start([path, from, to, newlines, generation, cancel, guard]() {
+        // A handle of our own: the GUI thread's QFile is not to be shared
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) return;
+
+        qint64 at = from;
+        qint64 count = newlines;
+        for (;;) {
+            LineIndex::Batch batch;
+            if (!LineIndex::scan(&file, at, qMin(to, at + kBatchBytes), count, &batch, cancel.get())) return;
+
+            // Short read: the file shrank under us, pollFile() will notice
+            const bool last = batch.to >= to || batch.to == at;
+            at = batch.to;
+            count += batch.newlines;
+
+            QMetaObject::invokeMethod(qApp, [guard, generation, batch, last]() {
+                if (guard) guard->onBatch(generation, batch, last);
+            }, Qt::QueuedConnection);
+            if (last) break;
+        }
+    });
+}
+
+void LogViewer::restoreIndex(const LineIndex &index) {
+    if (index.indexedBytes() > m_mappedSize || index.indexedBytes() <= m_index.indexedBytes()) return;
+
+    // Drop the scan in progress; it would only redo what 'index' covers
+    if (m_cancel) *m_cancel = true;
+    m_indexing = false;
+    ++m_generation;
+    m_index = index;
+
+    startIndexing();
+    updateScrollBars();
+    if (m_pendingLine >= 0 && m_pendingLine < lineCount()) goToLine(m_pendingLine + 1);
+    viewport()->update();
+}
+
+void LogViewer::onBatch(int generation, const LineIndex::Batch &batch, bool last) {
+    if (generation != m_generation) return;
+
+    QScrollBar *bar = verticalScrollBar();
+    const bool atBottom = bar->value() >= bar->maximum();
+
+    m_index.append(batch);
+    if (last) m_indexing = false;
+    updateScrollBars();
+
+    if (m_pendingLine >= 0 && m_pendingLine < lineCount()) {
+        goToLine(m_pendingLine + 1);
+    } else if (m_following && atBottom) {
+        bar->setValue(bar->maximum());
+    }
+    viewport()->update();
+
+    // The file grew while this run was going
+    if (last) startIndexing();
+}
+
+void LogViewer::pollFile() {
+    const qint64 size = m_file.size();
+    if (size == m_mappedSize) return;
+
+    if (size < m_mappedSize) {
+        // Truncated: everything we know is stale
+        if (m_cancel) *m_cancel = true;
+        m_indexing = false;
+        ++m_generation;
+        m_index.reset();
+        m_maxLineWidth = 0;
+    }
+    if (!remap(size)) qWarning() << "LogViewer: could not remap" << m_file.fileName();
+
+    startIndexing();
+    updateScrollBars();
+    viewport()->update();
+}
+
+qint64 LogViewer::lineStart(qint64 line) const {
+    if (!m_map || line < 0 || line >= lineCount()) return -1;
+
+    qint64 checkpointLine = 0;
+    qint64 offset = 0;
+    m_index.checkpointFor(line, &checkpointLine, &offset);
+
+    // At most kStride - 1 vectorized newline searches
+    const QByteArrayView data(reinterpret_cast<const char *>(m_map), m_mappedSize);
+    for (qint64 l = checkpointLine; l < line; ++l) {
+        const qsizetype newline = TextSearch::indexOf(data, "\n", offset);
+        if (newline < 0) return -1;
+        offset = newline + 1;
+    }
+    return offset;
+}
+
+// ---------------------------------
+// Navigation
+// ---------------------------------
+
+void LogViewer::goToLine(qint64 lineNumber) {
+    const qint64 line = qMax<qint64>(0, lineNumber - 1);
+    QScrollBar *bar = verticalScrollBar();
+
+    if (line >= lineCount() && m_indexing) {
+        // Not indexed yet: go as far as we can and finish the jump later
+        m_pendingLine = line;
+        bar->setValue(bar->maximum());
+        return;
+    }
+
+    m_pendingLine = -1;
+    m_markedLine = qMin(line, lineCount() - 1);
+    bar->setValue(int(qMin<qint64>(m_markedLine, INT_MAX)));
+    viewport()->update();
+}
+
+qint64 LogViewer::topLine() const {
+    return verticalScrollBar()->value();
+}
+
+void LogViewer::setFollowing(bool following) {
+    m_following = following;
+    if (following) verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+}
+
+void LogViewer::updateScrollBars() {
+    const QFontMetrics fm(font());
+    const int rows = qMax(1, viewport()->height() / fm.height());
+
+    // The scroll bar counts lines; past INT_MAX lines the tail is out of reach
+    QScrollBar *bar = verticalScrollBar();
+    bar->setRange(0, int(qBound<qint64>(0, lineCount() - rows, INT_MAX)));
+    bar->setPageStep(rows);
+    bar->setSingleStep(1);
+
+    QScrollBar *hbar = horizontalScrollBar();
+    const int textWidth = viewport()->width() - gutterWidth();
+    hbar->setRange(0, qMax(0, m_maxLineWidth + 8 - textWidth));
+    hbar->setPageStep(qMax(1, textWidth));
+    hbar->setSingleStep(fm.horizontalAdvance(QLatin1Char(' ')) * 4);
+}
+
+void LogViewer::resizeEvent(QResizeEvent *event) {
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void LogViewer::keyPressEvent(QKeyEvent *event) {
+    QScrollBar *bar = verticalScrollBar();
+    switch (event->key()) {
+    case Qt::Key_Up: bar->triggerAction(QAbstractSlider::SliderSingleStepSub); break;
+    case Qt::Key_Down: bar->triggerAction(QAbstractSlider::SliderSingleStepAdd); break;
+    case Qt::Key_PageUp: bar->triggerAction(QAbstractSlider::SliderPageStepSub); break;
+    case Qt::Key_PageDown: bar->triggerAction(QAbstractSlider::SliderPageStepAdd); break;
+    case Qt::Key_Home: bar->setValue(0); break;
+    case Qt::Key_End: setFollowing(true); break; // Like "less +F"
+    case Qt::Key_Left: horizontalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepSub); break;
+    case Qt::Key_Right: horizontalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepAdd); break;
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    event->accept();
+}
+
+void LogViewer::contextMenuEvent(QContextMenuEvent *event) {
+    QMenu menu(this);
+
+    QAction *follow = menu.addAction("Follow Tail");
+    follow->setCheckable(true);
+    follow->setChecked(m_following);
+    connect(follow, &QAction::toggled, this, &LogViewer::setFollowing);
+
+    menu.addSeparator();
+    menu.addAction("Go to Top", this, [this]() { verticalScrollBar()->setValue(0); });
+    menu.addAction("Go to End", this, [this]() {
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    });
+
+    menu.exec(event->globalPos());
+}
+
+// ---------------------------------
+// Painting
+// ---------------------------------
+
+int LogViewer::gutterWidth() const {
+    const int digits = QString::number(qMax<qint64>(1, lineCount())).size();
+    return 12 + QFontMetrics(font()).horizontalAdvance(QLatin1Char('9')) * digits;
+}
+
+void LogViewer::paintEvent(QPaintEvent *event) {
+    // Touching a mapped page past the end of a truncated file would crash,
+    // so check before every paint rather than waiting for the poll
+    if (m_file.size() < m_mappedSize) pollFile();
+
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), m_background);
+
+    const QFontMetrics fm(font());
+    const int lineHeight = fm.height();
+    const int gutter = gutterWidth();
+    const int width = viewport()->width();
+    const int rows = viewport()->height() / lineHeight + 1;
+    const int xOffset = horizontalScrollBar()->value();
+
+    painter.fillRect(0, 0, gutter, viewport()->height(), m_gutterBackground);
+
+    const qint64 first = verticalScrollBar()->value();
+    qint64 offset = lineStart(first);
+    if (offset < 0) return;
+
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    option.setTabStopDistance(fm.horizontalAdvance(QLatin1Char(' ')) * 4);
+    const qreal charWidth = fm.horizontalAdvance(QLatin1Char('m'));
+
+    const QByteArrayView data(reinterpret_cast<const char *>(m_map), m_mappedSize);
+    const qint64 lines = lineCount();
+    int widest = m_maxLineWidth;
+
+    for (int row = 0; row < rows; ++row) {
+        const qint64 line = first + row;
+        if (line >= lines || offset >= m_mappedSize) break;
+
+        qint64 end = TextSearch::indexOf(data, "\n", offset);
+        if (end < 0) end = m_mappedSize;
+
+        // Only what is drawn gets decoded
+        QString text = QString::fromUtf8(data.sliced(offset, qMin(end - offset, kMaxLineBytes)));
+        if (text.endsWith(QLatin1Char('\r'))) text.chop(1);
+        if (end - offset > kMaxLineBytes) text += QStringLiteral(" …");
+
+        const int y = row * lineHeight;
+        if (line == m_markedLine) painter.fillRect(gutter, y, width - gutter, lineHeight, m_markColor);
+
+        painter.setClipRect(gutter, 0, width - gutter, viewport()->height());
+        painter.setPen(m_foreground);
+        painter.drawText(QRectF(gutter + 4 - xOffset, y, 1e7, lineHeight), text, option);
+        painter.setClipping(false);
+
+        painter.setPen(m_gutterForeground);
+        painter.drawText(QRect(0, y, gutter - 6, lineHeight), Qt::AlignRight | Qt::AlignVCenter,
+                         QString::number(line + 1));
+
+        widest = qMax(widest, int(text.size() * charWidth));
+        offset = end + 1;
+    }
+
+    // Horizontal range grows with the widest line seen (not known up front)
+    if (widest > m_maxLineWidth) {
+        m_maxLineWidth = widest;
+        QMetaObject::invokeMethod(this, &LogViewer::updateScrollBars, Qt::QueuedConnection);
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QTimer>
+#include <QColor>
+#include <atomic>
+#include <memory>
+
+#include "LineIndex.h"
+
+struct Theme;
+
+// Read-only tab for files too large to edit (multi-GB logs).
+//
+// The file is memory-mapped, so nothing is loaded up front and only the pages
+// of the lines on screen are touched. A worker builds the sparse LineIndex in
+// batches; the view is usable after the first batch and the scroll range
+// grows as the rest comes in. Painting decodes just the visible lines.
+//
+// Growth is picked up by polling: new bytes are mapped and indexed, and if the
+// view was at the bottom it stays there (tail -f). A file that shrinks was
+// truncated (copytruncate log rotation) and is indexed again from the start.
+class LogViewer : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    // Files at least this large open here instead of in a CodeEditor
+    static constexpr qint64 kSizeThreshold = 64 * 1024 * 1024;
+
+    explicit LogViewer(const QString &filePath, QWidget *parent = nullptr);
+    ~LogViewer();
+
+    bool isOpen() const { return m_file.isOpen(); }
+    QString filePath() const { return m_file.fileName(); }
+
+    // Lines indexed so far (all of them once indexing is done)
+    qint64 lineCount() const { return m_index.lineCount(); }
+    bool isIndexing() const { return m_indexing; }
+
+    // The index so far, and one built earlier for the same bytes (see
+    // Session::loadLineIndex). Indexing continues from where that one ends.
+    const LineIndex &lineIndex() const { return m_index; }
+    void restoreIndex(const LineIndex &index);
+
+    // 0-based line at the top of the view
+    qint64 topLine() const;
+
+    // Scrolls a 1-based line to the top. Lines not indexed yet are jumped to
+    // as soon as the index reaches them.
+    void goToLine(qint64 lineNumber);
+
+    // Keeps the last line in view while the file grows
+    void setFollowing(bool following);
+    bool isFollowing() const { return m_following; }
+
+    void setTheme(const Theme *theme);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void contextMenuEvent(QContextMenuEvent *event) override;
+
+private slots:
+    void pollFile();
+
+private:
+    static constexpr qint64 kBatchBytes = 64 * 1024 * 1024; // Index merged per batch
+    static constexpr qint64 kMaxLineBytes = 16 * 1024;     // Longer lines are cut for display
+
+    bool remap(qint64 size);
+    void startIndexing();
+    void onBatch(int generation, const LineIndex::Batch &batch, bool last);
+    void updateScrollBars();
+    qint64 lineStart(qint64 line) const;
+    int gutterWidth() const;
+
+    QFile m_file;
+    uchar *m_map = nullptr;
+    qint64 m_mappedSize = 0;
+
+    LineIndex m_index;
+    bool m_indexing = false;
+    int m_generation = 0;                     // Bumped when the index is reset
+    std::shared_ptr<std::atomic<bool>> m_cancel;
+
+    QTimer *m_pollTimer;
+    bool m_following = false;
+    qint64 m_pendingLine = -1;                // goToLine() target past the index
+    qint64 m_markedLine = -1;                 // Last goToLine() target, highlighted
+
+    int m_maxLineWidth = 0;                   // Widest line painted so far (horizontal range)
+
+    QColor m_background;
+    QColor m_foreground;
+    QColor m_gutterBackground;
+    QColor m_gutterForeground;
+    QColor m_markColor;
+};
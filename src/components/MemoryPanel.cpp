@@ -0,0 +1,197 @@
+#include "MemoryPanel.h"
+#include "EditorArea.h"
+#include "CodeEditor.h"
+#include "RichTextEditor.h"
+#include "LogViewer.h"
+#include "LazyImageStore.h"
+#include "UndoHistory.h"
+
+#include <QDateTime>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLocale>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+namespace {
+
+QString formatBytes(qint64 bytes) {
+    if (bytes < 0) return QStringLiteral("?");
+    return QLocale::system().formattedDataSize(bytes, 1, QLocale::DataSizeTraditionalFormat);
+}
+
+} // namespace
+
+MemoryPanel::MemoryPanel(EditorArea *editorArea, QWidget *parent)
+    : QDialog(parent), m_editorArea(editorArea)
+{
+    setWindowTitle("Memory");
+    resize(640, 520);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    m_summary = new QLabel(this);
+    m_summary->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    layout->addWidget(m_summary);
+
+    m_subsystems = new QTreeWidget(this);
+    m_subsystems->setRootIsDecorated(false);
+    m_subsystems->setHeaderLabels({"Subsystem", "Live", "Blocks", "Allocs/s", "Allocated (total)"});
+    layout->addWidget(m_subsystems, 1);
+
+    m_tabs = new QTreeWidget(this);
+    m_tabs->setRootIsDecorated(false);
+    m_tabs->setHeaderLabels({"Tab", "Text", "Undo", "Images", "Decoded", "Encoded"});
+    m_tabs->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    layout->addWidget(m_tabs, 1);
+
+    QHBoxLayout *buttons = new QHBoxLayout();
+    QPushButton *save = new QPushButton("Save JSON...", this);
+    QPushButton *close = new QPushButton("Close", this);
+    connect(save, &QPushButton::clicked, this, &MemoryPanel::saveJson);
+    connect(close, &QPushButton::clicked, this, &QDialog::close);
+    buttons->addStretch();
+    buttons->addWidget(save);
+    buttons->addWidget(close);
+    layout->addLayout(buttons);
+
+    // Only ticks while the panel is open
+    m_timer = new QTimer(this);
+    m_timer->setInterval(1000);
+    connect(m_timer, &QTimer::timeout, this, &MemoryPanel::refresh);
+}
+
+void MemoryPanel::showEvent(QShowEvent *event) {
+    QDialog::showEvent(event);
+    refresh();
+    m_timer->start();
+}
+
+void MemoryPanel::hideEvent(QHideEvent *event) {
+    m_timer->stop();
+    QDialog::hideEvent(event);
+}
+
+// ---------------------------------
+// Reports
+// ---------------------------------
+
+// Per-tab estimates from the editors themselves; these don't need the
+// allocation hook. QTextDocument stores text as UTF-16.
+QJsonArray MemoryPanel::tabReport() const {
+    QJsonArray tabs;
+    for (const QString &path : m_editorArea->openFiles()) {
+        QWidget *editor = m_editorArea->editorFor(path);
+        QJsonObject tab;
+        tab["path"] = path;
+
+        QTextDocument *document = nullptr;
+        if (auto *code = qobject_cast<CodeEditor *>(editor)) {
+            tab["kind"] = "code";
+            document = code->document();
+            if (code->undoHistory()) tab["undo_bytes"] = code->undoHistory()->memoryUsage();
+        } else if (auto *rich = qobject_cast<RichTextEditor *>(editor)) {
+            tab["kind"] = "rich";
+            document = rich->document();
+            if (const LazyImageStore *images = rich->imageStore()) {
+                tab["images"] = images->imageCount();
+                tab["images_decoded_bytes"] = images->decodedBytes();
+                tab["images_encoded_bytes"] = images->encodedBytes();
+            }
+        } else if (auto *log = qobject_cast<LogViewer *>(editor)) {
+            // Mapped, not loaded: the kernel pages it in and out as needed
+            tab["kind"] = "log";
+            tab["mapped_bytes"] = QFileInfo(path).size();
+            tab["lines"] = log->lineCount();
+        }
+
+        if (document) {
+            tab["characters"] = document->characterCount();
+            tab["blocks"] = document->blockCount();
+            tab["text_bytes"] = qint64(document->characterCount()) * 2;
+        }
+        tabs.append(tab);
+    }
+    return tabs;
+}
+
+QJsonObject MemoryPanel::report() const {
+    QJsonObject report = MemoryAccounting::snapshot();
+    report["time"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    report["tabs"] = tabReport();
+    return report;
+}
+
+void MemoryPanel::refresh() {
+    const QJsonObject current = report();
+    const MemoryAccounting::Counters total = MemoryAccounting::total();
+
+    QString summary = QString("Resident: %1").arg(formatBytes(MemoryAccounting::residentBytes()));
+    if (MemoryAccounting::isEnabled()) {
+        summary += QString("    operator new: %1 in %2 blocks").arg(formatBytes(total.liveBytes)).arg(total.liveBlocks);
+        summary += "\nCounts operator new only; QString, QByteArray, QVector and QImage data"
+                   " (malloc) is not included.";
+    } else {
+        summary += "\nStart with QT_EDITOR_MEMORY_ACCOUNTING=1 to count heap allocations per subsystem.";
+    }
+    m_summary->setText(summary);
+
+    // --- Subsystems ---
+    const double seconds = m_sinceLast.isValid() ? m_sinceLast.restart() / 1000.0 : 0.0;
+    if (!m_sinceLast.isValid()) m_sinceLast.start();
+
+    m_subsystems->clear();
+    m_subsystems->setEnabled(MemoryAccounting::isEnabled());
+    for (int i = 0; i < MemoryAccounting::SubsystemCount; ++i) {
+        const auto subsystem = MemoryAccounting::Subsystem(i);
+        const MemoryAccounting::Counters c = MemoryAccounting::counters(subsystem);
+        const qint64 newAllocations = c.allocations - m_lastAllocations[i];
+        m_lastAllocations[i] = c.allocations;
+
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_subsystems);
+        item->setText(0, MemoryAccounting::subsystemName(subsystem));
+        item->setText(1, formatBytes(c.liveBytes));
+        item->setText(2, QString::number(c.liveBlocks));
+        item->setText(3, seconds > 0 ? QString::number(qRound64(newAllocations / seconds)) : QString("-"));
+        item->setText(4, formatBytes(c.allocatedBytes));
+    }
+
+    // --- Tabs ---
+    m_tabs->clear();
+    for (const QJsonValue &value : current["tabs"].toArray()) {
+        const QJsonObject tab = value.toObject();
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_tabs);
+        item->setText(0, QFileInfo(tab["path"].toString()).fileName());
+        item->setToolTip(0, tab["path"].toString());
+
+        if (tab["kind"] == "log") {
+            item->setText(1, formatBytes(tab["mapped_bytes"].toInteger()) + " (mapped)");
+            continue;
+        }
+        item->setText(1, formatBytes(tab["text_bytes"].toInteger()));
+        if (tab.contains("undo_bytes")) item->setText(2, formatBytes(tab["undo_bytes"].toInteger()));
+        if (tab.contains("images")) {
+            item->setText(3, QString::number(tab["images"].toInt()));
+            item->setText(4, formatBytes(tab["images_decoded_bytes"].toInteger()));
+            item->setText(5, formatBytes(tab["images_encoded_bytes"].toInteger()));
+        }
+    }
+    for (int column = 1; column < m_tabs->columnCount(); ++column) m_tabs->resizeColumnToContents(column);
+}
+
+void MemoryPanel::saveJson() {
+    QString path = QFileDialog::getSaveFileName(this, "Save Memory Report", "memory.json", "JSON (*.json)");
+    if (path.isEmpty()) return;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, "Error", "Could not save the memory report.");
+        return;
+    }
+    file.write(QJsonDocument(report()).toJson());
+}
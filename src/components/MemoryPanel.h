@@ -0,0 +1,51 @@
+#pragma once
+#include <QDialog>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QLabel>
+#include <QTimer>
+#include <QTreeWidget>
+
+#include "MemoryAccounting.h"
+
+class EditorArea;
+
+// View > Memory: where the editor's memory goes, refreshed every second.
+//
+// The upper list shows the heap per subsystem (MemoryAccounting) with the
+// allocation rate since the last refresh, to spot churn on hot paths. It
+// needs the app to be started with QT_EDITOR_MEMORY_ACCOUNTING=1.
+// The lower list is always available and estimates what each open tab holds:
+// document text, undo history, embedded images (encoded and decoded).
+// "Save JSON..." writes both, together with the process RSS.
+class MemoryPanel : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit MemoryPanel(EditorArea *editorArea, QWidget *parent = nullptr);
+
+    // Everything the panel shows, as one JSON object
+    QJsonObject report() const;
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void refresh();
+    void saveJson();
+
+private:
+    QJsonArray tabReport() const;
+
+    EditorArea *m_editorArea;
+    QLabel *m_summary;
+    QTreeWidget *m_subsystems;
+    QTreeWidget *m_tabs;
+    QTimer *m_timer;
+
+    // For the allocation rate
+    qint64 m_lastAllocations[MemoryAccounting::SubsystemCount] = {};
+    QElapsedTimer m_sinceLast;
+};
@@ -0,0 +1,205 @@
+#include "Minimap.h"
+#include "CodeEditor.h"
+#include "Highlighter.h"
+#include "ThemeRegistry.h"
+#include "BlockData.h"
+
+#include <QPainter>
+#include <QScrollBar>
+#include <QCoreApplication>
+#include <algorithm>
+
+// =========================================================
+// Minimap Implementation
+// =========================================================
+
+Minimap::Minimap(CodeEditor *editor, Highlighter *highlighter)
+    : QWidget(editor), m_editor(editor), m_highlighter(highlighter),
+      m_tiles(16 * 1024) // 16 MiB of tiles, about 75 tiles or 19k lines
+{
+    // We fill every pixel ourselves
+    setAttribute(Qt::WA_OpaquePaintEvent);
+
+    m_blockCount = editor->document()->blockCount();
+
+    connect(highlighter, &Highlighter::blockColorsChanged, this, &Minimap::onBlockColorsChanged);
+    connect(editor->document(), &QTextDocument::contentsChange, this, &Minimap::onContentsChange);
+
+    // Follow the editor's scrolling (moves the slider, and the map itself for long files)
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, QOverload<>::of(&QWidget::update));
+
+    applyTheme(highlighter->theme());
+}
+
+void Minimap::applyTheme(const Theme *theme) {
+    // Tiles hold final colors, so every tile is stale now
+    m_tiles.clear();
+
+    auto premultiplied = [](QColor color, int alpha) {
+        color.setAlpha(alpha);
+        return qPremultiply(color.rgba());
+    };
+
+    QColor foreground = theme ? theme->color("foreground", Qt::lightGray) : QColor(Qt::lightGray);
+    m_plainColor = premultiplied(foreground, 150);
+
+    m_scopeColors.clear();
+    for (const QTextCharFormat &format : m_highlighter->formats()) {
+        QColor color = format.hasProperty(QTextFormat::ForegroundBrush)
+                           ? format.foreground().color() : foreground;
+        m_scopeColors.append(premultiplied(color, 210));
+    }
+
+    // Slightly set apart from the text area
+    m_background = (theme ? theme->color("background", QColor("#282a36")) : QColor("#282a36")).darker(112);
+    m_sliderColor = foreground;
+    m_sliderColor.setAlpha(40);
+
+    update();
+}
+
+// ---------------------------------
+// Geometry
+// ---------------------------------
+
+void Minimap::visibleBlockRange(int *firstBlock, int *visibleBlocks) const {
+    // The editor scrolls in visual lines; map the top and bottom line back to
+    // blocks (tree lookups, so folded regions cost nothing)
+    QTextDocument *doc = m_editor->document();
+    *firstBlock = doc->findBlockByLineNumber(m_editor->verticalScrollBar()->value()).blockNumber();
+    int lastBlock = m_editor->cursorForPosition(QPoint(0, m_editor->viewport()->height() - 1))
+                        .block().blockNumber();
+    *firstBlock = qMax(0, *firstBlock);
+    *visibleBlocks = qMax(1, lastBlock - *firstBlock + 1);
+}
+
+int Minimap::scrollOffset(int firstBlock, int visibleBlocks) const {
+    const qint64 documentHeight = qint64(m_editor->document()->blockCount()) * kLinePixels;
+    if (documentHeight <= height()) return 0;
+
+    // Top of the editor at the top of the document -> offset 0,
+    // bottom of the editor at the end -> last pixel of the map at the bottom
+    const int maxFirst = qMax(1, m_editor->document()->blockCount() - visibleBlocks);
+    const int first = qMin(firstBlock, maxFirst);
+    return int((documentHeight - height()) * first / maxFirst);
+}
+
+// ---------------------------------
+// Tiles
+// ---------------------------------
+
+QImage *Minimap::tile(int index) {
+    if (QImage *cached = m_tiles.object(index)) return cached;
+
+    auto *image = new QImage(kWidth, kTileRows * kLinePixels, QImage::Format_ARGB32_Premultiplied);
+    image->fill(Qt::transparent);
+
+    // One lookup for the first block, then walk the tile's rows
+    QTextBlock block = m_editor->document()->findBlockByNumber(index * kTileRows);
+    for (int row = 0; row < kTileRows && block.isValid(); ++row, block = block.next()) {
+        renderRow(image, row, block);
+    }
+
+    const int costKiB = qMax<qsizetype>(1, image->sizeInBytes() / 1024);
+    m_tiles.insert(index, image, costKiB);
+    return m_tiles.object(index);
+}
+
+void Minimap::renderRow(QImage *image, int row, const QTextBlock &block) const {
+    // Lines are one pixel of color with a one pixel gap, which reads as text
+    auto *line = reinterpret_cast<QRgb *>(image->scanLine(row * kLinePixels));
+    std::fill(line, line + image->width(), 0);
+
+    auto *data = static_cast<BlockData *>(block.userData());
+    if (!data) return;
+
+    for (const ColorRun &run : std::as_const(data->colors)) {
+        const QRgb color = run.scope < m_scopeColors.size() ? m_scopeColors[run.scope] : m_plainColor;
+        const int from = qMin(image->width(), kMargin + run.column);
+        const int to = qMin(image->width(), from + run.length);
+        std::fill(line + from, line + to, color);
+    }
+}
+
+void Minimap::onBlockColorsChanged(const QTextBlock &block) {
+    // Nothing rendered yet, e.g. during the first highlighting pass
+    if (m_tiles.isEmpty()) return;
+
+    // Redraw just this row inside its cached tile
+    const int number = block.blockNumber();
+    if (QImage *image = m_tiles.object(number / kTileRows)) {
+        renderRow(image, number % kTileRows, block);
+        update();
+    }
+}
+
+void Minimap::onContentsChange(int position, int /*charsRemoved*/, int /*charsAdded*/) {
+    const int blockCount = m_editor->document()->blockCount();
+    if (blockCount != m_blockCount) {
+        // Every row below the edit moved; drop those tiles. Only the ones on
+        // screen are rebuilt, on the next paint.
+        const int firstTile = m_editor->document()->findBlock(position).blockNumber() / kTileRows;
+        const QList<int> keys = m_tiles.keys();
+        for (int key : keys) {
+            if (key >= firstTile) m_tiles.remove(key);
+        }
+        m_blockCount = blockCount;
+    }
+    update();
+}
+
+// ---------------------------------
+// Painting and Interaction
+// ---------------------------------
+
+void Minimap::paintEvent(QPaintEvent *event) {
+    QPainter painter(this);
+    painter.fillRect(event->rect(), m_background);
+
+    int firstBlock = 0;
+    int visibleBlocks = 1;
+    visibleBlockRange(&firstBlock, &visibleBlocks);
+    const int offset = scrollOffset(firstBlock, visibleBlocks);
+
+    // Draw only the tiles that intersect the dirty rect
+    const int tileHeight = kTileRows * kLinePixels;
+    const int lastTile = qMin((m_editor->document()->blockCount() - 1) / kTileRows,
+                              (offset + event->rect().bottom()) / tileHeight);
+    for (int index = (offset + event->rect().top()) / tileHeight; index <= lastTile; ++index) {
+        if (QImage *image = tile(index)) {
+            painter.drawImage(0, index * tileHeight - offset, *image);
+        }
+    }
+
+    // The part of the document the editor currently shows
+    painter.fillRect(QRect(0, firstBlock * kLinePixels - offset, width(),
+                           qMax(4, visibleBlocks * kLinePixels)),
+                     m_sliderColor);
+}
+
+void Minimap::scrollEditorTo(int y) {
+    int firstBlock = 0;
+    int visibleBlocks = 1;
+    visibleBlockRange(&firstBlock, &visibleBlocks);
+
+    // Center the clicked line in the editor
+    const int clicked = (y + scrollOffset(firstBlock, visibleBlocks)) / kLinePixels;
+    const int target = qBound(0, clicked - visibleBlocks / 2, m_editor->document()->blockCount() - 1);
+    QTextBlock block = m_editor->document()->findBlockByNumber(target);
+    m_editor->verticalScrollBar()->setValue(block.firstLineNumber());
+}
+
+void Minimap::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton) scrollEditorTo(event->pos().y());
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent *event) {
+    // Dragging keeps scrolling
+    if (event->buttons() & Qt::LeftButton) scrollEditorTo(event->pos().y());
+}
+
+void Minimap::wheelEvent(QWheelEvent *event) {
+    // Scroll the editor as if the wheel was turned over its text
+    QCoreApplication::sendEvent(m_editor->viewport(), event);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <QWidget>
+#include <QCache>
+#include <QImage>
+#include <QVector>
+#include <QTextBlock>
+
+class CodeEditor;
+class Highlighter;
+struct Theme;
+
+// Overview of the whole document drawn beside a CodeEditor: one 2px row per
+// line, colored from the per-block ColorRun summaries the Highlighter keeps.
+//
+// Rows are rendered into tiles of kTileRows lines that are cached (QCache,
+// least recently used tiles are dropped). Scrolling only renders tiles that
+// weren't on screen recently, and when the highlighter recolors a block only
+// that block's row is redrawn inside its cached tile. Inserting or removing
+// lines drops the tiles from the edit downwards; they are rebuilt when they
+// are next painted.
+class Minimap : public QWidget {
+    Q_OBJECT
+
+public:
+    static constexpr int kWidth = 110;
+
+    Minimap(CodeEditor *editor, Highlighter *highlighter);
+
+    // Recolors everything (the colors live in the tiles, not in the summaries)
+    void applyTheme(const Theme *theme);
+
+    QSize sizeHint() const override { return QSize(kWidth, 0); }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+
+private slots:
+    void onBlockColorsChanged(const QTextBlock &block);
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    static constexpr int kLinePixels = 2;
+    static constexpr int kTileRows = 256;
+    static constexpr int kMargin = 4;
+
+    // Pixel offset of the minimap's top inside the full-document image. When
+    // the document is taller than the widget the minimap scrolls along with
+    // the editor, proportionally.
+    int scrollOffset(int firstBlock, int visibleBlocks) const;
+    void visibleBlockRange(int *firstBlock, int *visibleBlocks) const;
+
+    QImage *tile(int index);
+    void renderRow(QImage *image, int row, const QTextBlock &block) const;
+    void scrollEditorTo(int y);
+
+    CodeEditor *m_editor;
+    Highlighter *m_highlighter;
+
+    QVector<QRgb> m_scopeColors; // Premultiplied, per grammar scope
+    QRgb m_plainColor = 0;
+    QColor m_background;
+    QColor m_sliderColor;
+
+    QCache<int, QImage> m_tiles; // Tile index -> image, cost in KiB
+    int m_blockCount = 0;
+};
@@ -1,32 +1,22 @@
 #include "ProjectSidebar.h"
 
+#include <QApplication>
+#include <QKeyEvent>
+#include <algorithm>
+
 // ProjectSidebar constructor
 ProjectSidebar::ProjectSidebar(QWidget *parent) : QWidget(parent) {
     // Create a vertical box layout for the sidebar
     QVBoxLayout *layout = new QVBoxLayout(this);
     layout->setContentsMargins(0, 0, 0, 0); // Remove margins to fit content tightly
 
-    // --- Setup Model ---
-    // QFileSystemModel provides a data model for the local filesystem
-    m_model = new QFileSystemModel(this);
-    // Set the root path of the model to the system's root directory
-    m_model->setRootPath(QDir::rootPath());
-
     // --- Setup View ---
-    // QTreeView provides a view for the filesystem model
+    // QTreeView provides a view for the filesystem model (see populate())
     m_treeView = new QTreeView(this);
-    // Set the model for the tree view
-    m_treeView->setModel(m_model);
     // Disable editing triggers in the tree view
     m_treeView->setEditTriggers(QAbstractItemView::NoEditTriggers);
-    // Set the root index of the tree view to the application's current directory
-    m_treeView->setRootIndex(m_model->index(QDir::currentPath())); 
-    
-    // --- Aesthetics ---
-    // Hide columns for size, type, and date modified for a cleaner look
-    m_treeView->hideColumn(1); // Size
-    m_treeView->hideColumn(2); // Type
-    m_treeView->hideColumn(3); // Date
+    // Ctrl+Click / Shift+Click select several files, Enter opens them all
+    m_treeView->setSelectionMode(QAbstractItemView::ExtendedSelection);
     // Hide the header of the tree view
     m_treeView->setHeaderHidden(true); 
 
@@ -39,6 +29,8 @@ ProjectSidebar::ProjectSidebar(QWidget *parent) : QWidget(parent) {
 
     // Install an event filter on the tree view's viewport to handle mouse events
     m_treeView->viewport()->installEventFilter(this);
+    // ... and on the tree view itself for the Enter key
+    m_treeView->installEventFilter(this);
 
     // Add the tree view to the layout
     layout->addWidget(m_treeView);
@@ -52,11 +44,34 @@ ProjectSidebar::ProjectSidebar(QWidget *parent) : QWidget(parent) {
     connect(m_treeView, &QTreeView::customContextMenuRequested, this, &ProjectSidebar::showContextMenu);
 }
 
+// Builds the model after startup. QFileSystemModel lists directories on its
+// own thread; only the current directory is watched, not the whole disk.
+void ProjectSidebar::populate() {
+    if (m_model) return;
+
+    // --- Setup Model ---
+    // QFileSystemModel provides a data model for the local filesystem
+    m_model = new QFileSystemModel(this);
+    m_model->setRootPath(QDir::currentPath());
+
+    // Set the model for the tree view, rooted at the application's current directory
+    m_treeView->setModel(m_model);
+    m_treeView->setRootIndex(m_model->index(QDir::currentPath()));
+
+    // --- Aesthetics ---
+    // Hide columns for size, type, and date modified for a cleaner look
+    m_treeView->hideColumn(1); // Size
+    m_treeView->hideColumn(2); // Type
+    m_treeView->hideColumn(3); // Date
+}
+
 // --- SIGNAL PROPAGATION ---
 // Slot to handle double-click events on the tree view
 void ProjectSidebar::onDoubleClicked(const QModelIndex &index) {
     // Check if the index is valid before proceeding
-    if (index.isValid()) {
+    // A click that extends the selection only selects
+    if (QApplication::keyboardModifiers() & (Qt::ControlModifier | Qt::ShiftModifier)) return;
+    if (index.isValid() && m_model) {
         // Get file information for the clicked index
         QFileInfo info = m_model->fileInfo(index);
         // If the item is a file, emit the fileClicked signal with the file path
@@ -79,6 +94,14 @@ bool ProjectSidebar::eventFilter(QObject *object, QEvent *event) {
             m_treeView->setCurrentIndex(QModelIndex());
         }
     }
+    // Enter opens every selected file
+    if (object == m_treeView && event->type() == QEvent::KeyPress) {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        if (keyEvent->key() == Qt::Key_Return || keyEvent->key() == Qt::Key_Enter) {
+            openSelected();
+            return true;
+        }
+    }
     // Pass the event to the base class for default processing
     return QWidget::eventFilter(object, event);
 }
@@ -86,12 +109,20 @@ bool ProjectSidebar::eventFilter(QObject *object, QEvent *event) {
 // --- CONTEXT MENU LOGIC ---
 // Show a context menu when requested
 void ProjectSidebar::showContextMenu(const QPoint &pos) {
+    if (!m_model) return; // Not populated yet
     // Get the index of the item at the requested position
     QModelIndex index = m_treeView->indexAt(pos);
     // Create a new context menu
     QMenu menu(this);
 
     // --- Actions ---
+    QAction *openAll = nullptr;
+    const int selectedCount = selectedFiles().size();
+    if (selectedCount > 1) {
+        openAll = menu.addAction(QString("Open %1 Files").arg(selectedCount));
+        menu.addSeparator();
+    }
+
     // Add actions for creating a new file and a new folder
     QAction *newFile = menu.addAction("New File");
     QAction *newFolder = new QAction("New Folder", this);
@@ -111,12 +142,33 @@ void ProjectSidebar::showContextMenu(const QPoint &pos) {
     QAction *selected = menu.exec(m_treeView->viewport()->mapToGlobal(pos));
 
     // Perform actions based on the selected item
+    if (openAll && selected == openAll) openSelected();
     if (selected == newFile) createNewFile();
     if (selected == newFolder) createNewFolder();
     if (selected == rename) renameItem();
     if (selected == del) deleteItem();
 }
 
+QStringList ProjectSidebar::selectedFiles() const {
+    QStringList files;
+    if (!m_model) return files;
+    QModelIndexList rows = m_treeView->selectionModel()->selectedRows();
+    std::sort(rows.begin(), rows.end(), [this](const QModelIndex &a, const QModelIndex &b) {
+        return m_treeView->visualRect(a).top() < m_treeView->visualRect(b).top();
+    });
+    for (const QModelIndex &index : rows) {
+        QFileInfo info = m_model->fileInfo(index);
+        if (info.isFile()) files << info.absoluteFilePath();
+    }
+    return files;
+}
+
+// Opens all selected files; they are read in parallel (EditorArea::openFileList)
+void ProjectSidebar::openSelected() {
+    const QStringList files = selectedFiles();
+    if (!files.isEmpty()) emit filesOpenRequested(files);
+}
+
 // Create a new file in the selected directory
 void ProjectSidebar::createNewFile() {
     // Determine the path for the new file
@@ -18,9 +18,15 @@ class ProjectSidebar : public QWidget {
 public:
     explicit ProjectSidebar(QWidget *parent = nullptr);
 
+    // Creates the file system model for the current directory. Deferred until
+    // after the first frame (see MainWindow); the tree is empty until then.
+    void populate();
+
 signals:
     // Signal to tell MainWindow: "Hey, the user wants to open this file!"
     void fileClicked(const QString &filePath);
+    // Several files at once: the selection, opened with Enter or the context menu
+    void filesOpenRequested(const QStringList &filePaths);
 
 protected:
     // More robust way to handle mouse events on the tree view
@@ -31,12 +37,16 @@ private slots:
     void showContextMenu(const QPoint &pos);
     
     // Actions
+    void openSelected();
     void createNewFile();
     void createNewFolder();
     void deleteItem();
     void renameItem();
 
 private:
-    QFileSystemModel *m_model;
+    // Files (not folders) in the selection, in tree order
+    QStringList selectedFiles() const;
+
+    QFileSystemModel *m_model = nullptr;
     QTreeView *m_treeView;
 };
\ No newline at end of file
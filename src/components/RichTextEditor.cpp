@@ -1,6 +1,10 @@
 #include "RichTextEditor.h"
 #include "ImageResizeWidget.h"
 #include "ImageCropDialog.h"
+#include "utils/ImageCodec.h"
+#include "LazyImageStore.h"
+#include "RichHtmlWriter.h"
+#include "ThemeRegistry.h"
 #include <QVBoxLayout>
 #include <QFont>
 #include <QTextCharFormat>
@@ -13,6 +17,9 @@
 #include <QTextBlock>
 #include <QAbstractTextDocumentLayout>
 #include <QScrollBar>
+#include <QPixmap>
+#include <QSet>
+#include <QTimer>
 
 // Define fixed widths for the different page size options.
 int SMALL_PAGE_WIDTH = 600;
@@ -57,7 +64,35 @@ RichTextEditor::RichTextEditor(QWidget *parent)
 
     // Enable mouse tracking to detect hovering
     m_editor->viewport()->setMouseTracking(true);
+
+    // Follow View > Theme switches
+    connect(ThemeRegistry::instance(), &ThemeRegistry::currentThemeChanged,
+            this, &RichTextEditor::setTheme);
     
+    // --- Lazy Image Loading ---
+    // Images of loaded documents live compressed in the store. The document asks
+    // our resource provider for them only when it paints them, and the provider
+    // result is not cached by Qt, so the store alone decides what stays decoded.
+    m_imageStore = new LazyImageStore(m_editor->document());
+    m_editor->document()->setResourceProvider([this](const QUrl &url) {
+        return lazyResource(url);
+    });
+
+    // Copies and drags carry the images themselves, like a save does
+    m_editor->setHtmlExporter([this](const QString &html) {
+        return m_imageStore->restoreImages(bakeCroppedImages(html));
+    });
+
+    // Re-evaluate the decode window shortly after scrolling or resizing stops.
+    m_imageWindowTimer = new QTimer(this);
+    m_imageWindowTimer->setSingleShot(true);
+    m_imageWindowTimer->setInterval(50);
+    connect(m_imageWindowTimer, &QTimer::timeout, this, &RichTextEditor::updateImageWindow);
+    connect(m_editor->verticalScrollBar(), &QScrollBar::valueChanged,
+            m_imageWindowTimer, QOverload<>::of(&QTimer::start));
+    connect(m_editor->verticalScrollBar(), &QScrollBar::rangeChanged,
+            m_imageWindowTimer, QOverload<>::of(&QTimer::start));
+
     // Connect the editor's cursor position changes to a slot that updates the toolbar buttons.
     // This ensures the "Bold" button is checked when the cursor is on bold text.
     connect(m_editor, &QTextEdit::cursorPositionChanged, this, &RichTextEditor::onCursorPositionChanged);
@@ -91,6 +126,10 @@ void RichTextEditor::setupToolbar() {
     m_actImage = m_toolbar->addAction("Img");
     m_actImage->setToolTip("Insert Image");
 
+    m_actCrop = m_toolbar->addAction("Crop");
+    m_actCrop->setToolTip("Crop Selected Image");
+    m_actCrop->setEnabled(false); // Enabled while an image is selected
+
     m_toolbar->addSeparator(); // Visually separate actions.
 
     // --- Page Size Control ---
@@ -105,6 +144,7 @@ void RichTextEditor::setupToolbar() {
     connect(m_actItalic, &QAction::triggered, this, &RichTextEditor::toggleItalic);
     connect(m_actUnderline, &QAction::triggered, this, &RichTextEditor::toggleUnderline);
     connect(m_actImage, &QAction::triggered, this, &RichTextEditor::insertImage);
+    connect(m_actCrop, &QAction::triggered, this, &RichTextEditor::cropImage);
     connect(m_sizeCombo, QOverload<int>::of(&QComboBox::activated), this, &RichTextEditor::onPageSizeChanged);
 }
 
@@ -128,11 +168,40 @@ void RichTextEditor::onPageSizeChanged(int index) {
 // --- Public API ---
 
 void RichTextEditor::setHtml(const QString &text) {
-    m_editor->setHtml(text);
+    // Hand Qt the HTML with the embedded images pulled out; they are decoded
+    // later, only when they come near the viewport (see updateImageWindow).
+    m_editor->setHtml(m_imageStore->extractImages(text));
+    m_imageWindowTimer->start();
 }
 
 QString RichTextEditor::toHtml() const {
-    return m_editor->toHtml();
+    // Crops are baked first, then the remaining lazy references get their
+    // original data: URIs back.
+    return m_imageStore->restoreImages(bakeCroppedImages(m_editor->toHtml()));
+}
+
+// Saves through RichHtmlWriter: blocks are written as they are visited and
+// images are streamed from their encoded bytes, so no full-document string
+// (and no Base64 copy of every image) is ever built.
+bool RichTextEditor::writeHtml(QIODevice *device) const {
+    RichHtmlWriter writer(m_editor->document());
+    writer.setImageSource([this](const QString &name, QByteArray *bytes, QByteArray *mimeType) {
+        // Cropped images: encode just the cropped pixels (the only re-encode)
+        if (ImageCropDialog::parseCropResourceName(name, nullptr, nullptr)) {
+            QImage cropped = imageResource(name);
+            if (cropped.isNull()) return false;
+            QString mime;
+            *bytes = ImageCodec::encode(cropped, QString(), &mime);
+            *mimeType = mime.toLatin1();
+            return true;
+        }
+        // Lazily loaded images: hand out the original file bytes untouched
+        return m_imageStore->encodedImage(QUrl(name), bytes, mimeType);
+    });
+    // Documents with tables go through Qt's exporter; crops and lazy
+    // references still have to be resolved there
+    writer.setHtmlFallback([this]() { return toHtml(); });
+    return writer.write(device);
 }
 
 QTextDocument* RichTextEditor::document() const {
@@ -178,40 +247,26 @@ void RichTextEditor::onCursorPositionChanged() {
 }
 
 // Applies a new color theme to the editor and its toolbar.
-void RichTextEditor::setTheme(const QHash<QString, QColor> &theme) {
-    QColor baseBg = theme.value("background");
-    QString fg = theme.value("foreground").name();
-    QString comment = theme.value("comment").name(); // Use comment color for borders and accents.
-
-    // Style the parent widget (this) with a slightly darker background.
-    // This creates a visual "frame" effect for the centered editor page.
-    this->setStyleSheet(QString("QWidget { background-color: %1; }")
-                        .arg(baseBg.darker(115).name()));
-
-    // Style the main text editor area itself.
-    m_editor->setStyleSheet(QString("QTextEdit { background-color: %1; color: %2; border: none; }")
-                            .arg(baseBg.name(), fg));
-
-    // Style the toolbar and its child controls to match the theme.
-    QString toolbarStyle = QString(
-        "QToolBar { background: %1; border-bottom: 1px solid %3; spacing: 5px; padding: 3px; }"
-        "QToolButton { "
-            "color: %2; "
-            "background: transparent; "
-            "padding: 4px; "
-            "border-radius: 4px; "
-            "border: 1px solid transparent; " // Reserve space for the border
-            "min-width: 28px; "
-            "min-height: 28px; "
-        "}"
-        "QToolButton:hover { background: %3; }" // Use accent color for hover.
-        "QToolButton:checked { background: %3; border-color: %2; }" // Change border color, not size
-        "QComboBox { color: %2; background-color: %1; border: 1px solid %3; padding: 4px; }"
-        "QComboBox::drop-down { border: none; }"
-        "QComboBox QAbstractItemView { background-color: %1; color: %2; border: 1px solid %3; }"
-    ).arg(baseBg.name(), fg, comment);
-
-    m_toolbar->setStyleSheet(toolbarStyle);
+void RichTextEditor::setTheme(const Theme *theme) {
+    m_theme = theme;
+    if (isVisible()) applyPendingTheme();
+}
+
+void RichTextEditor::showEvent(QShowEvent *event) {
+    applyPendingTheme();
+    QWidget::showEvent(event);
+}
+
+void RichTextEditor::applyPendingTheme() {
+    if (!m_theme || m_theme->id == m_appliedThemeId) return;
+    m_appliedThemeId = m_theme->id;
+
+    // The style sheets are built once per theme by ThemeRegistry.
+    // The parent widget (this) gets a slightly darker background, which
+    // creates a visual "frame" effect for the centered editor page.
+    this->setStyleSheet(m_theme->richPageStyleSheet);
+    m_editor->setStyleSheet(m_theme->richEditorStyleSheet);
+    m_toolbar->setStyleSheet(m_theme->richToolbarStyleSheet);
 }
 
 // Opens a file dialog to let the user insert an image from a local file.
@@ -244,22 +299,13 @@ void RichTextEditor::insertImage() {
         image = image.scaledToWidth(targetWidth, Qt::SmoothTransformation);
     }
 
-    // Convert the image data to a Base64 string to embed it directly in the HTML.
-    QByteArray byteArray;
-    QBuffer buffer(&byteArray);
-    buffer.open(QIODevice::WriteOnly);
-    
-    // Automatically detect the image format from the file extension. Default to PNG.
-    QString format = QFileInfo(file).suffix().toUpper();
-    if (format.isEmpty()) format = "PNG";
-    
-    image.save(&buffer, format.toLatin1());
-    QString base64 = byteArray.toBase64();
+    // Encode the image and embed it directly in the HTML as a data: URI.
+    // JPEGs stay JPEG; everything else uses the configured fast PNG/WebP path.
+    QString dataUri = ImageCodec::toDataUri(image, QFileInfo(file).suffix());
 
     // Create the HTML `<img>` tag with the embedded Base64 data.
-    QString htmlImage = QString("<img src=\"data:image/%1;base64,%2\" width=\"%3\" height=\"%4\" />")
-                        .arg(format)
-                        .arg(base64)
+    QString htmlImage = QString("<img src=\"%1\" width=\"%2\" height=\"%3\" />")
+                        .arg(dataUri)
                         .arg(image.width())
                         .arg(image.height());
 
@@ -427,6 +473,8 @@ void RichTextEditor::showImageResizeWidget(const QTextImageFormat &imageFormat,
         m_resizeWidget = new ImageResizeWidget(m_editor->viewport());
         connect(m_resizeWidget, &ImageResizeWidget::resizeRequested,
                 this, &RichTextEditor::onImageResizeRequested);
+        connect(m_resizeWidget, &ImageResizeWidget::resizeFinished,
+                this, [this]() { m_resizeJoinsUndo = false; });
     }
     
     // Show the visual border/handles at the computed image rectangle. The widget
@@ -444,7 +492,9 @@ void RichTextEditor::hideImageResizeWidget() {
     }
     // Reset the image tracking state (no image selected)
     m_currentImageCursor = QTextCursor();
+    m_resizeJoinsUndo = false;
     m_currentImageName.clear();
+    m_actCrop->setEnabled(false);
 }
 
 void RichTextEditor::onImageResizeRequested(QSize newSize) {
@@ -472,9 +522,19 @@ void RichTextEditor::onImageResizeRequested(QSize newSize) {
     if (!imageFormat.isValid()) return;
     
     // 2. Apply the new size
+    // A drag sends a size per mouse move. All of them join the edit block of
+    // the first one, so the whole drag is a single undo step instead of one
+    // per pixel of mouse movement.
     imageFormat.setWidth(newSize.width());
     imageFormat.setHeight(newSize.height());
+    if (m_resizeJoinsUndo) {
+        cursor.joinPreviousEditBlock();
+    } else {
+        cursor.beginEditBlock();
+    }
     cursor.setCharFormat(imageFormat);
+    cursor.endEditBlock();
+    m_resizeJoinsUndo = true;
     
     // [CRITICAL FIX 1]: Maintain Cursor Position
     // The 'cursor' object is now at the RIGHT side of the image (because of the selection).
@@ -511,6 +571,8 @@ void RichTextEditor::onEditorClicked(QPoint pos) {
         
         m_currentImageCursor = cursor;
         m_currentImageName = imageFormat.name();
+        m_actCrop->setEnabled(true);
+        m_resizeJoinsUndo = false; // A new image starts a new undo step
         
         // Show widget
         QRect imageRect = getImageRect(cursor);
@@ -520,4 +582,136 @@ void RichTextEditor::onEditorClicked(QPoint pos) {
 
     qDebug() << "[onEditorClicked][1] Not an image click - hiding resize widget";
     hideImageResizeWidget();
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Non-destructive Crop
+// ============================================================================
+
+// Fetches an image from the document's resource cache, whichever form it is stored in.
+QImage RichTextEditor::imageResource(const QString &name) const {
+    QVariant data = m_editor->document()->resource(QTextDocument::ImageResource, QUrl(name));
+    if (data.userType() == QMetaType::QPixmap) {
+        return data.value<QPixmap>().toImage();
+    }
+    return data.value<QImage>();
+}
+
+// Opens the crop dialog for the selected image. The crop only changes the
+// image's resource name (see ImageCropDialog::cropResourceName), so applying
+// it is instant and the original pixels stay in the document for a later undo
+// or re-crop. Pixels are re-encoded only when the document is saved.
+void RichTextEditor::cropImage() {
+    if (m_currentImageCursor.isNull()) return;
+
+    // Select the image character, same as onImageResizeRequested
+    QTextCursor cursor = m_currentImageCursor;
+    cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, 1);
+    QTextImageFormat imageFormat = cursor.charFormat().toImageFormat();
+    if (!imageFormat.isValid()) return;
+
+    // Always crop relative to the original, never to a previous crop
+    QString baseName = imageFormat.name();
+    QRect currentCrop;
+    ImageCropDialog::parseCropResourceName(imageFormat.name(), &baseName, &currentCrop);
+
+    QImage source = imageResource(baseName);
+    if (source.isNull()) return;
+    if (currentCrop.isEmpty()) currentCrop = source.rect();
+
+    ImageCropDialog dlg(source, currentCrop, this);
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    QRect crop = dlg.cropRect();
+    if (crop.isEmpty()) return;
+
+    // Keep the on-page zoom level the user picked with the resize handles
+    qreal scale = imageFormat.width() > 0 ? imageFormat.width() / currentCrop.width() : 1.0;
+
+    // A crop that covers the whole image is the same as no crop at all
+    imageFormat.setName(crop == source.rect()
+                        ? baseName
+                        : ImageCropDialog::cropResourceName(baseName, crop));
+    imageFormat.setWidth(crop.width() * scale);
+    imageFormat.setHeight(crop.height() * scale);
+    cursor.setCharFormat(imageFormat);
+
+    // Same cursor/overlay re-sync as after a resize
+    cursor.setPosition(cursor.anchor());
+    m_currentImageCursor = cursor;
+    m_currentImageName = imageFormat.name();
+
+    QRect realImageRect = getImageRect(m_currentImageCursor);
+    if (!realImageRect.isNull() && m_resizeWidget) {
+        m_resizeWidget->showAtPosition(realImageRect);
+    }
+}
+
+// Replaces every cropped image reference in the exported HTML with a freshly
+// encoded PNG of just the cropped pixels. This is the only point where a crop
+// costs an encode, and only for images that are actually cropped.
+QString RichTextEditor::bakeCroppedImages(const QString &html) const {
+    // Collect the distinct cropped names first; a name may appear several times.
+    QSet<QString> croppedNames;
+    for (QTextBlock block = m_editor->document()->begin(); block.isValid(); block = block.next()) {
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+            QTextCharFormat fmt = it.fragment().charFormat();
+            if (!fmt.isImageFormat()) continue;
+
+            QString name = fmt.toImageFormat().name();
+            if (ImageCropDialog::parseCropResourceName(name, nullptr, nullptr)) {
+                croppedNames.insert(name);
+            }
+        }
+    }
+    if (croppedNames.isEmpty()) return html;
+
+    QString result = html;
+    for (const QString &name : croppedNames) {
+        QImage cropped = imageResource(name);
+        if (cropped.isNull()) continue;
+
+        QString src = QString("src=\"%1\"").arg(name.toHtmlEscaped());
+        QString baked = QString("src=\"%1\"").arg(ImageCodec::toDataUri(cropped));
+        result.replace(src, baked);
+    }
+    return result;
+}
+
+// ============================================================================
+// Lazy Image Loading
+// ============================================================================
+
+// Resource provider for "lazy-image:N" names (and crops of them). Returning a
+// QPixmap keeps painting cheap; crops come from the store's crop cache, so
+// they are cut out once rather than on every paint.
+QVariant RichTextEditor::lazyResource(const QUrl &url) {
+    if (url.scheme() != LazyImageStore::scheme()) return QVariant();
+
+    QString baseName;
+    QRect crop;
+    if (ImageCropDialog::parseCropResourceName(url.toString(), &baseName, &crop)) {
+        QPixmap cropped = m_imageStore->croppedPixmap(QUrl(baseName), crop);
+        if (cropped.isNull()) return QVariant();
+        return cropped;
+    }
+
+    QPixmap pm = m_imageStore->pixmap(url);
+    if (pm.isNull()) return QVariant();
+    return pm;
+}
+
+// Prefetches images within one screen above/below the viewport and releases
+// anything further than three screens away. The gap between the two windows
+// stops images at the edge from being decoded and dropped on every scroll step.
+void RichTextEditor::updateImageWindow() {
+    if (m_imageStore->imageCount() == 0) return;
+
+    int h = m_editor->viewport()->height();
+    auto positionAt = [this](int y) {
+        return m_editor->cursorForPosition(QPoint(0, y)).position();
+    };
+
+    m_imageStore->updateWindow(positionAt(-h), positionAt(2 * h),
+                               positionAt(-3 * h), positionAt(4 * h));
+}
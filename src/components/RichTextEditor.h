@@ -10,6 +10,10 @@
 
 class ImageResizeWidget;
 class ImageCropDialog;
+class LazyImageStore;
+class QIODevice;
+class QTimer;
+struct Theme;
 
 class RichTextEditor : public QWidget {
     Q_OBJECT
@@ -20,16 +24,19 @@ public:
     // Common Interface
     void setHtml(const QString &text);
     QString toHtml() const;
+    bool writeHtml(QIODevice *device) const; // Streaming save, see RichHtmlWriter
     QTextDocument* document() const; // Expose doc for "unsaved changes" signal
-    void setTheme(const QHash<QString, QColor> &theme);
+    void setTheme(const Theme *theme); // Applied on the next show when hidden
     void setInitialPageSize(int index);
     int currentPageSizeIndex() const;
+    const LazyImageStore *imageStore() const { return m_imageStore; } // Memory diagnostics
 
 private slots:
     void toggleBold();
     void toggleItalic();
     void toggleUnderline();
     void insertImage();
+    void cropImage();
     void onCursorPositionChanged(); // Sync buttons with cursor state
     void onPageSizeChanged(int index);
     
@@ -37,15 +44,23 @@ private slots:
     void onImageResizeRequested(QSize newSize);
     void onEditorClicked(QPoint pos);
 
+    // Decodes images coming into view and releases those far away
+    void updateImageWindow();
+
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
 
 private:
     void setupToolbar();
+    void applyPendingTheme();
     void showImageResizeWidget(const QTextImageFormat &imageFormat, const QRect &imageRect);
     void hideImageResizeWidget();
     QRect getImageRect(const QTextCursor &cursor);
     QTextCursor findImageCursor(const QPoint &pos);
+    QImage imageResource(const QString &name) const;
+    QString bakeCroppedImages(const QString &html) const;
+    QVariant lazyResource(const QUrl &url);
 
     CustomRichTextBoard *m_editor;
     QToolBar *m_toolbar;
@@ -54,10 +69,20 @@ private:
     QAction *m_actItalic;
     QAction *m_actUnderline;
     QAction *m_actImage;
+    QAction *m_actCrop;
     QComboBox *m_sizeCombo;
     
     // Image manipulation
     ImageResizeWidget *m_resizeWidget;
     QTextCursor m_currentImageCursor;
+    bool m_resizeJoinsUndo = false; // Later steps of one drag join the first undo step
     QString m_currentImageName;
+
+    // Deferred image decoding for loaded documents
+    LazyImageStore *m_imageStore;
+    QTimer *m_imageWindowTimer;
+
+    // Theme waiting to be applied (style sheets are only set while visible)
+    const Theme *m_theme = nullptr;
+    int m_appliedThemeId = 0;
 };
\ No newline at end of file
@@ -0,0 +1,106 @@
+#include "SymbolSearchDialog.h"
+#include "SymbolIndex.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QVBoxLayout>
+
+namespace {
+
+// Where the symbol is, stored on the list item
+constexpr int kPathRole = Qt::UserRole;
+constexpr int kLineRole = Qt::UserRole + 1;
+constexpr int kColumnRole = Qt::UserRole + 2;
+
+} // namespace
+
+SymbolSearchDialog::SymbolSearchDialog(QWidget *parent) : QDialog(parent) {
+    setWindowTitle("Go to Symbol in Workspace");
+    resize(640, 420);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+
+    m_query = new QLineEdit(this);
+    m_query->setPlaceholderText("Symbol name");
+    m_query->installEventFilter(this);
+    layout->addWidget(m_query);
+
+    m_results = new QListWidget(this);
+    m_results->setUniformItemSizes(true); // No per-item size queries for 200 rows
+    layout->addWidget(m_results, 1);
+
+    m_status = new QLabel(this);
+    layout->addWidget(m_status);
+
+    connect(m_query, &QLineEdit::textChanged, this, &SymbolSearchDialog::updateResults);
+    connect(m_query, &QLineEdit::returnPressed, this, &SymbolSearchDialog::activateCurrent);
+    connect(m_results, &QListWidget::itemActivated, this, &SymbolSearchDialog::activateCurrent);
+
+    // The index may finish (re)building while the dialog is open
+    connect(SymbolIndex::instance(), &SymbolIndex::indexChanged, this, [this]() {
+        if (isVisible()) updateResults();
+    });
+}
+
+void SymbolSearchDialog::reset() {
+    m_query->clear();
+    updateResults();
+    m_query->setFocus();
+}
+
+bool SymbolSearchDialog::eventFilter(QObject *watched, QEvent *event) {
+    // Up/Down move through the results without leaving the query field
+    if (watched == m_query && event->type() == QEvent::KeyPress) {
+        const int key = static_cast<QKeyEvent *>(event)->key();
+        if (key == Qt::Key_Up || key == Qt::Key_Down || key == Qt::Key_PageUp || key == Qt::Key_PageDown) {
+            QCoreApplication::sendEvent(m_results, event);
+            return true;
+        }
+    }
+    return QDialog::eventFilter(watched, event);
+}
+
+void SymbolSearchDialog::updateResults() {
+    SymbolIndex *index = SymbolIndex::instance();
+    const QString root = index->root();
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<SymbolIndex::Symbol> symbols = index->search(m_query->text(), kMaxResults);
+    const double ms = timer.nsecsElapsed() / 1e6;
+
+    m_results->setUpdatesEnabled(false);
+    m_results->clear();
+    for (const SymbolIndex::Symbol &symbol : symbols) {
+        QString file = symbol.filePath;
+        if (file.startsWith(root + '/')) file = file.mid(root.size() + 1);
+
+        const QString kind = QString::fromLatin1(SymbolIndex::kindName(symbol.kind));
+        QListWidgetItem *item = new QListWidgetItem(
+            QString("%1  (%2)  %3:%4").arg(symbol.name, kind, file).arg(symbol.line + 1), m_results);
+        item->setToolTip(symbol.detail);
+        item->setData(kPathRole, symbol.filePath);
+        item->setData(kLineRole, symbol.line);
+        item->setData(kColumnRole, symbol.column);
+    }
+    if (m_results->count() > 0) m_results->setCurrentRow(0);
+    m_results->setUpdatesEnabled(true);
+
+    QString status = QString("%1 symbols in %2 files").arg(index->symbolCount()).arg(index->fileCount());
+    if (!m_query->text().trimmed().isEmpty()) {
+        status = QString("%1 match%2 (%3 ms) - ").arg(symbols.size()).arg(symbols.size() == 1 ? "" : "es")
+                     .arg(ms, 0, 'f', 2)
+                 + status;
+    }
+    if (index->isIndexing()) status += " - indexing...";
+    m_status->setText(status);
+}
+
+void SymbolSearchDialog::activateCurrent() {
+    QListWidgetItem *item = m_results->currentItem();
+    if (!item) return;
+    hide();
+    emit symbolActivated(item->data(kPathRole).toString(), item->data(kLineRole).toInt(),
+                         item->data(kColumnRole).toInt());
+}
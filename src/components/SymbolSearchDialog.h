@@ -0,0 +1,35 @@
+#pragma once
+#include <QDialog>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+
+// Edit > Go to Symbol in Workspace (Ctrl+T): a query field over the project's
+// SymbolIndex. Results update with every keystroke (names starting with the
+// query first, then names containing it); Enter or a double click opens one.
+class SymbolSearchDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit SymbolSearchDialog(QWidget *parent = nullptr);
+
+    // Clears the query and focuses it
+    void reset();
+
+signals:
+    void symbolActivated(const QString &filePath, int line, int column);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void updateResults();
+    void activateCurrent();
+
+private:
+    static constexpr int kMaxResults = 200;
+
+    QLineEdit *m_query;
+    QListWidget *m_results;
+    QLabel *m_status;
+};
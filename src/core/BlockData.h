@@ -0,0 +1,64 @@
+#pragma once
+#include <QTextBlockUserData>
+#include <QString>
+#include <QVector>
+
+// What the highlighter learned about one line that the structural features
+// need. It is computed while the line is highlighted anyway, so folding,
+// bracket matching and the outline never lex the document a second time.
+struct BlockSummary {
+    struct Bracket {
+        int column;
+        QChar ch; // One of ( ) [ ] { }
+    };
+
+    // Brackets outside strings and comments, in column order
+    QVector<Bracket> brackets;
+
+    // Leading whitespace width (tab = 4), -1 for blank lines
+    int indent = -1;
+
+    // Outline candidate on this line ("class Foo", "def bar", "Foo::run(...)")
+    QString outlineName;
+    QString outlineKind;     // "class", "function", ... empty if none
+    int outlineColumn = -1;
+    bool outlineNeedsBrace = false; // Function candidates must be followed by '{'
+
+    // Hash of everything above; equal hashes mean equal summaries (to the
+    // chunk cache in DocumentStructure)
+    quint64 hash = 0;
+};
+
+// One run of same-colored, non-blank text on a line, for the minimap. Four
+// bytes per run keeps a million-line document's color summary small.
+struct ColorRun {
+    static constexpr int kMaxColumns = 120;    // Text further right isn't summarized
+    static constexpr quint16 kPlainScope = 0xffff; // Text outside any token
+
+    quint8 column;  // Visual column (tab = 4)
+    quint8 length;
+    quint16 scope;  // Grammar scope index, or kPlainScope
+
+    bool operator==(const ColorRun &other) const {
+        return column == other.column && length == other.length && scope == other.scope;
+    }
+};
+
+// Per-block user data. Qt keeps it attached to the block as text is edited
+// around it and deletes it with the block.
+class BlockData : public QTextBlockUserData {
+public:
+    BlockSummary summary;
+
+    // Minimap color summary, maintained by the Highlighter
+    QVector<ColorRun> colors;
+
+    // Folding (owned by CodeEditor). A folded header stays visible and the
+    // 'foldedBlocks' blocks after it are hidden.
+    bool folded = false;
+    int foldedBlocks = 0;
+
+    // The highlighter skipped setFormat() because the block was hidden; it
+    // must be highlighted again when it is revealed
+    bool formatsPending = false;
+};
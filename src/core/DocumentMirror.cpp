@@ -0,0 +1,53 @@
+#include "DocumentMirror.h"
+
+#include <QTextCursor>
+#include <QTextDocument>
+
+DocumentMirror *DocumentMirror::forDocument(QTextDocument *document) {
+    if (auto *mirror = document->findChild<DocumentMirror *>(QString(), Qt::FindDirectChildrenOnly)) {
+        return mirror;
+    }
+    return new DocumentMirror(document);
+}
+
+DocumentMirror::DocumentMirror(QTextDocument *document)
+    : QObject(document), m_document(document), m_text(document->toRawText())
+{
+    connect(m_document, &QTextDocument::contentsChange, this, &DocumentMirror::onContentsChange);
+}
+
+void DocumentMirror::onContentsChange(int position, int charsRemoved, int charsAdded) {
+    // Qt may count the document's final block separator, which isn't part of
+    // the raw text; clamp both sides to real characters
+    const int textLength = m_document->characterCount() - 1;
+    const QString removed = m_text.mid(position, charsRemoved);
+
+    QTextCursor cursor(m_document);
+    cursor.setPosition(qMin(position, textLength));
+    cursor.setPosition(qMin(position + charsAdded, textLength), QTextCursor::KeepAnchor);
+    const QString inserted = cursor.selectedText(); // Raw: U+2029 between blocks
+
+    m_text.replace(position, removed.size(), inserted);
+    if (m_text.size() != textLength) {
+        // Should not happen; start over from the document
+        m_text = m_document->toRawText();
+        emit resynced();
+        return;
+    }
+
+    // Keep only what really changed (format-only changes end up empty)
+    int prefix = 0;
+    while (prefix < removed.size() && prefix < inserted.size() && removed[prefix] == inserted[prefix]) {
+        ++prefix;
+    }
+    int suffix = 0;
+    while (suffix < removed.size() - prefix && suffix < inserted.size() - prefix
+           && removed[removed.size() - 1 - suffix] == inserted[inserted.size() - 1 - suffix]) {
+        ++suffix;
+    }
+    if (prefix + suffix == removed.size() && prefix + suffix == inserted.size()) return;
+
+    emit changed(position + prefix,
+                 removed.mid(prefix, removed.size() - prefix - suffix),
+                 inserted.mid(prefix, inserted.size() - prefix - suffix));
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <QObject>
+#include <QString>
+
+class QTextDocument;
+
+// A copy of a QTextDocument's raw text (U+2029 between blocks) kept in step
+// with its edits, turning contentsChange into what really changed.
+//
+// contentsChange only reports how many characters were removed, and the
+// highlighter's format-only changes look like replacements of whole blocks.
+// The mirror supplies the removed text and trims both sides to the characters
+// that differ; format-only changes produce nothing.
+//
+// One mirror per document, shared by everyone who needs the deltas
+// (UndoHistory, LspDocument): see forDocument().
+class DocumentMirror : public QObject {
+    Q_OBJECT
+
+public:
+    // The document's mirror, created (from its current text) on first use.
+    // Child of the document.
+    static DocumentMirror *forDocument(QTextDocument *document);
+
+    // The document's raw text as of the last change
+    const QString &text() const { return m_text; }
+
+signals:
+    // At 'position', 'removed' was replaced by 'inserted' (both trimmed to
+    // the characters that differ, raw text). Emitted right from the
+    // document's contentsChange, so the document already has the new text.
+    void changed(int position, const QString &removed, const QString &inserted);
+
+    // The mirror lost track of the document and was rebuilt from its text;
+    // deltas seen so far may not add up to it.
+    void resynced();
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+
+private:
+    explicit DocumentMirror(QTextDocument *document);
+
+    QTextDocument *m_document;
+    QString m_text;
+};
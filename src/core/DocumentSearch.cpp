@@ -0,0 +1,349 @@
+#include "DocumentSearch.h"
+#include "DocumentMirror.h"
+#include "MemoryAccounting.h"
+#include "utils/TextSearch.h"
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QStringList>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <algorithm>
+
+// One search generation: the chunk results are collected on the GUI thread,
+// workers only look at 'cancelled'
+struct DocumentSearch::Job {
+    int generation = 0;
+    std::atomic<bool> cancelled{false};
+    QVector<QVector<Match>> chunks;
+    int pending = 0;
+};
+
+namespace {
+
+bool isWordChar(QChar c) {
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+// Expands \0..\9 (captures), \n and \t in a regex replacement
+QString expandReplacement(const QString &replacement, const QRegularExpressionMatch &match) {
+    QString out;
+    out.reserve(replacement.size());
+    for (qsizetype i = 0; i < replacement.size(); ++i) {
+        const QChar c = replacement.at(i);
+        if (c != QLatin1Char('\\') || i + 1 == replacement.size()) {
+            out += c;
+            continue;
+        }
+        const QChar next = replacement.at(++i);
+        if (next.isDigit()) out += match.captured(next.digitValue());
+        else if (next == QLatin1Char('n')) out += QLatin1Char('\n');
+        else if (next == QLatin1Char('t')) out += QLatin1Char('\t');
+        else out += next;
+    }
+    return out;
+}
+
+}
+
+// =========================================================
+// DocumentSearch Implementation
+// =========================================================
+
+DocumentSearch::DocumentSearch(QTextDocument *document, QObject *parent)
+    : QObject(parent), m_document(document)
+{
+    // Created before our contentsChange connection, so it is current by the
+    // time we look at it
+    m_mirror = DocumentMirror::forDocument(document);
+
+    // Typing while the bar is open restarts the search, but not per keystroke
+    m_restartTimer = new QTimer(this);
+    m_restartTimer->setSingleShot(true);
+    m_restartTimer->setInterval(150);
+    connect(m_restartTimer, &QTimer::timeout, this, &DocumentSearch::start);
+
+    connect(document, &QTextDocument::contentsChange, this, &DocumentSearch::onContentsChange);
+}
+
+DocumentSearch::~DocumentSearch() {
+    if (m_job) m_job->cancelled = true;
+}
+
+void DocumentSearch::setQuery(const Query &query) {
+    m_query = query;
+    m_error.clear();
+    m_regex = QRegularExpression();
+
+    if (m_query.regex && !m_query.pattern.isEmpty()) {
+        QString pattern = m_query.pattern;
+        if (m_query.wholeWord) pattern = QStringLiteral("\\b(?:%1)\\b").arg(pattern);
+
+        // Lines are searched with '\n' between them, so ^ and $ mean line start/end
+        QRegularExpression::PatternOptions options = QRegularExpression::MultilineOption;
+        if (!m_query.caseSensitive) options |= QRegularExpression::CaseInsensitiveOption;
+        m_regex = QRegularExpression(pattern, options);
+        if (!m_regex.isValid()) m_error = m_regex.errorString();
+    }
+
+    m_restartTimer->stop();
+    start();
+}
+
+void DocumentSearch::onContentsChange() {
+    // The matches are stale from here on; matchesIn() searches directly until
+    // the new run is done
+    m_finished = false;
+    if (m_job) m_job->cancelled = true;
+    m_job.reset();
+    if (!m_query.pattern.isEmpty()) m_restartTimer->start();
+}
+
+// ---------------------------------
+// Searching
+// ---------------------------------
+
+QVector<DocumentSearch::Match> DocumentSearch::searchRange(const QString &text, int from, int to,
+                                                           const Query &query,
+                                                           const QRegularExpression &regex, const Job *job) {
+    QVector<Match> found;
+
+    if (query.regex) {
+        // Raw text separates blocks with U+2029; a regex expects '\n'
+        QString subject = text;
+        subject.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+
+        int seen = 0;
+        QRegularExpressionMatchIterator it = regex.globalMatch(subject, from);
+        while (it.hasNext()) {
+            if (job && (++seen & 1023) == 0 && job->cancelled) return {};
+            const QRegularExpressionMatch match = it.next();
+            if (match.capturedStart() >= to) break;
+            if (match.capturedLength() == 0) continue;
+            found.append(Match{int(match.capturedStart()), int(match.capturedLength())});
+        }
+        return found;
+    }
+
+    QString needle = query.pattern;
+    needle.replace(QLatin1Char('\n'), QChar::ParagraphSeparator);
+    const int length = int(needle.size());
+
+    QVector<int> positions;
+    TextSearch::findAll(text, needle, from, to,
+                        query.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive, &positions);
+
+    found.reserve(positions.size());
+    for (int pos : positions) {
+        if (query.wholeWord) {
+            if (pos > 0 && isWordChar(text.at(pos - 1))) continue;
+            if (pos + length < text.size() && isWordChar(text.at(pos + length))) continue;
+        }
+        found.append(Match{pos, length});
+    }
+    return found;
+}
+
+void DocumentSearch::start() {
+    ++m_generation;
+    if (m_job) m_job->cancelled = true;
+    m_job.reset();
+    m_matches.clear();
+    m_finished = false;
+
+    if (m_query.pattern.isEmpty() || !m_error.isEmpty()) {
+        m_finished = true;
+        emit resultsChanged();
+        return;
+    }
+
+    const QString text = m_mirror->text();
+
+    // Independent chunks are only exact when matches can't overlap each
+    // other; a regex or such a needle ("aa") is searched in one piece
+    int chunkCount = 1;
+    if (!m_query.regex
+        && !TextSearch::canSelfOverlap(m_query.pattern,
+                                       m_query.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive)) {
+        chunkCount = qMax(1, int((text.size() + kChunkSize - 1) / kChunkSize));
+    }
+
+    auto job = std::make_shared<Job>();
+    job->generation = m_generation;
+    job->chunks.resize(chunkCount);
+    job->pending = chunkCount;
+    m_job = job;
+
+    const Query query = m_query;
+    const QRegularExpression regex = m_regex;
+    const int generation = m_generation;
+    QPointer<DocumentSearch> guard(this);
+
+    for (int chunk = 0; chunk < chunkCount; ++chunk) {
+        const int from = chunkCount == 1 ? 0 : chunk * kChunkSize;
+        const int to = chunkCount == 1 ? int(text.size()) : qMin(int(text.size()), from + kChunkSize);
+
+        QThreadPool::globalInstance()->start([text, from, to, query, regex, job, generation, chunk, guard]() {
+            if (job->cancelled) return;
+            MemoryAccounting::Scope scope(MemoryAccounting::Search);
+            QVector<Match> found = searchRange(text, from, to, query, regex, job.get());
+            if (job->cancelled) return;
+
+            QMetaObject::invokeMethod(qApp, [guard, generation, chunk, found]() {
+                if (guard) guard->chunkFinished(generation, chunk, found);
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void DocumentSearch::chunkFinished(int generation, int chunk, const QVector<Match> &matches) {
+    if (!m_job || m_job->generation != generation) return;
+
+    m_job->chunks[chunk] = matches;
+    if (--m_job->pending > 0) return;
+
+    // Chunks are in document order and each holds the matches starting in it
+    qsizetype total = 0;
+    for (const QVector<Match> &part : std::as_const(m_job->chunks)) total += part.size();
+    m_matches.reserve(total);
+    for (const QVector<Match> &part : std::as_const(m_job->chunks)) m_matches += part;
+
+    m_job.reset();
+    m_finished = true;
+    emit resultsChanged();
+}
+
+// ---------------------------------
+// Queries
+// ---------------------------------
+
+QVector<DocumentSearch::Match> DocumentSearch::matchesIn(int from, int to) const {
+    if (m_query.pattern.isEmpty() || !m_error.isEmpty() || from >= to) return {};
+
+    if (m_finished) {
+        auto it = std::lower_bound(m_matches.constBegin(), m_matches.constEnd(), from,
+                                   [](const Match &match, int pos) { return match.position < pos; });
+        QVector<Match> out;
+        for (; it != m_matches.constEnd() && it->position < to; ++it) out.append(*it);
+        return out;
+    }
+
+    // No complete results yet: search just this range. A match may start
+    // inside it and end after it (a regex up to the end of that line).
+    int end = to + int(m_query.pattern.size());
+    if (m_query.regex) {
+        const QTextBlock last = m_document->findBlock(to);
+        end = last.position() + last.length() - 1;
+    }
+    end = qMin(end, m_document->characterCount() - 1);
+    QTextCursor range(m_document);
+    range.setPosition(from);
+    range.setPosition(end, QTextCursor::KeepAnchor);
+    const QString text = range.selectedText();
+
+    QVector<Match> out = searchRange(text, 0, to - from, m_query, m_regex, nullptr);
+    for (Match &match : out) match.position += from;
+    return out;
+}
+
+bool DocumentSearch::nextMatch(int position, bool backward, Match *match) const {
+    if (m_query.pattern.isEmpty() || !m_error.isEmpty()) return false;
+
+    if (m_finished) {
+        if (m_matches.isEmpty()) return false;
+        auto it = std::lower_bound(m_matches.constBegin(), m_matches.constEnd(), position,
+                                   [](const Match &m, int pos) { return m.position < pos; });
+        if (backward) {
+            *match = it == m_matches.constBegin() ? m_matches.last() : *(it - 1);
+        } else {
+            *match = it == m_matches.constEnd() ? m_matches.first() : *it;
+        }
+        return true;
+    }
+
+    // Still searching: ask the document, it stops at the first hit
+    QTextDocument::FindFlags flags;
+    if (backward) flags |= QTextDocument::FindBackward;
+    auto find = [&](int from) {
+        if (m_query.regex) return m_document->find(m_regex, from, flags);
+        QTextDocument::FindFlags literalFlags = flags;
+        if (m_query.caseSensitive) literalFlags |= QTextDocument::FindCaseSensitively;
+        if (m_query.wholeWord) literalFlags |= QTextDocument::FindWholeWords;
+        return m_document->find(m_query.pattern, from, literalFlags);
+    };
+
+    QTextCursor found = find(position);
+    if (found.isNull()) found = find(backward ? m_document->characterCount() - 1 : 0);
+    if (found.isNull() || !found.hasSelection()) return false;
+
+    *match = Match{found.selectionStart(), found.selectionEnd() - found.selectionStart()};
+    return true;
+}
+
+QString DocumentSearch::replacementFor(const Match &match, const QString &replacement) const {
+    if (!m_query.regex) return replacement;
+
+    // Re-run the regex on the lines around the match to get its captures
+    const QTextBlock first = m_document->findBlock(match.position);
+    const QTextBlock last = m_document->findBlock(match.position + match.length);
+    QTextCursor lines(m_document);
+    lines.setPosition(first.position());
+    lines.setPosition(last.position() + last.length() - 1, QTextCursor::KeepAnchor);
+    QString text = lines.selectedText();
+    text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+
+    const QRegularExpressionMatch found =
+        m_regex.match(text, match.position - first.position(), QRegularExpression::NormalMatch,
+                      QRegularExpression::AnchorAtOffsetMatchOption);
+    return found.hasMatch() ? expandReplacement(replacement, found) : replacement;
+}
+
+// ---------------------------------
+// Replace All
+// ---------------------------------
+
+int DocumentSearch::replaceAll(const QString &replacement) {
+    if (m_query.pattern.isEmpty() || !m_error.isEmpty()) return 0;
+
+    QVector<Match> targets;
+    QStringList texts;
+
+    if (m_query.regex) {
+        // Every match may expand differently, so this is one pass that keeps
+        // the captures
+        QString text = m_mirror->text();
+        text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+        QRegularExpressionMatchIterator it = m_regex.globalMatch(text);
+        while (it.hasNext()) {
+            const QRegularExpressionMatch match = it.next();
+            if (match.capturedLength() == 0) continue;
+            targets.append(Match{int(match.capturedStart()), int(match.capturedLength())});
+            texts.append(expandReplacement(replacement, match));
+        }
+    } else {
+        targets = m_finished ? m_matches
+                             : searchRange(m_mirror->text(), 0, m_document->characterCount(),
+                                           m_query, m_regex, nullptr);
+    }
+    if (targets.isEmpty()) return 0;
+
+    // Ascending with a running offset, all inside one edit block: the layout,
+    // the highlighter and the undo history see a single change
+    QTextCursor edit(m_document);
+    edit.beginEditBlock();
+    int delta = 0;
+    for (int i = 0; i < targets.size(); ++i) {
+        const Match &match = targets.at(i);
+        const QString &text = texts.isEmpty() ? replacement : texts.at(i);
+        edit.setPosition(match.position + delta);
+        edit.setPosition(match.position + match.length + delta, QTextCursor::KeepAnchor);
+        edit.insertText(text);
+        delta += int(text.size()) - match.length;
+    }
+    edit.endEditBlock();
+
+    return int(targets.size());
+}
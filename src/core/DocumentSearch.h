@@ -0,0 +1,99 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QRegularExpression>
+#include <atomic>
+#include <memory>
+
+class QTextDocument;
+class QTimer;
+class DocumentMirror;
+
+// Find / replace over a plain text document, for the FindBar.
+//
+// A search takes the raw text from the document's DocumentMirror (implicitly
+// shared: neither a restart nor a worker copies it) and splits it into chunks
+// that run on the QThreadPool,
+// each with the vectorized TextSearch kernels. The GUI thread only stitches
+// the chunk results together. A regex can't be cut at arbitrary places, so it
+// runs as one task with QRegularExpression.
+//
+// Every new query or edit starts a new generation; workers of an older one
+// stop early and their results are dropped. Until the current generation is
+// done, matchesIn() searches the requested range directly, so the viewport
+// can be highlighted on every keystroke however large the document is.
+class DocumentSearch : public QObject {
+    Q_OBJECT
+
+public:
+    struct Query {
+        QString pattern;
+        bool caseSensitive = false;
+        bool wholeWord = false;
+        bool regex = false;
+    };
+
+    struct Match {
+        int position;
+        int length;
+    };
+
+    // Characters per worker task
+    static constexpr int kChunkSize = 4 * 1024 * 1024;
+
+    explicit DocumentSearch(QTextDocument *document, QObject *parent = nullptr);
+    ~DocumentSearch();
+
+    void setQuery(const Query &query);
+    const Query &query() const { return m_query; }
+
+    // Empty when the query is usable, otherwise why not (bad regex)
+    QString errorString() const { return m_error; }
+
+    // True once every match of the current query and text is known
+    bool isFinished() const { return m_finished; }
+    const QVector<Match> &matches() const { return m_matches; }
+
+    // Matches starting in [from, to), in document order
+    QVector<Match> matchesIn(int from, int to) const;
+
+    // First match after 'position' (or before it, backwards), wrapping around.
+    // Returns false if there is none.
+    bool nextMatch(int position, bool backward, Match *match) const;
+
+    // What 'replacement' turns 'match' into: \0..\9 and \n, \t expand for a regex
+    QString replacementFor(const Match &match, const QString &replacement) const;
+
+    // Replaces every match as one edit (one undo step). Returns how many.
+    int replaceAll(const QString &replacement);
+
+signals:
+    // A search finished; matches() is complete
+    void resultsChanged();
+
+private slots:
+    void onContentsChange();
+    void start();
+
+private:
+    struct Job;
+
+    static QVector<Match> searchRange(const QString &text, int from, int to, const Query &query,
+                                      const QRegularExpression &regex, const Job *job);
+    void chunkFinished(int generation, int chunk, const QVector<Match> &matches);
+
+    QTextDocument *m_document;
+    DocumentMirror *m_mirror; // The text searched, kept up to date with the document
+    QTimer *m_restartTimer;
+
+    Query m_query;
+    QRegularExpression m_regex; // Compiled once per query (regex mode only)
+    QString m_error;
+
+    QVector<Match> m_matches;
+    bool m_finished = false;
+
+    std::shared_ptr<Job> m_job;   // The running generation
+    int m_generation = 0;
+};
@@ -0,0 +1,477 @@
+#include "DocumentStructure.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QThreadPool>
+#include <QTimer>
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+// =========================================================
+// Helpers
+// =========================================================
+
+namespace {
+
+// A chunk ends after a block whose hash has these bits clear (~1 in 64 of
+// the blocks that contain brackets), or after kMaxChunkBlocks blocks.
+constexpr quint64 kChunkMask = 63;
+constexpr int kMaxChunkBlocks = 256;
+
+// matchingBracket() gives up after this many blocks (pathological files)
+constexpr int kMaxMatchBlocks = 20000;
+
+inline quint64 mix(quint64 h, quint64 v) {
+    return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+inline bool isBracket(QChar c) {
+    switch (c.unicode()) {
+    case '(': case ')': case '[': case ']': case '{': case '}': return true;
+    default: return false;
+    }
+}
+
+inline bool isOpening(QChar c) {
+    return c == '(' || c == '[' || c == '{';
+}
+
+inline QChar partnerOf(QChar c) {
+    switch (c.unicode()) {
+    case '(': return ')';
+    case ')': return '(';
+    case '[': return ']';
+    case ']': return '[';
+    case '{': return '}';
+    default: return '{';
+    }
+}
+
+inline bool isIdentifierChar(QChar c) {
+    return c.isLetterOrNumber() || c == '_' || c == ':' || c == '~';
+}
+
+} // namespace
+
+// =========================================================
+// Worker data
+// =========================================================
+
+namespace {
+
+struct ChunkBracket {
+    int block; // Relative to the chunk start
+    QChar ch;
+};
+
+// A chunk with its matched brackets removed
+struct ChunkReduction {
+    QVector<ChunkBracket> unmatchedClose;           // In document order
+    QVector<ChunkBracket> unmatchedOpen;            // Stack, innermost last
+    QVector<DocumentStructure::FoldRange> pairs;    // Multi-line pairs, relative blocks
+};
+
+ChunkReduction reduceChunk(const QVector<BlockSummary> &blocks, int first, int last) {
+    ChunkReduction r;
+    for (int b = first; b <= last; ++b) {
+        for (const BlockSummary::Bracket &bracket : blocks[b].brackets) {
+            if (isOpening(bracket.ch)) {
+                r.unmatchedOpen.append({b - first, bracket.ch});
+            } else if (r.unmatchedOpen.isEmpty()) {
+                r.unmatchedClose.append({b - first, bracket.ch}); // Matched in an earlier chunk
+            } else if (r.unmatchedOpen.last().ch == partnerOf(bracket.ch)) {
+                int open = r.unmatchedOpen.takeLast().block;
+                if (open != b - first) r.pairs.append({open, b - first});
+            }
+            // A mismatched closer is a syntax error: it neither pops nor matches later
+        }
+    }
+    return r;
+}
+
+// Indentation based folds (Python, YAML): a block starts a fold when the next
+// non-blank lines are indented deeper than it.
+QVector<DocumentStructure::FoldRange> indentFolds(const QVector<BlockSummary> &blocks) {
+    QVector<DocumentStructure::FoldRange> folds;
+    QVector<QPair<int, int>> stack; // (indent, block)
+    int lastNonBlank = -1;
+
+    auto closeUntil = [&](int indent) {
+        while (!stack.isEmpty() && stack.last().first >= indent) {
+            int start = stack.takeLast().second;
+            if (lastNonBlank > start) folds.append({start, lastNonBlank});
+        }
+    };
+
+    for (int b = 0; b < blocks.size(); ++b) {
+        int indent = blocks[b].indent;
+        if (indent < 0) continue;
+        closeUntil(indent);
+        stack.append({indent, b});
+        lastNonBlank = b;
+    }
+    closeUntil(-1);
+
+    std::sort(folds.begin(), folds.end(), [](const DocumentStructure::FoldRange &a,
+                                             const DocumentStructure::FoldRange &b) {
+        return a.startBlock < b.startBlock;
+    });
+    return folds;
+}
+
+} // namespace
+
+struct DocumentStructure::Cache {
+    // Keyed by the chunk content hash; rebuilt each run from the chunks that
+    // were actually used, so it never outgrows the document.
+    QHash<quint64, ChunkReduction> chunks;
+};
+
+struct DocumentStructure::Result {
+    QVector<FoldRange> folds;
+    QVector<OutlineEntry> outline;
+    double ms = 0.0;
+};
+
+// Runs on the worker thread: everything it touches is the snapshot or the cache
+std::shared_ptr<DocumentStructure::Result> DocumentStructure::parseSnapshot(const QVector<BlockSummary> &blocks,
+                                                                            bool byIndent, Cache *cache) {
+    QElapsedTimer timer;
+    timer.start();
+    auto result = std::make_shared<Result>();
+
+    if (byIndent) {
+        result->folds = indentFolds(blocks);
+    } else {
+        QHash<quint64, ChunkReduction> used;
+        QVector<QPair<int, QChar>> stack; // Open brackets (absolute block, char)
+        QVector<FoldRange> folds;
+
+        const int count = blocks.size();
+        int chunkStart = 0;
+        quint64 key = 0;
+        for (int b = 0; b < count; ++b) {
+            key = mix(key, blocks[b].hash);
+
+            bool boundary = (blocks[b].hash != 0 && (blocks[b].hash & kChunkMask) == 0)
+                            || b - chunkStart + 1 >= kMaxChunkBlocks || b == count - 1;
+            if (!boundary) continue;
+
+            key = mix(key, quint64(b - chunkStart + 1));
+            auto it = used.constFind(key);
+            if (it == used.constEnd()) {
+                auto cached = cache->chunks.constFind(key);
+                it = used.insert(key, cached != cache->chunks.constEnd() ? cached.value()
+                                                                        : reduceChunk(blocks, chunkStart, b));
+            }
+            const ChunkReduction &r = it.value();
+
+            // Closers left over by the chunk match the brackets still open before it
+            for (const auto &close : r.unmatchedClose) {
+                if (!stack.isEmpty() && stack.last().second == partnerOf(close.ch)) {
+                    int open = stack.takeLast().first;
+                    if (open != chunkStart + close.block) folds.append({open, chunkStart + close.block});
+                }
+            }
+            for (const auto &open : r.unmatchedOpen) stack.append({chunkStart + open.block, open.ch});
+            for (const FoldRange &pair : r.pairs) {
+                folds.append({chunkStart + pair.startBlock, chunkStart + pair.endBlock});
+            }
+
+            chunkStart = b + 1;
+            key = 0;
+        }
+        cache->chunks.swap(used);
+
+        // One range per start block: the outermost one wins ("{ ... ( ..." on one line)
+        std::sort(folds.begin(), folds.end(), [](const FoldRange &a, const FoldRange &b) {
+            return a.startBlock != b.startBlock ? a.startBlock < b.startBlock : a.endBlock > b.endBlock;
+        });
+        for (const FoldRange &fold : std::as_const(folds)) {
+            if (result->folds.isEmpty() || result->folds.last().startBlock != fold.startBlock) {
+                result->folds.append(fold);
+            }
+        }
+    }
+
+    // --- Outline ---
+    // Nesting depth = number of fold ranges strictly enclosing the entry
+    std::priority_queue<int, std::vector<int>, std::greater<int>> activeEnds;
+    int nextFold = 0;
+    const QVector<FoldRange> &folds = result->folds;
+
+    for (int b = 0; b < blocks.size(); ++b) {
+        const BlockSummary &s = blocks[b];
+        if (s.outlineKind.isEmpty()) continue;
+
+        if (s.outlineNeedsBrace) {
+            // "name(...) {" on one line, or the '{' opening the next line
+            bool confirmed = false;
+            for (const BlockSummary::Bracket &bracket : s.brackets) {
+                if (bracket.ch == '{' && bracket.column > s.outlineColumn) confirmed = true;
+            }
+            if (!confirmed && b + 1 < blocks.size() && !blocks[b + 1].brackets.isEmpty()) {
+                confirmed = blocks[b + 1].brackets.first().ch == '{';
+            }
+            if (!confirmed) continue;
+        }
+
+        while (nextFold < folds.size() && folds[nextFold].startBlock < b) {
+            activeEnds.push(folds[nextFold].endBlock);
+            ++nextFold;
+        }
+        while (!activeEnds.empty() && activeEnds.top() < b) activeEnds.pop();
+
+        result->outline.append({s.outlineName, s.outlineKind, b, s.outlineColumn,
+                                static_cast<int>(activeEnds.size())});
+    }
+
+    result->ms = timer.nsecsElapsed() / 1e6;
+    return result;
+}
+
+// =========================================================
+// DocumentStructure
+// =========================================================
+
+DocumentStructure::DocumentStructure(QTextDocument *document, const Grammar *grammar)
+    : QObject(document), m_document(document), m_grammar(grammar),
+      m_cache(std::make_shared<Cache>())
+{
+    // Coalesce: the highlighter's own format updates also report contentsChange,
+    // one zero-timer run after the event loop settles covers them all.
+    m_parseTimer = new QTimer(this);
+    m_parseTimer->setSingleShot(true);
+    m_parseTimer->setInterval(0);
+    connect(m_parseTimer, &QTimer::timeout, this, &DocumentStructure::startParse);
+
+    connect(document, &QTextDocument::contentsChange, this, &DocumentStructure::scheduleParse);
+    scheduleParse();
+}
+
+DocumentStructure::~DocumentStructure() = default;
+
+BlockSummary DocumentStructure::summarize(const QString &text, const QVector<Grammar::Token> &tokens,
+                                          const Grammar *grammar) {
+    BlockSummary s;
+    const int length = text.size();
+
+    // Indentation (blank lines don't end indentation folds)
+    int indent = 0;
+    int first = 0;
+    for (; first < length; ++first) {
+        QChar c = text.at(first);
+        if (c == ' ') indent += 1;
+        else if (c == '\t') indent += 4;
+        else break;
+    }
+    s.indent = first < length ? indent : -1;
+
+    // Brackets in the gaps between tokens. Tokens cover strings and comments,
+    // so "{" inside them never counts.
+    int t = 0;
+    for (int col = first; col < length; ++col) {
+        while (t < tokens.size() && tokens[t].start + tokens[t].length <= col) ++t;
+        if (t < tokens.size() && tokens[t].start <= col) {
+            col = tokens[t].start + tokens[t].length - 1;
+            continue;
+        }
+        QChar c = text.at(col);
+        if (isBracket(c)) s.brackets.append({col, c});
+    }
+
+    // Structural hash: only the bracket sequence matters to the chunk reductions
+    quint64 hash = 0;
+    for (const BlockSummary::Bracket &bracket : std::as_const(s.brackets)) {
+        hash = mix(hash, bracket.ch.unicode());
+    }
+    s.hash = hash;
+
+    if (!grammar) return s;
+
+    // --- Outline: "class Foo", "namespace app", "def run" ---
+    int lastCode = length - 1;
+    while (lastCode >= 0 && text.at(lastCode).isSpace()) --lastCode;
+    bool endsWithSemicolon = lastCode >= 0 && text.at(lastCode) == ';';
+
+    for (const Grammar::Token &token : tokens) {
+        if (endsWithSemicolon || !grammar->isKeywordScope(token.scope)) continue;
+        QString kind = grammar->outlineKind(text.mid(token.start, token.length));
+        if (kind.isEmpty()) continue;
+
+        int p = token.start + token.length;
+        while (p < length && text.at(p).isSpace()) ++p;
+        int nameStart = p;
+        while (p < length && isIdentifierChar(text.at(p))) ++p;
+        if (p == nameStart) continue;
+
+        QString name = text.mid(nameStart, p - nameStart);
+        while (name.endsWith(':')) name.chop(1); // "class Foo: public Bar"
+        if (name.isEmpty() || !grammar->outlineKind(name).isEmpty()) continue; // "enum class X": take the next keyword
+
+        // "template <class T>" and "f(class X *x)" are not declarations
+        while (p < length && text.at(p).isSpace()) ++p;
+        if (p < length && (text.at(p) == '>' || text.at(p) == ',' || text.at(p) == '=' || text.at(p) == ')')) continue;
+
+        s.outlineName = name;
+        s.outlineKind = kind;
+        s.outlineColumn = nameStart;
+        s.outlineNeedsBrace = !grammar->foldsByIndent();
+        return s;
+    }
+
+    // --- Outline: C-style function definitions "Type Class::name(args) const {" ---
+    if (!grammar->outlinesFunctions() || endsWithSemicolon
+        || s.brackets.isEmpty() || s.brackets.first().ch != '(') {
+        return s;
+    }
+
+    int open = s.brackets.first().column;
+    int close = -1;
+    int depth = 0;
+    for (const BlockSummary::Bracket &bracket : std::as_const(s.brackets)) {
+        if (bracket.ch == '(') ++depth;
+        else if (bracket.ch == ')' && --depth == 0) {
+            close = bracket.column;
+            break;
+        }
+    }
+    if (close < 0) return s;
+
+    int nameEnd = open;
+    while (nameEnd > 0 && text.at(nameEnd - 1).isSpace()) --nameEnd;
+    int nameStart = nameEnd;
+    while (nameStart > 0 && isIdentifierChar(text.at(nameStart - 1))) --nameStart;
+    if (nameStart == nameEnd || text.at(nameStart).isDigit()) return s;
+
+    // "if (", "while (", "sizeof(" ...
+    for (const Grammar::Token &token : tokens) {
+        if (token.start <= nameEnd - 1 && nameEnd - 1 < token.start + token.length
+            && grammar->isKeywordScope(token.scope)) {
+            return s;
+        }
+    }
+
+    // Calls and expressions: "x = f(", "obj.f(", "a, f(", "return f(" ...
+    static const QString exprChars = QStringLiteral("=.,;!?+-|/%^\"'");
+    for (int i = first; i < nameStart; ++i) {
+        if (exprChars.contains(text.at(i))) return s;
+    }
+
+    // After the parameter list only qualifiers, a trailing return type, '{' or
+    // a constructor initializer list may follow
+    static const QRegularExpression tailPattern(QStringLiteral(
+        "^\\s*((const|override|final|noexcept|volatile|mutable|&&|&)\\s*)*(->[^{;]*)?\\s*([{:].*)?$"));
+    if (!tailPattern.match(text.mid(close + 1)).hasMatch()) return s;
+
+    s.outlineName = text.mid(nameStart, nameEnd - nameStart);
+    s.outlineKind = QStringLiteral("function");
+    s.outlineColumn = nameStart;
+    s.outlineNeedsBrace = true;
+    return s;
+}
+
+DocumentStructure::FoldRange DocumentStructure::foldRangeAt(int blockNumber) const {
+    auto it = std::lower_bound(m_folds.constBegin(), m_folds.constEnd(), blockNumber,
+                               [](const FoldRange &fold, int block) { return fold.startBlock < block; });
+    if (it != m_folds.constEnd() && it->startBlock == blockNumber) return *it;
+    return FoldRange{-1, -1};
+}
+
+int DocumentStructure::matchingBracket(int position) const {
+    QTextBlock block = m_document->findBlock(position);
+    auto *data = static_cast<BlockData *>(block.userData());
+    if (!data) return -1;
+
+    const int column = position - block.position();
+    const QVector<BlockSummary::Bracket> &brackets = data->summary.brackets;
+    int index = -1;
+    for (int i = 0; i < brackets.size(); ++i) {
+        if (brackets[i].column == column) index = i;
+    }
+    if (index < 0) return -1;
+
+    const QChar ch = brackets[index].ch;
+    const QChar target = partnerOf(ch);
+    const bool forward = isOpening(ch);
+    int depth = 0;
+
+    // Count only brackets of the same kind, like most editors do
+    for (int visited = 0; block.isValid() && visited < kMaxMatchBlocks; ++visited) {
+        data = static_cast<BlockData *>(block.userData());
+        if (data) {
+            const QVector<BlockSummary::Bracket> &list = data->summary.brackets;
+            int i = visited == 0 ? index + (forward ? 1 : -1) : (forward ? 0 : list.size() - 1);
+            for (; i >= 0 && i < list.size(); i += forward ? 1 : -1) {
+                if (list[i].ch == ch) {
+                    ++depth;
+                } else if (list[i].ch == target) {
+                    if (depth == 0) return block.position() + list[i].column;
+                    --depth;
+                }
+            }
+        }
+        block = forward ? block.next() : block.previous();
+    }
+    return -1;
+}
+
+void DocumentStructure::scheduleParse() {
+    if (m_running) {
+        m_dirty = true; // Re-run when the current job returns
+        return;
+    }
+    m_parseTimer->start();
+}
+
+void DocumentStructure::startParse() {
+    // Snapshot the summaries (shared copies, no bracket list is duplicated)
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<BlockSummary> blocks;
+    blocks.reserve(m_document->blockCount());
+    for (QTextBlock block = m_document->begin(); block.isValid(); block = block.next()) {
+        auto *data = static_cast<BlockData *>(block.userData());
+        blocks.append(data ? data->summary : BlockSummary());
+    }
+    const double snapshotMs = timer.nsecsElapsed() / 1e6;
+
+    m_running = true;
+    m_dirty = false;
+    ++m_revision;
+
+    std::shared_ptr<Cache> cache = m_cache;
+    const bool byIndent = m_grammar && m_grammar->foldsByIndent();
+    QPointer<DocumentStructure> guard(this);
+
+    QThreadPool::globalInstance()->start([blocks, byIndent, cache, guard, snapshotMs]() {
+        std::shared_ptr<Result> result = parseSnapshot(blocks, byIndent, cache.get());
+        result->ms += snapshotMs;
+
+        // Back to the GUI thread. qApp is the context object because 'guard'
+        // may already be gone by the time this runs.
+        QMetaObject::invokeMethod(qApp, [guard, result]() {
+            if (guard) guard->applyResult(result);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DocumentStructure::applyResult(const std::shared_ptr<Result> &result) {
+    m_running = false;
+    m_folds = result->folds;
+    m_outline = result->outline;
+    m_lastParseMs = result->ms;
+    emit structureChanged();
+
+    if (m_dirty) {
+        m_dirty = false;
+        m_parseTimer->start();
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QTextCursor>
+#include <memory>
+
+#include "BlockData.h"
+#include "Grammar.h"
+
+class QTextDocument;
+class QTimer;
+
+// Structural view of a code document: fold ranges, bracket matching and an
+// outline of declarations.
+//
+// The "syntax tree" is kept as a two level reduction over the per-block
+// summaries the Highlighter stores in BlockData:
+//   1. Blocks are grouped into content-defined chunks (a chunk ends after a
+//      block whose summary hash hits a fixed bit pattern), so inserting a line
+//      only changes the chunk it lands in, not every chunk after it.
+//   2. Each chunk is reduced to its unmatched brackets and its multi-line
+//      bracket pairs. Reductions are cached by the chunk's content hash and
+//      reused as long as the chunk is unchanged, wherever it moved to.
+// After an edit the GUI thread only snapshots the summaries (implicitly shared,
+// no copying of bracket lists); the chunking, the reductions of changed chunks
+// and the final combine run on a QThreadPool worker.
+class DocumentStructure : public QObject {
+    Q_OBJECT
+
+public:
+    struct FoldRange {
+        int startBlock; // Block that stays visible (contains the opener)
+        int endBlock;   // Last block of the region (contains the closer)
+    };
+
+    struct OutlineEntry {
+        QString name;
+        QString kind;  // "class", "function", "namespace", ...
+        int block;
+        int column;
+        int depth;     // Nesting level, 0 = top level
+    };
+
+    DocumentStructure(QTextDocument *document, const Grammar *grammar);
+    ~DocumentStructure();
+
+    // Called by the Highlighter for each highlighted line
+    static BlockSummary summarize(const QString &text, const QVector<Grammar::Token> &tokens,
+                                  const Grammar *grammar);
+
+    // Latest results (may lag an edit by one worker run, a few milliseconds)
+    const QVector<FoldRange> &foldRanges() const { return m_folds; }
+    const QVector<OutlineEntry> &outline() const { return m_outline; }
+
+    // Fold range starting at this block, or {-1, -1}
+    FoldRange foldRangeAt(int blockNumber) const;
+
+    // Position of the bracket matching the one at 'position', or -1. Walks the
+    // block summaries directly, so it is always in sync with the document.
+    int matchingBracket(int position) const;
+
+    // Time the last worker run took, for diagnostics
+    double lastParseMs() const { return m_lastParseMs; }
+
+signals:
+    void structureChanged();
+
+private slots:
+    void scheduleParse();
+    void startParse();
+
+private:
+    struct Cache;
+    struct Result;
+    static std::shared_ptr<Result> parseSnapshot(const QVector<BlockSummary> &blocks, bool byIndent,
+                                                 Cache *cache);
+    void applyResult(const std::shared_ptr<Result> &result);
+
+    QTextDocument *m_document;
+    const Grammar *m_grammar;
+    QTimer *m_parseTimer;
+
+    // Shared with the worker; only ever touched by one job at a time
+    std::shared_ptr<Cache> m_cache;
+    bool m_running = false;
+    bool m_dirty = false;
+    int m_revision = 0;
+
+    QVector<FoldRange> m_folds;
+    QVector<OutlineEntry> m_outline;
+    double m_lastParseMs = 0.0;
+};
@@ -0,0 +1,704 @@
+#include "Grammar.h"
+
+#include <QJsonArray>
+#include <QMap>
+#include <algorithm>
+#include <bitset>
+
+// =========================================================
+// Regex -> NFA (Thompson construction)
+// =========================================================
+
+namespace {
+
+// ASCII characters are their own symbol, everything else shares symbol 128.
+constexpr int kSymbols = 129;
+constexpr int kNonAscii = 128;
+using CharSet = std::bitset<kSymbols>;
+
+// Guards against definitions that would explode during subset construction
+constexpr int kMaxNfaStates = 20000;
+constexpr int kMaxDfaStates = 4000;
+
+inline int symbolOf(QChar c) {
+    ushort u = c.unicode();
+    return u < 128 ? u : kNonAscii;
+}
+
+struct Nfa {
+    struct State {
+        QVector<int> epsilon;  // Epsilon transitions
+        int set = -1;          // Index into 'sets' for the single labelled edge
+        int next = -1;         // Target of the labelled edge
+        int acceptRule = -1;
+    };
+
+    QVector<State> states;
+    QVector<CharSet> sets;
+
+    int addState() {
+        states.append(State());
+        return states.size() - 1;
+    }
+};
+
+struct Fragment {
+    int start = -1;
+    int end = -1;
+};
+
+// Recursive-descent parser emitting NFA fragments directly:
+//   alternation := concat ('|' concat)*
+//   concat      := repeat*
+//   repeat      := atom ('*' | '+' | '?' | '{n,m}')*
+//   atom        := '(' alternation ')' | '[' class ']' | '.' | escape | literal
+class RegexParser {
+public:
+    RegexParser(const QString &pattern, Nfa &nfa) : m_pattern(pattern), m_nfa(nfa) {}
+
+    bool parse(Fragment *out, QString *error) {
+        *out = parseAlternation();
+        if (m_error.isEmpty() && m_pos < m_pattern.size()) {
+            fail("unexpected ')'");
+        }
+        if (m_error.isEmpty() && m_nfa.states.size() > kMaxNfaStates) {
+            fail("pattern too large");
+        }
+        if (!m_error.isEmpty()) {
+            *error = QString("%1 at offset %2 in \"%3\"").arg(m_error).arg(m_pos).arg(m_pattern);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool atEnd() const { return m_pos >= m_pattern.size() || !m_error.isEmpty(); }
+    QChar peek() const { return m_pattern.at(m_pos); }
+
+    void fail(const QString &message) {
+        if (m_error.isEmpty()) m_error = message;
+    }
+
+    Fragment emptyFragment() {
+        Fragment f;
+        f.start = m_nfa.addState();
+        f.end = m_nfa.addState();
+        m_nfa.states[f.start].epsilon.append(f.end);
+        return f;
+    }
+
+    Fragment setFragment(const CharSet &set) {
+        Fragment f;
+        f.start = m_nfa.addState();
+        f.end = m_nfa.addState();
+        m_nfa.sets.append(set);
+        m_nfa.states[f.start].set = m_nfa.sets.size() - 1;
+        m_nfa.states[f.start].next = f.end;
+        return f;
+    }
+
+    Fragment parseAlternation() {
+        Fragment first = parseConcat();
+        if (atEnd() || peek() != '|') return first;
+
+        Fragment result;
+        result.start = m_nfa.addState();
+        result.end = m_nfa.addState();
+        m_nfa.states[result.start].epsilon.append(first.start);
+        m_nfa.states[first.end].epsilon.append(result.end);
+
+        while (!atEnd() && peek() == '|') {
+            ++m_pos;
+            Fragment branch = parseConcat();
+            m_nfa.states[result.start].epsilon.append(branch.start);
+            m_nfa.states[branch.end].epsilon.append(result.end);
+        }
+        return result;
+    }
+
+    Fragment parseConcat() {
+        Fragment result = emptyFragment();
+        while (!atEnd() && peek() != '|' && peek() != ')') {
+            Fragment next = parseRepeat();
+            m_nfa.states[result.end].epsilon.append(next.start);
+            result.end = next.end;
+        }
+        return result;
+    }
+
+    Fragment parseRepeat() {
+        int atomStart = m_pos;
+        Fragment atom = parseAtom();
+        int atomEnd = m_pos;
+
+        while (!atEnd()) {
+            QChar c = peek();
+            if (c == '*' || c == '+' || c == '?') {
+                ++m_pos;
+                atom = c == '*' ? star(atom) : c == '+' ? plus(atom) : optional(atom);
+            } else if (c == '{') {
+                int min = 0, max = 0;
+                if (!parseBounds(&min, &max)) return atom;
+                atom = counted(atom, atomStart, atomEnd, min, max);
+            } else {
+                break;
+            }
+        }
+        return atom;
+    }
+
+    Fragment star(Fragment a) {
+        Fragment f;
+        f.start = m_nfa.addState();
+        f.end = m_nfa.addState();
+        m_nfa.states[f.start].epsilon << a.start << f.end;
+        m_nfa.states[a.end].epsilon << a.start << f.end;
+        return f;
+    }
+
+    Fragment plus(Fragment a) {
+        int end = m_nfa.addState();
+        m_nfa.states[a.end].epsilon << a.start << end;
+        return Fragment{a.start, end};
+    }
+
+    Fragment optional(Fragment a) {
+        Fragment f;
+        f.start = m_nfa.addState();
+        f.end = m_nfa.addState();
+        m_nfa.states[f.start].epsilon << a.start << f.end;
+        m_nfa.states[a.end].epsilon << f.end;
+        return f;
+    }
+
+    // '{' already peeked. Accepts {n}, {n,} and {n,m}; max == -1 means unbounded.
+    bool parseBounds(int *min, int *max) {
+        int close = m_pattern.indexOf('}', m_pos);
+        if (close < 0) {
+            fail("unterminated '{'");
+            return false;
+        }
+        QString body = m_pattern.mid(m_pos + 1, close - m_pos - 1);
+        QStringList parts = body.split(',');
+        bool ok1 = true, ok2 = true;
+        *min = parts.value(0).toInt(&ok1);
+        if (parts.size() == 1) *max = *min;
+        else if (parts.value(1).isEmpty()) *max = -1;
+        else *max = parts.value(1).toInt(&ok2);
+
+        if (!ok1 || !ok2 || parts.size() > 2 || *min < 0 || (*max >= 0 && *max < *min) || *min > 100 || *max > 100) {
+            fail("invalid repetition bounds");
+            return false;
+        }
+        m_pos = close + 1;
+        return true;
+    }
+
+    // Expands a{min,max} into min copies of 'a' followed by optional copies.
+    // Copies are produced by parsing the atom's source text again, which is
+    // simpler than cloning an NFA sub-graph.
+    Fragment counted(Fragment first, int atomStart, int atomEnd, int min, int max) {
+        int resume = m_pos;
+        auto copy = [&]() {
+            m_pos = atomStart;
+            Fragment f = parseAtom();
+            Q_ASSERT(m_pos == atomEnd);
+            Q_UNUSED(atomEnd);
+            return f;
+        };
+
+        Fragment result = emptyFragment();
+        auto append = [&](Fragment f) {
+            m_nfa.states[result.end].epsilon.append(f.start);
+            result.end = f.end;
+        };
+
+        bool firstUsed = false;
+        auto next = [&]() {
+            if (!firstUsed) {
+                firstUsed = true;
+                return first;
+            }
+            return copy();
+        };
+
+        for (int i = 0; i < min; ++i) append(next());
+        if (max < 0) {
+            append(star(next()));
+        } else {
+            for (int i = min; i < max; ++i) append(optional(next()));
+        }
+
+        m_pos = resume;
+        return result;
+    }
+
+    Fragment parseAtom() {
+        if (atEnd()) {
+            fail("unexpected end of pattern");
+            return emptyFragment();
+        }
+
+        QChar c = peek();
+        ++m_pos;
+
+        if (c == '(') {
+            // Non-capturing group syntax is accepted and means the same thing
+            if (m_pattern.mid(m_pos, 2) == "?:") m_pos += 2;
+            Fragment inner = parseAlternation();
+            if (atEnd() || peek() != ')') {
+                fail("missing ')'");
+                return inner;
+            }
+            ++m_pos;
+            return inner;
+        }
+        if (c == '[') {
+            return setFragment(parseClass());
+        }
+        if (c == '.') {
+            CharSet set;
+            set.set();
+            set.reset('\n');
+            return setFragment(set);
+        }
+        if (c == '\\') {
+            return setFragment(parseEscape());
+        }
+        if (c == '*' || c == '+' || c == '?' || c == '{' || c == ')' || c == '|') {
+            fail(QString("unexpected '%1'").arg(c));
+            return emptyFragment();
+        }
+        if (c == '^' || c == '$') {
+            fail("anchors are not supported");
+            return emptyFragment();
+        }
+
+        CharSet set;
+        set.set(symbolOf(c));
+        return setFragment(set);
+    }
+
+    // '\' already consumed
+    CharSet parseEscape() {
+        CharSet set;
+        if (atEnd()) {
+            fail("trailing '\\'");
+            return set;
+        }
+
+        QChar c = peek();
+        ++m_pos;
+        switch (c.unicode()) {
+        case 'd': for (int i = '0'; i <= '9'; ++i) set.set(i); break;
+        case 'w': set = wordSet(); break;
+        case 's': for (int i : {' ', '\t', '\n', '\r', '\f', '\v'}) set.set(i); break;
+        case 'D': for (int i = '0'; i <= '9'; ++i) set.set(i); set.flip(); break;
+        case 'W': set = wordSet(); set.flip(); break;
+        case 'S': for (int i : {' ', '\t', '\n', '\r', '\f', '\v'}) set.set(i); set.flip(); break;
+        case 't': set.set('\t'); break;
+        case 'n': set.set('\n'); break;
+        case 'r': set.set('\r'); break;
+        case 'f': set.set('\f'); break;
+        case 'v': set.set('\v'); break;
+        default:
+            if (c.isLetterOrNumber()) {
+                fail(QString("unsupported escape '\\%1'").arg(c));
+            }
+            set.set(symbolOf(c)); // \. \\ \[ \" ...
+            break;
+        }
+        return set;
+    }
+
+    static CharSet wordSet() {
+        CharSet set;
+        for (int i = 'a'; i <= 'z'; ++i) set.set(i);
+        for (int i = 'A'; i <= 'Z'; ++i) set.set(i);
+        for (int i = '0'; i <= '9'; ++i) set.set(i);
+        set.set('_');
+        set.set(kNonAscii); // Unicode identifiers
+        return set;
+    }
+
+    // '[' already consumed
+    CharSet parseClass() {
+        CharSet set;
+        bool negate = false;
+        if (!atEnd() && peek() == '^') {
+            negate = true;
+            ++m_pos;
+        }
+
+        bool firstChar = true;
+        while (!atEnd() && (peek() != ']' || firstChar)) {
+            firstChar = false;
+
+            CharSet item;
+            int low = -1;
+            if (peek() == '\\') {
+                ++m_pos;
+                item = parseEscape();
+                if (item.count() == 1) {
+                    for (int i = 0; i < kSymbols; ++i) if (item.test(i)) low = i;
+                }
+            } else {
+                low = symbolOf(peek());
+                item.set(low);
+                ++m_pos;
+            }
+
+            // Range a-z (a trailing '-' is a literal)
+            if (low >= 0 && low != kNonAscii && !atEnd() && peek() == '-'
+                && m_pos + 1 < m_pattern.size() && m_pattern.at(m_pos + 1) != ']') {
+                ++m_pos;
+                int high;
+                if (peek() == '\\') {
+                    ++m_pos;
+                    CharSet h = parseEscape();
+                    high = -1;
+                    for (int i = 0; i < kSymbols; ++i) if (h.test(i)) high = i;
+                } else {
+                    high = symbolOf(peek());
+                    ++m_pos;
+                }
+                if (high < low) {
+                    fail("invalid class range");
+                    return set;
+                }
+                for (int i = low; i <= high; ++i) item.set(i);
+            }
+            set |= item;
+        }
+
+        if (atEnd()) {
+            fail("missing ']'");
+            return set;
+        }
+        ++m_pos; // ']'
+
+        if (negate) set.flip();
+        return set;
+    }
+
+    const QString m_pattern;
+    Nfa &m_nfa;
+    int m_pos = 0;
+    QString m_error;
+};
+
+// Epsilon closure, returned sorted so it can key the DFA state map
+QVector<int> closure(const Nfa &nfa, QVector<int> states) {
+    QVector<bool> seen(nfa.states.size(), false);
+    QVector<int> stack = states;
+    states.clear();
+    while (!stack.isEmpty()) {
+        int s = stack.takeLast();
+        if (seen[s]) continue;
+        seen[s] = true;
+        states.append(s);
+        for (int e : nfa.states[s].epsilon) {
+            if (!seen[e]) stack.append(e);
+        }
+    }
+    std::sort(states.begin(), states.end());
+    return states;
+}
+
+} // namespace
+
+// =========================================================
+// Grammar
+// =========================================================
+
+int Grammar::scopeIndex(const QString &scope) {
+    if (scope.isEmpty()) return -1;
+    int index = m_scopes.indexOf(scope);
+    if (index < 0) {
+        m_scopes.append(scope);
+        index = m_scopes.size() - 1;
+    }
+    return index;
+}
+
+Grammar *Grammar::compile(const QJsonObject &definition, QString *error) {
+    Grammar *grammar = new Grammar;
+    grammar->m_name = definition.value("name").toString();
+
+    // --- Keywords: { "keyword": ["class", ...], "constant": ["true", ...] } ---
+    QJsonObject keywords = definition.value("keywords").toObject();
+    for (auto it = keywords.constBegin(); it != keywords.constEnd(); ++it) {
+        int scope = grammar->scopeIndex(it.key());
+        for (const QJsonValue &word : it.value().toArray()) {
+            grammar->m_keywords.insert(word.toString(), scope);
+        }
+    }
+
+    // --- Structure hints ---
+    //   "folding": "indent", "outline": { "class": "class", "def": "function" },
+    //   "outlineFunctions": true
+    grammar->m_foldsByIndent = definition.value("folding").toString() == QLatin1String("indent");
+    grammar->m_outlineFunctions = definition.value("outlineFunctions").toBool();
+    QJsonObject outline = definition.value("outline").toObject();
+    for (auto it = outline.constBegin(); it != outline.constEnd(); ++it) {
+        grammar->m_outline.insert(it.key(), it.value().toString());
+    }
+
+    // --- Token rules -> one NFA with a shared start state ---
+    Nfa nfa;
+    int start = nfa.addState();
+
+    auto addRule = [&](const QString &pattern, const Rule &rule) {
+        Fragment fragment;
+        RegexParser parser(pattern, nfa);
+        if (!parser.parse(&fragment, error)) return false;
+
+        grammar->m_rules.append(rule);
+        nfa.states[start].epsilon.append(fragment.start);
+        nfa.states[fragment.end].acceptRule = grammar->m_rules.size() - 1;
+        return true;
+    };
+
+    // Region openers come first so they win ties against ordinary tokens
+    //   { "begin": "/\\*", "end": "*/", "scope": "comment" }
+    //   { "begin": "R\"[^ ()\\\\]{0,16}\\(", "end": ")${delim}\"",
+    //     "delimiterAfter": "\"", "delimiterBefore": "(", "scope": "string" }
+    QJsonArray regions = definition.value("regions").toArray();
+    for (const QJsonValue &value : regions) {
+        QJsonObject regionDef = value.toObject();
+
+        Region region;
+        region.end = regionDef.value("end").toString();
+        region.scope = grammar->scopeIndex(regionDef.value("scope").toString());
+        QString escape = regionDef.value("escape").toString();
+        if (!escape.isEmpty()) region.escape = escape.at(0);
+        region.delimiterAfter = regionDef.value("delimiterAfter").toString();
+        region.delimiterBefore = regionDef.value("delimiterBefore").toString();
+
+        if (region.end.isEmpty()) {
+            *error = QString("region in '%1' has no end marker").arg(grammar->m_name);
+            delete grammar;
+            return nullptr;
+        }
+        grammar->m_regions.append(region);
+
+        Rule rule;
+        rule.scope = region.scope;
+        rule.region = grammar->m_regions.size() - 1;
+        if (!addRule(regionDef.value("begin").toString(), rule)) {
+            delete grammar;
+            return nullptr;
+        }
+    }
+
+    QJsonArray tokens = definition.value("tokens").toArray();
+    for (const QJsonValue &value : tokens) {
+        QJsonObject tokenDef = value.toObject();
+
+        Rule rule;
+        rule.scope = grammar->scopeIndex(tokenDef.value("scope").toString());
+        rule.keywords = tokenDef.value("keywords").toBool();
+        if (!addRule(tokenDef.value("match").toString(), rule)) {
+            delete grammar;
+            return nullptr;
+        }
+    }
+
+    // --- Symbol equivalence classes ---
+    // Symbols that no edge tells apart share a column in the table.
+    // Start with one class and split it by every distinct edge set.
+    int classOf[kSymbols] = {};
+    int classCount = 1;
+    for (const CharSet &set : nfa.sets) {
+        QHash<int, int> splitTo; // old class -> new class for members of 'set'
+        for (int sym = 0; sym < kSymbols; ++sym) {
+            if (!set.test(sym)) continue;
+            int old = classOf[sym];
+            auto it = splitTo.find(old);
+            if (it == splitTo.end()) {
+                // Only split when the old class also has members outside 'set'
+                bool mixed = false;
+                for (int other = 0; other < kSymbols && !mixed; ++other) {
+                    mixed = classOf[other] == old && !set.test(other);
+                }
+                it = splitTo.insert(old, mixed ? classCount++ : old);
+            }
+            classOf[sym] = it.value();
+        }
+    }
+
+    QVector<int> representative(classCount, -1);
+    for (int sym = 0; sym < kSymbols; ++sym) {
+        grammar->m_classOf[sym] = static_cast<unsigned char>(classOf[sym]);
+        if (representative[classOf[sym]] < 0) representative[classOf[sym]] = sym;
+    }
+    grammar->m_classCount = classCount;
+
+    // --- Subset construction ---
+    QMap<QVector<int>, int> dfaIndex;
+    QVector<QVector<int>> pending;
+
+    auto addDfaState = [&](const QVector<int> &nfaStates) {
+        auto it = dfaIndex.constFind(nfaStates);
+        if (it != dfaIndex.constEnd()) return it.value();
+
+        int index = grammar->m_acceptRule.size();
+        dfaIndex.insert(nfaStates, index);
+        pending.append(nfaStates);
+
+        // The lowest rule index wins when several rules accept
+        int accept = -1;
+        for (int s : nfaStates) {
+            int rule = nfa.states[s].acceptRule;
+            if (rule >= 0 && (accept < 0 || rule < accept)) accept = rule;
+        }
+        grammar->m_acceptRule.append(accept);
+        grammar->m_next.resize(grammar->m_next.size() + classCount);
+        std::fill(grammar->m_next.end() - classCount, grammar->m_next.end(), -1);
+        return index;
+    };
+
+    addDfaState(closure(nfa, {start}));
+
+    for (int current = 0; current < pending.size(); ++current) {
+        if (pending.size() > kMaxDfaStates) {
+            *error = QString("grammar '%1' is too complex (more than %2 DFA states)")
+                     .arg(grammar->m_name).arg(kMaxDfaStates);
+            delete grammar;
+            return nullptr;
+        }
+
+        const QVector<int> nfaStates = pending[current];
+        for (int cls = 0; cls < classCount; ++cls) {
+            int sym = representative[cls];
+            QVector<int> moved;
+            for (int s : nfaStates) {
+                const Nfa::State &state = nfa.states[s];
+                if (state.set >= 0 && nfa.sets[state.set].test(sym)) moved.append(state.next);
+            }
+            if (moved.isEmpty()) continue;
+
+            int target = addDfaState(closure(nfa, moved));
+            grammar->m_next[current * classCount + cls] = target;
+        }
+    }
+
+    for (const QString &scope : std::as_const(grammar->m_scopes)) {
+        grammar->m_keywordScopes.append(scope.startsWith(QLatin1String("keyword")));
+    }
+
+    return grammar;
+}
+
+int Grammar::match(const QChar *text, int length, int pos, int *rule) const {
+    int state = 0;
+    int matched = 0;
+    *rule = -1;
+
+    for (int i = pos; i < length; ++i) {
+        state = m_next[state * m_classCount + m_classOf[symbolOf(text[i])]];
+        if (state < 0) break;
+        if (m_acceptRule[state] >= 0) {
+            *rule = m_acceptRule[state];
+            matched = i - pos + 1;
+        }
+    }
+    return matched;
+}
+
+int Grammar::findRegionEnd(const QString &line, int from, const Region &region, const QString &delimiter) const {
+    QString end = region.end;
+    if (end.contains(QLatin1String("${delim}"))) end.replace(QLatin1String("${delim}"), delimiter);
+
+    if (region.escape.isNull()) {
+        int found = line.indexOf(end, from);
+        return found < 0 ? -1 : found + end.size();
+    }
+
+    // With an escape character we walk the line, so an escaped quote can't close a """ string
+    const int length = line.size();
+    for (int i = from; i < length; ++i) {
+        if (line.at(i) == region.escape) {
+            ++i;
+            continue;
+        }
+        if (QStringView(line).mid(i).startsWith(end)) return i + end.size();
+    }
+    return -1;
+}
+
+Grammar::LexState Grammar::tokenize(const QString &line, const LexState &in, QVector<Token> *tokens) const {
+    tokens->clear();
+
+    const QChar *text = line.constData();
+    const int length = line.size();
+
+    LexState state = in;
+    int pos = 0;
+
+    // The previous line ended inside a region: find where it closes first
+    if (state.region >= 0 && state.region < m_regions.size()) {
+        const Region &region = m_regions[state.region];
+        int end = findRegionEnd(line, 0, region, state.delimiter);
+        int regionEnd = end < 0 ? length : end;
+
+        if (region.scope >= 0 && regionEnd > 0) tokens->append(Token{0, regionEnd, region.scope});
+        if (end < 0) return state; // Still open, the whole line belongs to it
+
+        state = LexState();
+        pos = regionEnd;
+    } else {
+        state = LexState();
+    }
+
+    while (pos < length) {
+        int ruleIndex;
+        int matched = match(text, length, pos, &ruleIndex);
+        if (matched == 0) {
+            ++pos; // Nothing starts here, leave the character unformatted
+            continue;
+        }
+
+        const Rule &rule = m_rules[ruleIndex];
+
+        if (rule.region >= 0) {
+            const Region &region = m_regions[rule.region];
+
+            // Capture the raw string delimiter from the opening text, e.g. R"xy( -> xy
+            QString delimiter;
+            if (!region.delimiterAfter.isEmpty()) {
+                QStringView begin(text + pos, matched);
+                int after = begin.indexOf(region.delimiterAfter);
+                int before = region.delimiterBefore.isEmpty() ? matched : begin.lastIndexOf(region.delimiterBefore);
+                if (after >= 0 && before > after) {
+                    delimiter = begin.mid(after + region.delimiterAfter.size(),
+                                          before - after - region.delimiterAfter.size()).toString();
+                }
+            }
+
+            int end = findRegionEnd(line, pos + matched, region, delimiter);
+            int regionEnd = end < 0 ? length : end;
+            if (rule.scope >= 0) tokens->append(Token{pos, regionEnd - pos, rule.scope});
+
+            if (end < 0) {
+                state.region = rule.region;
+                state.delimiter = delimiter;
+                return state;
+            }
+            pos = regionEnd;
+            continue;
+        }
+
+        int scope = rule.scope;
+        if (rule.keywords) {
+            // fromRawData: look the word up without copying it
+            auto it = m_keywords.constFind(QString::fromRawData(text + pos, matched));
+            if (it != m_keywords.constEnd()) scope = it.value();
+        }
+
+        if (scope >= 0) tokens->append(Token{pos, matched, scope});
+        pos += matched;
+    }
+
+    return state;
+}
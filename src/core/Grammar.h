@@ -0,0 +1,120 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QJsonObject>
+
+// A compiled language definition (see resources/languages/*.json).
+//
+// All token rules of a language are compiled into ONE deterministic automaton
+// when the grammar is loaded. Lexing a line is then a table walk per character:
+// no regex engine runs while highlighting, and the cost does not grow with the
+// number of rules. At each position the longest match wins; on a tie the rule
+// listed first in the JSON wins (the usual lex/flex convention).
+//
+// Supported pattern syntax (a deliberate subset of ECMAScript regex):
+//   literals, escapes (\t \n \\ \. ...), classes [a-z] [^"\\], shorthand
+//   \d \w \s \D \W \S, '.', groups ( ), alternation |, and the quantifiers
+//   * + ? {n} {n,} {n,m}. No anchors, lookaround or back-references.
+// Characters above U+007F are matched as one "non-ASCII" symbol, which \w,
+// '.' and negated classes include.
+//
+// Constructs that span lines (block comments, triple-quoted and raw strings)
+// are "regions": their begin pattern is part of the DFA, their end is a literal
+// searched for afterwards. Whether a line ends inside a region is returned as
+// a LexState, which the highlighter stores in the block state so the next line
+// can resume there.
+class Grammar {
+public:
+    struct Token {
+        int start;
+        int length;
+        int scope; // Index into scopeNames(), never -1
+    };
+
+    // Lexer state between two lines
+    struct LexState {
+        int region = -1;   // Open region (index into the definition), -1 = none
+        QString delimiter; // Raw string delimiter captured at the region begin
+
+        bool operator==(const LexState &other) const {
+            return region == other.region && delimiter == other.delimiter;
+        }
+    };
+
+    // Compiles a definition. Returns nullptr and fills 'error' on failure.
+    static Grammar *compile(const QJsonObject &definition, QString *error);
+
+    QString name() const { return m_name; }
+
+    // Distinct theme scopes used by this grammar ("comment", "keyword", ...).
+    // Highlighters map these to formats once per theme, not per token.
+    const QStringList &scopeNames() const { return m_scopes; }
+
+    // Splits one line into scoped tokens, starting in state 'in' (the state
+    // the previous line ended in). 'tokens' is cleared first so the caller can
+    // reuse its buffer between blocks. Returns the state at the end of the line.
+    LexState tokenize(const QString &line, const LexState &in, QVector<Token> *tokens) const;
+
+    int regionCount() const { return m_regions.size(); }
+
+    // --- Structure hints (see DocumentStructure) ---
+    // Fold by indentation (Python, YAML) instead of by brackets
+    bool foldsByIndent() const { return m_foldsByIndent; }
+    // Outline kind for a declaration keyword ("class" -> "class", "def" -> "function"),
+    // empty if the word doesn't introduce an outline entry
+    QString outlineKind(const QString &keyword) const { return m_outline.value(keyword); }
+    // Detect C-style function definitions "name(...) {" for the outline
+    bool outlinesFunctions() const { return m_outlineFunctions; }
+    // False for data formats (JSON, YAML, logs): nothing to put in an outline
+    bool hasOutline() const { return m_outlineFunctions || !m_outline.isEmpty(); }
+    // True if 'scope' (index) is a keyword-like scope, used to reject "if (" etc.
+    bool isKeywordScope(int scope) const { return m_keywordScopes.value(scope); }
+
+    // Table sizes, for diagnostics
+    int stateCount() const { return m_acceptRule.size(); }
+    int classCount() const { return m_classCount; }
+
+private:
+    Grammar() = default;
+
+    struct Rule {
+        int scope = -1;          // -1: token consumed but left unformatted
+        bool keywords = false;   // Look the matched text up in m_keywords
+        int region = -1;         // This rule opens a region
+    };
+
+    struct Region {
+        QString end;             // Literal; "${delim}" is replaced by the delimiter
+        int scope = -1;
+        QChar escape;            // Skips the following character while searching the end
+        QString delimiterAfter;  // The delimiter is the begin text between these two
+        QString delimiterBefore;
+    };
+
+    // Longest match starting at 'pos'. Returns the length (0 = no match).
+    int match(const QChar *text, int length, int pos, int *rule) const;
+
+    // Index just past the region's end marker, or -1 if the line ends first
+    int findRegionEnd(const QString &line, int from, const Region &region, const QString &delimiter) const;
+
+    int scopeIndex(const QString &scope);
+
+    QString m_name;
+    QStringList m_scopes;
+    QVector<Rule> m_rules;
+    QVector<Region> m_regions;
+    QHash<QString, int> m_keywords; // Word -> scope
+
+    bool m_foldsByIndent = false;
+    bool m_outlineFunctions = false;
+    QHash<QString, QString> m_outline;   // Keyword -> outline kind
+    QVector<bool> m_keywordScopes;       // Per scope: name starts with "keyword"
+
+    // DFA: state 0 is the start state, -1 is the dead state.
+    int m_classCount = 0;
+    unsigned char m_classOf[129] = {}; // Symbol -> equivalence class
+    QVector<int> m_next;               // [state * m_classCount + class]
+    QVector<int> m_acceptRule;         // Per state, -1 if not accepting
+};
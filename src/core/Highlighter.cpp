@@ -1,67 +1,131 @@
 #include "Highlighter.h"
+#include "ThemeRegistry.h"
+#include "BlockData.h"
+#include "DocumentStructure.h"
+#include "MemoryAccounting.h"
 
-Highlighter::Highlighter(QTextDocument *parent, const QHash<QString, QColor> &theme)
-    : QSyntaxHighlighter(parent) 
+namespace {
+
+// Non-blank text of a line as colored runs, for the minimap
+void summarizeColors(const QString &text, const QVector<Grammar::Token> &tokens, QVector<ColorRun> *runs) {
+    runs->clear();
+
+    int tokenIndex = 0;
+    int column = 0;
+    for (int i = 0; i < text.size() && column < ColorRun::kMaxColumns; ++i) {
+        const QChar ch = text.at(i);
+        if (ch == QLatin1Char('\t')) {
+            column = (column / 4 + 1) * 4;
+            continue;
+        }
+        if (ch.isSpace()) {
+            ++column;
+            continue;
+        }
+
+        // Tokens are sorted and don't overlap
+        while (tokenIndex < tokens.size() && tokens[tokenIndex].start + tokens[tokenIndex].length <= i) {
+            ++tokenIndex;
+        }
+        quint16 scope = ColorRun::kPlainScope;
+        if (tokenIndex < tokens.size() && tokens[tokenIndex].start <= i) {
+            scope = quint16(tokens[tokenIndex].scope);
+        }
+
+        // Extend the previous run if it ends right here in the same color
+        if (!runs->isEmpty()) {
+            ColorRun &last = runs->last();
+            if (last.scope == scope && last.column + last.length == column && last.length < 255) {
+                ++last.length;
+                ++column;
+                continue;
+            }
+        }
+        runs->append(ColorRun{quint8(column), 1, scope});
+        ++column;
+    }
+}
+
+} // namespace
+
+Highlighter::Highlighter(QTextDocument *parent, const Grammar *grammar, const Theme *theme)
+    : QSyntaxHighlighter(parent), m_grammar(grammar)
 {
-    HighlightingRule rule;
-
-    // Define format helper
-    auto createFormat = [&](const QString &colorKey, bool bold = false) {
-        QTextCharFormat fmt;
-        fmt.setForeground(theme.value(colorKey, Qt::black)); // Default to black if key missing
-        if (bold) fmt.setFontWeight(QFont::Bold);
-        return fmt;
-    };
-
-    // Define the Keywords (The Regex)
-    // Using "keyword" color from JSON
-    QTextCharFormat keywordFmt = createFormat("keyword", true);
-    // We look for words bounded by \b (word boundaries)
-    QStringList keywords;
-    keywords << "\\bclass\\b" << "\\bconst\\b" << "\\benum\\b" << "\\bexplicit\\b"
-             << "\\bfriend\\b" << "\\binline\\b" << "\\bint\\b" << "\\blong\\b"
-             << "\\bnamespace\\b" << "\\boperator\\b" << "\\bprivate\\b" << "\\bprotected\\b"
-             << "\\bpublic\\b" << "\\bshort\\b" << "\\bsignals\\b" << "\\bsigned\\b"
-             << "\\bslots\\b" << "\\bstatic\\b" << "\\bstruct\\b"
-             << "\\btemplate\\b" << "\\btypedef\\b" << "\\btypename\\b"
-             << "\\bunion\\b" << "\\bunsigned\\b" << "\\bvirtual\\b"
-             << "\\bvoid\\b" << "\\bvolatile\\b" << "\\bbool\\b";
-
-    // Compile the Rules
-    for (const QString &pattern : keywords) {
-        rule.pattern = QRegularExpression(pattern);
-        rule.format = keywordFmt;
-        rules.append(rule);
+    setTheme(theme);
+}
+
+void Highlighter::setTheme(const Theme *theme) {
+    // The formats are implicitly shared with the Theme, nothing is rebuilt here
+    m_theme = theme;
+
+    m_formats.clear();
+    if (!m_grammar) return;
+    for (const QString &scope : m_grammar->scopeNames()) {
+        m_formats.append(theme ? theme->format(scope) : QTextCharFormat());
     }
+}
+
+int Highlighter::encodeState(const Grammar::LexState &state) {
+    if (state.region < 0) return 0;
+
+    int delimiterId = 0;
+    if (!state.delimiter.isEmpty()) {
+        auto it = m_delimiterIds.constFind(state.delimiter);
+        if (it == m_delimiterIds.constEnd()) {
+            m_delimiters.append(state.delimiter);
+            it = m_delimiterIds.insert(state.delimiter, m_delimiters.size());
+        }
+        delimiterId = it.value();
+    }
+    return (delimiterId << 8) | (state.region + 1);
+}
 
-    // Types (using "type" color)
-    QTextCharFormat typeFmt = createFormat("type");
-    rule.pattern = QRegularExpression("\\b[A-Z][A-Za-z0-9_]+\\b"); // Simple Regex for ClassNames
-    rule.format = typeFmt;
-    rules.append(rule);
-
-    // Strings (using "string" color)
-    QTextCharFormat stringFmt = createFormat("string");
-    rule.pattern = QRegularExpression("\".*\""); 
-    rule.format = stringFmt;
-    rules.append(rule);
-
-    // Comments (using "comment" color)
-    QTextCharFormat commentFmt = createFormat("comment");
-    rule.pattern = QRegularExpression("//[^\n]*");
-    rule.format = commentFmt;
-    rules.append(rule);
+Grammar::LexState Highlighter::decodeState(int blockState) const {
+    Grammar::LexState state;
+    if (blockState <= 0) return state;
+
+    state.region = (blockState & 0xff) - 1;
+    int delimiterId = blockState >> 8;
+    if (delimiterId > 0) state.delimiter = m_delimiters.value(delimiterId - 1);
+    return state;
 }
 
 void Highlighter::highlightBlock(const QString &text) {
-    // Loop through every rule we defined
-    for (const HighlightingRule &rule : rules) {
-        // Find every match in the current line of text
-        QRegularExpressionMatchIterator i = rule.pattern.globalMatch(text);
-        while (i.hasNext()) {
-            QRegularExpressionMatch match = i.next();
-            // Apply the color to the matched range
-            setFormat(match.capturedStart(), match.capturedLength(), rule.format);
+    if (!m_grammar) return;
+    MemoryAccounting::Scope scope(MemoryAccounting::Highlighting);
+
+    // One pass of the grammar's DFA over the line, resuming inside a block
+    // comment or raw string if the previous line ended in one
+    Grammar::LexState in = decodeState(previousBlockState());
+    Grammar::LexState out = m_grammar->tokenize(text, in, &m_tokens);
+
+    auto *data = static_cast<BlockData *>(currentBlockUserData());
+    if (!data) {
+        data = new BlockData;
+        setCurrentBlockUserData(data);
+    }
+
+    // Lines inside a folded region still need their end state and summary,
+    // but formatting them would only lay out text nobody sees. CodeEditor
+    // rehighlights them when the fold is opened.
+    const bool visible = currentBlock().isVisible();
+    data->formatsPending = !visible;
+    if (visible) {
+        for (const Grammar::Token &token : std::as_const(m_tokens)) {
+            setFormat(token.start, token.length, m_formats[token.scope]);
         }
     }
-}
\ No newline at end of file
+
+    setCurrentBlockState(encodeState(out));
+
+    // Keep the line's structural summary (brackets, indentation, outline
+    // candidate) next to it for DocumentStructure, from the tokens we already have
+    data->summary = DocumentStructure::summarize(text, m_tokens, m_grammar);
+
+    // Minimap colors; only blocks whose summary really changed are repainted
+    summarizeColors(text, m_tokens, &m_colors);
+    if (m_colors != data->colors) {
+        data->colors = m_colors;
+        emit blockColorsChanged(currentBlock());
+    }
+}
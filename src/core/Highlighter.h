@@ -1,17 +1,39 @@
 #pragma once
 #include <QSyntaxHighlighter>
-#include <QRegularExpression>
+#include <QTextCharFormat>
+#include <QVector>
+#include <QHash>
+#include <QStringList>
+#include <QTextBlock>
 
-struct ThemeRule {
-    QString pattern;
-    QString colorKey; // e.g., "keyword" or "type"
-};
+#include "Grammar.h"
+#include "BlockData.h"
+
+struct Theme;
 
+// Colors a document using a compiled Grammar (see LanguageRegistry).
+// The grammar only yields scope indices; this class maps them to the
+// theme's shared formats once per theme instead of once per token.
 class Highlighter : public QSyntaxHighlighter {
     Q_OBJECT
 
 public:
-    explicit Highlighter(QTextDocument *parent, const QHash<QString, QColor> &theme);
+    explicit Highlighter(QTextDocument *parent, const Grammar *grammar, const Theme *theme);
+
+    // Swap the formats to another theme's. Does NOT rehighlight; the owner
+    // decides when (see CodeEditor, which waits until it is visible).
+    void setTheme(const Theme *theme);
+    const Theme *theme() const { return m_theme; }
+
+    const Grammar *grammar() const { return m_grammar; }
+
+    // Current format per grammar scope (see ColorRun::scope)
+    const QVector<QTextCharFormat> &formats() const { return m_formats; }
+
+signals:
+    // The block's minimap color summary changed (not emitted when only the
+    // theme changed, since the summary stores scopes, not colors)
+    void blockColorsChanged(const QTextBlock &block);
 
 protected:
     // This is the ONLY function we need to override.
@@ -19,9 +41,22 @@ protected:
     void highlightBlock(const QString &text) override;
 
 private:
-    struct HighlightingRule {
-        QRegularExpression pattern;
-        QTextCharFormat format;
-    };
-    QVector<HighlightingRule> rules;
-};
\ No newline at end of file
+    // Block states are plain ints. 0 (or Qt's initial -1) means "not inside a
+    // region"; otherwise the low byte is region + 1 and the upper bits are the
+    // interned raw-string delimiter + 1. QSyntaxHighlighter only continues to
+    // the next block while its state changes, so an edit that opens or closes
+    // a comment rehighlights just until the states converge again.
+    int encodeState(const Grammar::LexState &state);
+    Grammar::LexState decodeState(int blockState) const;
+
+    const Grammar *m_grammar;
+    const Theme *m_theme = nullptr;
+
+    QVector<QTextCharFormat> m_formats;   // Indexed by grammar scope
+    QVector<Grammar::Token> m_tokens;     // Reused between blocks
+    QVector<ColorRun> m_colors;           // Reused between blocks
+
+    // Raw-string delimiters seen in this document, so they fit in a block state
+    QStringList m_delimiters;
+    QHash<QString, int> m_delimiterIds;
+};
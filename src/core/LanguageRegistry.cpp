@@ -0,0 +1,132 @@
+#include "LanguageRegistry.h"
+#include "Grammar.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QDebug>
+
+LanguageRegistry *LanguageRegistry::instance() {
+    static LanguageRegistry registry;
+    return &registry;
+}
+
+LanguageRegistry::LanguageRegistry() {
+    loadDefinitions();
+}
+
+LanguageRegistry::~LanguageRegistry() {
+    for (Language &language : m_languages) delete language.compiled;
+}
+
+// Reads the small JSON definitions compiled into the binary (":/languages").
+// Only the selection data is extracted here; rule compilation is deferred.
+void LanguageRegistry::loadDefinitions() {
+    // The .qrc is linked into the editor_core static library; without a
+    // reference to it the linker would drop it from the executable
+    Q_INIT_RESOURCE(languages);
+
+    QDir dir(":/languages");
+    const QStringList files = dir.entryList(QStringList() << "*.json", QDir::Files, QDir::Name);
+
+    for (const QString &fileName : files) {
+        QFile file(dir.filePath(fileName));
+        if (!file.open(QIODevice::ReadOnly)) continue;
+
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+        if (!doc.isObject()) {
+            qWarning() << "LanguageRegistry: invalid definition" << fileName << parseError.errorString();
+            continue;
+        }
+
+        Language language;
+        language.id = QFileInfo(fileName).baseName();
+        language.definition = doc.object();
+        for (const QJsonValue &ext : language.definition.value("extensions").toArray()) {
+            language.extensions << ext.toString().toLower();
+        }
+        QString firstLine = language.definition.value("firstLine").toString();
+        if (!firstLine.isEmpty()) language.firstLine = QRegularExpression(firstLine);
+
+        int index = m_languages.size();
+        m_languages.append(language);
+        m_byId.insert(language.id, index);
+        for (const QString &ext : std::as_const(m_languages[index].extensions)) {
+            m_byExtension.insert(ext, index);
+        }
+    }
+}
+
+QStringList LanguageRegistry::languageIds() const {
+    return m_byId.keys();
+}
+
+QString LanguageRegistry::languageIdForFile(const QString &filePath) const {
+    auto it = m_byExtension.constFind(QFileInfo(filePath).suffix().toLower());
+    return it == m_byExtension.constEnd() ? QString() : m_languages.at(it.value()).id;
+}
+
+QStringList LanguageRegistry::languageServer(const QString &id) const {
+    const QByteArray variable = "QT_EDITOR_LSP_" + id.toUpper().toLatin1();
+    if (qEnvironmentVariableIsSet(variable.constData())) {
+        return QProcess::splitCommand(qEnvironmentVariable(variable.constData()));
+    }
+
+    QStringList command;
+    auto it = m_byId.constFind(id);
+    if (it == m_byId.constEnd()) return command;
+    for (const QJsonValue &arg : m_languages.at(it.value()).definition.value("languageServer").toArray()) {
+        command << arg.toString();
+    }
+    return command;
+}
+
+const Grammar *LanguageRegistry::grammar(const QString &id) {
+    auto it = m_byId.constFind(id);
+    if (it == m_byId.constEnd()) return nullptr;
+
+    Language &language = m_languages[it.value()];
+    if (!language.compiled && !language.failed) {
+        QString error;
+        language.compiled = Grammar::compile(language.definition, &error);
+        if (!language.compiled) {
+            language.failed = true;
+            qWarning() << "LanguageRegistry: could not compile" << language.id << ":" << error;
+        }
+    }
+    return language.compiled;
+}
+
+QHash<QString, const Grammar *> LanguageRegistry::grammarsBySuffix() {
+    QHash<QString, const Grammar *> grammars;
+    for (auto it = m_byExtension.constBegin(); it != m_byExtension.constEnd(); ++it) {
+        if (const Grammar *compiled = grammar(m_languages[it.value()].id)) grammars.insert(it.key(), compiled);
+    }
+    return grammars;
+}
+
+const Grammar *LanguageRegistry::grammarForFile(const QString &filePath, const QString &content) {
+    // 1. Extension
+    QString suffix = QFileInfo(filePath).suffix().toLower();
+    auto it = m_byExtension.constFind(suffix);
+    if (it != m_byExtension.constEnd()) {
+        return grammar(m_languages[it.value()].id);
+    }
+
+    // 2. Content sniffing on the first line (shebangs, "{", "---", timestamps)
+    QString firstLine = content.left(content.indexOf('\n'));
+    if (firstLine.size() > 512) firstLine.truncate(512);
+
+    for (const Language &language : std::as_const(m_languages)) {
+        if (language.firstLine.isValid() && !language.firstLine.pattern().isEmpty()
+            && language.firstLine.match(firstLine).hasMatch()) {
+            return grammar(language.id);
+        }
+    }
+
+    return nullptr; // Plain text: no highlighting at all
+}
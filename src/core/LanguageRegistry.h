@@ -0,0 +1,60 @@
+#pragma once
+#include <QHash>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class Grammar;
+
+// Knows every language definition shipped in resources/languages.qrc and picks
+// one for a file. Definitions are indexed at startup (name, extensions, first
+// line pattern) but each grammar is compiled to its DFA only the first time a
+// file of that language is opened; the compiled grammar is then shared by all
+// highlighters for the lifetime of the process.
+class LanguageRegistry {
+public:
+    static LanguageRegistry *instance();
+    ~LanguageRegistry();
+
+    // Grammar for a file, chosen by extension first and by sniffing the first
+    // line of 'content' otherwise. Returns nullptr for plain text.
+    const Grammar *grammarForFile(const QString &filePath, const QString &content);
+
+    // Grammar by language id ("cpp", "python", ...), compiled on first use
+    const Grammar *grammar(const QString &id);
+
+    QStringList languageIds() const;
+
+    // Language id of a file by its extension, empty if none matches
+    QString languageIdForFile(const QString &filePath) const;
+
+    // Command line of the language server for a language ("languageServer"
+    // in its definition), empty if it has none. QT_EDITOR_LSP_<ID> in the
+    // environment overrides it, e.g. QT_EDITOR_LSP_CPP="clangd --log=error",
+    // and an empty value turns it off.
+    QStringList languageServer(const QString &id) const;
+
+    // Every grammar, compiled now, by lower-case file suffix. For workers:
+    // the registry itself compiles lazily and must only be used on the GUI
+    // thread, but compiled grammars are read-only and can be shared.
+    QHash<QString, const Grammar *> grammarsBySuffix();
+
+private:
+    LanguageRegistry();
+    void loadDefinitions();
+
+    struct Language {
+        QString id;                 // File base name, e.g. "cpp"
+        QJsonObject definition;
+        QStringList extensions;
+        QRegularExpression firstLine; // Content sniffing, may be invalid/empty
+        Grammar *compiled = nullptr;
+        bool failed = false;        // Don't retry a definition that didn't compile
+    };
+
+    QVector<Language> m_languages;
+    QHash<QString, int> m_byExtension; // Lower-case suffix -> index
+    QHash<QString, int> m_byId;
+};
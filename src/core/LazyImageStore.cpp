@@ -0,0 +1,256 @@
+#include "LazyImageStore.h"
+#include "utils/Base64.h"
+#include "MemoryAccounting.h"
+
+#include <QBuffer>
+#include <QImageReader>
+#include <QRegularExpression>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextFragment>
+#include <QTextImageFormat>
+
+LazyImageStore::LazyImageStore(QTextDocument *document)
+    : QObject(document), m_document(document) {
+}
+
+// ---------------------------------
+// HTML Rewriting
+// ---------------------------------
+
+QString LazyImageStore::extractImages(const QString &html) {
+    MemoryAccounting::Scope scope(MemoryAccounting::Images);
+    m_entries.clear();
+    m_decoded.clear();
+
+    static const QLatin1String marker("src=\"data:");
+    const QStringView view(html);
+
+    QString result;
+    qsizetype pos = 0;        // Everything before pos has been copied to result
+    qsizetype searchFrom = 0;
+
+    while (true) {
+        qsizetype hit = html.indexOf(marker, searchFrom);
+        if (hit < 0) break;
+
+        qsizetype uriStart = hit + 5; // Skip 'src="'
+        qsizetype uriEnd = html.indexOf(QLatin1Char('"'), uriStart);
+        if (uriEnd < 0) break;
+        searchFrom = uriEnd;
+
+        // Only "data:<mime>;base64,<payload>" is worth deferring
+        QStringView uri = view.mid(uriStart, uriEnd - uriStart);
+        qsizetype comma = uri.indexOf(QLatin1Char(','));
+        QStringView header = comma < 0 ? QStringView() : uri.left(comma);
+        if (!header.endsWith(QLatin1String(";base64"))) continue;
+
+        // The HTML we are given is only a few percent markup, so size the
+        // output lazily on the first hit instead of copying the whole input.
+        if (result.isEmpty()) result.reserve(html.size() / 16);
+
+        Entry entry;
+        entry.mimeType = header.mid(5, header.size() - 5 - 7).toLatin1(); // Between "data:" and ";base64"
+        entry.encoded = Base64::decode(uri.mid(comma + 1).toLatin1());
+
+        result.append(view.mid(pos, uriStart - pos));
+        result.append(scheme() + QLatin1Char(':') + QString::number(m_entries.size()));
+        pos = uriEnd;
+
+        // Without a width and height the layout asks for the image to size
+        // it, which would decode it right away; the header has the size
+        const qsizetype tagStart = html.lastIndexOf(QLatin1String("<img"), hit, Qt::CaseInsensitive);
+        const qsizetype tagEnd = html.indexOf(QLatin1Char('>'), uriEnd);
+        if (tagStart >= 0 && tagEnd > uriEnd && !view.mid(tagStart, hit - tagStart).contains(QLatin1Char('>'))) {
+            // The tag's attributes, without the (long) URI
+            const QString attributes = view.mid(tagStart, uriStart - tagStart).toString()
+                                       + view.mid(uriEnd, tagEnd - uriEnd);
+            const QString size = missingSizeAttributes(attributes, entry.encoded);
+            if (!size.isEmpty()) {
+                result.append(QLatin1Char('"'));
+                result.append(size);
+                pos = uriEnd + 1; // Past the closing quote, already written
+            }
+        }
+        m_entries.append(entry);
+    }
+
+    if (m_entries.isEmpty()) return html;
+
+    result.append(view.mid(pos));
+    return result;
+}
+
+QString LazyImageStore::missingSizeAttributes(const QString &tag, const QByteArray &encoded) {
+    static const QRegularExpression widthPattern(QStringLiteral("\\swidth\\s*=\\s*\"?(\\d+)"),
+                                                 QRegularExpression::CaseInsensitiveOption);
+    static const QRegularExpression heightPattern(QStringLiteral("\\sheight\\s*=\\s*\"?(\\d+)"),
+                                                  QRegularExpression::CaseInsensitiveOption);
+    const QRegularExpressionMatch width = widthPattern.match(tag);
+    const QRegularExpressionMatch height = heightPattern.match(tag);
+    if (width.hasMatch() && height.hasMatch()) return QString();
+
+    QBuffer buffer;
+    buffer.setData(encoded);
+    QImageReader reader(&buffer);
+    const QSize natural = reader.size(); // Reads the header only
+    if (!natural.isValid() || natural.isEmpty()) return QString();
+
+    // One of them given: the other keeps the aspect ratio, as Qt would
+    if (width.hasMatch()) {
+        const qint64 w = width.captured(1).toLongLong();
+        return QString(" height=\"%1\"").arg(w * natural.height() / natural.width());
+    }
+    if (height.hasMatch()) {
+        const qint64 h = height.captured(1).toLongLong();
+        return QString(" width=\"%1\"").arg(h * natural.width() / natural.height());
+    }
+    return QString(" width=\"%1\" height=\"%2\"").arg(natural.width()).arg(natural.height());
+}
+
+QString LazyImageStore::restoreImages(const QString &html) const {
+    if (m_entries.isEmpty()) return html;
+
+    const QString marker = QStringLiteral("src=\"") + scheme() + QLatin1Char(':');
+    const QStringView view(html);
+
+    QString result;
+    result.reserve(html.size() + encodedBytes() * 4 / 3 + 64);
+    qsizetype pos = 0;
+
+    while (true) {
+        qsizetype hit = html.indexOf(marker, pos);
+        if (hit < 0) break;
+
+        // Parse the image number right after the marker
+        qsizetype idStart = hit + marker.size();
+        qsizetype idEnd = idStart;
+        while (idEnd < html.size() && html.at(idEnd).isDigit()) ++idEnd;
+
+        bool ok = false;
+        int id = view.mid(idStart, idEnd - idStart).toInt(&ok);
+        if (!ok || id < 0 || id >= m_entries.size()) {
+            result.append(view.mid(pos, idEnd - pos));
+            pos = idEnd;
+            continue;
+        }
+
+        const Entry &entry = m_entries.at(id);
+        result.append(view.mid(pos, hit + 5 - pos)); // Up to and including 'src="'
+        result.append(QLatin1String("data:"));
+        result.append(QLatin1String(entry.mimeType));
+        result.append(QLatin1String(";base64,"));
+        result.append(QLatin1String(Base64::encode(entry.encoded)));
+        pos = idEnd; // Anything after the id (e.g. a "#crop=" fragment) is kept
+    }
+
+    result.append(view.mid(pos));
+    return result;
+}
+
+// ---------------------------------
+// On-demand Decoding
+// ---------------------------------
+
+int LazyImageStore::idForUrl(const QUrl &url) const {
+    if (url.scheme() != scheme()) return -1;
+
+    bool ok = false;
+    int id = url.path().toInt(&ok);
+    return (ok && id >= 0 && id < m_entries.size()) ? id : -1;
+}
+
+QPixmap LazyImageStore::pixmap(const QUrl &url) {
+    int id = idForUrl(url);
+    if (id < 0) return QPixmap();
+
+    Entry &entry = m_entries[id];
+    if (entry.decoded.isNull()) {
+        MemoryAccounting::Scope scope(MemoryAccounting::Images);
+        entry.decoded.loadFromData(entry.encoded);
+        if (!entry.decoded.isNull()) m_decoded.insert(id);
+    }
+    return entry.decoded;
+}
+
+QPixmap LazyImageStore::croppedPixmap(const QUrl &url, const QRect &crop) {
+    const QPixmap base = pixmap(url);
+    if (base.isNull()) return QPixmap();
+
+    const QRect bounded = crop.intersected(base.rect());
+    if (bounded.isEmpty()) return QPixmap();
+    if (bounded == base.rect()) return base;
+
+    Entry &entry = m_entries[idForUrl(url)];
+    if (entry.cropped.isNull() || entry.cropRect != bounded) {
+        MemoryAccounting::Scope scope(MemoryAccounting::Images);
+        entry.cropped = base.copy(bounded);
+        entry.cropRect = bounded;
+    }
+    return entry.cropped;
+}
+
+bool LazyImageStore::encodedImage(const QUrl &url, QByteArray *bytes, QByteArray *mimeType) const {
+    int id = idForUrl(url);
+    if (id < 0) return false;
+
+    if (bytes) *bytes = m_entries.at(id).encoded;
+    if (mimeType) *mimeType = m_entries.at(id).mimeType;
+    return true;
+}
+
+// Collects the lazy images between two text positions. Only the blocks in the
+// range are visited, so the cost follows the window size, not the document.
+QSet<int> LazyImageStore::imagesInRange(int from, int to) const {
+    QSet<int> ids;
+    QTextBlock block = m_document->findBlock(from);
+    QTextBlock last = m_document->findBlock(to);
+
+    while (block.isValid()) {
+        for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+            QTextCharFormat fmt = it.fragment().charFormat();
+            if (!fmt.isImageFormat()) continue;
+
+            int id = idForUrl(QUrl(fmt.toImageFormat().name()));
+            if (id >= 0) ids.insert(id);
+        }
+        if (block == last) break;
+        block = block.next();
+    }
+    return ids;
+}
+
+void LazyImageStore::updateWindow(int prefetchFrom, int prefetchTo, int keepFrom, int keepTo) {
+    if (m_entries.isEmpty()) return;
+
+    // Release first, so memory never peaks above the keep window plus prefetch
+    QSet<int> keep = imagesInRange(keepFrom, keepTo);
+    const QSet<int> decoded = m_decoded;
+    for (int id : decoded) {
+        if (!keep.contains(id)) {
+            m_entries[id].decoded = QPixmap();
+            m_entries[id].cropped = QPixmap();
+            m_decoded.remove(id);
+        }
+    }
+
+    for (int id : imagesInRange(prefetchFrom, prefetchTo)) {
+        pixmap(QUrl(scheme() + QLatin1Char(':') + QString::number(id)));
+    }
+}
+
+qint64 LazyImageStore::encodedBytes() const {
+    qint64 total = 0;
+    for (const Entry &entry : m_entries) total += entry.encoded.size();
+    return total;
+}
+
+qint64 LazyImageStore::decodedBytes() const {
+    qint64 total = 0;
+    for (int id : m_decoded) {
+        for (const QPixmap *pm : {&m_entries.at(id).decoded, &m_entries.at(id).cropped}) {
+            total += qint64(pm->width()) * pm->height() * pm->depth() / 8;
+        }
+    }
+    return total;
+}
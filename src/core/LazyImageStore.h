@@ -0,0 +1,74 @@
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QPixmap>
+#include <QRect>
+#include <QSet>
+#include <QString>
+#include <QUrl>
+#include <QVector>
+
+class QTextDocument;
+
+// Keeps the embedded images of a rich document in their compressed form and
+// decodes them only while they are near the viewport.
+//
+// extractImages() swaps every "data:" image in the HTML for a short
+// "lazy-image:N" reference before Qt parses it, so setHtml() neither copies
+// the Base64 text into the document nor decodes a single pixel. Images
+// without a width and height get them from their file header, or the layout
+// would decode them to learn their size. Pixmaps are
+// produced on demand (first paint or prefetch) and dropped again once they
+// scroll far away, which bounds decoded-image memory by what is on screen.
+class LazyImageStore : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LazyImageStore(QTextDocument *document);
+
+    static QString scheme() { return QStringLiteral("lazy-image"); }
+
+    // One pass over the HTML; returns it with the data: URIs replaced.
+    QString extractImages(const QString &html);
+
+    // Inverse of extractImages, used when exporting the document.
+    QString restoreImages(const QString &html) const;
+
+    // Returns the decoded pixmap for a "lazy-image:N" url, decoding it if needed.
+    QPixmap pixmap(const QUrl &url);
+
+    // The 'crop' part of that pixmap. The last crop of each image is kept
+    // until the image is released (or cropped differently), so painting a
+    // cropped image doesn't copy its pixels again on every paint.
+    QPixmap croppedPixmap(const QUrl &url, const QRect &crop);
+
+    // The still-encoded bytes of an image, for writers that stream them out.
+    bool encodedImage(const QUrl &url, QByteArray *bytes, QByteArray *mimeType) const;
+
+    // Decodes images whose text position is in [prefetchFrom, prefetchTo] and
+    // releases decoded ones that are outside [keepFrom, keepTo].
+    void updateWindow(int prefetchFrom, int prefetchTo, int keepFrom, int keepTo);
+
+    // Memory held by the store (for diagnostics)
+    qint64 encodedBytes() const;
+    qint64 decodedBytes() const;
+    int imageCount() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        QByteArray encoded;  // Raw image file bytes (PNG/JPEG/...), Base64 already removed
+        QByteArray mimeType; // e.g. "image/png"
+        QPixmap decoded;     // Null while the image is far from the viewport
+        QRect cropRect;      // Of 'cropped'
+        QPixmap cropped;     // Last crop asked for, released with 'decoded'
+    };
+
+    // ' width="W" height="H"' (whichever the <img> tag lacks), or empty
+    static QString missingSizeAttributes(const QString &tag, const QByteArray &encoded);
+    int idForUrl(const QUrl &url) const;
+    QSet<int> imagesInRange(int from, int to) const;
+
+    QTextDocument *m_document;
+    QVector<Entry> m_entries; // Indexed by N in "lazy-image:N"
+    QSet<int> m_decoded;
+};
@@ -0,0 +1,115 @@
+#include "LineIndex.h"
+#include "utils/TextSearch.h"
+
+#include <QDataStream>
+#include <QIODevice>
+#include <QByteArrayView>
+
+bool LineIndex::scan(QIODevice *file, qint64 from, qint64 to, qint64 newlinesBefore, Batch *batch,
+                     const std::atomic<bool> *cancel) {
+    static constexpr qint64 kReadSize = 1024 * 1024;
+
+    batch->from = from;
+    batch->to = from;
+    batch->newlines = 0;
+    batch->checkpoints.clear();
+    if (!file->seek(from)) return false;
+
+    QByteArray buffer(kReadSize, Qt::Uninitialized);
+    qint64 newlines = newlinesBefore;
+    qint64 offset = from;
+    char last = '\n';
+
+    while (offset < to) {
+        if (cancel && *cancel) return false;
+
+        const qint64 read = file->read(buffer.data(), qMin(kReadSize, to - offset));
+        if (read <= 0) break;
+        const QByteArrayView chunk(buffer.constData(), read);
+
+        // Most chunks don't reach the next checkpoint: counting is enough.
+        // Otherwise walk the newlines of this chunk to find where it falls.
+        const qint64 count = TextSearch::count(chunk, '\n');
+        const qint64 nextCheckpoint = (newlines / kStride + 1) * kStride;
+        if (newlines + count < nextCheckpoint) {
+            newlines += count;
+        } else {
+            for (qsizetype at = TextSearch::indexOf(chunk, "\n"); at >= 0;
+                 at = TextSearch::indexOf(chunk, "\n", at + 1)) {
+                if (++newlines % kStride == 0) batch->checkpoints.append(offset + at + 1);
+            }
+        }
+
+        last = chunk.back();
+        offset += read;
+    }
+
+    batch->to = offset;
+    batch->newlines = newlines - newlinesBefore;
+    batch->endsWithNewline = last == '\n';
+    return true;
+}
+
+void LineIndex::reset() {
+    m_checkpoints = {0};
+    m_newlines = 0;
+    m_indexedBytes = 0;
+    m_endsWithNewline = true;
+}
+
+void LineIndex::append(const Batch &batch) {
+    if (batch.from != m_indexedBytes) return; // Stale batch (file was reset)
+    m_checkpoints += batch.checkpoints;
+    m_newlines += batch.newlines;
+    if (batch.to > batch.from) m_endsWithNewline = batch.endsWithNewline;
+    m_indexedBytes = batch.to;
+}
+
+qint64 LineIndex::lineCount() const {
+    return m_newlines + (m_endsWithNewline ? 0 : 1);
+}
+
+void LineIndex::checkpointFor(qint64 line, qint64 *checkpointLine, qint64 *offset) const {
+    const qint64 k = qBound<qint64>(0, line / kStride, m_checkpoints.size() - 1);
+    *checkpointLine = k * kStride;
+    *offset = m_checkpoints.at(k);
+}
+
+void LineIndex::write(QDataStream &out) const {
+    out << m_checkpoints << m_newlines << m_indexedBytes << m_endsWithNewline;
+}
+
+bool LineIndex::read(QDataStream &in) {
+    // The checkpoints are read by hand: QDataStream would reserve whatever
+    // count a damaged file claims before finding out the data isn't there.
+    // Same layout as 'out << m_checkpoints' for any real index (a quint32
+    // count below Qt's 0xfffffffe escape, then the values).
+    quint32 count = 0;
+    in >> count;
+    if (in.status() != QDataStream::Ok || count >= 0xfffffffe || !in.device()
+        || quint64(count) * sizeof(qint64) > quint64(in.device()->bytesAvailable())) {
+        return false;
+    }
+    QVector<qint64> checkpoints(count);
+    for (qint64 &checkpoint : checkpoints) in >> checkpoint;
+
+    qint64 newlines = 0;
+    qint64 indexedBytes = 0;
+    bool endsWithNewline = true;
+    in >> newlines >> indexedBytes >> endsWithNewline;
+    if (in.status() != QDataStream::Ok || checkpoints.isEmpty() || checkpoints.first() != 0) return false;
+
+    // A cache file from elsewhere (or a damaged one) must not make lookups
+    // jump outside the file: one checkpoint per kStride newlines, ascending,
+    // all inside the indexed bytes
+    if (newlines < 0 || indexedBytes < newlines || checkpoints.size() != newlines / kStride + 1) return false;
+    for (qsizetype i = 1; i < checkpoints.size(); ++i) {
+        if (checkpoints[i] <= checkpoints[i - 1] || checkpoints[i] > indexedBytes) return false;
+    }
+
+    m_checkpoints = checkpoints;
+    m_newlines = newlines;
+    m_indexedBytes = indexedBytes;
+    m_endsWithNewline = endsWithNewline;
+    return true;
+}
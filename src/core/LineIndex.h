@@ -0,0 +1,57 @@
+#pragma once
+#include <QVector>
+#include <atomic>
+
+class QIODevice;
+class QDataStream;
+
+// Sparse index of line starts in a large file, for the LogViewer.
+//
+// Only every kStride-th line start is stored (about 800 KB for 100M lines);
+// any other line is found from the checkpoint before it with at most
+// kStride - 1 newline searches in the mapped file. The file is scanned in
+// batches with the vectorized newline counter, so the index can be built on
+// a worker and merged batch by batch while the view is already usable, and
+// extended when the file grows.
+class LineIndex {
+public:
+    static constexpr qint64 kStride = 1024;
+
+    // What scanning one stretch of the file added
+    struct Batch {
+        qint64 from = 0;
+        qint64 to = 0;
+        qint64 newlines = 0;
+        QVector<qint64> checkpoints; // Offsets of the new checkpoint lines
+        bool endsWithNewline = false;
+    };
+
+    // Scans [from, to) of 'file' with plain reads (the pages don't stay in our
+    // RSS). 'newlinesBefore' is the newline count of [0, from). Returns false
+    // if 'cancel' was set on the way.
+    static bool scan(QIODevice *file, qint64 from, qint64 to, qint64 newlinesBefore, Batch *batch,
+                     const std::atomic<bool> *cancel);
+
+    void reset();
+    void append(const Batch &batch);
+
+    qint64 indexedBytes() const { return m_indexedBytes; }
+    qint64 newlineCount() const { return m_newlines; }
+
+    // Lines in the indexed part: every '\n' ends one, plus an unterminated last line
+    qint64 lineCount() const;
+
+    // Nearest checkpoint at or before 'line': the line it starts and its offset
+    void checkpointFor(qint64 line, qint64 *checkpointLine, qint64 *offset) const;
+
+    // For the session cache (see Session::saveLineIndex). read() leaves the
+    // index untouched if the data is incomplete or inconsistent.
+    void write(QDataStream &out) const;
+    bool read(QDataStream &in);
+
+private:
+    QVector<qint64> m_checkpoints{0}; // Entry k = offset of line k * kStride
+    qint64 m_newlines = 0;
+    qint64 m_indexedBytes = 0;
+    bool m_endsWithNewline = true;    // Nothing after the last '\n' (empty file too)
+};
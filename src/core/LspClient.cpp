@@ -0,0 +1,387 @@
+#include "LspClient.h"
+#include "LanguageRegistry.h"
+
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QProcess>
+#include <QThread>
+#include <QUrl>
+#include <QDebug>
+
+namespace {
+
+constexpr int kShutdownTimeoutMs = 500;   // For the answer to "shutdown"
+constexpr int kExitTimeoutMs = 500;       // After "exit", before the server is killed
+constexpr int kShutdownId = 0;            // LspClient numbers its requests from 1
+constexpr qint64 kMaxHeaderBytes = 4096;  // Anything longer isn't an LSP header
+
+// Key: language id + root
+QHash<QString, LspClient *> &clients() {
+    static QHash<QString, LspClient *> map;
+    return map;
+}
+
+} // namespace
+
+// =========================================================
+// LspConnection (I/O thread)
+// =========================================================
+
+LspConnection::LspConnection(const QStringList &command, const QString &rootPath)
+    : m_command(command), m_rootPath(rootPath) {}
+
+void LspConnection::start() {
+    m_process = new QProcess(this);
+    m_process->setWorkingDirectory(m_rootPath);
+    m_process->setStandardErrorFile(QProcess::nullDevice()); // Servers log a lot there
+
+    connect(m_process, &QProcess::readyReadStandardOutput, this, &LspConnection::onReadyRead);
+    connect(m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) emit failed(m_process->errorString());
+    });
+    connect(m_process, &QProcess::finished, this, [this](int exitCode) {
+        emit failed(QString("exited with code %1").arg(exitCode));
+    });
+    m_process->start(m_command.first(), m_command.mid(1));
+}
+
+void LspConnection::send(const QJsonObject &message) {
+    if (!m_process || m_process->state() == QProcess::NotRunning) return;
+    const QByteArray body = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    m_process->write("Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n");
+    m_process->write(body);
+}
+
+void LspConnection::stop() {
+    if (!m_process) return;
+    m_process->disconnect(this); // Going away is expected now
+
+    if (m_process->state() != QProcess::NotRunning) {
+        // The polite way out: "shutdown", wait for its answer, then "exit".
+        // Nothing else is passed on any more (the client is going away).
+        m_stopping = true;
+        m_shutdownAnswered = false;
+        send(QJsonObject{{"jsonrpc", "2.0"}, {"id", kShutdownId}, {"method", "shutdown"}});
+        QDeadlineTimer deadline(kShutdownTimeoutMs);
+        while (!m_shutdownAnswered && !deadline.hasExpired()
+               && m_process->waitForReadyRead(int(deadline.remainingTime()))) {
+            onReadyRead();
+        }
+
+        send(QJsonObject{{"jsonrpc", "2.0"}, {"method", "exit"}});
+        m_process->closeWriteChannel();
+        if (!m_process->waitForFinished(kExitTimeoutMs)) {
+            m_process->kill();
+            m_process->waitForFinished(kExitTimeoutMs);
+        }
+    }
+    // Deleted here: its socket notifiers belong to this thread
+    delete m_process;
+    m_process = nullptr;
+}
+
+void LspConnection::onReadyRead() {
+    m_buffer += m_process->readAllStandardOutput();
+
+    // Messages: "Content-Length: N\r\n" (other headers ignored) "\r\n" + N bytes of JSON
+    while (true) {
+        if (m_contentLength < 0) {
+            const qsizetype end = m_buffer.indexOf("\r\n\r\n");
+            if (end < 0) {
+                if (m_buffer.size() > kMaxHeaderBytes) {
+                    qWarning() << "LspConnection: garbage from" << m_command.first() << "- dropped";
+                    m_buffer.clear();
+                }
+                return;
+            }
+            for (const QByteArray &line : m_buffer.left(end).split('\n')) {
+                const QByteArray header = line.trimmed();
+                if (header.toLower().startsWith("content-length:")) {
+                    m_contentLength = header.mid(int(sizeof("content-length:")) - 1).trimmed().toLongLong();
+                }
+            }
+            m_buffer.remove(0, end + 4);
+            if (m_contentLength < 0) continue; // No length: skip that header block
+        }
+
+        if (m_buffer.size() < m_contentLength) return;
+        const QByteArray body = m_buffer.left(m_contentLength);
+        m_buffer.remove(0, m_contentLength);
+        m_contentLength = -1;
+
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(body, &error);
+        if (doc.isObject()) handleMessage(doc.object());
+        else qWarning() << "LspConnection: invalid message" << error.errorString();
+    }
+}
+
+void LspConnection::handleMessage(const QJsonObject &message) {
+    const QString method = message.value("method").toString();
+
+    if (m_stopping) {
+        if (method.isEmpty() && message.value("id").toInt(-1) == kShutdownId) m_shutdownAnswered = true;
+        return;
+    }
+
+    // A response to one of ours
+    if (method.isEmpty()) {
+        emit responseReceived(message.value("id").toInt(-1), message.value("result"), !message.contains("error"));
+        return;
+    }
+
+    // A notification (diagnostics, progress, log messages)
+    if (!message.contains("id")) {
+        emit notificationReceived(method, message.value("params").toObject());
+        return;
+    }
+
+    // A request from the server. Nothing it may ask (configuration, progress
+    // tokens, capability registration) needs more than an empty answer; an
+    // unanswered request would stall some servers.
+    QJsonValue result;
+    if (method == QLatin1String("workspace/configuration")) {
+        const qsizetype count = message.value("params").toObject().value("items").toArray().size();
+        QJsonArray items;
+        for (qsizetype i = 0; i < count; ++i) items.append(QJsonValue()); // "Use your defaults"
+        result = items;
+    }
+    send(QJsonObject{{"jsonrpc", "2.0"}, {"id", message.value("id")}, {"result", result}});
+}
+
+// =========================================================
+// LspClient (GUI thread)
+// =========================================================
+
+LspClient *LspClient::clientFor(const QString &languageId, const QString &rootPath) {
+    const QString key = languageId + '\n' + rootPath;
+    auto it = clients().constFind(key);
+    if (it != clients().constEnd()) return it.value()->isFailed() ? nullptr : it.value();
+
+    const QStringList command = LanguageRegistry::instance()->languageServer(languageId);
+    if (command.isEmpty()) return nullptr;
+
+    // Owned by the application: stopped before it goes
+    LspClient *client = new LspClient(languageId, command, rootPath, QCoreApplication::instance());
+    clients().insert(key, client);
+    return client;
+}
+
+LspClient::LspClient(const QString &serverName, const QStringList &command, const QString &rootPath,
+                     QObject *parent)
+    : QObject(parent), m_serverName(serverName), m_cache(kCacheEntries)
+{
+    m_thread = new QThread(this);
+    m_thread->setObjectName("LSP " + serverName);
+    m_connection = new LspConnection(command, rootPath);
+    m_connection->moveToThread(m_thread);
+    connect(m_connection, &LspConnection::responseReceived, this, &LspClient::onResponse);
+    connect(m_connection, &LspConnection::notificationReceived, this, &LspClient::notificationReceived);
+    connect(m_connection, &LspConnection::failed, this, &LspClient::onFailed);
+    m_thread->start();
+
+    LspConnection *connection = m_connection;
+    QMetaObject::invokeMethod(connection, [connection]() { connection->start(); }, Qt::QueuedConnection);
+
+    // The handshake; everything else waits in m_queued for its answer
+    QJsonObject capabilities{
+        {"general", QJsonObject{{"positionEncodings", QJsonArray{"utf-16"}}}},
+        {"textDocument", QJsonObject{
+            {"synchronization", QJsonObject{{"didSave", false}}},
+            {"hover", QJsonObject{{"contentFormat", QJsonArray{"plaintext"}}}}}}};
+    QJsonObject params{
+        {"processId", QCoreApplication::applicationPid()},
+        {"clientInfo", QJsonObject{{"name", QCoreApplication::applicationName()}}},
+        {"rootUri", uriFor(rootPath)},
+        {"workspaceFolders", QJsonArray{QJsonObject{{"uri", uriFor(rootPath)}, {"name", QFileInfo(rootPath).fileName()}}}},
+        {"capabilities", capabilities}};
+    m_initializeId = m_nextId++;
+    write(QJsonObject{{"jsonrpc", "2.0"}, {"id", m_initializeId}, {"method", "initialize"}, {"params", params}});
+}
+
+LspClient::~LspClient() {
+    for (auto it = clients().begin(); it != clients().end(); ++it) {
+        if (it.value() == this) {
+            clients().erase(it);
+            break;
+        }
+    }
+
+    // Runs on the I/O thread; waits at most about a second and a half for
+    // the server (shutdown, exit, kill)
+    LspConnection *connection = m_connection;
+    QMetaObject::invokeMethod(connection, [connection]() { connection->stop(); }, Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+    delete m_connection;
+}
+
+QString LspClient::uriFor(const QString &filePath) {
+    return QUrl::fromLocalFile(QFileInfo(filePath).absoluteFilePath()).toString(QUrl::FullyEncoded);
+}
+
+void LspClient::write(const QJsonObject &message) {
+    LspConnection *connection = m_connection;
+    QMetaObject::invokeMethod(connection, [connection, message]() { connection->send(message); },
+                              Qt::QueuedConnection);
+}
+
+void LspClient::post(const QJsonObject &message) {
+    if (m_state == Starting) m_queued.append(message);
+    else if (m_state == Ready) write(message);
+}
+
+void LspClient::notify(const QString &method, const QJsonObject &params) {
+    post(QJsonObject{{"jsonrpc", "2.0"}, {"method", method}, {"params", params}});
+}
+
+void LspClient::onFailed(const QString &reason) {
+    if (m_state == Failed) return;
+    qWarning() << "LspClient:" << m_serverName << "server unavailable:" << reason;
+    m_state = Failed;
+    m_queued.clear();
+
+    // Whoever is waiting gets "no answer" now rather than never
+    const QHash<int, Pending> pending = m_pending;
+    m_pending.clear();
+    for (const Pending &p : pending) {
+        if (p.context && p.callback) p.callback(QJsonValue());
+    }
+}
+
+// ---------------------------------
+// Document sync
+// ---------------------------------
+
+void LspClient::didOpen(const QString &filePath, const QString &languageId, int version, const QString &text) {
+    m_versions.insert(filePath, version);
+    notify("textDocument/didOpen", QJsonObject{{"textDocument", QJsonObject{
+        {"uri", uriFor(filePath)}, {"languageId", languageId}, {"version", version}, {"text", text}}}});
+}
+
+void LspClient::didChange(const QString &filePath, int version, const QJsonArray &contentChanges) {
+    m_versions.insert(filePath, version);
+
+    // Answers about the old text would be wrong now
+    QVector<int> stale;
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        if (it->filePath == filePath && it->version < version) stale << it.key();
+    }
+    for (int id : stale) cancel(id);
+
+    notify("textDocument/didChange", QJsonObject{
+        {"textDocument", QJsonObject{{"uri", uriFor(filePath)}, {"version", version}}},
+        {"contentChanges", contentChanges}});
+}
+
+void LspClient::didClose(const QString &filePath) {
+    m_versions.remove(filePath);
+    QVector<int> stale;
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        if (it->filePath == filePath) stale << it.key();
+    }
+    for (int id : stale) cancel(id);
+
+    notify("textDocument/didClose", QJsonObject{{"textDocument", QJsonObject{{"uri", uriFor(filePath)}}}});
+}
+
+// ---------------------------------
+// Requests
+// ---------------------------------
+
+int LspClient::sendRequest(const QString &method, const QJsonObject &params, const Pending &pending) {
+    if (m_state == Failed) return -1;
+    const int id = m_nextId++;
+    m_pending.insert(id, pending);
+    post(QJsonObject{{"jsonrpc", "2.0"}, {"id", id}, {"method", method}, {"params", params}});
+    return id;
+}
+
+int LspClient::request(const QString &method, const QJsonObject &params, QObject *context, Callback callback) {
+    Pending pending;
+    pending.context = context;
+    pending.callback = std::move(callback);
+    return sendRequest(method, params, pending);
+}
+
+void LspClient::cancel(int id) {
+    if (!m_pending.remove(id)) return;
+
+    // Not sent yet: just forget it
+    for (int i = 0; i < m_queued.size(); ++i) {
+        if (m_queued.at(i).value("id").toInt(-1) == id) {
+            m_queued.remove(i);
+            return;
+        }
+    }
+    notify("$/cancelRequest", QJsonObject{{"id", id}});
+}
+
+int LspClient::hover(const QString &filePath, int version, int line, int character,
+                     QObject *context, std::function<void(const QString &text)> callback) {
+    // The server must have exactly this text (LspDocument::flush() first)
+    if (m_versions.value(filePath, -1) != version) return -1;
+
+    const QString key = QString("hover\n%1\n%2\n%3\n%4").arg(filePath).arg(version).arg(line).arg(character);
+    if (const QJsonValue *cached = m_cache.object(key)) {
+        callback(hoverText(*cached));
+        return 0;
+    }
+
+    Pending pending;
+    pending.context = context;
+    pending.callback = [callback](const QJsonValue &result) { callback(hoverText(result)); };
+    pending.filePath = filePath;
+    pending.version = version;
+    pending.cacheKey = key;
+    return sendRequest("textDocument/hover", QJsonObject{
+        {"textDocument", QJsonObject{{"uri", uriFor(filePath)}}},
+        {"position", QJsonObject{{"line", line}, {"character", character}}}}, pending);
+}
+
+QString LspClient::hoverText(const QJsonValue &result) {
+    const QJsonValue contents = result.toObject().value("contents");
+    const QJsonArray parts = contents.isArray() ? contents.toArray() : QJsonArray{contents};
+
+    QStringList texts;
+    for (const QJsonValue &part : parts) {
+        // A MarkedString is a string or {language, value}; MarkupContent is {kind, value}
+        const QString text = part.isString() ? part.toString() : part.toObject().value("value").toString();
+        if (!text.trimmed().isEmpty()) texts << text.trimmed();
+    }
+    return texts.join("\n\n");
+}
+
+void LspClient::onResponse(int id, const QJsonValue &result, bool ok) {
+    if (id == m_initializeId) {
+        if (!ok) {
+            onFailed("initialize was refused");
+            return;
+        }
+        // textDocumentSync is a kind (0 none, 1 full, 2 incremental) or {change: kind}
+        const QJsonValue sync = result.toObject().value("capabilities").toObject().value("textDocumentSync");
+        const int kind = sync.isObject() ? sync.toObject().value("change").toInt() : sync.toInt();
+        m_incrementalSync = kind == 2;
+
+        m_state = Ready;
+        write(QJsonObject{{"jsonrpc", "2.0"}, {"method", "initialized"}, {"params", QJsonObject()}});
+        const QVector<QJsonObject> queued = m_queued;
+        m_queued.clear();
+        for (const QJsonObject &message : queued) write(message);
+        return;
+    }
+
+    // Cancelled, or dropped because its document changed
+    auto it = m_pending.find(id);
+    if (it == m_pending.end()) return;
+    const Pending pending = it.value();
+    m_pending.erase(it);
+
+    // Stale: the document moved on since the request was sent
+    if (!pending.filePath.isEmpty() && m_versions.value(pending.filePath, -1) != pending.version) return;
+
+    if (ok && !pending.cacheKey.isEmpty()) m_cache.insert(pending.cacheKey, new QJsonValue(result));
+    if (pending.context && pending.callback) pending.callback(ok ? result : QJsonValue());
+}
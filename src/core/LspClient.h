@@ -0,0 +1,145 @@
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+class QProcess;
+class QThread;
+
+// The pipe to one language server process (JSON-RPC over stdio, framed with
+// Content-Length headers). Lives on the LspClient's I/O thread: encoding,
+// writing, reading and parsing never run on the GUI thread.
+class LspConnection : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LspConnection(const QStringList &command, const QString &rootPath);
+
+    // All three are invoked (queued) from the GUI thread
+    void start();
+    void send(const QJsonObject &message);
+    void stop(); // shutdown request and exit notification, then the process gets a moment to go
+
+signals:
+    void responseReceived(int id, const QJsonValue &result, bool ok);
+    void notificationReceived(const QString &method, const QJsonObject &params);
+    void failed(const QString &reason);
+
+private slots:
+    void onReadyRead();
+
+private:
+    void handleMessage(const QJsonObject &message);
+
+    QStringList m_command;
+    QString m_rootPath;
+    QProcess *m_process = nullptr;
+    QByteArray m_buffer;
+    qint64 m_contentLength = -1; // Of the message being read, -1 while in the headers
+    bool m_stopping = false;       // In stop(): only the shutdown answer matters
+    bool m_shutdownAnswered = false;
+};
+
+// Client for one language server (clangd, or a local stand-in), shared by the
+// editors of every file of its language under one project root.
+//
+// Everything is asynchronous. Requests return an id right away and their
+// callback runs later on the GUI thread, only if
+//   - the context object still exists,
+//   - the request wasn't cancelled (cancel() also tells the server),
+//   - the document it was about hasn't changed since (stale results are
+//     dropped; requests about an older version are cancelled by didChange).
+// The callback gets a null value if the server answered with an error or went
+// away. Results of position queries (hover, definition) are cached per
+// document version, so hovering the same spot twice asks only once.
+//
+// Servers are configured per language (see LanguageRegistry::languageServer).
+// A server that can't be started is remembered and not tried again.
+class LspClient : public QObject {
+    Q_OBJECT
+
+public:
+    using Callback = std::function<void(const QJsonValue &result)>;
+
+    // The client for 'languageId' under 'rootPath', started on first use.
+    // Null if the language has no server configured, or it failed to start.
+    static LspClient *clientFor(const QString &languageId, const QString &rootPath);
+
+    ~LspClient();
+
+    bool isFailed() const { return m_state == Failed; }
+
+    // Whether didChange may send ranges, or must send the whole text
+    // (textDocumentSync of the server's capabilities)
+    bool incrementalSync() const { return m_incrementalSync; }
+
+    static QString uriFor(const QString &filePath);
+
+    // --- Document sync (LspDocument calls these) ---
+    void didOpen(const QString &filePath, const QString &languageId, int version, const QString &text);
+    void didChange(const QString &filePath, int version, const QJsonArray &contentChanges);
+    void didClose(const QString &filePath);
+
+    // --- Requests ---
+    // Any method. Returns the request id (for cancel()), or -1 if it wasn't sent.
+    int request(const QString &method, const QJsonObject &params, QObject *context, Callback callback);
+    void cancel(int id);
+
+    // textDocument/hover at a 0-based line and UTF-16 column of a document at
+    // 'version'. The callback gets the hover contents as plain text. Returns
+    // 0 if the answer came from the cache (the callback already ran).
+    int hover(const QString &filePath, int version, int line, int character,
+              QObject *context, std::function<void(const QString &text)> callback);
+
+    // Flattens hover contents (MarkupContent, MarkedString or a list of them)
+    static QString hoverText(const QJsonValue &result);
+
+signals:
+    void notificationReceived(const QString &method, const QJsonObject &params);
+
+private slots:
+    void onResponse(int id, const QJsonValue &result, bool ok);
+    void onFailed(const QString &reason);
+
+private:
+    enum State { Starting, Ready, Failed };
+
+    struct Pending {
+        QPointer<QObject> context;
+        Callback callback;
+        QString filePath;   // Empty if the request isn't about a document version
+        int version = 0;
+        QString cacheKey;   // Empty if the result isn't cached
+    };
+
+    LspClient(const QString &serverName, const QStringList &command, const QString &rootPath,
+              QObject *parent);
+
+    int sendRequest(const QString &method, const QJsonObject &params, const Pending &pending);
+    void write(const QJsonObject &message); // To the I/O thread, now
+    void post(const QJsonObject &message);  // Queued until the server is initialized
+    void notify(const QString &method, const QJsonObject &params);
+
+    static constexpr int kCacheEntries = 512;
+
+    QString m_serverName;
+    QThread *m_thread;
+    LspConnection *m_connection;
+    State m_state = Starting;
+    bool m_incrementalSync = true;
+    int m_nextId = 1;
+    int m_initializeId = -1;
+    QVector<QJsonObject> m_queued;      // Sent once the server is initialized
+    QHash<int, Pending> m_pending;
+    QHash<QString, int> m_versions;     // Open document -> version the server has
+    QCache<QString, QJsonValue> m_cache;
+};
@@ -0,0 +1,85 @@
+#include "LspDocument.h"
+#include "LspClient.h"
+#include "DocumentMirror.h"
+
+#include <QJsonObject>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTimer>
+
+namespace {
+
+QJsonObject lspPosition(int line, int character) {
+    return QJsonObject{{"line", line}, {"character", character}};
+}
+
+QString withLineFeeds(QString text) {
+    return text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+}
+
+} // namespace
+
+LspDocument::LspDocument(QTextDocument *document, LspClient *client, const QString &filePath,
+                         const QString &languageId)
+    : QObject(document), m_document(document), m_client(client), m_filePath(filePath)
+{
+    m_mirror = DocumentMirror::forDocument(m_document);
+
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(kChangeDelayMs);
+    connect(m_flushTimer, &QTimer::timeout, this, &LspDocument::flush);
+
+    connect(m_mirror, &DocumentMirror::changed, this, &LspDocument::onChanged);
+    connect(m_mirror, &DocumentMirror::resynced, this, &LspDocument::onResynced);
+    m_client->didOpen(m_filePath, languageId, m_version, documentText());
+}
+
+LspDocument::~LspDocument() {
+    if (m_client) m_client->didClose(m_filePath);
+}
+
+QString LspDocument::documentText() const {
+    return withLineFeeds(m_mirror->text());
+}
+
+void LspDocument::onChanged(int position, const QString &removed, const QString &inserted) {
+    if (!m_resync) {
+        // The text before the edit is unchanged, so its start is the same in
+        // the old and the new document; the end follows from the removed text
+        const QTextBlock block = m_document->findBlock(position);
+        const int startLine = block.blockNumber();
+        const int startColumn = position - block.position();
+
+        const int breaks = int(removed.count(QChar::ParagraphSeparator));
+        const int endLine = startLine + breaks;
+        const int endColumn = breaks == 0 ? startColumn + int(removed.size())
+                                          : int(removed.size() - removed.lastIndexOf(QChar::ParagraphSeparator) - 1);
+
+        m_changes.append(QJsonObject{
+            {"range", QJsonObject{{"start", lspPosition(startLine, startColumn)}, {"end", lspPosition(endLine, endColumn)}}},
+            {"text", withLineFeeds(inserted)}});
+    }
+
+    // Typing restarts the wait; the server sees one edit per pause
+    m_flushTimer->start();
+}
+
+void LspDocument::onResynced() {
+    // Lost track; the next didChange carries the whole text
+    m_resync = true;
+    m_flushTimer->start();
+}
+
+void LspDocument::flush() {
+    m_flushTimer->stop();
+    if (!m_client || (!m_resync && m_changes.isEmpty())) return;
+
+    QJsonArray changes = m_changes;
+    if (m_resync || !m_client->incrementalSync()) changes = QJsonArray{QJsonObject{{"text", documentText()}}};
+    m_changes = QJsonArray();
+    m_resync = false;
+
+    ++m_version;
+    m_client->didChange(m_filePath, m_version, changes);
+}
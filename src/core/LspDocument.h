@@ -0,0 +1,56 @@
+#pragma once
+#include <QObject>
+#include <QJsonArray>
+#include <QPointer>
+#include <QString>
+
+class QTextDocument;
+class QTimer;
+class DocumentMirror;
+class LspClient;
+
+// Keeps a language server's copy of one QTextDocument in sync.
+//
+// Every change becomes an LSP range edit (the trimmed deltas of the
+// document's DocumentMirror, shared with UndoHistory; format-only changes
+// from the highlighter never get here). Edits are collected while the user
+// types and sent as one didChange after kChangeDelayMs of quiet, or right
+// away by flush() before a request that needs the server to see the current
+// text. Servers that only take whole documents get the full text instead.
+//
+// Child of the document: didOpen on creation, didClose when it goes.
+class LspDocument : public QObject {
+    Q_OBJECT
+
+public:
+    LspDocument(QTextDocument *document, LspClient *client, const QString &filePath, const QString &languageId);
+    ~LspDocument();
+
+    LspClient *client() const { return m_client; }
+    QString filePath() const { return m_filePath; }
+
+    // Version the server has after flush()
+    int version() const { return m_version; }
+
+    // Sends the pending edits now
+    void flush();
+
+private slots:
+    void onChanged(int position, const QString &removed, const QString &inserted);
+    void onResynced();
+
+private:
+    static constexpr int kChangeDelayMs = 150;
+
+    QString documentText() const; // The mirror with '\n' line breaks
+
+    QTextDocument *m_document;
+    DocumentMirror *m_mirror;
+    QPointer<LspClient> m_client;
+    QString m_filePath;
+    QTimer *m_flushTimer;
+
+    QJsonArray m_changes;    // Not sent yet, in order
+    bool m_resync = false;   // Send the whole text instead of m_changes
+    int m_version = 0;
+};
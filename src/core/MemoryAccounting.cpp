@@ -0,0 +1,201 @@
+#include "MemoryAccounting.h"
+
+#include <QFile>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace {
+
+using MemoryAccounting::Subsystem;
+
+// Put in front of every block while accounting is on. 16 bytes, so the
+// pointer handed out keeps malloc's alignment.
+struct alignas(16) Header {
+    std::size_t size;
+    quint32 subsystem;
+    quint32 padding;
+};
+static_assert(sizeof(Header) == 16, "Header must not change the alignment of the block");
+
+struct AtomicCounters {
+    std::atomic<qint64> allocations{0};
+    std::atomic<qint64> frees{0};
+    std::atomic<qint64> allocatedBytes{0};
+    std::atomic<qint64> liveBytes{0};
+    std::atomic<qint64> liveBlocks{0};
+};
+
+enum Mode { Undecided, Off, On };
+
+std::atomic<int> g_mode{Undecided};
+AtomicCounters g_counters[MemoryAccounting::SubsystemCount];
+thread_local Subsystem t_subsystem = MemoryAccounting::Other;
+
+// Read once, at the first allocation (before main). It must never change
+// afterwards: a block allocated without a header can't be freed as one with.
+bool accounting() {
+    int mode = g_mode.load(std::memory_order_relaxed);
+    if (mode == Undecided) {
+        const char *env = std::getenv("QT_EDITOR_MEMORY_ACCOUNTING");
+        mode = (env && *env && std::strcmp(env, "0") != 0) ? On : Off;
+        g_mode.store(mode, std::memory_order_relaxed);
+    }
+    return mode == On;
+}
+
+void *allocate(std::size_t size) {
+    if (!accounting()) return std::malloc(size ? size : 1);
+
+    auto *header = static_cast<Header *>(std::malloc(sizeof(Header) + size));
+    if (!header) return nullptr;
+    header->size = size;
+    header->subsystem = t_subsystem;
+
+    AtomicCounters &c = g_counters[t_subsystem];
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.allocatedBytes.fetch_add(qint64(size), std::memory_order_relaxed);
+    c.liveBytes.fetch_add(qint64(size), std::memory_order_relaxed);
+    c.liveBlocks.fetch_add(1, std::memory_order_relaxed);
+    return header + 1;
+}
+
+void release(void *p) {
+    if (!p) return;
+    if (!accounting()) {
+        std::free(p);
+        return;
+    }
+
+    // Freed where it was allocated from, whatever the current scope is
+    Header *header = static_cast<Header *>(p) - 1;
+    AtomicCounters &c = g_counters[header->subsystem];
+    c.frees.fetch_add(1, std::memory_order_relaxed);
+    c.liveBytes.fetch_sub(qint64(header->size), std::memory_order_relaxed);
+    c.liveBlocks.fetch_sub(1, std::memory_order_relaxed);
+    std::free(header);
+}
+
+MemoryAccounting::Counters load(const AtomicCounters &c) {
+    MemoryAccounting::Counters counters;
+    counters.allocations = c.allocations.load(std::memory_order_relaxed);
+    counters.frees = c.frees.load(std::memory_order_relaxed);
+    counters.allocatedBytes = c.allocatedBytes.load(std::memory_order_relaxed);
+    counters.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+    counters.liveBlocks = c.liveBlocks.load(std::memory_order_relaxed);
+    return counters;
+}
+
+QJsonObject toJson(const MemoryAccounting::Counters &counters) {
+    QJsonObject object;
+    object["allocations"] = counters.allocations;
+    object["frees"] = counters.frees;
+    object["allocated_bytes"] = counters.allocatedBytes;
+    object["live_bytes"] = counters.liveBytes;
+    object["live_blocks"] = counters.liveBlocks;
+    return object;
+}
+
+} // namespace
+
+// =========================================================
+// Global operator new / delete
+// =========================================================
+// The array, sized and nothrow forms of the standard library forward to these.
+
+void *operator new(std::size_t size) {
+    if (void *p = allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept { release(p); }
+void operator delete(void *p, std::size_t) noexcept { release(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { release(p); }
+
+// =========================================================
+// MemoryAccounting
+// =========================================================
+
+namespace MemoryAccounting {
+
+bool isEnabled() {
+    return accounting();
+}
+
+const char *subsystemName(Subsystem subsystem) {
+    switch (subsystem) {
+    case Other: return "other";
+    case Documents: return "documents";
+    case Layouts: return "layouts";
+    case Highlighting: return "highlighting";
+    case Images: return "images";
+    case Diff: return "diff";
+    case Undo: return "undo";
+    case Search: return "search";
+    case SubsystemCount: break;
+    }
+    return "?";
+}
+
+Counters counters(Subsystem subsystem) {
+    return load(g_counters[subsystem]);
+}
+
+Counters total() {
+    Counters sum;
+    for (int i = 0; i < SubsystemCount; ++i) {
+        const Counters c = counters(Subsystem(i));
+        sum.allocations += c.allocations;
+        sum.frees += c.frees;
+        sum.allocatedBytes += c.allocatedBytes;
+        sum.liveBytes += c.liveBytes;
+        sum.liveBlocks += c.liveBlocks;
+    }
+    return sum;
+}
+
+qint64 residentBytes() {
+#ifdef Q_OS_LINUX
+    // "size resident shared ..." in pages
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) return -1;
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2) return -1;
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+QJsonObject snapshot() {
+    QJsonObject subsystems;
+    for (int i = 0; i < SubsystemCount; ++i) {
+        subsystems[subsystemName(Subsystem(i))] = toJson(counters(Subsystem(i)));
+    }
+
+    QJsonObject object;
+    object["enabled"] = isEnabled();
+    object["resident_bytes"] = residentBytes();
+    object["heap"] = toJson(total());
+    object["subsystems"] = subsystems;
+    return object;
+}
+
+Scope::Scope(Subsystem subsystem) : m_previous(t_subsystem) {
+    t_subsystem = subsystem;
+}
+
+Scope::~Scope() {
+    t_subsystem = m_previous;
+}
+
+} // namespace MemoryAccounting
@@ -0,0 +1,73 @@
+#pragma once
+#include <QJsonObject>
+#include <QtGlobal>
+
+// Opt-in heap accounting, to see which part of the editor holds the memory
+// and which hot paths churn through allocations.
+//
+// The global operator new/delete are replaced (see MemoryAccounting.cpp).
+// When the process is started with QT_EDITOR_MEMORY_ACCOUNTING=1, every
+// allocation carries a small header with its size and the subsystem that made
+// it, so live bytes can be followed per subsystem. Otherwise the hooks go
+// straight to malloc/free and nothing is counted.
+//
+// Only operator new is hooked. The data of QString, QByteArray, QVector,
+// QImage and other implicitly shared Qt types is allocated with malloc (via
+// QArrayData) and is never counted; neither is anything else that calls
+// malloc directly. The counters show objects created with new (std
+// containers, QObjects, Qt's private classes), not the total heap.
+//
+// Allocations are attributed with a Scope on the current thread:
+//
+//     MemoryAccounting::Scope scope(MemoryAccounting::Diff);
+//     ... everything allocated with new here counts as Diff, inside Qt too ...
+//
+// Scopes nest; the innermost wins. Untagged allocations count as Other.
+namespace MemoryAccounting {
+
+enum Subsystem {
+    Other,
+    Documents,    // Loading and editing text (QTextDocument contents)
+    Layouts,      // Line layout and painting of the editors
+    Highlighting, // Syntax highlighter and its per-block data
+    Images,       // Embedded images: extraction, decoding, pasting
+    Diff,         // The LCS matrix and the diff view
+    Undo,         // Undo history steps and spill files
+    Search,       // Find/replace workers
+    SubsystemCount
+};
+
+struct Counters {
+    qint64 allocations = 0;    // Since startup
+    qint64 frees = 0;
+    qint64 allocatedBytes = 0; // Since startup (churn)
+    qint64 liveBytes = 0;      // Allocated and not freed yet
+    qint64 liveBlocks = 0;
+};
+
+// Fixed for the lifetime of the process (decided by the first allocation)
+bool isEnabled();
+
+const char *subsystemName(Subsystem subsystem);
+Counters counters(Subsystem subsystem);
+Counters total();
+
+// Resident set size of the process, -1 where it can't be read
+qint64 residentBytes();
+
+// Process RSS plus the counters of every subsystem
+QJsonObject snapshot();
+
+class Scope {
+public:
+    explicit Scope(Subsystem subsystem);
+    ~Scope();
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    Subsystem m_previous;
+};
+
+} // namespace MemoryAccounting
@@ -0,0 +1,251 @@
+#include "MultiCursor.h"
+
+#include <QTextDocument>
+#include <algorithm>
+
+// =========================================================
+// Caret Bookkeeping
+// =========================================================
+
+void MultiCursor::coalesce(QVector<Caret> *carets, int *primaryIndex) {
+    // Input is sorted by start. Overlapping carets, or empty carets on the same
+    // spot, become one; carets that only touch stay separate.
+    QVector<Caret> out;
+    out.reserve(carets->size());
+    int primaryOut = 0;
+
+    for (int i = 0; i < carets->size(); ++i) {
+        const Caret &caret = carets->at(i);
+        if (!out.isEmpty()) {
+            Caret &last = out.last();
+            const bool overlaps = caret.start() < last.end();
+            const bool samePoint = caret.start() == last.start() && caret.end() == last.end();
+            if (overlaps || samePoint) {
+                const int start = last.start();
+                const int end = qMax(last.end(), caret.end());
+                // Keep the direction of the caret we merge into
+                last = last.anchor <= last.position ? Caret{start, end} : Caret{end, start};
+                if (i == *primaryIndex) primaryOut = out.size() - 1;
+                continue;
+            }
+        }
+        out.append(caret);
+        if (i == *primaryIndex) primaryOut = out.size() - 1;
+    }
+
+    *carets = out;
+    *primaryIndex = primaryOut;
+}
+
+QVector<MultiCursor::Caret> MultiCursor::merged(const Caret &primary, int *primaryIndex) const {
+    // m_carets is already sorted, so the primary only has to be put in its place
+    auto it = std::lower_bound(m_carets.constBegin(), m_carets.constEnd(), primary.start(),
+                               [](const Caret &caret, int start) { return caret.start() < start; });
+    QVector<Caret> all = m_carets;
+    *primaryIndex = int(it - m_carets.constBegin());
+    all.insert(*primaryIndex, primary);
+    coalesce(&all, primaryIndex);
+    return all;
+}
+
+void MultiCursor::split(QVector<Caret> all, int primaryIndex, Caret *primary) {
+    *primary = all.at(primaryIndex);
+    all.remove(primaryIndex);
+    m_carets = all;
+}
+
+void MultiCursor::setCarets(const QVector<Caret> &carets, Caret *primary) {
+    m_carets = carets;
+    std::sort(m_carets.begin(), m_carets.end(),
+              [](const Caret &a, const Caret &b) { return a.start() < b.start(); });
+    int noPrimary = -1;
+    coalesce(&m_carets, &noPrimary);
+
+    int primaryIndex = 0;
+    QVector<Caret> all = merged(*primary, &primaryIndex);
+    split(all, primaryIndex, primary);
+}
+
+void MultiCursor::indexRange(int from, int to, int *first, int *last) const {
+    auto begin = std::lower_bound(m_carets.constBegin(), m_carets.constEnd(), from,
+                                  [](const Caret &caret, int pos) { return caret.end() < pos; });
+    auto end = std::upper_bound(begin, m_carets.constEnd(), to,
+                                [](int pos, const Caret &caret) { return pos < caret.start(); });
+    *first = int(begin - m_carets.constBegin());
+    *last = int(end - m_carets.constBegin());
+}
+
+void MultiCursor::documentChanged(int position, int charsRemoved, int charsAdded) {
+    if (m_editing || m_carets.isEmpty()) return;
+
+    auto adjust = [&](int pos) {
+        if (pos <= position) return pos;
+        if (pos >= position + charsRemoved) return pos + charsAdded - charsRemoved;
+        return position + qMin(pos - position, charsAdded); // Inside the replaced text
+    };
+    for (Caret &caret : m_carets) {
+        caret.anchor = adjust(caret.anchor);
+        caret.position = adjust(caret.position);
+    }
+
+    int noPrimary = -1;
+    coalesce(&m_carets, &noPrimary);
+}
+
+// =========================================================
+// Batched Edits
+// =========================================================
+
+void MultiCursor::replaceRanges(QVector<Caret> &all, int primaryIndex, const QVector<int> &from,
+                                const QVector<int> &to, const QStringList &texts, Caret *primary) {
+    // Ascending order with a running offset: each range is shifted by what the
+    // edits before it added or removed
+    QTextCursor edit(m_document);
+    m_editing = true;
+    edit.beginEditBlock();
+
+    int delta = 0;
+    int previousEnd = 0;
+    for (int i = 0; i < all.size(); ++i) {
+        // Neighbouring carets may claim the same character (Backspace at "a|b|")
+        const int start = qMax(from[i], previousEnd);
+        const int end = qMax(start, to[i]);
+        const QString &text = texts.size() == all.size() ? texts.at(i) : texts.at(0);
+
+        if (start != end || !text.isEmpty()) {
+            edit.setPosition(start + delta);
+            edit.setPosition(end + delta, QTextCursor::KeepAnchor);
+            edit.insertText(text);
+        }
+
+        const int caret = start + delta + int(text.size());
+        all[i] = Caret{caret, caret};
+        delta += int(text.size()) - (end - start);
+        previousEnd = end;
+    }
+
+    edit.endEditBlock();
+    m_editing = false;
+
+    coalesce(&all, &primaryIndex);
+    split(all, primaryIndex, primary);
+}
+
+void MultiCursor::insert(Caret *primary, const QStringList &texts) {
+    if (texts.isEmpty()) return;
+
+    int primaryIndex = 0;
+    QVector<Caret> all = merged(*primary, &primaryIndex);
+    QVector<int> from(all.size());
+    QVector<int> to(all.size());
+    for (int i = 0; i < all.size(); ++i) {
+        from[i] = all[i].start();
+        to[i] = all[i].end();
+    }
+    replaceRanges(all, primaryIndex, from, to, texts, primary);
+}
+
+void MultiCursor::erase(Caret *primary, bool forward) {
+    int primaryIndex = 0;
+    QVector<Caret> all = merged(*primary, &primaryIndex);
+    const int lastPosition = m_document->characterCount() - 1;
+
+    QVector<int> from(all.size());
+    QVector<int> to(all.size());
+    for (int i = 0; i < all.size(); ++i) {
+        from[i] = all[i].start();
+        to[i] = all[i].end();
+        if (all[i].hasSelection()) continue;
+
+        // One character, keeping surrogate pairs together
+        if (forward && to[i] < lastPosition) {
+            to[i] += m_document->characterAt(to[i]).isHighSurrogate() ? 2 : 1;
+            to[i] = qMin(to[i], lastPosition);
+        } else if (!forward && from[i] > 0) {
+            from[i] -= 1;
+            if (from[i] > 0 && m_document->characterAt(from[i]).isLowSurrogate()) from[i] -= 1;
+        }
+    }
+    replaceRanges(all, primaryIndex, from, to, QStringList{QString()}, primary);
+}
+
+void MultiCursor::move(Caret *primary, QTextCursor::MoveOperation operation, QTextCursor::MoveMode mode) {
+    int primaryIndex = 0;
+    QVector<Caret> all = merged(*primary, &primaryIndex);
+
+    for (Caret &caret : all) {
+        // Left/Right without Shift first collapse a selection to that edge
+        if (mode == QTextCursor::MoveAnchor && caret.hasSelection()
+            && (operation == QTextCursor::Left || operation == QTextCursor::Right)) {
+            const int edge = operation == QTextCursor::Left ? caret.start() : caret.end();
+            caret = Caret{edge, edge};
+            continue;
+        }
+
+        // One short-lived cursor at a time, so the document tracks at most one
+        QTextCursor cursor(m_document);
+        cursor.setPosition(caret.anchor);
+        cursor.setPosition(caret.position, QTextCursor::KeepAnchor);
+        cursor.movePosition(operation, mode);
+        caret = Caret{cursor.anchor(), cursor.position()};
+    }
+
+    // Moving can reorder carets (Home on a wrapped line) and make them meet;
+    // remember where the primary went before sorting, then find it again
+    const Caret moved = all.value(primaryIndex);
+    std::stable_sort(all.begin(), all.end(),
+                     [](const Caret &a, const Caret &b) { return a.start() < b.start(); });
+    primaryIndex = 0;
+    for (int i = 0; i < all.size(); ++i) {
+        if (all[i].anchor == moved.anchor && all[i].position == moved.position) {
+            primaryIndex = i;
+            break;
+        }
+    }
+    coalesce(&all, &primaryIndex);
+    split(all, primaryIndex, primary);
+}
+
+QStringList MultiCursor::selectedTexts(const Caret &primary) const {
+    int primaryIndex = 0;
+    const QVector<Caret> all = merged(primary, &primaryIndex);
+
+    QStringList texts;
+    QTextCursor cursor(m_document);
+    for (const Caret &caret : all) {
+        cursor.setPosition(caret.start());
+        cursor.setPosition(caret.end(), QTextCursor::KeepAnchor);
+        QString text = cursor.selectedText();
+        text.replace(QChar::ParagraphSeparator, QLatin1Char('\n'));
+        texts.append(text);
+    }
+    return texts;
+}
+
+// =========================================================
+// Columns
+// =========================================================
+
+int MultiCursor::positionAtColumn(const QTextBlock &block, int column, int tabWidth) {
+    const QString text = block.text();
+    int visual = 0;
+    for (int i = 0; i < text.size(); ++i) {
+        const int advance = text.at(i) == QLatin1Char('\t') ? tabWidth - visual % tabWidth : 1;
+        if (visual + advance > column) {
+            // Inside a tab: snap to the nearer side
+            return block.position() + (column - visual > advance / 2 ? i + 1 : i);
+        }
+        visual += advance;
+    }
+    return block.position() + int(text.size()); // Short line: clamp to its end
+}
+
+int MultiCursor::columnAt(const QTextBlock &block, int position, int tabWidth) {
+    const QString text = block.text();
+    const int length = qMin(int(text.size()), position - block.position());
+    int visual = 0;
+    for (int i = 0; i < length; ++i) {
+        visual += text.at(i) == QLatin1Char('\t') ? tabWidth - visual % tabWidth : 1;
+    }
+    return visual;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QTextCursor>
+#include <QTextBlock>
+
+class QTextDocument;
+
+// Secondary carets for CodeEditor (the editor's own QTextCursor stays the
+// primary one) and the batched edits that apply to all of them.
+//
+// Carets are plain positions, kept sorted and non-overlapping, instead of
+// QTextCursors: every live QTextCursor is adjusted by the document on every
+// single edit, so 10k of them would make an edit at 10k carets cost 10^8
+// updates. Here an edit at N carets is N piece-table operations inside ONE
+// edit block: the layout and the highlighter see a single contentsChange,
+// and undo sees a single step.
+class MultiCursor {
+public:
+    struct Caret {
+        int anchor = 0;
+        int position = 0;
+
+        int start() const { return qMin(anchor, position); }
+        int end() const { return qMax(anchor, position); }
+        bool hasSelection() const { return anchor != position; }
+    };
+
+    explicit MultiCursor(QTextDocument *document) : m_document(document) {}
+
+    // Secondary carets in document order
+    const QVector<Caret> &carets() const { return m_carets; }
+    bool isEmpty() const { return m_carets.isEmpty(); }
+    void clear() { m_carets.clear(); }
+
+    // Replaces the secondary carets. Carets that overlap each other or the
+    // primary are merged; 'primary' is updated if it absorbed one.
+    void setCarets(const QVector<Caret> &carets, Caret *primary);
+
+    // --- Batched edits over the primary and all secondary carets ---
+    // Replaces every selection with 'texts' (one text for all carets, or one
+    // per caret in document order)
+    void insert(Caret *primary, const QStringList &texts);
+    // Backspace / Delete: removes the selection, or one character
+    void erase(Caret *primary, bool forward);
+    // Moves every caret like QTextCursor::movePosition
+    void move(Caret *primary, QTextCursor::MoveOperation operation, QTextCursor::MoveMode mode);
+
+    // Selected text of every caret in document order (for copy)
+    QStringList selectedTexts(const Caret &primary) const;
+
+    // Index range [first, last) of the secondary carets that touch [from, to],
+    // so painting only looks at the carets on screen
+    void indexRange(int from, int to, int *first, int *last) const;
+
+    // Keeps the carets in place when the document is changed by something
+    // else (undo, replace all, ...). Connected to QTextDocument::contentsChange.
+    void documentChanged(int position, int charsRemoved, int charsAdded);
+
+    // Column <-> position on one line, with tabs expanded (for box selection)
+    static int positionAtColumn(const QTextBlock &block, int column, int tabWidth);
+    static int columnAt(const QTextBlock &block, int position, int tabWidth);
+
+private:
+    // All carets (primary included) sorted, with overlapping ones merged
+    QVector<Caret> merged(const Caret &primary, int *primaryIndex) const;
+    static void coalesce(QVector<Caret> *carets, int *primaryIndex);
+    void split(QVector<Caret> all, int primaryIndex, Caret *primary);
+
+    // Replaces [from[i], to[i]) by texts[i] for every caret in one edit block
+    void replaceRanges(QVector<Caret> &all, int primaryIndex, const QVector<int> &from,
+                       const QVector<int> &to, const QStringList &texts, Caret *primary);
+
+    QTextDocument *m_document;
+    QVector<Caret> m_carets;
+    bool m_editing = false; // Our own batch, documentChanged() ignores it
+};
@@ -0,0 +1,289 @@
+#include "RichHtmlWriter.h"
+#include "utils/Base64.h"
+
+#include <QIODevice>
+#include <QFont>
+#include <QTextDocument>
+#include <QTextBlock>
+#include <QTextFragment>
+#include <QTextFrame>
+#include <QTextList>
+#include <QTextImageFormat>
+#include <QVector>
+
+// Bytes kept in memory before they are handed to the device
+static const int SINK_CAPACITY = 64 * 1024;
+
+// Raw image bytes encoded per step (a multiple of 3, so chunks need no padding)
+static const int BASE64_CHUNK = 48 * 1024;
+
+RichHtmlWriter::RichHtmlWriter(const QTextDocument *document)
+    : m_document(document) {
+}
+
+bool RichHtmlWriter::write(QIODevice *device) {
+    m_device = device;
+    m_ok = true;
+    m_buffer.reserve(SINK_CAPACITY + BASE64_CHUNK * 4 / 3 + 16);
+
+    // Tables and other frames are rare in our notes but need the full Qt
+    // exporter; fall back to it rather than silently dropping structure.
+    if (!m_document->rootFrame()->childFrames().isEmpty()) {
+        put(m_htmlFallback ? m_htmlFallback() : m_document->toHtml());
+        flush();
+        return m_ok;
+    }
+
+    QFont font = m_document->defaultFont();
+    put("<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0//EN\" \"http://www.w3.org/TR/REC-html40/strict.dtd\">\n"
+        "<html><head><meta name=\"qrichtext\" content=\"1\" /><meta charset=\"utf-8\" />"
+        "<style type=\"text/css\">\np, li { white-space: pre-wrap; }\n</style></head>");
+    put(QString("<body style=\" font-family:'%1';%2\">\n")
+        .arg(font.family().toHtmlEscaped(), fontSizeStyle(font.pointSizeF(), font.pixelSize())));
+
+    // Lists are opened at their first item and closed after their last one,
+    // like QTextDocument::toHtml() does; a list that starts inside another
+    // one (a deeper indent) ends up nested in it.
+    QVector<const QTextList *> openLists;
+    for (QTextBlock block = m_document->begin(); block.isValid() && m_ok; block = block.next()) {
+        const QTextList *list = block.textList();
+        if (list && !openLists.contains(list)) {
+            openList(list);
+            openLists.append(list);
+        }
+
+        writeBlock(block);
+
+        if (list && list->itemNumber(block) == list->count() - 1) {
+            // Lists that aren't properly nested in it close with it
+            while (!openLists.isEmpty()) {
+                const QTextList *last = openLists.takeLast();
+                closeList(last);
+                if (last == list) break;
+            }
+        }
+    }
+    while (!openLists.isEmpty()) closeList(openLists.takeLast());
+
+    put("</body></html>");
+    flush();
+    return m_ok;
+}
+
+// " font-size:Npt;" for a point size, " font-size:Npx;" for a pixel size,
+// nothing if neither is set (QFont reports -1 for the one it doesn't use)
+QString RichHtmlWriter::fontSizeStyle(qreal pointSize, int pixelSize) {
+    if (pointSize > 0) return QString(" font-size:%1pt;").arg(pointSize);
+    if (pixelSize > 0) return QString(" font-size:%1px;").arg(pixelSize);
+    return QString();
+}
+
+// ---------------------------------
+// Lists
+// ---------------------------------
+
+static bool isOrdered(QTextListFormat::Style style) {
+    return style <= QTextListFormat::ListDecimal;
+}
+
+static const char *listStyleType(QTextListFormat::Style style) {
+    switch (style) {
+        case QTextListFormat::ListDisc: return "disc";
+        case QTextListFormat::ListCircle: return "circle";
+        case QTextListFormat::ListSquare: return "square";
+        case QTextListFormat::ListDecimal: return "decimal";
+        case QTextListFormat::ListLowerAlpha: return "lower-alpha";
+        case QTextListFormat::ListUpperAlpha: return "upper-alpha";
+        case QTextListFormat::ListLowerRoman: return "lower-roman";
+        case QTextListFormat::ListUpperRoman: return "upper-roman";
+        default: return nullptr;
+    }
+}
+
+// Same properties as QTextDocument::toHtml(): the style, the list's own
+// indent level and non-default number decorations
+void RichHtmlWriter::openList(const QTextList *list) {
+    const QTextListFormat fmt = list->format();
+
+    QString style = QString("margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; "
+                            "-qt-list-indent:%1;").arg(fmt.indent());
+    if (const char *type = listStyleType(fmt.style())) style += QString(" list-style-type:%1;").arg(QLatin1String(type));
+    if (!fmt.numberPrefix().isEmpty()) {
+        style += QString(" -qt-list-number-prefix:'%1';").arg(fmt.numberPrefix().toHtmlEscaped());
+    }
+    if (fmt.numberSuffix() != QLatin1String(".")) {
+        style += QString(" -qt-list-number-suffix:'%1';").arg(fmt.numberSuffix().toHtmlEscaped());
+    }
+
+    put(QString("<%1 style=\"%2\">").arg(QLatin1String(isOrdered(fmt.style()) ? "ol" : "ul"), style));
+}
+
+void RichHtmlWriter::closeList(const QTextList *list) {
+    put(isOrdered(list->format().style()) ? "</ol>\n" : "</ul>\n");
+}
+
+// ---------------------------------
+// Blocks and Fragments
+// ---------------------------------
+
+void RichHtmlWriter::writeBlock(const QTextBlock &block) {
+    QTextBlockFormat fmt = block.blockFormat();
+
+    QByteArray tag = "p";
+    if (block.textList()) tag = "li";
+    else if (fmt.headingLevel() > 0) tag = "h" + QByteArray::number(qMin(fmt.headingLevel(), 6));
+
+    put("<" + tag);
+    Qt::Alignment align = fmt.alignment() & Qt::AlignHorizontal_Mask;
+    if (align & Qt::AlignRight) put(" align=\"right\"");
+    else if (align & Qt::AlignHCenter) put(" align=\"center\"");
+    else if (align & Qt::AlignJustify) put(" align=\"justify\"");
+
+    put(QString(" style=\"%1margin-top:%2px; margin-bottom:%3px; margin-left:%4px; margin-right:%5px; "
+                "-qt-block-indent:%6; text-indent:%7px;\">")
+        .arg(QLatin1String(block.length() <= 1 ? "-qt-paragraph-type:empty; " : ""))
+        .arg(fmt.topMargin()).arg(fmt.bottomMargin())
+        .arg(fmt.leftMargin()).arg(fmt.rightMargin())
+        .arg(fmt.indent()).arg(fmt.textIndent()));
+
+    if (block.length() <= 1) {
+        put("<br />");
+    }
+
+    for (QTextBlock::iterator it = block.begin(); !it.atEnd() && m_ok; ++it) {
+        QTextFragment fragment = it.fragment();
+        if (!fragment.isValid()) continue;
+
+        QTextCharFormat charFmt = fragment.charFormat();
+        if (charFmt.isImageFormat()) {
+            // One object replacement character per image
+            for (int i = 0; i < fragment.length(); ++i) writeImage(charFmt.toImageFormat());
+            continue;
+        }
+
+        bool hasAnchor = false;
+        openCharFormat(charFmt, &hasAnchor);
+        writeFragmentText(fragment.text());
+        put("</span>");
+        if (hasAnchor) put("</a>");
+    }
+
+    put("</" + tag + ">\n");
+}
+
+// Emits the opening <a>/<span> for a fragment. Every property is written
+// explicitly so the result does not depend on the surrounding block format.
+void RichHtmlWriter::openCharFormat(const QTextCharFormat &format, bool *hasAnchor) {
+    *hasAnchor = format.isAnchor() && !format.anchorHref().isEmpty();
+    if (*hasAnchor) {
+        put(QString("<a href=\"%1\">").arg(format.anchorHref().toHtmlEscaped()));
+    }
+
+    QString style;
+    if (format.hasProperty(QTextFormat::FontFamilies)) {
+        QStringList families = format.fontFamilies().toStringList();
+        if (!families.isEmpty()) style += QString(" font-family:'%1';").arg(families.first().toHtmlEscaped());
+    }
+    if (format.hasProperty(QTextFormat::FontPointSize) || format.hasProperty(QTextFormat::FontPixelSize)) {
+        style += fontSizeStyle(format.fontPointSize(), format.intProperty(QTextFormat::FontPixelSize));
+    }
+    if (format.hasProperty(QTextFormat::FontWeight)) {
+        style += QString(" font-weight:%1;").arg(format.fontWeight());
+    }
+    if (format.fontItalic()) style += " font-style:italic;";
+
+    QString decoration;
+    if (format.fontUnderline()) decoration += " underline";
+    if (format.fontStrikeOut()) decoration += " line-through";
+    if (!decoration.isEmpty()) style += " text-decoration:" + decoration + ";";
+
+    if (format.foreground().style() != Qt::NoBrush) {
+        style += QString(" color:%1;").arg(format.foreground().color().name());
+    }
+    if (format.background().style() != Qt::NoBrush) {
+        style += QString(" background-color:%1;").arg(format.background().color().name());
+    }
+
+    if (style.isEmpty()) put("<span>");
+    else put(QString("<span style=\"%1\">").arg(style));
+}
+
+void RichHtmlWriter::writeFragmentText(const QString &text) {
+    // Escape in small runs so even a huge paragraph never doubles in memory
+    QString escaped;
+    escaped.reserve(qMin<qsizetype>(text.size(), 4096) + 64);
+
+    for (QChar ch : text) {
+        switch (ch.unicode()) {
+            case '<': escaped += QLatin1String("&lt;"); break;
+            case '>': escaped += QLatin1String("&gt;"); break;
+            case '&': escaped += QLatin1String("&amp;"); break;
+            case '"': escaped += QLatin1String("&quot;"); break;
+            case 0x00A0: escaped += QLatin1String("&nbsp;"); break;
+            case 0x2028: escaped += QLatin1String("<br />"); break; // QChar::LineSeparator (Shift+Enter)
+            default: escaped += ch; break;
+        }
+        if (escaped.size() >= 4096) {
+            put(escaped);
+            escaped.clear();
+        }
+    }
+    put(escaped);
+}
+
+void RichHtmlWriter::writeImage(const QTextImageFormat &format) {
+    put("<img src=\"");
+
+    QByteArray bytes, mimeType;
+    if (m_imageSource && m_imageSource(format.name(), &bytes, &mimeType)) {
+        put("data:" + mimeType + ";base64,");
+        putBase64(bytes);
+    } else {
+        // Already a data: URI (or a plain url) held by the format itself
+        const QString name = format.name();
+        for (qsizetype i = 0; i < name.size(); i += SINK_CAPACITY) {
+            put(name.mid(i, SINK_CAPACITY).toHtmlEscaped());
+        }
+    }
+    put("\"");
+
+    if (format.width() > 0) put(QString(" width=\"%1\"").arg(format.width()));
+    if (format.height() > 0) put(QString(" height=\"%1\"").arg(format.height()));
+    put(" />");
+}
+
+// ---------------------------------
+// Buffered Sink
+// ---------------------------------
+
+void RichHtmlWriter::put(const char *text) {
+    m_buffer.append(text);
+    if (m_buffer.size() >= SINK_CAPACITY) flush();
+}
+
+void RichHtmlWriter::put(const QByteArray &bytes) {
+    m_buffer.append(bytes);
+    if (m_buffer.size() >= SINK_CAPACITY) flush();
+}
+
+void RichHtmlWriter::put(const QString &text) {
+    m_buffer.append(text.toUtf8());
+    if (m_buffer.size() >= SINK_CAPACITY) flush();
+}
+
+// Encodes straight into the sink buffer, one chunk at a time.
+void RichHtmlWriter::putBase64(const QByteArray &bytes) {
+    for (qsizetype offset = 0; offset < bytes.size() && m_ok; offset += BASE64_CHUNK) {
+        size_t len = size_t(qMin<qsizetype>(BASE64_CHUNK, bytes.size() - offset));
+        qsizetype start = m_buffer.size();
+        m_buffer.resize(start + qsizetype(Base64::encodedSize(len)));
+        Base64::encode(bytes.constData() + offset, len, m_buffer.data() + start);
+        if (m_buffer.size() >= SINK_CAPACITY) flush();
+    }
+}
+
+void RichHtmlWriter::flush() {
+    if (m_buffer.isEmpty()) return;
+    if (m_device->write(m_buffer) != m_buffer.size()) m_ok = false;
+    m_buffer.resize(0); // Unlike clear(), keeps the capacity so the sink never reallocates
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+class QIODevice;
+class QTextDocument;
+class QTextBlock;
+class QTextCharFormat;
+class QTextImageFormat;
+class QTextList;
+
+// Serializes a QTextDocument to HTML by walking its blocks and fragments and
+// writing straight into a device through a small fixed-size buffer.
+//
+// Unlike QTextDocument::toHtml() it never builds the whole document as one
+// QString, and embedded images are streamed through the Base64 encoder in
+// chunks, so the extra memory needed to save does not grow with the document.
+// The output is plain Qt rich-text HTML and loads back with setHtml(): block
+// alignment, margins and indents, nested lists with their numbering style,
+// and character formats survive the round trip.
+class RichHtmlWriter {
+public:
+    // Supplies the encoded bytes for an image resource name. Returning false
+    // makes the writer emit the name itself as the src attribute.
+    typedef std::function<bool(const QString &name, QByteArray *bytes, QByteArray *mimeType)> ImageSource;
+
+    // Produces the whole document as HTML for documents the walker can't
+    // write (tables and other frames). Defaults to QTextDocument::toHtml();
+    // set it when the document holds resources that need post-processing.
+    typedef std::function<QString()> HtmlFallback;
+
+    explicit RichHtmlWriter(const QTextDocument *document);
+
+    void setImageSource(const ImageSource &source) { m_imageSource = source; }
+    void setHtmlFallback(const HtmlFallback &fallback) { m_htmlFallback = fallback; }
+
+    // Returns false if the device reported a write error.
+    bool write(QIODevice *device);
+
+private:
+    void openList(const QTextList *list);
+    void closeList(const QTextList *list);
+    void writeBlock(const QTextBlock &block);
+    void writeFragmentText(const QString &text);
+    void writeImage(const QTextImageFormat &format);
+    void openCharFormat(const QTextCharFormat &format, bool *hasAnchor);
+    static QString fontSizeStyle(qreal pointSize, int pixelSize);
+
+    // --- Buffered sink ---
+    void put(const char *text);
+    void put(const QByteArray &bytes);
+    void put(const QString &text);
+    void putBase64(const QByteArray &bytes);
+    void flush();
+
+    const QTextDocument *m_document;
+    ImageSource m_imageSource;
+    HtmlFallback m_htmlFallback;
+    QIODevice *m_device = nullptr;
+    QByteArray m_buffer;
+    bool m_ok = true;
+};
@@ -0,0 +1,166 @@
+#include "Session.h"
+#include "LineIndex.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QDebug>
+
+namespace {
+
+constexpr int kVersion = 1;
+constexpr quint32 kLineIndexMagic = 0x4c494431;  // "LID1"
+constexpr quint32 kLineIndexVersion = 1;
+
+QJsonObject toJson(const Session::Fingerprint &fingerprint) {
+    QJsonObject object;
+    object["mtime"] = fingerprint.mtime;
+    object["size"] = fingerprint.size;
+    object["hash"] = QString::fromLatin1(fingerprint.hash.toHex());
+    return object;
+}
+
+Session::Fingerprint fingerprintFromJson(const QJsonObject &object) {
+    Session::Fingerprint fingerprint;
+    fingerprint.mtime = object["mtime"].toInteger();
+    fingerprint.size = object["size"].toInteger(-1);
+    fingerprint.hash = QByteArray::fromHex(object["hash"].toString().toLatin1());
+    return fingerprint;
+}
+
+QDataStream &operator<<(QDataStream &out, const Session::Fingerprint &fingerprint) {
+    return out << fingerprint.mtime << fingerprint.size << fingerprint.hash;
+}
+
+QDataStream &operator>>(QDataStream &in, Session::Fingerprint &fingerprint) {
+    return in >> fingerprint.mtime >> fingerprint.size >> fingerprint.hash;
+}
+
+} // namespace
+
+// =========================================================
+// Fingerprint
+// =========================================================
+
+Session::Fingerprint Session::Fingerprint::of(const QString &filePath) {
+    Fingerprint fingerprint;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return fingerprint;
+
+    fingerprint.mtime = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+    fingerprint.size = file.size();
+    fingerprint.hash = QCryptographicHash::hash(file.read(kHashedBytes), QCryptographicHash::Sha1);
+    return fingerprint;
+}
+
+// =========================================================
+// Session file
+// =========================================================
+
+QString Session::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/session.json";
+}
+
+bool Session::save(const QString &path) const {
+    QJsonArray tabArray;
+    for (const Tab &tab : tabs) {
+        QJsonObject object;
+        object["path"] = tab.path;
+        object["fingerprint"] = toJson(tab.fingerprint);
+        object["cursor"] = tab.cursor;
+        object["anchor"] = tab.anchor;
+        object["scroll"] = tab.scroll;
+        object["top_line"] = tab.topLine;
+        tabArray.append(object);
+    }
+
+    QJsonObject root;
+    root["version"] = kVersion;
+    root["current"] = current;
+    root["tabs"] = tabArray;
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(QJsonDocument(root).toJson());
+    return file.commit();
+}
+
+bool Session::load(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError || doc["version"].toInt() != kVersion) {
+        qWarning() << "Session: ignoring" << path << error.errorString();
+        return false;
+    }
+
+    tabs.clear();
+    for (const QJsonValue &value : doc["tabs"].toArray()) {
+        const QJsonObject object = value.toObject();
+        Tab tab;
+        tab.path = object["path"].toString();
+        if (tab.path.isEmpty()) continue;
+        tab.fingerprint = fingerprintFromJson(object["fingerprint"].toObject());
+        tab.cursor = object["cursor"].toInt();
+        tab.anchor = object["anchor"].toInt();
+        tab.scroll = object["scroll"].toInt();
+        tab.topLine = object["top_line"].toInteger();
+        tabs.append(tab);
+    }
+    current = qBound(-1, doc["current"].toInt(-1), int(tabs.size()) - 1);
+    return true;
+}
+
+// =========================================================
+// Per-file cache
+// =========================================================
+
+QString Session::cachePathFor(const QString &filePath, const QString &suffix) {
+    const QByteArray key = QCryptographicHash::hash(QFileInfo(filePath).absoluteFilePath().toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+           + "/" + QString::fromLatin1(key) + suffix;
+}
+
+bool Session::saveLineIndex(const QString &filePath, const Fingerprint &fingerprint, const LineIndex &index) {
+    const QString path = cachePathFor(filePath, ".lineindex");
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out << kLineIndexMagic << kLineIndexVersion << fingerprint;
+    index.write(out);
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool Session::loadLineIndex(const QString &filePath, const Fingerprint &fingerprint, LineIndex *index) {
+    QFile file(cachePathFor(filePath, ".lineindex"));
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    Fingerprint saved;
+    in >> magic >> version;
+    if (magic != kLineIndexMagic || version != kLineIndexVersion) return false;
+
+    // Line offsets are only good for the exact bytes they were taken from
+    in >> saved;
+    if (!fingerprint.isValid() || saved != fingerprint) return false;
+    LineIndex loaded;
+    if (!loaded.read(in) || loaded.indexedBytes() > fingerprint.size) return false;
+    *index = loaded;
+    return true;
+}
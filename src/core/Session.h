@@ -0,0 +1,68 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class LineIndex;
+
+// The workspace of the last run: which tabs were open, which one was in
+// front, and where each one's cursor and scroll position were. Written when
+// the main window closes, read back at startup (EditorArea::restoreSession).
+//
+// Anything restored for a file is keyed by its Fingerprint. If the file was
+// changed outside the editor since, the tab still comes back but opens at the
+// top, and cached data for it is ignored.
+//
+// Besides the session file there is a per-file cache for data that is
+// expensive to rebuild; for now the LineIndex of files shown in a LogViewer,
+// so reopening a multi-GB log doesn't scan it again.
+class Session {
+public:
+    // mtime, size and a hash of the first kHashedBytes. Cheap enough to take
+    // for every tab on quit, even for huge files.
+    struct Fingerprint {
+        static constexpr qint64 kHashedBytes = 64 * 1024;
+
+        qint64 mtime = 0; // ms since epoch
+        qint64 size = -1;
+        QByteArray hash;
+
+        static Fingerprint of(const QString &filePath);
+        bool isValid() const { return size >= 0; }
+        bool operator==(const Fingerprint &other) const {
+            return mtime == other.mtime && size == other.size && hash == other.hash;
+        }
+        bool operator!=(const Fingerprint &other) const { return !(*this == other); }
+    };
+
+    struct Tab {
+        QString path;
+        Fingerprint fingerprint;
+        // Code editors: cursor (anchor = other end of the selection) and the
+        // vertical scroll bar, which counts blocks
+        int cursor = 0;
+        int anchor = 0;
+        int scroll = 0;
+        // Log viewers: first line on screen (0-based)
+        qint64 topLine = 0;
+    };
+
+    QVector<Tab> tabs;
+    int current = -1; // Index into tabs of the tab in front
+
+    bool isEmpty() const { return tabs.isEmpty(); }
+
+    // session.json in the app's data directory
+    static QString defaultPath();
+    bool save(const QString &path) const;
+    bool load(const QString &path);
+
+    // --- Per-file cache ---
+    // Stored with the fingerprint of the file it was built from; loading
+    // fails if the file doesn't match that fingerprint any more.
+    static bool saveLineIndex(const QString &filePath, const Fingerprint &fingerprint, const LineIndex &index);
+    static bool loadLineIndex(const QString &filePath, const Fingerprint &fingerprint, LineIndex *index);
+
+private:
+    static QString cachePathFor(const QString &filePath, const QString &suffix);
+};
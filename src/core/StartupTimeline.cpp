@@ -0,0 +1,119 @@
+#include "StartupTimeline.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QVector>
+#include <QDebug>
+
+namespace {
+
+struct Mark {
+    QString name;
+    qint64 ms;
+};
+
+// Startup runs on the GUI thread only; no locking needed
+QElapsedTimer g_clock;
+QVector<Mark> g_marks;
+bool g_finished = false;
+
+void budgets(qint64 *firstPaint, qint64 *interactive) {
+    *firstPaint = StartupTimeline::kFirstPaintBudgetMs;
+    *interactive = StartupTimeline::kInteractiveBudgetMs;
+
+    const QList<QByteArray> values = qgetenv("QT_EDITOR_STARTUP_BUDGET_MS").split(',');
+    bool ok = false;
+    qint64 value = values.value(0).toLongLong(&ok);
+    if (ok) *firstPaint = value;
+    value = values.value(1).toLongLong(&ok);
+    if (ok) *interactive = value;
+}
+
+} // namespace
+
+namespace StartupTimeline {
+
+void start() {
+    g_clock.start();
+    g_marks.clear();
+    g_finished = false;
+    mark("main");
+}
+
+void mark(const QString &name) {
+    if (!g_clock.isValid() || elapsed(name) >= 0) return;
+    g_marks.append(Mark{name, g_clock.elapsed()});
+}
+
+qint64 elapsed(const QString &name) {
+    for (const Mark &m : std::as_const(g_marks)) {
+        if (m.name == name) return m.ms;
+    }
+    return -1;
+}
+
+bool isFinished() {
+    return g_finished;
+}
+
+QJsonObject toJson() {
+    QJsonArray marks;
+    for (const Mark &m : std::as_const(g_marks)) {
+        QJsonObject entry;
+        entry["name"] = m.name;
+        entry["ms"] = m.ms;
+        marks.append(entry);
+    }
+
+    qint64 firstPaintBudget = 0;
+    qint64 interactiveBudget = 0;
+    budgets(&firstPaintBudget, &interactiveBudget);
+
+    QJsonObject object;
+    object["marks"] = marks;
+    object["first_paint_ms"] = elapsed("first paint");
+    object["interactive_ms"] = elapsed("interactive");
+    object["first_paint_budget_ms"] = firstPaintBudget;
+    object["interactive_budget_ms"] = interactiveBudget;
+    return object;
+}
+
+void finish() {
+    if (g_finished || !g_clock.isValid()) return;
+    mark("interactive");
+    g_finished = true;
+
+    qint64 firstPaintBudget = 0;
+    qint64 interactiveBudget = 0;
+    budgets(&firstPaintBudget, &interactiveBudget);
+    const qint64 firstPaint = elapsed("first paint");
+    const qint64 interactive = elapsed("interactive");
+
+    if (firstPaint > firstPaintBudget || interactive > interactiveBudget) {
+        qWarning().noquote() << QString("Startup over budget: first paint %1 ms (budget %2), interactive %3 ms (budget %4)")
+                                    .arg(firstPaint).arg(firstPaintBudget).arg(interactive).arg(interactiveBudget);
+    }
+
+    const QByteArray output = qgetenv("QT_EDITOR_STARTUP_TIMELINE");
+    if (output.isEmpty() || output == "0") return;
+
+    if (output == "1") {
+        qint64 previous = 0;
+        for (const Mark &m : std::as_const(g_marks)) {
+            qInfo().noquote() << QString("startup %1 ms (+%2) %3").arg(m.ms, 6).arg(m.ms - previous, 5).arg(m.name);
+            previous = m.ms;
+        }
+        return;
+    }
+
+    QFile file(QString::fromLocal8Bit(output));
+    if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        file.write(QJsonDocument(toJson()).toJson());
+    } else {
+        qWarning() << "StartupTimeline: could not write" << file.fileName();
+    }
+}
+
+} // namespace StartupTimeline
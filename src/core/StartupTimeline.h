@@ -0,0 +1,37 @@
+#pragma once
+#include <QJsonObject>
+#include <QString>
+
+// Named moments of application startup, in ms since main() began.
+//
+//   main -> application -> window -> shown -> first paint
+//        -> (deferred: sidebar, session, theme) -> interactive
+//
+// "first paint" is the first frame of the main window; "interactive" is when
+// the work deferred past it (see MainWindow::startDeferredInit) is done.
+// finish() checks both against a budget and warns when one is exceeded.
+//
+// QT_EDITOR_STARTUP_TIMELINE=1 prints the timeline when startup is done, any
+// other value is taken as a path to write it to as JSON.
+// QT_EDITOR_STARTUP_BUDGET_MS=<first paint>,<interactive> overrides the budget.
+namespace StartupTimeline {
+
+constexpr qint64 kFirstPaintBudgetMs = 250;
+constexpr qint64 kInteractiveBudgetMs = 500;
+
+// Starts the clock; call first thing in main()
+void start();
+
+// Records 'name' at the current time. Only the first mark of a name counts.
+void mark(const QString &name);
+
+// ms of a mark, -1 if it wasn't reached
+qint64 elapsed(const QString &name);
+
+// Marks "interactive", then reports and checks the budget (once)
+void finish();
+bool isFinished();
+
+QJsonObject toJson();
+
+} // namespace StartupTimeline
@@ -0,0 +1,594 @@
+#include "SymbolIndex.h"
+#include "DocumentStructure.h"
+#include "Grammar.h"
+#include "LanguageRegistry.h"
+#include "utils/TextCodec.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QMutex>
+#include <QPointer>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr quint32 kMagic = 0x53594d31;           // "SYM1"
+constexpr quint32 kVersion = 1;
+constexpr qint64 kMaxFileBytes = 4 * 1024 * 1024; // Larger sources are generated or minified
+constexpr int kMaxDetail = 160;                   // Characters of the defining line kept
+constexpr int kFilesPerTask = 16;
+constexpr int kRescanIntervalMs = 5000;           // Re-activations closer together don't rescan
+
+// --- On-disk layout (native byte order; the magic doubles as a check) ---
+struct Header {
+    quint32 magic;
+    quint32 version;
+    quint32 fileCount;
+    quint32 symbolCount;
+    quint32 stringBytes;
+    quint32 reserved;
+};
+
+struct FileRecord {
+    qint64 mtime;
+    qint64 size;
+    quint32 path;       // Offset into the strings
+    quint32 pathLength;
+};
+
+struct SymbolRecord {
+    quint32 name;
+    quint32 detail;
+    quint32 file;       // Index into the file table
+    quint32 line;
+    quint16 nameLength;
+    quint16 detailLength;
+    quint16 column;
+    quint8 kind;
+    quint8 reserved;
+};
+
+static_assert(sizeof(Header) == 24 && sizeof(FileRecord) == 24 && sizeof(SymbolRecord) == 24,
+              "The index layout must not depend on the compiler's padding");
+
+// Pointers into an index image (mapped or read). Null header if it's not one.
+struct IndexView {
+    const Header *header = nullptr;
+    const FileRecord *files = nullptr;
+    const SymbolRecord *symbols = nullptr;
+    const char *strings = nullptr;
+
+    int symbolCount() const { return header ? int(header->symbolCount) : 0; }
+    QByteArrayView name(const SymbolRecord &s) const { return QByteArrayView(strings + s.name, s.nameLength); }
+
+    static IndexView of(const uchar *data, qint64 size) {
+        IndexView view;
+        if (!data || size < qint64(sizeof(Header))) return view;
+        const Header *header = reinterpret_cast<const Header *>(data);
+        if (header->magic != kMagic || header->version != kVersion) return view;
+        if (size != qint64(sizeof(Header)) + qint64(header->fileCount) * qint64(sizeof(FileRecord))
+                        + qint64(header->symbolCount) * qint64(sizeof(SymbolRecord)) + header->stringBytes) {
+            return view;
+        }
+        view.header = header;
+        view.files = reinterpret_cast<const FileRecord *>(header + 1);
+        view.symbols = reinterpret_cast<const SymbolRecord *>(view.files + header->fileCount);
+        view.strings = reinterpret_cast<const char *>(view.symbols + header->symbolCount);
+        return view;
+    }
+
+    // Every offset in bounds; done once per image, not per lookup
+    bool isValid() const {
+        if (!header) return false;
+        const quint64 bytes = header->stringBytes;
+        for (quint32 i = 0; i < header->fileCount; ++i) {
+            if (quint64(files[i].path) + files[i].pathLength > bytes) return false;
+        }
+        for (quint32 i = 0; i < header->symbolCount; ++i) {
+            const SymbolRecord &s = symbols[i];
+            if (s.file >= header->fileCount || quint64(s.name) + s.nameLength > bytes
+                || quint64(s.detail) + s.detailLength > bytes) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+inline uchar fold(char c) {
+    const uchar u = uchar(c);
+    return (u >= 'A' && u <= 'Z') ? u + ('a' - 'A') : u;
+}
+
+// Case-folded (ASCII) order of UTF-8 names, the order of the symbol table
+int compareFolded(QByteArrayView a, QByteArrayView b) {
+    const qsizetype n = qMin(a.size(), b.size());
+    for (qsizetype i = 0; i < n; ++i) {
+        const uchar x = fold(a[i]);
+        const uchar y = fold(b[i]);
+        if (x != y) return x < y ? -1 : 1;
+    }
+    return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+}
+
+bool startsWithFolded(QByteArrayView s, QByteArrayView prefix) {
+    return s.size() >= prefix.size() && compareFolded(s.first(prefix.size()), prefix) == 0;
+}
+
+bool containsFolded(QByteArrayView s, QByteArrayView needle) {
+    for (qsizetype at = 0; at + needle.size() <= s.size(); ++at) {
+        if (compareFolded(s.sliced(at, needle.size()), needle) == 0) return true;
+    }
+    return false;
+}
+
+SymbolIndex::Kind kindFor(const QString &outlineKind) {
+    if (outlineKind == QLatin1String("class")) return SymbolIndex::Class;
+    if (outlineKind == QLatin1String("struct")) return SymbolIndex::Struct;
+    if (outlineKind == QLatin1String("union")) return SymbolIndex::Union;
+    if (outlineKind == QLatin1String("enum")) return SymbolIndex::Enum;
+    if (outlineKind == QLatin1String("namespace")) return SymbolIndex::Namespace;
+    if (outlineKind == QLatin1String("function")) return SymbolIndex::Function;
+    return SymbolIndex::Other;
+}
+
+// "Worker::run" is found as "run"
+bool makeSymbol(const QString &outlineName, SymbolIndex::Kind kind, int line, int column,
+                const QString &text, SymbolIndex::Symbol *symbol) {
+    const int qualifier = outlineName.lastIndexOf(QLatin1String("::"));
+    symbol->name = qualifier >= 0 ? outlineName.mid(qualifier + 2) : outlineName;
+    if (symbol->name.isEmpty()) return false;
+    symbol->kind = kind;
+    symbol->line = line;
+    symbol->column = column + (qualifier >= 0 ? qualifier + 2 : 0);
+    symbol->detail = text.trimmed().left(kMaxDetail);
+    return true;
+}
+
+// Not walked: hidden directories (VCS, tool state), dependencies and build trees
+bool skipDirectory(const QFileInfo &info) {
+    const QString name = info.fileName();
+    if (name.startsWith(QLatin1Char('.')) || name == QLatin1String("node_modules")) return true;
+    return QFileInfo::exists(info.absoluteFilePath() + QLatin1String("/CMakeCache.txt"));
+}
+
+} // namespace
+
+// =========================================================
+// Extraction
+// =========================================================
+
+QVector<SymbolIndex::Symbol> SymbolIndex::extract(const QString &text, const Grammar *grammar) {
+    QVector<Symbol> symbols;
+    if (!grammar || !grammar->hasOutline()) return symbols;
+
+    const QStringList lines = text.split(QLatin1Char('\n'));
+    const QStringList &scopes = grammar->scopeNames();
+    Grammar::LexState state;
+    QVector<Grammar::Token> tokens;
+
+    // A definition whose '{' may be the first thing on the next line
+    Symbol pending;
+    bool hasPending = false;
+
+    for (int i = 0; i < lines.size(); ++i) {
+        const QString &line = lines.at(i);
+        state = grammar->tokenize(line, state, &tokens);
+
+        // #define NAME ...
+        if (!tokens.isEmpty() && scopes.value(tokens.first().scope) == QLatin1String("keyword.preprocessor")) {
+            const Grammar::Token &directive = tokens.first();
+            if (line.mid(directive.start, directive.length).endsWith(QLatin1String("define"))) {
+                int p = directive.start + directive.length;
+                while (p < line.size() && line.at(p).isSpace()) ++p;
+                const int nameStart = p;
+                while (p < line.size() && (line.at(p).isLetterOrNumber() || line.at(p) == QLatin1Char('_'))) ++p;
+                Symbol symbol;
+                if (p > nameStart && makeSymbol(line.mid(nameStart, p - nameStart), Macro, i, nameStart, line, &symbol)) {
+                    symbols.append(symbol);
+                }
+            }
+            hasPending = false;
+            continue;
+        }
+
+        // Same detection as the outline of an open document
+        const BlockSummary summary = DocumentStructure::summarize(line, tokens, grammar);
+        if (hasPending && line.trimmed().startsWith(QLatin1Char('{'))) {
+            symbols.append(pending);
+        }
+        hasPending = false;
+        if (summary.outlineKind.isEmpty()) continue;
+
+        Symbol symbol;
+        if (!makeSymbol(summary.outlineName, kindFor(summary.outlineKind), i, summary.outlineColumn, line, &symbol)) {
+            continue;
+        }
+        bool confirmed = !summary.outlineNeedsBrace;
+        for (const BlockSummary::Bracket &bracket : summary.brackets) {
+            if (bracket.ch == QLatin1Char('{') && bracket.column > summary.outlineColumn) confirmed = true;
+        }
+        if (confirmed) {
+            symbols.append(symbol);
+        } else {
+            pending = symbol;
+            hasPending = true;
+        }
+    }
+    return symbols;
+}
+
+// =========================================================
+// Building (workers)
+// =========================================================
+
+QString SymbolIndex::indexPathFor(const QString &rootPath) {
+    const QByteArray key = QCryptographicHash::hash(rootPath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+           + "/symbols/" + QString::fromLatin1(key) + ".idx";
+}
+
+std::shared_ptr<const SymbolIndex::Model> SymbolIndex::run(const Job &job) {
+    Model model = job.previous ? *job.previous : readModel(job.indexPath);
+
+    auto grammarFor = [&job](const QString &path) -> const Grammar * {
+        const Grammar *grammar = job.grammars.value(QFileInfo(path).suffix().toLower());
+        return grammar && grammar->hasOutline() ? grammar : nullptr;
+    };
+
+    QStringList toRead;
+    if (job.files.isEmpty()) {
+        // --- Rescan: stat everything, read only what changed ---
+        QSet<QString> seen;
+        QStringList dirs{job.root};
+        while (!dirs.isEmpty()) {
+            if (*job.cancel) return nullptr;
+            const QDir dir(dirs.takeLast());
+            const QFileInfoList entries = dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+            for (const QFileInfo &info : entries) {
+                if (info.isDir()) {
+                    if (!skipDirectory(info)) dirs.append(info.absoluteFilePath());
+                    continue;
+                }
+                if (info.size() > kMaxFileBytes || !grammarFor(info.fileName())) continue;
+
+                const QString path = info.absoluteFilePath();
+                seen.insert(path);
+                auto it = model.constFind(path);
+                if (it == model.constEnd() || it->size != info.size()
+                    || it->mtime != info.lastModified().toMSecsSinceEpoch()) {
+                    toRead << path;
+                }
+            }
+        }
+        for (auto it = model.begin(); it != model.end();) {
+            if (seen.contains(it.key())) ++it;
+            else it = model.erase(it); // Deleted, or no longer indexable
+        }
+    } else {
+        // --- Single files ---
+        for (const QString &filePath : job.files) {
+            const QFileInfo info(filePath);
+            const QString path = info.absoluteFilePath();
+            if (info.isFile() && info.size() <= kMaxFileBytes && grammarFor(path) && path.startsWith(job.root + '/')) {
+                toRead << path;
+            } else {
+                model.remove(path);
+            }
+        }
+    }
+
+    // --- Read and lex, on every core ---
+    QMutex mutex;
+    QThreadPool pool;
+    for (int from = 0; from < toRead.size(); from += kFilesPerTask) {
+        const QStringList chunk = toRead.mid(from, kFilesPerTask);
+        pool.start([&job, &model, &mutex, &grammarFor, chunk]() {
+            Model local;
+            for (const QString &path : chunk) {
+                if (*job.cancel) return;
+                QFile file(path);
+                if (!file.open(QIODevice::ReadOnly)) continue;
+
+                FileSymbols entry;
+                entry.mtime = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+                entry.size = file.size();
+                TextCodec::Format format;
+                entry.symbols = extract(TextCodec::decode(file.readAll(), &format), grammarFor(path));
+                local.insert(path, entry);
+            }
+            QMutexLocker lock(&mutex);
+            for (auto it = local.constBegin(); it != local.constEnd(); ++it) model.insert(it.key(), it.value());
+        });
+    }
+    pool.waitForDone();
+    if (*job.cancel) return nullptr;
+
+    if (!writeIndex(job.indexPath, model)) qWarning() << "SymbolIndex: could not write" << job.indexPath;
+    return std::make_shared<const Model>(std::move(model));
+}
+
+SymbolIndex::Model SymbolIndex::readModel(const QString &indexPath) {
+    QFile file(indexPath);
+    if (!file.open(QIODevice::ReadOnly)) return Model();
+    return parseIndex(file.readAll());
+}
+
+SymbolIndex::Model SymbolIndex::parseIndex(const QByteArray &data) {
+    Model model;
+    const IndexView view = IndexView::of(reinterpret_cast<const uchar *>(data.constData()), data.size());
+    if (!view.isValid()) return model;
+
+    QVector<QString> paths(view.header->fileCount);
+    for (quint32 i = 0; i < view.header->fileCount; ++i) {
+        const FileRecord &record = view.files[i];
+        paths[i] = QString::fromUtf8(view.strings + record.path, record.pathLength);
+        FileSymbols &entry = model[paths[i]];
+        entry.mtime = record.mtime;
+        entry.size = record.size;
+    }
+    for (quint32 i = 0; i < view.header->symbolCount; ++i) {
+        const SymbolRecord &record = view.symbols[i];
+        Symbol symbol;
+        symbol.name = QString::fromUtf8(view.strings + record.name, record.nameLength);
+        symbol.kind = Kind(record.kind);
+        symbol.line = int(record.line);
+        symbol.column = record.column;
+        symbol.detail = QString::fromUtf8(view.strings + record.detail, record.detailLength);
+        model[paths[record.file]].symbols.append(symbol);
+    }
+    return model;
+}
+
+bool SymbolIndex::writeIndex(const QString &indexPath, const Model &model) {
+    QByteArray strings;
+    QVector<FileRecord> files;
+    QVector<SymbolRecord> symbols;
+    auto addString = [&strings](const QByteArray &text, quint32 *offset, quint16 *length) {
+        const QByteArray clipped = text.left(0xffff);
+        *offset = quint32(strings.size());
+        *length = quint16(clipped.size());
+        strings += clipped;
+    };
+
+    for (auto it = model.constBegin(); it != model.constEnd(); ++it) {
+        const QByteArray path = it.key().toUtf8();
+        files.append(FileRecord{it->mtime, it->size, quint32(strings.size()), quint32(path.size())});
+        strings += path;
+
+        for (const Symbol &symbol : it->symbols) {
+            SymbolRecord record{};
+            addString(symbol.name.toUtf8(), &record.name, &record.nameLength);
+            addString(symbol.detail.toUtf8(), &record.detail, &record.detailLength);
+            record.file = quint32(files.size() - 1);
+            record.line = quint32(symbol.line);
+            record.column = quint16(qMin(symbol.column, 0xffff));
+            record.kind = symbol.kind;
+            symbols.append(record);
+        }
+    }
+
+    // The lookup order: folded name, exact name, then file and line
+    const char *base = strings.constData();
+    std::sort(symbols.begin(), symbols.end(), [base](const SymbolRecord &a, const SymbolRecord &b) {
+        const QByteArrayView x(base + a.name, a.nameLength);
+        const QByteArrayView y(base + b.name, b.nameLength);
+        if (int c = compareFolded(x, y)) return c < 0;
+        if (int c = x.compare(y)) return c < 0;
+        if (a.file != b.file) return a.file < b.file;
+        return a.line < b.line;
+    });
+
+    const Header header{kMagic, kVersion, quint32(files.size()), quint32(symbols.size()), quint32(strings.size()), 0};
+
+    QDir().mkpath(QFileInfo(indexPath).absolutePath());
+    QSaveFile file(indexPath);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(files.constData()), files.size() * qsizetype(sizeof(FileRecord)));
+    file.write(reinterpret_cast<const char *>(symbols.constData()), symbols.size() * qsizetype(sizeof(SymbolRecord)));
+    file.write(strings);
+    return file.commit();
+}
+
+// =========================================================
+// SymbolIndex (GUI thread)
+// =========================================================
+
+SymbolIndex *SymbolIndex::instance() {
+    static SymbolIndex index;
+    return &index;
+}
+
+SymbolIndex::SymbolIndex() {
+    // Catch what changed while the user was elsewhere (a checkout, another editor)
+    if (auto *app = qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
+        connect(app, &QGuiApplication::applicationStateChanged, this, [this](Qt::ApplicationState state) {
+            if (state == Qt::ApplicationActive) queueRescan();
+        });
+    }
+}
+
+SymbolIndex::~SymbolIndex() {
+    if (m_cancel) *m_cancel = true;
+    unmapIndex();
+}
+
+const char *SymbolIndex::kindName(Kind kind) {
+    switch (kind) {
+    case Class: return "class";
+    case Struct: return "struct";
+    case Union: return "union";
+    case Enum: return "enum";
+    case Namespace: return "namespace";
+    case Function: return "function";
+    case Macro: return "macro";
+    case Other: break;
+    }
+    return "symbol";
+}
+
+void SymbolIndex::setRoot(const QString &rootPath) {
+    const QString root = QDir(rootPath).absolutePath();
+    if (root == m_root) return;
+
+    // Work for the old root is moot
+    if (m_cancel) *m_cancel = true;
+    ++m_generation;
+    m_running = false;
+    m_model.reset();
+    m_queuedFiles.clear();
+
+    m_root = root;
+    if (mapIndex()) emit indexChanged(); // Last run's index, until the rescan is done
+    m_rescanQueued = true;
+    startJob();
+}
+
+void SymbolIndex::updateFile(const QString &filePath) {
+    if (m_root.isEmpty()) return;
+    if (!m_queuedFiles.contains(filePath)) m_queuedFiles << filePath;
+    startJob();
+}
+
+void SymbolIndex::queueRescan() {
+    if (m_root.isEmpty() || (m_lastRescan.isValid() && m_lastRescan.elapsed() < kRescanIntervalMs)) return;
+    m_rescanQueued = true;
+    startJob();
+}
+
+void SymbolIndex::startJob() {
+    if (m_running || m_root.isEmpty() || (!m_rescanQueued && m_queuedFiles.isEmpty())) return;
+
+    Job job;
+    job.root = m_root;
+    job.indexPath = indexPathFor(m_root);
+    if (m_rescanQueued) m_lastRescan.start();
+    else job.files = m_queuedFiles; // A rescan picks those up too (by mtime)
+    m_rescanQueued = false;
+    m_queuedFiles.clear();
+    job.previous = m_model;
+    job.grammars = LanguageRegistry::instance()->grammarsBySuffix();
+    m_cancel = std::make_shared<std::atomic<bool>>(false);
+    job.cancel = m_cancel;
+    m_running = true;
+
+    const int generation = m_generation;
+    QPointer<SymbolIndex> guard(this);
+    QThreadPool::globalInstance()->start([job, generation, guard]() {
+        std::shared_ptr<const Model> model = run(job);
+        QMetaObject::invokeMethod(qApp, [guard, generation, model]() {
+            if (guard && generation == guard->m_generation) guard->onJobDone(model);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SymbolIndex::onJobDone(const std::shared_ptr<const Model> &model) {
+    m_running = false;
+    if (model) {
+        m_model = model;
+        mapIndex();
+        emit indexChanged();
+    }
+    startJob(); // What was queued meanwhile
+}
+
+bool SymbolIndex::mapIndex() {
+    unmapIndex();
+    m_file.setFileName(indexPathFor(m_root));
+    if (!m_file.open(QIODevice::ReadOnly)) return false;
+
+    // The file is replaced (not rewritten) by every update, so this mapping
+    // stays intact until the next swap
+    m_mapSize = m_file.size();
+    m_map = m_mapSize > 0 ? m_file.map(0, m_mapSize) : nullptr;
+    if (!IndexView::of(m_map, m_mapSize).isValid()) {
+        qWarning() << "SymbolIndex: ignoring invalid index" << m_file.fileName();
+        unmapIndex();
+        return false;
+    }
+    return true;
+}
+
+void SymbolIndex::unmapIndex() {
+    if (m_map) m_file.unmap(m_map);
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_file.close();
+}
+
+// ---------------------------------
+// Lookups
+// ---------------------------------
+
+int SymbolIndex::symbolCount() const {
+    return IndexView::of(m_map, m_mapSize).symbolCount();
+}
+
+int SymbolIndex::fileCount() const {
+    const IndexView view = IndexView::of(m_map, m_mapSize);
+    return view.header ? int(view.header->fileCount) : 0;
+}
+
+SymbolIndex::Symbol SymbolIndex::symbolAt(int index) const {
+    const IndexView view = IndexView::of(m_map, m_mapSize);
+    const SymbolRecord &record = view.symbols[index];
+    const FileRecord &file = view.files[record.file];
+
+    Symbol symbol;
+    symbol.name = QString::fromUtf8(view.strings + record.name, record.nameLength);
+    symbol.kind = Kind(record.kind);
+    symbol.filePath = QString::fromUtf8(view.strings + file.path, file.pathLength);
+    symbol.line = int(record.line);
+    symbol.column = record.column;
+    symbol.detail = QString::fromUtf8(view.strings + record.detail, record.detailLength);
+    return symbol;
+}
+
+QVector<SymbolIndex::Symbol> SymbolIndex::definitions(const QString &name) const {
+    QVector<Symbol> result;
+    const IndexView view = IndexView::of(m_map, m_mapSize);
+    const QByteArray key = name.toUtf8();
+    if (!view.header || key.isEmpty()) return result;
+
+    const SymbolRecord *end = view.symbols + view.symbolCount();
+    const SymbolRecord *it = std::lower_bound(view.symbols, end, key, [&view](const SymbolRecord &s, const QByteArray &k) {
+        return compareFolded(view.name(s), k) < 0;
+    });
+    for (; it != end && compareFolded(view.name(*it), key) == 0; ++it) {
+        if (view.name(*it).compare(key) == 0) result.append(symbolAt(int(it - view.symbols)));
+    }
+    return result;
+}
+
+QVector<SymbolIndex::Symbol> SymbolIndex::search(const QString &query, int limit) const {
+    QVector<Symbol> result;
+    const IndexView view = IndexView::of(m_map, m_mapSize);
+    const QByteArray key = query.trimmed().toUtf8();
+    if (!view.header || key.isEmpty()) return result;
+
+    // Prefix matches are one contiguous run of the sorted table
+    const SymbolRecord *end = view.symbols + view.symbolCount();
+    const SymbolRecord *it = std::lower_bound(view.symbols, end, key, [&view](const SymbolRecord &s, const QByteArray &k) {
+        return compareFolded(view.name(s), k) < 0;
+    });
+    for (; it != end && result.size() < limit && startsWithFolded(view.name(*it), key); ++it) {
+        result.append(symbolAt(int(it - view.symbols)));
+    }
+
+    // Then the rest that contain it, in name order: one pass over the names
+    for (int i = 0; i < view.symbolCount() && result.size() < limit; ++i) {
+        const QByteArrayView name = view.name(view.symbols[i]);
+        if (!startsWithFolded(name, key) && containsFolded(name, key)) result.append(symbolAt(i));
+    }
+    return result;
+}
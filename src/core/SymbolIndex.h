@@ -0,0 +1,127 @@
+#pragma once
+#include <QObject>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+class Grammar;
+
+// Definitions (classes, structs, enums, namespaces, functions, macros) of
+// every source file under the project root, for hover info, go to
+// definition and workspace symbol search.
+//
+// Symbols are found with the same grammar-driven outline detection the
+// editor uses for the open document (DocumentStructure::summarize), plus
+// #define lines. Files are read and lexed on a private thread pool, all cores
+// at once.
+//
+// The result is written to one flat file in the cache directory: a header, a
+// file table, a table of fixed-size symbol records sorted by case-folded name,
+// and a UTF-8 string blob. That file is memory-mapped and queried in place by
+// binary search, so lookups take microseconds and the index of the last run is
+// usable the moment the project is opened, before anything was re-read.
+//
+// Updates are incremental. A rescan (on setRoot() and whenever the app is
+// re-activated) only stats the files and lexes the ones whose mtime or size
+// changed; updateFile() redoes a single file (after a save or reload). Each
+// update writes a new file and swaps the mapping.
+class SymbolIndex : public QObject {
+    Q_OBJECT
+
+public:
+    enum Kind : quint8 { Class, Struct, Union, Enum, Namespace, Function, Macro, Other };
+
+    struct Symbol {
+        QString name;       // Unqualified ("run", not "Worker::run")
+        Kind kind = Other;
+        QString filePath;
+        int line = 0;       // 0-based
+        int column = 0;
+        QString detail;     // The defining line, trimmed
+    };
+
+    // One file's definitions, as extracted (also the unit of incremental updates)
+    struct FileSymbols {
+        qint64 mtime = 0;
+        qint64 size = -1;
+        QVector<Symbol> symbols; // filePath left empty
+    };
+
+    static SymbolIndex *instance();
+    ~SymbolIndex();
+
+    static const char *kindName(Kind kind);
+
+    // Indexes the project under 'rootPath' in the background. The index saved
+    // for that root by the last run is mapped first.
+    void setRoot(const QString &rootPath);
+    QString root() const { return m_root; }
+
+    // Re-reads one file (or drops it, if it's gone)
+    void updateFile(const QString &filePath);
+
+    bool isIndexing() const { return m_running; }
+    int symbolCount() const;
+    int fileCount() const;
+
+    // --- Lookups, on the mapped index ---
+    // Definitions named exactly 'name'
+    QVector<Symbol> definitions(const QString &name) const;
+    // Case-insensitive: names starting with 'query' first, then names containing it
+    QVector<Symbol> search(const QString &query, int limit = 100) const;
+
+    // Definitions in one file's text. Thread-safe.
+    static QVector<Symbol> extract(const QString &text, const Grammar *grammar);
+
+    using Model = QHash<QString, FileSymbols>; // Path -> definitions
+
+    // The definitions stored in an index image (the cache file's contents).
+    // Empty if it isn't a valid index. Thread-safe.
+    static Model parseIndex(const QByteArray &data);
+
+signals:
+    // A new index is mapped
+    void indexChanged();
+
+private:
+    struct Job {
+        QString root;
+        QString indexPath;
+        QStringList files;  // Empty: rescan the whole tree
+        std::shared_ptr<const Model> previous;
+        QHash<QString, const Grammar *> grammars;
+        std::shared_ptr<std::atomic<bool>> cancel;
+    };
+
+    SymbolIndex();
+    static QString indexPathFor(const QString &rootPath);
+    static std::shared_ptr<const Model> run(const Job &job);
+    static Model readModel(const QString &indexPath);
+    static bool writeIndex(const QString &indexPath, const Model &model);
+
+    void startJob();
+    void onJobDone(const std::shared_ptr<const Model> &model);
+    void queueRescan();
+    bool mapIndex();
+    void unmapIndex();
+    Symbol symbolAt(int index) const;
+
+    QString m_root;
+    std::shared_ptr<const Model> m_model; // Null until the first run finished
+    int m_generation = 0;                 // Bumped by setRoot(); older jobs are ignored
+    bool m_running = false;
+    bool m_rescanQueued = false;
+    QStringList m_queuedFiles;
+    std::shared_ptr<std::atomic<bool>> m_cancel;
+    QElapsedTimer m_lastRescan;
+
+    // The mapped index
+    QFile m_file;
+    uchar *m_map = nullptr;
+    qint64 m_mapSize = 0;
+};
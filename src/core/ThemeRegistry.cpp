@@ -0,0 +1,265 @@
+#include "ThemeRegistry.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QThreadPool>
+#include <QDebug>
+
+// =========================================================
+// Theme
+// =========================================================
+
+QTextCharFormat Theme::format(const QString &scope) const {
+    // "keyword.control.flow" -> "keyword.control" -> "keyword"
+    QString key = scope;
+    while (!key.isEmpty()) {
+        auto it = formats.constFind(key);
+        if (it != formats.constEnd()) return it.value();
+
+        int dot = key.lastIndexOf('.');
+        if (dot < 0) break;
+        key.truncate(dot);
+    }
+    return formats.value("foreground");
+}
+
+// =========================================================
+// ThemeRegistry
+// =========================================================
+
+ThemeRegistry *ThemeRegistry::instance() {
+    // Parented to the application so it goes away before QGuiApplication does
+    static ThemeRegistry *registry = new ThemeRegistry();
+    return registry;
+}
+
+ThemeRegistry::ThemeRegistry() : QObject(QCoreApplication::instance()) {
+    discoverThemes();
+
+    // dracula.json has always been the default; keep it that way when present,
+    // otherwise take the first theme by name so the choice is stable
+    m_currentName = m_paths.contains("dracula") ? QString("dracula")
+                  : (m_paths.isEmpty() ? QString("default") : m_paths.firstKey());
+}
+
+ThemeRegistry::~ThemeRegistry() {
+    qDeleteAll(m_themes);
+}
+
+// Themes live next to the executable or in the working directory, either as
+// the historic top-level dracula.json or as any *.json file under themes/.
+void ThemeRegistry::discoverThemes() {
+    QStringList roots;
+    roots << QDir::currentPath() << QCoreApplication::applicationDirPath();
+
+    for (const QString &root : roots) {
+        QFileInfo legacy(root + "/dracula.json");
+        if (legacy.isFile() && !m_paths.contains("dracula")) {
+            m_paths.insert("dracula", legacy.absoluteFilePath());
+        }
+
+        QDir themeDir(root + "/themes");
+        const QFileInfoList files = themeDir.entryInfoList(QStringList() << "*.json", QDir::Files);
+        for (const QFileInfo &info : files) {
+            if (!m_paths.contains(info.baseName())) {
+                m_paths.insert(info.baseName(), info.absoluteFilePath());
+            }
+        }
+    }
+}
+
+const Theme *ThemeRegistry::theme(const QString &name) {
+    if (Theme *loaded = m_themes.value(name)) return loaded;
+
+    Theme *theme = loadTheme(name, m_paths.value(name));
+    m_themes.insert(name, theme);
+    emit themeLoaded(theme);
+    return theme;
+}
+
+const Theme *ThemeRegistry::currentTheme() {
+    return theme(m_currentName);
+}
+
+void ThemeRegistry::setCurrentTheme(const QString &name) {
+    if (name == m_currentName || !m_paths.contains(name)) return;
+
+    m_currentName = name;
+    emit currentThemeChanged(currentTheme());
+}
+
+void ThemeRegistry::preloadCurrentTheme() {
+    const QString name = m_currentName;
+    if (Theme *loaded = m_themes.value(name)) {
+        emit themeLoaded(loaded);
+        return;
+    }
+
+    // Only the file I/O and JSON parsing run on the worker; the formats and
+    // palette are built back on the GUI thread
+    const QString path = m_paths.value(name);
+    QPointer<ThemeRegistry> guard(this);
+    QThreadPool::globalInstance()->start([name, path, guard]() {
+        QJsonObject obj = readThemeFile(path);
+        QMetaObject::invokeMethod(qApp, [guard, name, obj]() {
+            if (!guard) return;
+            Theme *theme = guard->m_themes.value(name);
+            if (!theme) {
+                // Nobody needed it synchronously in the meantime
+                theme = guard->buildTheme(name, obj);
+                guard->m_themes.insert(name, theme);
+            }
+            emit guard->themeLoaded(theme);
+        }, Qt::QueuedConnection);
+    });
+}
+
+Theme *ThemeRegistry::loadTheme(const QString &name, const QString &path) {
+    return buildTheme(name, readThemeFile(path));
+}
+
+// Parses one theme file. The file is mapped instead of read into a buffer;
+// the mapping only lives for the duration of the parse. Thread-safe.
+QJsonObject ThemeRegistry::readThemeFile(const QString &path) {
+    QJsonObject obj;
+    QFile file(path);
+    if (!path.isEmpty() && file.open(QIODevice::ReadOnly)) {
+        qint64 size = file.size();
+        uchar *data = file.map(0, size);
+        if (data) {
+            obj = QJsonDocument::fromJson(QByteArray::fromRawData(reinterpret_cast<const char *>(data), size)).object();
+            file.unmap(data);
+        } else {
+            obj = QJsonDocument::fromJson(file.readAll()).object();
+        }
+    } else if (!path.isEmpty()) {
+        qWarning() << "ThemeRegistry: could not open" << path;
+    }
+    return obj;
+}
+
+Theme *ThemeRegistry::buildTheme(const QString &name, const QJsonObject &obj) {
+    Theme *theme = new Theme;
+    theme->name = name;
+    theme->id = m_nextId++;
+
+    // Top-level string values are the base palette
+    for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+        if (it.value().isString()) {
+            QColor c(it.value().toString());
+            if (c.isValid()) theme->colors.insert(it.key(), c);
+        }
+    }
+
+    // If the theme can't be loaded, use simple black-on-white defaults.
+    if (!theme->colors.contains("background")) theme->colors.insert("background", Qt::white);
+    if (!theme->colors.contains("foreground")) theme->colors.insert("foreground", Qt::black);
+    if (!theme->colors.contains("comment")) theme->colors.insert("comment", Qt::gray);
+
+    // --- Token formats ---
+    QColor fg = theme->colors.value("foreground");
+    QTextCharFormat plain;
+    plain.setForeground(fg);
+    theme->formats.insert("foreground", plain);
+
+    // Every palette entry doubles as a token scope; keywords are bold by default
+    for (auto it = theme->colors.constBegin(); it != theme->colors.constEnd(); ++it) {
+        if (it.key() == "background") continue;
+        QTextCharFormat fmt;
+        fmt.setForeground(it.value());
+        if (it.key() == "keyword") fmt.setFontWeight(QFont::Bold);
+        theme->formats.insert(it.key(), fmt);
+    }
+
+    // Optional "tokens" section for finer scopes:
+    //   "tokens": { "keyword.control": { "color": "#ff79c6", "bold": true, "italic": false },
+    //               "number": "#bd93f9" }
+    QJsonObject tokens = obj.value("tokens").toObject();
+    for (auto it = tokens.constBegin(); it != tokens.constEnd(); ++it) {
+        QTextCharFormat fmt;
+        if (it.value().isString()) {
+            fmt.setForeground(QColor(it.value().toString()));
+        } else {
+            QJsonObject spec = it.value().toObject();
+            fmt.setForeground(QColor(spec.value("color").toString(fg.name())));
+            if (spec.value("bold").toBool()) fmt.setFontWeight(QFont::Bold);
+            if (spec.value("italic").toBool()) fmt.setFontItalic(true);
+            if (spec.value("underline").toBool()) fmt.setFontUnderline(true);
+        }
+        theme->formats.insert(it.key(), fmt);
+    }
+
+    buildDerivedData(theme);
+    return theme;
+}
+
+// Everything the widgets used to rebuild in their setTheme() calls.
+void ThemeRegistry::buildDerivedData(Theme *theme) {
+    QColor baseBg = theme->colors.value("background");
+    QColor fgColor = theme->colors.value("foreground");
+    QString fg = fgColor.name();
+    QString comment = theme->colors.value("comment").name(); // Used for borders and accents
+
+    // Code editors take a palette instead of a style sheet: no CSS parsing per tab
+    QPalette pal;
+    pal.setColor(QPalette::Base, baseBg);
+    pal.setColor(QPalette::Window, baseBg);
+    pal.setColor(QPalette::Text, fgColor);
+    pal.setColor(QPalette::WindowText, fgColor);
+    theme->editorPalette = pal;
+
+    theme->tooltipStyleSheet = QString(R"(
+        CommonTooltip {
+            background-color: %1;
+            border: 1px solid %3;
+            border-radius: 4px;
+        }
+        QLabel {
+            color: %2;
+            font-family: Consolas, "Courier New", monospace;
+            font-size: 12px;
+            padding: 4px;
+        }
+        QPushButton {
+            background: transparent;
+            color: %3; /* Use border color for the X initially */
+            border: none;
+            font-weight: bold;
+            border-radius: 2px;
+        }
+        QPushButton:hover {
+            background-color: #c51b25;
+            color: white;
+        }
+    )").arg(baseBg.name(), fg, comment);
+
+    // A slightly darker frame around the centered rich-text page
+    theme->richPageStyleSheet = QString("QWidget { background-color: %1; }")
+                                .arg(baseBg.darker(115).name());
+
+    theme->richEditorStyleSheet = QString("QTextEdit { background-color: %1; color: %2; border: none; }")
+                                  .arg(baseBg.name(), fg);
+
+    theme->richToolbarStyleSheet = QString(
+        "QToolBar { background: %1; border-bottom: 1px solid %3; spacing: 5px; padding: 3px; }"
+        "QToolButton { "
+            "color: %2; "
+            "background: transparent; "
+            "padding: 4px; "
+            "border-radius: 4px; "
+            "border: 1px solid transparent; " // Reserve space for the border
+            "min-width: 28px; "
+            "min-height: 28px; "
+        "}"
+        "QToolButton:hover { background: %3; }" // Use accent color for hover.
+        "QToolButton:checked { background: %3; border-color: %2; }" // Change border color, not size
+        "QComboBox { color: %2; background-color: %1; border: 1px solid %3; padding: 4px; }"
+        "QComboBox::drop-down { border: none; }"
+        "QComboBox QAbstractItemView { background-color: %1; color: %2; border: 1px solid %3; }"
+    ).arg(baseBg.name(), fg, comment);
+}
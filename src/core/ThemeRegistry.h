@@ -0,0 +1,77 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QColor>
+#include <QPalette>
+#include <QStringList>
+#include <QTextCharFormat>
+
+// A fully prepared color theme. Themes are built once by ThemeRegistry and
+// never modified afterwards, so every editor can share the same instance
+// (QTextCharFormat and QPalette are implicitly shared, copies are free).
+struct Theme {
+    QString name;
+    int id = 0; // Unique per loaded theme, cheap "did it change?" check
+
+    // Raw colors from the JSON file ("background", "keyword", ...)
+    QHash<QString, QColor> colors;
+
+    // Token scope -> character format. Scopes are dotted ("keyword.control");
+    // format() falls back to the parent scope, then to the plain foreground.
+    QHash<QString, QTextCharFormat> formats;
+
+    // Precomputed widget styling so switching themes never rebuilds it per tab
+    QPalette editorPalette;
+    QString tooltipStyleSheet;
+    QString richPageStyleSheet;
+    QString richEditorStyleSheet;
+    QString richToolbarStyleSheet;
+
+    QColor color(const QString &key, const QColor &fallback = QColor()) const {
+        return colors.value(key, fallback);
+    }
+    QTextCharFormat format(const QString &scope) const;
+};
+
+// Process-wide theme cache. Each theme file is read (memory-mapped) and parsed
+// exactly once; all editors receive the same const Theme pointer and are told
+// through currentThemeChanged() when the user switches.
+class ThemeRegistry : public QObject {
+    Q_OBJECT
+
+public:
+    static ThemeRegistry *instance();
+    ~ThemeRegistry();
+
+    // Names of every theme found on disk, sorted (loaded lazily on first use)
+    QStringList themeNames() const { return m_paths.keys(); }
+
+    const Theme *theme(const QString &name);
+    const Theme *currentTheme();
+    QString currentThemeName() const { return m_currentName; }
+
+    void setCurrentTheme(const QString &name);
+
+    // Reads and parses the current theme's file on a worker, so startup
+    // doesn't wait for it. themeLoaded() follows once it is ready (at once if
+    // it already is). Asking for the theme before that just loads it in place.
+    void preloadCurrentTheme();
+
+signals:
+    void currentThemeChanged(const Theme *theme);
+    void themeLoaded(const Theme *theme);
+
+private:
+    ThemeRegistry();
+    void discoverThemes();
+    Theme *loadTheme(const QString &name, const QString &path);
+    Theme *buildTheme(const QString &name, const QJsonObject &obj);
+    static QJsonObject readThemeFile(const QString &path);
+    static void buildDerivedData(Theme *theme);
+
+    QMap<QString, QString> m_paths; // Theme name -> JSON file, sorted by name
+    QHash<QString, Theme *> m_themes; // Loaded themes (owned)
+    QString m_currentName;
+    int m_nextId = 1;
+};
@@ -0,0 +1,345 @@
+#include "UndoHistory.h"
+#include "DocumentMirror.h"
+#include "MemoryAccounting.h"
+
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTemporaryFile>
+#include <QSaveFile>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDebug>
+
+namespace {
+
+constexpr quint32 kMagic = 0x554e4431;   // "UND1"
+constexpr quint32 kVersion = 1;
+constexpr int kCoalesceMs = 2000;        // A pause longer than this starts a new step
+constexpr int kMaxSavedSteps = 10000;    // Bounds the size of a saved history
+
+bool isLineBreak(QChar ch) {
+    return ch == QChar::ParagraphSeparator || ch == QLatin1Char('\n');
+}
+
+} // namespace
+
+// =========================================================
+// UndoHistory
+// =========================================================
+
+UndoHistory::UndoHistory(QTextDocument *document)
+    : QObject(document), m_document(document)
+{
+    // Two undo stacks would both grow; ours replaces Qt's
+    m_document->setUndoRedoEnabled(false);
+
+    m_mirror = DocumentMirror::forDocument(m_document);
+    m_lastEdit.start();
+
+    connect(m_mirror, &DocumentMirror::changed, this, &UndoHistory::onChanged);
+    connect(m_mirror, &DocumentMirror::resynced, this, &UndoHistory::onResynced);
+}
+
+qint64 UndoHistory::costOf(const Delta &delta) {
+    // Characters plus a rough per-step overhead (two QString headers, the struct)
+    return (delta.removed.size() + delta.inserted.size()) * qint64(sizeof(QChar)) + 64;
+}
+
+QByteArray UndoHistory::contentHash() const {
+    const QString &text = m_mirror->text();
+    return QCryptographicHash::hash(
+        QByteArray::fromRawData(reinterpret_cast<const char *>(text.constData()),
+                                text.size() * qsizetype(sizeof(QChar))),
+        QCryptographicHash::Sha1);
+}
+
+void UndoHistory::emitAvailability() {
+    emit undoAvailable(canUndo());
+    emit redoAvailable(canRedo());
+}
+
+// ---------------------------------
+// Recording
+// ---------------------------------
+
+void UndoHistory::onChanged(int position, const QString &removed, const QString &inserted) {
+    if (m_applying) return;
+
+    MemoryAccounting::Scope scope(MemoryAccounting::Undo);
+    Delta delta;
+    delta.position = position;
+    delta.removed = removed;
+    delta.inserted = inserted;
+    push(delta);
+}
+
+void UndoHistory::onResynced() {
+    // A wrong mirror would make every later step wrong
+    qWarning() << "UndoHistory: lost track of the document, history cleared";
+    m_undo.clear();
+    m_redo.clear();
+    m_segments.clear();
+    if (m_spillFile) m_spillFile->resize(0);
+    m_memoryBytes = 0;
+    emitAvailability();
+}
+
+bool UndoHistory::coalesceWith(Delta &last, const Delta &next) const {
+    // Typing: one more character right after the previous ones. A word
+    // started after a space begins a new step, like most editors.
+    if (last.removed.isEmpty() && next.removed.isEmpty() && next.inserted.size() == 1
+        && next.position == last.position + last.inserted.size()) {
+        const QChar ch = next.inserted.at(0);
+        if (isLineBreak(ch)) return false;
+        if (!last.inserted.isEmpty() && last.inserted.back().isSpace() && !ch.isSpace()) return false;
+        last.inserted += next.inserted;
+        return true;
+    }
+
+    if (last.inserted.isEmpty() && next.inserted.isEmpty() && next.removed.size() == 1
+        && !isLineBreak(next.removed.at(0))) {
+        // Backspace: the character before the previous deletion
+        if (next.position + 1 == last.position) {
+            last.removed.prepend(next.removed);
+            last.position = next.position;
+            return true;
+        }
+        // Delete: the character after it
+        if (next.position == last.position) {
+            last.removed += next.removed;
+            return true;
+        }
+    }
+    return false;
+}
+
+void UndoHistory::push(const Delta &delta) {
+    // A new edit makes the redo branch unreachable
+    for (const Delta &undone : std::as_const(m_redo)) m_memoryBytes -= costOf(undone);
+    m_redo.clear();
+
+    const bool typing = delta.removed.size() + delta.inserted.size() == 1;
+    bool merged = false;
+    if (typing && m_coalesce && !m_undo.isEmpty() && m_lastEdit.elapsed() < kCoalesceMs) {
+        Delta &last = m_undo.last();
+        const qint64 before = costOf(last);
+        merged = coalesceWith(last, delta);
+        if (merged) m_memoryBytes += costOf(last) - before;
+    }
+    if (!merged) {
+        m_undo.append(delta);
+        m_memoryBytes += costOf(delta);
+    }
+
+    m_coalesce = typing;
+    m_lastEdit.restart();
+
+    if (m_memoryBytes > m_budget) spill();
+    emitAvailability();
+}
+
+// ---------------------------------
+// Undo / Redo
+// ---------------------------------
+
+int UndoHistory::apply(int position, int length, const QString &text) {
+    m_applying = true;
+    QTextCursor cursor(m_document);
+    cursor.setPosition(position);
+    cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+    cursor.insertText(text);
+    m_applying = false;
+    return position + text.size();
+}
+
+int UndoHistory::undo() {
+    if (m_undo.isEmpty() && !unspill()) return -1;
+
+    const Delta delta = m_undo.takeLast();
+    const int cursor = apply(delta.position, delta.inserted.size(), delta.removed);
+    m_redo.append(delta);
+
+    m_coalesce = false;
+    emitAvailability();
+    return cursor;
+}
+
+int UndoHistory::redo() {
+    if (m_redo.isEmpty()) return -1;
+
+    const Delta delta = m_redo.takeLast();
+    const int cursor = apply(delta.position, delta.removed.size(), delta.inserted);
+    m_undo.append(delta);
+
+    m_coalesce = false;
+    emitAvailability();
+    return cursor;
+}
+
+// ---------------------------------
+// Memory Budget
+// ---------------------------------
+
+void UndoHistory::setMemoryBudget(qint64 bytes) {
+    m_budget = qMax<qint64>(64 * 1024, bytes);
+    if (m_memoryBytes > m_budget) spill();
+}
+
+QByteArray UndoHistory::serialize(const QVector<Delta> &deltas) {
+    QByteArray raw;
+    QDataStream out(&raw, QIODevice::WriteOnly);
+    out << qint32(deltas.size());
+    for (const Delta &delta : deltas) {
+        out << qint32(delta.position) << delta.removed << delta.inserted;
+    }
+    // Edits compress well: code, repeated indentation, similar lines
+    return qCompress(raw);
+}
+
+QVector<UndoHistory::Delta> UndoHistory::deserialize(const QByteArray &data) {
+    QVector<Delta> deltas;
+    const QByteArray raw = qUncompress(data);
+    QDataStream in(raw);
+
+    qint32 count = 0;
+    in >> count;
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        qint32 position = 0;
+        Delta delta;
+        in >> position >> delta.removed >> delta.inserted;
+        delta.position = position;
+        deltas.append(delta);
+    }
+    if (in.status() != QDataStream::Ok) deltas.clear();
+    return deltas;
+}
+
+void UndoHistory::spill() {
+    // Move the oldest steps out until half the budget is free, so we don't
+    // spill again on the very next keystroke
+    qint64 freed = 0;
+    int count = 0;
+    while (count < m_undo.size() - 1 && m_memoryBytes - freed > m_budget / 2) {
+        freed += costOf(m_undo.at(count));
+        ++count;
+    }
+    if (count == 0) return;
+
+    if (!m_spillFile) {
+        m_spillFile = new QTemporaryFile(QDir::tempPath() + "/undo-XXXXXX.spill", this);
+        if (!m_spillFile->open()) {
+            delete m_spillFile;
+            m_spillFile = nullptr;
+        }
+    }
+
+    if (m_spillFile) {
+        const QByteArray data = serialize(m_undo.mid(0, count));
+        Segment segment{m_spillFile->size(), data.size()};
+        m_spillFile->seek(segment.offset);
+        if (m_spillFile->write(data) == data.size()) {
+            m_segments.append(segment);
+        } else {
+            m_spillFile->resize(segment.offset);
+            qWarning() << "UndoHistory: could not write the spill file, oldest steps dropped";
+        }
+    } else {
+        qWarning() << "UndoHistory: no spill file, oldest steps dropped";
+    }
+
+    m_undo.remove(0, count);
+    m_memoryBytes -= freed;
+}
+
+bool UndoHistory::unspill() {
+    if (m_segments.isEmpty() || !m_spillFile) return false;
+
+    // The newest segment sits at the end of the file
+    const Segment segment = m_segments.takeLast();
+    m_spillFile->seek(segment.offset);
+    const QByteArray data = m_spillFile->read(segment.size);
+    m_spillFile->resize(segment.offset);
+
+    const QVector<Delta> deltas = deserialize(data);
+    if (deltas.isEmpty()) return false;
+
+    m_undo = deltas + m_undo;
+    for (const Delta &delta : deltas) m_memoryBytes += costOf(delta);
+    return true;
+}
+
+// ---------------------------------
+// Persistence
+// ---------------------------------
+
+QString UndoHistory::historyPathFor(const QString &filePath) {
+    const QByteArray key = QCryptographicHash::hash(QFileInfo(filePath).absoluteFilePath().toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)
+           + "/undo/" + QString::fromLatin1(key) + ".undo";
+}
+
+bool UndoHistory::save(const QString &path) {
+    // Everything undoable, oldest first: the spilled segments, then memory
+    QVector<Delta> undo;
+    if (m_spillFile) {
+        for (const Segment &segment : std::as_const(m_segments)) {
+            m_spillFile->seek(segment.offset);
+            undo += deserialize(m_spillFile->read(segment.size));
+        }
+    }
+    undo += m_undo;
+    if (undo.size() > kMaxSavedSteps) undo.remove(0, undo.size() - kMaxSavedSteps);
+
+    if (undo.isEmpty() && m_redo.isEmpty()) {
+        QFile::remove(path); // Nothing to restore next time
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&file);
+    out << kMagic << kVersion << contentHash() << serialize(undo) << serialize(m_redo);
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+bool UndoHistory::load(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray hash;
+    in >> magic >> version;
+    if (magic != kMagic || version != kVersion) return false;
+
+    // The steps only make sense for the exact text they were recorded on
+    in >> hash;
+    if (hash != contentHash()) return false;
+
+    QByteArray undoData;
+    QByteArray redoData;
+    in >> undoData >> redoData;
+    if (in.status() != QDataStream::Ok) return false;
+
+    m_undo = deserialize(undoData);
+    m_redo = deserialize(redoData);
+    m_segments.clear();
+    if (m_spillFile) m_spillFile->resize(0);
+
+    m_memoryBytes = 0;
+    for (const Delta &delta : std::as_const(m_undo)) m_memoryBytes += costOf(delta);
+    for (const Delta &delta : std::as_const(m_redo)) m_memoryBytes += costOf(delta);
+    m_coalesce = false;
+
+    if (m_memoryBytes > m_budget) spill();
+    emitAvailability();
+    return true;
+}
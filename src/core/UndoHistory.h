@@ -0,0 +1,105 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+
+class QTextDocument;
+class QTemporaryFile;
+class DocumentMirror;
+
+// Undo/redo for plain text documents (CodeEditor), replacing QTextDocument's
+// own stack.
+//
+// Qt keeps a command object per low-level operation, forever. Here a step is
+// one compact delta: "at 'position', 'removed' was replaced by 'inserted'",
+// trimmed to the characters that really changed (see DocumentMirror). An
+// edit block (Paste with Diff, a multi-cursor edit) reaches us as one
+// contentsChange and becomes one step; consecutive typing and deleting are
+// merged into one step as well.
+//
+// Memory is bounded: when the steps held in RAM exceed the budget, the oldest
+// half is serialized, qCompress'ed and appended to a temporary spill file. The
+// steps come back one segment at a time when undo reaches them.
+//
+// A history can be saved together with a hash of the text it leads to, and is
+// only restored if the file still has exactly that content.
+class UndoHistory : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr qint64 kDefaultMemoryBudget = 8 * 1024 * 1024;
+
+    // Takes over undo for 'document' (its own undo stack is switched off).
+    // Attach after the initial text is loaded; loading is not a step.
+    explicit UndoHistory(QTextDocument *document);
+
+    bool canUndo() const { return !m_undo.isEmpty() || !m_segments.isEmpty(); }
+    bool canRedo() const { return !m_redo.isEmpty(); }
+
+    // Return the cursor position after the step, or -1 if there was none
+    int undo();
+    int redo();
+
+    // Ends the current typing group, so the next keystroke starts a new step
+    void breakCoalescing() { m_coalesce = false; }
+
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const { return m_budget; }
+    qint64 memoryUsage() const { return m_memoryBytes; }
+
+    // --- Persistence ---
+    // Where the history of 'filePath' is kept between sessions
+    static QString historyPathFor(const QString &filePath);
+    bool save(const QString &path);
+    // Restores a saved history if it was saved for the document's current text
+    bool load(const QString &path);
+
+signals:
+    void undoAvailable(bool available);
+    void redoAvailable(bool available);
+
+private slots:
+    void onChanged(int position, const QString &removed, const QString &inserted);
+    void onResynced();
+
+private:
+    struct Delta {
+        int position = 0;
+        QString removed;
+        QString inserted;
+    };
+
+    // A run of old steps in the spill file
+    struct Segment {
+        qint64 offset;
+        qint64 size;
+    };
+
+    static qint64 costOf(const Delta &delta);
+    static QByteArray serialize(const QVector<Delta> &deltas);
+    static QVector<Delta> deserialize(const QByteArray &data);
+    QByteArray contentHash() const;
+
+    bool coalesceWith(Delta &last, const Delta &next) const;
+    void push(const Delta &delta);
+    void spill();
+    bool unspill();
+    int apply(int position, int length, const QString &text);
+    void emitAvailability();
+
+    QTextDocument *m_document;
+    DocumentMirror *m_mirror; // Shared with anyone else following the document
+
+    QVector<Delta> m_undo; // Oldest first
+    QVector<Delta> m_redo; // Next redo last
+    QVector<Segment> m_segments;
+    QTemporaryFile *m_spillFile = nullptr;
+
+    qint64 m_budget = kDefaultMemoryBudget;
+    qint64 m_memoryBytes = 0;
+
+    bool m_applying = false;   // Our own undo/redo edit
+    bool m_coalesce = false;   // The last step may absorb the next keystroke
+    QElapsedTimer m_lastEdit;
+};
@@ -1,19 +1,66 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDir>
 #include "MainWindow.h"
+#include "SingleInstance.h"
+#include "StartupTimeline.h"
 
 
 int main(int argc, char *argv[])
 {
+    // Startup is measured from here to the first frame and to "interactive"
+    // (see StartupTimeline and MainWindow::startDeferredInit)
+    StartupTimeline::start();
+
+    // 0. Command line, and the fast path: if an editor is already running,
+    // hand it the files and quit. A QCoreApplication is all that needs; the
+    // expensive part of startup (QApplication, platform plugin, fonts) is skipped.
+    QStringList files;
+    bool separate = false;
+    {
+        QCoreApplication launcher(argc, argv);
+
+        QCommandLineParser parser;
+        parser.setApplicationDescription("A small Qt code and rich text editor.");
+        parser.addHelpOption();
+        QCommandLineOption separateOption({"n", "new-instance"},
+                                          "Start a separate editor instead of opening the files in a running one.");
+        parser.addOption(separateOption);
+        parser.addPositionalArgument("files", "Files to open.", "[files...]");
+        parser.process(launcher);
+
+        // The running editor has a working directory of its own
+        for (const QString &file : parser.positionalArguments()) files << QDir::current().absoluteFilePath(file);
+        separate = parser.isSet(separateOption);
+
+        if (!separate && SingleInstance::forward(files)) return 0;
+    }
+
     // 1. The Manager: QApplication
     // It creates the "Event Loop" (the heartbeat of the app).
     // It handles mouse clicks, window resizing, etc.
     QApplication app(argc, argv);
+    StartupTimeline::mark("application");
+
+    // Later invocations forward their files here (unless this one is
+    // separate). Claimed before the window is built, so the time in which a
+    // second launch finds no editor to forward to is as short as possible.
+    // Another editor may have claimed it since forward() above: then it gets
+    // the files after all. Nothing is received before the event loop runs.
+    SingleInstance instance;
+    if (!separate && !instance.listen() && SingleInstance::forward(files)) return 0;
 
     // Create and show our new class
     MainWindow w;
+    StartupTimeline::mark("window");
+    if (!separate) QObject::connect(&instance, &SingleInstance::filesReceived, &w, &MainWindow::openFiles);
     w.show();
+    StartupTimeline::mark("shown");
+
+    // Files on the command line open after last session's tabs
+    w.openFiles(files);
 
     // 5. Enter the Loop
     // This pauses main() here. It won't return until the window is closed.
     return app.exec();
-}
\ No newline at end of file
+}
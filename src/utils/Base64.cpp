@@ -0,0 +1,342 @@
+#include "Base64.h"
+#include "CpuFeatures.h"
+
+#include <cstdint>
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+namespace Base64 {
+
+typedef unsigned char uchar;
+
+// The kernels advance 'in' and 'out' past whatever they consumed/produced and
+// leave the tail (and anything they can't handle) to the scalar code.
+typedef void (*BlockKernel)(const uchar *&in, const uchar *end, char *&out);
+
+static const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 0..63 = sextet value, -1 = not part of the alphabet, -2 = padding
+static const signed char *decodeTable() {
+    static const struct Table {
+        signed char values[256];
+        Table() {
+            for (int i = 0; i < 256; ++i) values[i] = -1;
+            for (int i = 0; i < 64; ++i) values[(uchar)kAlphabet[i]] = (signed char)i;
+            values[(uchar)'='] = -2;
+        }
+    } table;
+    return table.values;
+}
+
+// =========================================================
+// Scalar Fallback
+// =========================================================
+
+static void encodeTail(const uchar *in, const uchar *end, char *&out) {
+    while (end - in >= 3) {
+        uint32_t v = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+        out[0] = kAlphabet[v >> 18];
+        out[1] = kAlphabet[(v >> 12) & 63];
+        out[2] = kAlphabet[(v >> 6) & 63];
+        out[3] = kAlphabet[v & 63];
+        in += 3;
+        out += 4;
+    }
+
+    // 1 or 2 leftover bytes become a padded quantum
+    if (end - in == 1) {
+        uint32_t v = uint32_t(in[0]) << 16;
+        out[0] = kAlphabet[v >> 18];
+        out[1] = kAlphabet[(v >> 12) & 63];
+        out[2] = '=';
+        out[3] = '=';
+        out += 4;
+    } else if (end - in == 2) {
+        uint32_t v = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8);
+        out[0] = kAlphabet[v >> 18];
+        out[1] = kAlphabet[(v >> 12) & 63];
+        out[2] = kAlphabet[(v >> 6) & 63];
+        out[3] = '=';
+        out += 4;
+    }
+}
+
+// =========================================================
+// SSSE3 / AVX2 Kernels
+// =========================================================
+// Both follow the well-known pshufb approach (W. Mula, D. Lemire):
+// reshuffle 3-byte groups into 4 lanes, split them into sextets with
+// multiplies, then translate with a 16-entry lookup table.
+
+#ifdef CPU_FEATURES_X86
+
+CPU_TARGET("ssse3")
+static inline __m128i encodeReshuffle128(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+}
+
+CPU_TARGET("ssse3")
+static inline __m128i encodeTranslate128(__m128i in) {
+    __m128i result = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), in);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i shiftLut = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0);
+    result = _mm_shuffle_epi8(shiftLut, result);
+    return _mm_add_epi8(result, in);
+}
+
+CPU_TARGET("ssse3")
+static void encodeSsse3(const uchar *&in, const uchar *end, char *&out) {
+    // Each step reads 16 bytes but only consumes 12
+    while (end - in >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+        v = encodeTranslate128(encodeReshuffle128(v));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), v);
+        in += 12;
+        out += 16;
+    }
+}
+
+CPU_TARGET("avx2")
+static void encodeAvx2(const uchar *&in, const uchar *end, char *&out) {
+    const __m256i shuffle = _mm256_broadcastsi128_si256(
+        _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i shiftLut = _mm256_broadcastsi128_si256(_mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+        '/' - 63, 'A', 0, 0));
+
+    // Each lane takes 12 input bytes; the upper lane is loaded from in + 12
+    while (end - in >= 28) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 12));
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        v = _mm256_shuffle_epi8(v, shuffle);
+        const __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        v = _mm256_or_si256(t1, t3);
+
+        __m256i result = _mm256_subs_epu8(v, _mm256_set1_epi8(51));
+        const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), v);
+        result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        result = _mm256_add_epi8(_mm256_shuffle_epi8(shiftLut, result), v);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), result);
+        in += 24;
+        out += 32;
+    }
+}
+
+// Lookup tables for validating and translating ASCII to sextets.
+// A block containing anything outside the alphabet (including '=' and
+// whitespace) is rejected as a whole and left to the scalar decoder.
+#define BASE64_DECODE_LUTS                                                        \
+    _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,               \
+                  0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A),               \
+    _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,               \
+                  0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10),               \
+    _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0)
+
+CPU_TARGET("ssse3")
+static void decodeSsse3(const uchar *&in, const uchar *end, char *&out) {
+    const __m128i luts[3] = { BASE64_DECODE_LUTS };
+    const __m128i mask2F = _mm_set1_epi8(0x2f);
+
+    // Stores write 16 bytes for 12 decoded ones; keeping 32 input bytes in
+    // reserve guarantees the output buffer (decodedSizeBound) has the slack.
+    while (end - in >= 32) {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+
+        const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask2F);
+        const __m128i loNibbles = _mm_and_si128(str, mask2F);
+        const __m128i hi = _mm_shuffle_epi8(luts[1], hiNibbles);
+        const __m128i lo = _mm_shuffle_epi8(luts[0], loNibbles);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0) {
+            break;
+        }
+
+        const __m128i eq2F = _mm_cmpeq_epi8(str, mask2F);
+        const __m128i roll = _mm_shuffle_epi8(luts[2], _mm_add_epi8(eq2F, hiNibbles));
+        str = _mm_add_epi8(str, roll);
+
+        const __m128i merged = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+        __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        packed = _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                                        14, 13, 12, -1, -1, -1, -1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), packed);
+        in += 16;
+        out += 12;
+    }
+}
+
+CPU_TARGET("avx2")
+static void decodeAvx2(const uchar *&in, const uchar *end, char *&out) {
+    const __m128i luts[3] = { BASE64_DECODE_LUTS };
+    const __m256i lutLo = _mm256_broadcastsi128_si256(luts[0]);
+    const __m256i lutHi = _mm256_broadcastsi128_si256(luts[1]);
+    const __m256i lutRoll = _mm256_broadcastsi128_si256(luts[2]);
+    const __m256i mask2F = _mm256_set1_epi8(0x2f);
+    const __m256i laneShuffle = _mm256_broadcastsi128_si256(
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+    // Same slack rule as the SSSE3 kernel: 32-byte stores for 24 decoded bytes
+    while (end - in >= 48) {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in));
+
+        const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask2F);
+        const __m256i loNibbles = _mm256_and_si256(str, mask2F);
+        const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+        const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+        if (!_mm256_testz_si256(lo, hi)) {
+            break;
+        }
+
+        const __m256i eq2F = _mm256_cmpeq_epi8(str, mask2F);
+        const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+        str = _mm256_add_epi8(str, roll);
+
+        const __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        packed = _mm256_shuffle_epi8(packed, laneShuffle);
+        packed = _mm256_permutevar8x32_epi32(packed, pack);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), packed);
+        in += 32;
+        out += 24;
+    }
+}
+
+#undef BASE64_DECODE_LUTS
+
+// ---------------------------------
+// Kernel Selection
+// ---------------------------------
+
+enum Kernel { KernelScalar, KernelSsse3, KernelAvx2 };
+
+static Kernel activeKernelId() {
+    static const Kernel kernel = CpuFeatures::hasAvx2() ? KernelAvx2
+                               : CpuFeatures::hasSsse3() ? KernelSsse3 : KernelScalar;
+    return kernel;
+}
+
+static BlockKernel encodeKernel() {
+    switch (activeKernelId()) {
+        case KernelAvx2: return encodeAvx2;
+        case KernelSsse3: return encodeSsse3;
+        default: return nullptr;
+    }
+}
+
+static BlockKernel decodeKernel() {
+    switch (activeKernelId()) {
+        case KernelAvx2: return decodeAvx2;
+        case KernelSsse3: return decodeSsse3;
+        default: return nullptr;
+    }
+}
+
+const char *activeKernel() {
+    switch (activeKernelId()) {
+        case KernelAvx2: return "avx2";
+        case KernelSsse3: return "ssse3";
+        default: return "scalar";
+    }
+}
+
+#else // !CPU_FEATURES_X86
+
+static BlockKernel encodeKernel() { return nullptr; }
+static BlockKernel decodeKernel() { return nullptr; }
+const char *activeKernel() { return "scalar"; }
+
+#endif
+
+// =========================================================
+// Public API
+// =========================================================
+
+size_t encode(const char *data, size_t len, char *out) {
+    const uchar *in = reinterpret_cast<const uchar *>(data);
+    const uchar *end = in + len;
+    char *o = out;
+
+    static const BlockKernel kernel = encodeKernel();
+    if (kernel) kernel(in, end, o);
+
+    encodeTail(in, end, o);
+    return size_t(o - out);
+}
+
+size_t decode(const char *data, size_t len, char *out) {
+    const uchar *in = reinterpret_cast<const uchar *>(data);
+    const uchar *end = in + len;
+    const signed char *table = decodeTable();
+    char *o = out;
+
+    static const BlockKernel kernel = decodeKernel();
+
+    uint32_t acc = 0;
+    int count = 0; // Sextets collected for the current quantum
+    while (in < end) {
+        // Whenever we are at a quantum boundary, let the vector kernel take
+        // over again. It stops at the first block with a non-alphabet byte.
+        if (count == 0 && kernel) {
+            kernel(in, end, o);
+            if (in >= end) break;
+        }
+
+        signed char v = table[*in++];
+        if (v == -2) break;    // Padding: nothing meaningful follows
+        if (v < 0) continue;   // Skip whitespace and other junk
+
+        acc = (acc << 6) | uint32_t(v);
+        if (++count == 4) {
+            o[0] = char(acc >> 16);
+            o[1] = char(acc >> 8);
+            o[2] = char(acc);
+            o += 3;
+            acc = 0;
+            count = 0;
+        }
+    }
+
+    // An unpadded or padded partial quantum still carries 1 or 2 bytes
+    if (count == 2) {
+        *o++ = char(acc >> 4);
+    } else if (count == 3) {
+        *o++ = char(acc >> 10);
+        *o++ = char(acc >> 2);
+    }
+    return size_t(o - out);
+}
+
+QByteArray encode(const QByteArray &data) {
+    QByteArray result(qsizetype(encodedSize(size_t(data.size()))), Qt::Uninitialized);
+    size_t written = encode(data.constData(), size_t(data.size()), result.data());
+    result.truncate(qsizetype(written));
+    return result;
+}
+
+QByteArray decode(const QByteArray &base64) {
+    QByteArray result(qsizetype(decodedSizeBound(size_t(base64.size()))), Qt::Uninitialized);
+    size_t written = decode(base64.constData(), size_t(base64.size()), result.data());
+    result.truncate(qsizetype(written));
+    return result;
+}
+
+}
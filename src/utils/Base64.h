@@ -0,0 +1,34 @@
+#pragma once
+#include <QByteArray>
+#include <cstddef>
+
+namespace Base64 {
+
+// Vectorized standard-alphabet (RFC 4648) Base64.
+// The implementation picks AVX2, SSSE3 or a scalar loop at runtime, so the
+// same binary runs on any x86-64 CPU (and non-x86 builds use the scalar path).
+
+// Number of output bytes produced by encode() for a given input size (padded).
+inline size_t encodedSize(size_t inputSize) { return (inputSize + 2) / 3 * 4; }
+
+// Upper bound on the bytes written by decode() for a given input size.
+inline size_t decodedSizeBound(size_t inputSize) { return inputSize / 4 * 3 + 3; }
+
+// Raw buffer API, used by streaming writers that encode chunk by chunk.
+// 'out' must hold at least encodedSize(len) bytes. Returns the bytes written.
+size_t encode(const char *in, size_t len, char *out);
+
+// Decodes 'len' bytes of Base64. Characters outside the alphabet (whitespace,
+// line breaks) are skipped, matching QByteArray::fromBase64's default mode.
+// Decoding stops at the first '='. 'out' must hold decodedSizeBound(len) bytes.
+// Returns the bytes written.
+size_t decode(const char *in, size_t len, char *out);
+
+// Convenience wrappers with the same results as QByteArray::toBase64/fromBase64.
+QByteArray encode(const QByteArray &data);
+QByteArray decode(const QByteArray &base64);
+
+// Name of the kernel selected for this CPU ("avx2", "ssse3" or "scalar").
+const char *activeKernel();
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// Runtime CPU feature detection shared by the vectorized kernels (Base64,
+// TextSearch, TextCodec). Each kernel table asks here which instruction sets
+// it may use; the CPU is queried once per process.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_FEATURES_X86 1
+#endif
+
+// GCC/Clang need the ISA enabled per function so the rest of the binary keeps
+// the baseline instruction set. MSVC allows intrinsics anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CPU_TARGET(isa)
+#endif
+
+namespace CpuFeatures {
+
+// All false on non-x86 builds
+bool hasSse2();
+bool hasSsse3();
+bool hasAvx2(); // Also requires the OS to save the YMM registers
+
+}
@@ -1,4 +1,5 @@
 #include "DiffHelpers.h"
+#include "MemoryAccounting.h"
 
 
 namespace DiffHelpers {
@@ -10,6 +11,7 @@ static QString normalize(const QString& s) {
 }
 
 QVector<DiffHunk> computeDiff(const QStringList &oldLines, const QStringList &newLines) {
+    MemoryAccounting::Scope scope(MemoryAccounting::Diff);
     int N = oldLines.size();
     int M = newLines.size();
 
@@ -55,4 +57,92 @@ QVector<DiffHunk> computeDiff(const QStringList &oldLines, const QStringList &ne
     return diffs;
 }
 
+// Myers, "An O(ND) Difference Algorithm and Its Variations" (1986). V[k] is
+// the furthest old index reached on diagonal k = x - y with d edits; the
+// V slices of every d are kept to walk the path back. They hold d^2 ints in
+// total, which is why 'maxEdits' bounds d.
+QVector<LineHunk> computeHunks(const QStringList &oldLines, const QStringList &newLines, int maxEdits) {
+    MemoryAccounting::Scope scope(MemoryAccounting::Diff);
+
+    // --- Common prefix and suffix ---
+    int start = 0;
+    int oldEnd = oldLines.size();
+    int newEnd = newLines.size();
+    while (start < oldEnd && start < newEnd && oldLines[start] == newLines[start]) ++start;
+    while (oldEnd > start && newEnd > start && oldLines[oldEnd - 1] == newLines[newEnd - 1]) {
+        --oldEnd;
+        --newEnd;
+    }
+
+    const int n = oldEnd - start;
+    const int m = newEnd - start;
+    if (n == 0 && m == 0) return {};
+    if (n == 0 || m == 0) return {{start, n, start, m}};
+
+    // --- Forward pass ---
+    const int limit = std::min(n + m, maxEdits);
+    const int offset = limit + 1;
+    std::vector<int> V(2 * limit + 3, 0);
+    std::vector<std::vector<int>> trace; // trace[d][k + d] = V[k] after d edits
+    int edits = -1;
+
+    for (int d = 0; d <= limit && edits < 0; ++d) {
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && V[offset + k - 1] < V[offset + k + 1]))
+                        ? V[offset + k + 1]      // Down: insert newLines[y]
+                        : V[offset + k - 1] + 1; // Right: delete oldLines[x]
+            int y = x - k;
+            while (x < n && y < m && oldLines[start + x] == newLines[start + y]) {
+                ++x;
+                ++y;
+            }
+            V[offset + k] = x;
+            if (x >= n && y >= m) edits = d;
+        }
+        trace.emplace_back(V.begin() + offset - d, V.begin() + offset + d + 1);
+    }
+
+    // Too different to be worth the detail
+    if (edits < 0) return {{start, n, start, m}};
+
+    // --- Walk back: one deleted or inserted line per d ---
+    struct Edit {
+        int x; // Old index before the edit
+        int y; // New index before the edit
+        bool insert;
+    };
+    std::vector<Edit> path;
+    int x = n;
+    int y = m;
+    for (int d = edits; d > 0; --d) {
+        const std::vector<int> &prev = trace[d - 1];
+        auto at = [&prev, d](int k) { return prev[k + d - 1]; };
+
+        const int k = x - y;
+        const bool insert = k == -d || (k != d && at(k - 1) < at(k + 1));
+        const int prevK = insert ? k + 1 : k - 1;
+        const int prevX = at(prevK);
+        const int prevY = prevX - prevK;
+
+        path.push_back({prevX, prevY, insert});
+        x = prevX;
+        y = prevY;
+    }
+
+    // --- Merge adjacent edits into hunks ---
+    QVector<LineHunk> hunks;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        if (!hunks.isEmpty()) {
+            LineHunk &last = hunks.last();
+            if (last.oldStart + last.oldCount == start + it->x && last.newStart + last.newCount == start + it->y) {
+                if (it->insert) ++last.newCount;
+                else ++last.oldCount;
+                continue;
+            }
+        }
+        hunks.append({start + it->x, it->insert ? 0 : 1, start + it->y, it->insert ? 1 : 0});
+    }
+    return hunks;
+}
+
 }
@@ -23,4 +23,21 @@ struct DiffHunk {
 // Uses trimmed line comparison to ignore whitespace differences.
 QVector<DiffHunk> computeDiff(const QStringList &oldLines, const QStringList &newLines);
 
+// A run of changed lines: 'oldCount' lines at 'oldStart' became the
+// 'newCount' lines at 'newStart' (either count may be 0).
+struct LineHunk {
+    int oldStart;
+    int oldCount;
+    int newStart;
+    int newCount;
+};
+
+// Exact line diff (no whitespace normalization) for turning oldLines into
+// newLines, e.g. to reload a file in place. The common prefix and suffix are
+// skipped in linear time and the rest is diffed with Myers' O((N+M)D)
+// algorithm, so the cost follows the size of the change rather than the size
+// of the file. If more than 'maxEdits' lines differ, the middle that's left
+// is returned as one hunk.
+QVector<LineHunk> computeHunks(const QStringList &oldLines, const QStringList &newLines, int maxEdits = 1000);
+
 }
\ No newline at end of file
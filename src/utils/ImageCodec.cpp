@@ -0,0 +1,91 @@
+#include "ImageCodec.h"
+#include "Base64.h"
+
+#include <QBuffer>
+#include <QImageWriter>
+
+namespace ImageCodec {
+
+static Options loadDefaultOptions() {
+    Options opts;
+
+    QByteArray format = qgetenv("QT_EDITOR_IMAGE_FORMAT").toLower();
+    if (format == "webp") opts.format = WebpLossless;
+
+    bool ok = false;
+    int level = qEnvironmentVariableIntValue("QT_EDITOR_PNG_LEVEL", &ok);
+    if (ok) opts.pngCompressionLevel = qBound(0, level, 9);
+
+    return opts;
+}
+
+static Options &currentOptions() {
+    static Options opts = loadDefaultOptions();
+    return opts;
+}
+
+Options options() {
+    return currentOptions();
+}
+
+void setOptions(const Options &options) {
+    currentOptions() = options;
+}
+
+// Qt's PNG writer has no direct zlib level setting; it derives the level
+// from the "quality" as (100 - quality) * 9 / 91. This picks the quality that
+// lands exactly on the requested level.
+static int pngQualityForLevel(int level) {
+    level = qBound(0, level, 9);
+    return 100 - (level * 91 + 8) / 9;
+}
+
+static bool webpAvailable() {
+    static const bool available = QImageWriter::supportedImageFormats().contains("webp");
+    return available;
+}
+
+QByteArray encode(const QImage &image, const QString &preferredFormat, QString *mimeType) {
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+
+    QString suffix = preferredFormat.toLower();
+    if (suffix == "jpg" || suffix == "jpeg") {
+        // Already lossy, re-encoding as PNG would only make it bigger
+        QImageWriter writer(&buffer, "jpeg");
+        writer.write(image);
+        if (mimeType) *mimeType = "image/jpeg";
+        return bytes;
+    }
+
+    Options opts = options();
+    if (opts.format == WebpLossless && webpAvailable()) {
+        // The webp plugin switches to lossless mode at quality 100
+        QImageWriter writer(&buffer, "webp");
+        writer.setQuality(100);
+        if (writer.write(image)) {
+            if (mimeType) *mimeType = "image/webp";
+            return bytes;
+        }
+        bytes.clear();
+        buffer.seek(0);
+    }
+
+    QImageWriter writer(&buffer, "png");
+    writer.setQuality(pngQualityForLevel(opts.pngCompressionLevel));
+    writer.write(image);
+    if (mimeType) *mimeType = "image/png";
+    return bytes;
+}
+
+QString toDataUri(const QImage &image, const QString &preferredFormat) {
+    QString mimeType;
+    QByteArray bytes = encode(image, preferredFormat, &mimeType);
+
+    QByteArray uri = "data:" + mimeType.toLatin1() + ";base64,";
+    uri += Base64::encode(bytes);
+    return QString::fromLatin1(uri);
+}
+
+}
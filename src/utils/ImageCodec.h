@@ -0,0 +1,35 @@
+#pragma once
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+
+namespace ImageCodec {
+
+// How embedded images are encoded before they go into a data: URI.
+enum Format {
+    Png,          // Portable, works everywhere the HTML is opened
+    WebpLossless  // Smaller and faster, needs the Qt "webp" image plugin
+};
+
+struct Options {
+    Format format = Png;
+
+    // zlib level used for PNG (0 = store, 1 = fastest, 9 = smallest).
+    // Qt's own default is 6, which is several times slower for pasted screenshots.
+    int pngCompressionLevel = 1;
+};
+
+// Defaults can be overridden with QT_EDITOR_IMAGE_FORMAT=png|webp and
+// QT_EDITOR_PNG_LEVEL=0..9 in the environment.
+Options options();
+void setOptions(const Options &options);
+
+// Encodes an image. 'preferredFormat' is an image file suffix (e.g. "jpg");
+// lossy formats are kept as-is, everything else goes through Options.
+// On return, 'mimeType' holds the MIME type of the encoded bytes.
+QByteArray encode(const QImage &image, const QString &preferredFormat, QString *mimeType);
+
+// Builds a complete "data:<mime>;base64,..." URI using the vectorized Base64 encoder.
+QString toDataUri(const QImage &image, const QString &preferredFormat = QString());
+
+}
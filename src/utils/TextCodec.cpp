@@ -0,0 +1,370 @@
+#include "TextCodec.h"
+#include "TextSearch.h"
+#include "CpuFeatures.h"
+
+#include <QStringDecoder>
+#include <QStringEncoder>
+#include <cstring>
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+namespace TextCodec {
+
+typedef unsigned char uchar;
+
+// Kernels return how far they got with whole vectors; the scalar code
+// finishes the tail (and stops at the same non-ASCII byte they stopped at)
+typedef qsizetype (*AsciiKernel)(const uchar *data, qsizetype size);
+typedef qsizetype (*WidenKernel)(const uchar *data, qsizetype size, char16_t *out);
+
+// =========================================================
+// SSE2 / AVX2 Kernels
+// =========================================================
+// An ASCII byte has its top bit clear, and movemask collects exactly the top
+// bits, so a whole vector is checked with one instruction. Widening is a
+// zero-extension of each byte to 16 bits.
+
+#ifdef CPU_FEATURES_X86
+
+CPU_TARGET("sse2")
+static qsizetype asciiPrefixSse2(const uchar *data, qsizetype size) {
+    qsizetype i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        if (_mm_movemask_epi8(v)) break;
+    }
+    return i;
+}
+
+CPU_TARGET("avx2")
+static qsizetype asciiPrefixAvx2(const uchar *data, qsizetype size) {
+    qsizetype i = 0;
+    // Two vectors per iteration; OR-ing them keeps the test to one movemask
+    for (; i + 64 <= size; i += 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 32));
+        if (_mm256_movemask_epi8(_mm256_or_si256(a, b))) break;
+    }
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        if (_mm256_movemask_epi8(v)) break;
+    }
+    return i;
+}
+
+CPU_TARGET("sse2")
+static qsizetype widenSse2(const uchar *data, qsizetype size, char16_t *out) {
+    const __m128i zero = _mm_setzero_si128();
+    qsizetype i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        if (_mm_movemask_epi8(v)) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+    return i;
+}
+
+CPU_TARGET("avx2")
+static qsizetype widenAvx2(const uchar *data, qsizetype size, char16_t *out) {
+    qsizetype i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        if (_mm256_movemask_epi8(v)) break;
+        __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+        __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + 16), hi);
+    }
+    return i;
+}
+
+// ---------------------------------
+// Kernel Selection
+// ---------------------------------
+
+enum Kernel { KernelScalar, KernelSse2, KernelAvx2 };
+
+static Kernel activeKernelId() {
+    static const Kernel kernel = CpuFeatures::hasAvx2() ? KernelAvx2
+                               : CpuFeatures::hasSse2() ? KernelSse2 : KernelScalar;
+    return kernel;
+}
+
+static AsciiKernel asciiKernel() {
+    switch (activeKernelId()) {
+        case KernelAvx2: return asciiPrefixAvx2;
+        case KernelSse2: return asciiPrefixSse2;
+        default: return nullptr;
+    }
+}
+
+static WidenKernel widenKernel() {
+    switch (activeKernelId()) {
+        case KernelAvx2: return widenAvx2;
+        case KernelSse2: return widenSse2;
+        default: return nullptr;
+    }
+}
+
+const char *activeKernel() {
+    switch (activeKernelId()) {
+        case KernelAvx2: return "avx2";
+        case KernelSse2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+#else // !CPU_FEATURES_X86
+
+static AsciiKernel asciiKernel() { return nullptr; }
+static WidenKernel widenKernel() { return nullptr; }
+const char *activeKernel() { return "scalar"; }
+
+#endif
+
+// =========================================================
+// Scalar Parts
+// =========================================================
+
+qsizetype asciiPrefixLength(const char *data, qsizetype size) {
+    static const AsciiKernel kernel = asciiKernel();
+    const auto *in = reinterpret_cast<const uchar *>(data);
+    qsizetype i = kernel ? kernel(in, size) : 0;
+    while (i < size && in[i] < 0x80) ++i;
+    return i;
+}
+
+qsizetype widenAscii(const char *data, qsizetype size, char16_t *out) {
+    static const WidenKernel kernel = widenKernel();
+    const auto *in = reinterpret_cast<const uchar *>(data);
+    qsizetype i = kernel ? kernel(in, size, out) : 0;
+    for (; i < size && in[i] < 0x80; ++i) out[i] = in[i];
+    return i;
+}
+
+// Length of the well-formed UTF-8 sequence at 'p' (lead byte >= 0x80), or 0.
+// Overlong forms, surrogates and code points above U+10FFFF are rejected,
+// following the table in RFC 3629 section 4.
+static int sequenceLength(const uchar *p, qsizetype remaining) {
+    const uchar lead = p[0];
+    int length;
+    uchar low = 0x80;
+    uchar high = 0xBF; // Allowed range of the second byte
+    if (lead < 0xC2) return 0;
+    if (lead < 0xE0) {
+        length = 2;
+    } else if (lead < 0xF0) {
+        length = 3;
+        if (lead == 0xE0) low = 0xA0;
+        if (lead == 0xED) high = 0x9F;
+    } else if (lead < 0xF5) {
+        length = 4;
+        if (lead == 0xF0) low = 0x90;
+        if (lead == 0xF4) high = 0x8F;
+    } else {
+        return 0;
+    }
+
+    if (remaining < length) return 0;
+    if (p[1] < low || p[1] > high) return 0;
+    for (int k = 2; k < length; ++k) {
+        if ((p[k] & 0xC0) != 0x80) return 0;
+    }
+    return length;
+}
+
+bool isValidUtf8(const char *data, qsizetype size) {
+    const auto *in = reinterpret_cast<const uchar *>(data);
+    qsizetype i = 0;
+    while (i < size) {
+        // ASCII runs go through the vector kernel, multi-byte sequences are
+        // checked one by one
+        i += asciiPrefixLength(data + i, size - i);
+        while (i < size && in[i] >= 0x80) {
+            const int length = sequenceLength(in + i, size - i);
+            if (!length) return false;
+            i += length;
+        }
+    }
+    return true;
+}
+
+// UTF-16 without a BOM: ASCII-range characters leave every other byte zero
+static bool looksLikeUtf16(const uchar *data, qsizetype size, Encoding *encoding) {
+    const qsizetype sample = qMin<qsizetype>(size, 4096) & ~qsizetype(1);
+    if (sample < 4) return false;
+
+    qsizetype zeroEven = 0;
+    qsizetype zeroOdd = 0;
+    for (qsizetype i = 0; i < sample; i += 2) {
+        if (!data[i]) ++zeroEven;
+        if (!data[i + 1]) ++zeroOdd;
+    }
+    const qsizetype pairs = sample / 2;
+    if (zeroOdd * 10 >= pairs * 4 && zeroEven * 20 < pairs) {
+        *encoding = Utf16LE;
+        return true;
+    }
+    if (zeroEven * 10 >= pairs * 4 && zeroOdd * 20 < pairs) {
+        *encoding = Utf16BE;
+        return true;
+    }
+    return false;
+}
+
+// Turns CRLF and lone CR into '\n' in place and reports which style won
+static LineEnding normalizeLineEndings(QString *text, bool *mixed) {
+    const QStringView cr(u"\r");
+    const qsizetype firstCr = TextSearch::indexOf(*text, cr);
+    *mixed = false;
+    if (firstCr < 0) return LF; // The common case, nothing to rewrite
+
+    const qsizetype size = text->size();
+    const qsizetype newlines = TextSearch::findAll(*text, u"\n", 0, size, Qt::CaseSensitive, nullptr);
+
+    // Moves whole lines between CRs with memmove; write never passes read
+    char16_t *d = reinterpret_cast<char16_t *>(text->data());
+    const QStringView view(d, size);
+    qsizetype read = firstCr;
+    qsizetype write = firstCr;
+    qsizetype crlfCount = 0;
+    qsizetype crCount = 0;
+    while (read < size) {
+        if (read + 1 < size && d[read + 1] == u'\n') {
+            ++crlfCount;
+            read += 2;
+        } else {
+            ++crCount;
+            read += 1;
+        }
+        d[write++] = u'\n';
+
+        qsizetype next = TextSearch::indexOf(view, cr, read);
+        if (next < 0) next = size;
+        std::memmove(d + write, d + read, size_t(next - read) * sizeof(char16_t));
+        write += next - read;
+        read = next;
+    }
+    text->truncate(write);
+
+    const qsizetype lfCount = newlines - crlfCount;
+    *mixed = (lfCount > 0) + (crlfCount > 0) + (crCount > 0) > 1;
+    if (crlfCount >= lfCount && crlfCount >= crCount) return CRLF;
+    return crCount > lfCount ? CR : LF;
+}
+
+// =========================================================
+// Public API
+// =========================================================
+
+// UTF-8 (or ASCII) if it validates, Latin-1 otherwise
+static QString decode8Bit(const char *data, qsizetype size, Encoding *encoding) {
+    *encoding = Utf8;
+
+    // Every UTF-8 byte yields at most one UTF-16 unit, so 'size' is enough room
+    QString text(size, Qt::Uninitialized);
+    const qsizetype ascii = widenAscii(data, size, reinterpret_cast<char16_t *>(text.data()));
+    if (ascii == size) return text;
+
+    if (!isValidUtf8(data + ascii, size - ascii)) {
+        *encoding = Latin1;
+        return QString::fromLatin1(data, size);
+    }
+
+    // The ASCII prefix is already in place; decode the rest behind it
+    QStringDecoder decoder(QStringDecoder::Utf8, QStringDecoder::Flag::Stateless);
+    QChar *end = decoder.appendToBuffer(text.data() + ascii, QByteArrayView(data + ascii, size - ascii));
+    text.truncate(end - text.constData());
+    return text;
+}
+
+QString decode(const QByteArray &data, Format *format) {
+    Format detected;
+    const char *p = data.constData();
+    qsizetype size = data.size();
+    const auto *bytes = reinterpret_cast<const uchar *>(p);
+
+    if (size >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF) {
+        detected.bom = true;
+        p += 3;
+        size -= 3;
+    } else if (size >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE) {
+        detected.encoding = Utf16LE;
+        detected.bom = true;
+    } else if (size >= 2 && bytes[0] == 0xFE && bytes[1] == 0xFF) {
+        detected.encoding = Utf16BE;
+        detected.bom = true;
+    } else {
+        looksLikeUtf16(bytes, size, &detected.encoding);
+    }
+
+    QString text;
+    if (detected.encoding == Utf16LE || detected.encoding == Utf16BE) {
+        if (detected.bom) {
+            p += 2;
+            size -= 2;
+        }
+        QStringDecoder decoder(detected.encoding == Utf16LE ? QStringDecoder::Utf16LE : QStringDecoder::Utf16BE);
+        text = decoder.decode(QByteArrayView(p, size));
+    } else {
+        text = decode8Bit(p, size, &detected.encoding);
+    }
+
+    detected.lineEnding = normalizeLineEndings(&text, &detected.mixedLineEndings);
+    if (format) *format = detected;
+    return text;
+}
+
+QByteArray encode(const QString &text, const Format &format, bool *ok) {
+    if (ok) *ok = true;
+
+    QString out = text;
+    if (format.lineEnding == CRLF) out.replace(QLatin1Char('\n'), QLatin1String("\r\n"));
+    else if (format.lineEnding == CR) out.replace(QLatin1Char('\n'), QLatin1Char('\r'));
+
+    switch (format.encoding) {
+    case Utf16LE:
+    case Utf16BE: {
+        QStringEncoder encoder(format.encoding == Utf16LE ? QStringEncoder::Utf16LE : QStringEncoder::Utf16BE,
+                               format.bom ? QStringEncoder::Flag::WriteBom : QStringEncoder::Flag::Default);
+        return encoder.encode(out);
+    }
+    case Latin1:
+        if (ok) {
+            for (QChar c : std::as_const(out)) {
+                if (c.unicode() > 0xFF) {
+                    *ok = false;
+                    break;
+                }
+            }
+        }
+        return out.toLatin1();
+    case Utf8:
+    default:
+        return format.bom ? QByteArray("\xEF\xBB\xBF") + out.toUtf8() : out.toUtf8();
+    }
+}
+
+QString encodingName(const Format &format) {
+    switch (format.encoding) {
+    case Utf16LE: return format.bom ? "UTF-16 LE" : "UTF-16 LE (no BOM)";
+    case Utf16BE: return format.bom ? "UTF-16 BE" : "UTF-16 BE (no BOM)";
+    case Latin1: return "ISO-8859-1";
+    case Utf8:
+    default: return format.bom ? "UTF-8 with BOM" : "UTF-8";
+    }
+}
+
+QString lineEndingName(LineEnding lineEnding) {
+    switch (lineEnding) {
+    case CRLF: return "CRLF";
+    case CR: return "CR";
+    case LF:
+    default: return "LF";
+    }
+}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+
+namespace TextCodec {
+
+// Decoding and encoding of text files with their encoding and line endings
+// kept, so that saving writes back what was read.
+//
+// Detection: a BOM wins; without one, UTF-16 is recognized by its zero
+// bytes, then the data is validated as UTF-8 and anything that isn't valid
+// UTF-8 is read as Latin-1. Pure ASCII (most source code) never reaches a
+// real decoder: the vectorized kernels check and widen it to UTF-16 in one
+// pass at memory speed. Like Base64, AVX2 or SSE2 is picked at runtime.
+
+enum Encoding {
+    Utf8,
+    Utf16LE,
+    Utf16BE,
+    Latin1
+};
+
+enum LineEnding {
+    LF,   // Unix, the default for files without line breaks
+    CRLF, // Windows
+    CR    // Classic Mac OS
+};
+
+struct Format {
+    Encoding encoding = Utf8;
+    bool bom = false;
+    LineEnding lineEnding = LF;
+    bool mixedLineEndings = false; // Saving writes 'lineEnding' everywhere
+};
+
+// Decodes file contents. Line breaks come back as '\n' whatever they were.
+QString decode(const QByteArray &data, Format *format);
+
+// Encodes text with '\n' line breaks back to 'format'. 'ok' is set to false
+// if the encoding can't represent some character (Latin-1), which was then
+// replaced by '?'.
+QByteArray encode(const QString &text, const Format &format, bool *ok = nullptr);
+
+// Human readable form, e.g. "UTF-8 with BOM", "CRLF"
+QString encodingName(const Format &format);
+QString lineEndingName(LineEnding lineEnding);
+
+// --- Kernels, exposed for the benchmark ---
+// Length of the leading run of ASCII bytes
+qsizetype asciiPrefixLength(const char *data, qsizetype size);
+// Widens the leading ASCII run of 'data' into 'out' (room for 'size' QChars).
+// Returns how many bytes were ASCII and converted.
+qsizetype widenAscii(const char *data, qsizetype size, char16_t *out);
+bool isValidUtf8(const char *data, qsizetype size);
+
+// Name of the kernel selected for this CPU ("avx2", "sse2" or "scalar").
+const char *activeKernel();
+
+}
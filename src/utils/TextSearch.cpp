@@ -0,0 +1,346 @@
+#include "TextSearch.h"
+#include "CpuFeatures.h"
+
+#include <cstring>
+
+#ifdef CPU_FEATURES_X86
+#include <immintrin.h>
+#endif
+
+namespace TextSearch {
+
+typedef unsigned char uchar;
+
+// The needle as the kernels see it. 'first'/'last' are the characters every
+// candidate must have at both ends; with case folding the Alt variants hold
+// the other case of an ASCII letter (otherwise the same character again).
+template <typename T>
+struct Needle {
+    const T *data;
+    qsizetype size;
+    bool fold;
+    T first, firstAlt;
+    T last, lastAlt;
+};
+
+// A kernel scans from 'pos' as far as whole vectors reach. It returns true
+// with 'pos' on a verified match, or false with 'pos' where the scalar code
+// has to continue.
+template <typename T>
+using Kernel = bool (*)(const T *haystack, qsizetype size, const Needle<T> &needle, qsizetype &pos);
+
+template <typename T>
+static inline T foldAscii(T c) {
+    return (c >= 'A' && c <= 'Z') ? T(c + ('a' - 'A')) : c;
+}
+
+template <typename T>
+static inline T otherAsciiCase(T c) {
+    if (c >= 'A' && c <= 'Z') return T(c + ('a' - 'A'));
+    if (c >= 'a' && c <= 'z') return T(c - ('a' - 'A'));
+    return c;
+}
+
+template <typename T>
+static Needle<T> makeNeedle(const T *data, qsizetype size, bool fold) {
+    Needle<T> needle;
+    needle.data = data;
+    needle.size = size;
+    needle.fold = fold;
+    needle.first = data[0];
+    needle.last = data[size - 1];
+    needle.firstAlt = fold ? otherAsciiCase(needle.first) : needle.first;
+    needle.lastAlt = fold ? otherAsciiCase(needle.last) : needle.last;
+    return needle;
+}
+
+template <typename T>
+static inline bool matchesAt(const T *p, const Needle<T> &needle) {
+    if (!needle.fold) return std::memcmp(p, needle.data, size_t(needle.size) * sizeof(T)) == 0;
+    for (qsizetype k = 0; k < needle.size; ++k) {
+        if (foldAscii(p[k]) != foldAscii(needle.data[k])) return false;
+    }
+    return true;
+}
+
+// =========================================================
+// Scalar Fallback
+// =========================================================
+
+template <typename T>
+static qsizetype findScalar(const T *haystack, qsizetype size, const Needle<T> &needle, qsizetype pos) {
+    const qsizetype lastOffset = needle.size - 1;
+    for (qsizetype i = pos; i + lastOffset < size; ++i) {
+        const T a = haystack[i];
+        const T b = haystack[i + lastOffset];
+        if ((a == needle.first || a == needle.firstAlt) && (b == needle.last || b == needle.lastAlt)
+            && matchesAt(haystack + i, needle)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// =========================================================
+// SSE2 / AVX2 Kernels
+// =========================================================
+// "Generic SIMD" substring search (W. Mula): load the text at i and at
+// i + size - 1, compare against the broadcast first and last character and
+// AND the results. Each set lane is a candidate that agrees on both ends,
+// which on real text is rare enough that the full compare hardly matters.
+
+#ifdef CPU_FEATURES_X86
+
+static inline int lowestBit(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return int(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// movemask yields one bit per byte, so a 16-bit lane owns two of them
+#define TEXTSEARCH_KERNEL(name, isa, T, Vec, load, set1, cmpeq, vor, vand, movemask)            \
+    CPU_TARGET(isa)                                                                   \
+    static bool name(const T *haystack, qsizetype size, const Needle<T> &needle, qsizetype &pos) { \
+        const qsizetype lanes = qsizetype(sizeof(Vec) / sizeof(T));                          \
+        const qsizetype lastOffset = needle.size - 1;                                        \
+        const Vec first = set1(needle.first), firstAlt = set1(needle.firstAlt);              \
+        const Vec last = set1(needle.last), lastAlt = set1(needle.lastAlt);                  \
+        const unsigned laneBits = (1u << sizeof(T)) - 1;                                     \
+        qsizetype i = pos;                                                                   \
+        for (; i + lastOffset + lanes <= size; i += lanes) {                                 \
+            const Vec a = load(reinterpret_cast<const Vec *>(haystack + i));                 \
+            const Vec b = load(reinterpret_cast<const Vec *>(haystack + i + lastOffset));    \
+            const Vec eq = vand(vor(cmpeq(a, first), cmpeq(a, firstAlt)),                    \
+                                vor(cmpeq(b, last), cmpeq(b, lastAlt)));                     \
+            unsigned mask = unsigned(movemask(eq));                                          \
+            while (mask) {                                                                   \
+                const int lane = lowestBit(mask) / int(sizeof(T));                           \
+                if (matchesAt(haystack + i + lane, needle)) {                                \
+                    pos = i + lane;                                                          \
+                    return true;                                                             \
+                }                                                                            \
+                mask &= ~(laneBits << (lane * int(sizeof(T))));                              \
+            }                                                                                \
+        }                                                                                    \
+        pos = i;                                                                             \
+        return false;                                                                        \
+    }
+
+TEXTSEARCH_KERNEL(findSse2_8, "sse2", uchar, __m128i, _mm_loadu_si128, _mm_set1_epi8,
+                  _mm_cmpeq_epi8, _mm_or_si128, _mm_and_si128, _mm_movemask_epi8)
+TEXTSEARCH_KERNEL(findSse2_16, "sse2", char16_t, __m128i, _mm_loadu_si128, _mm_set1_epi16,
+                  _mm_cmpeq_epi16, _mm_or_si128, _mm_and_si128, _mm_movemask_epi8)
+TEXTSEARCH_KERNEL(findAvx2_8, "avx2", uchar, __m256i, _mm256_loadu_si256, _mm256_set1_epi8,
+                  _mm256_cmpeq_epi8, _mm256_or_si256, _mm256_and_si256, _mm256_movemask_epi8)
+TEXTSEARCH_KERNEL(findAvx2_16, "avx2", char16_t, __m256i, _mm256_loadu_si256, _mm256_set1_epi16,
+                  _mm256_cmpeq_epi16, _mm256_or_si256, _mm256_and_si256, _mm256_movemask_epi8)
+
+#undef TEXTSEARCH_KERNEL
+
+// Byte counting: cmpeq yields -1 per hit, so subtracting it counts into
+// 8-bit lanes. After at most 255 rounds (before a lane could wrap) psadbw
+// folds the lanes into 64-bit totals.
+typedef qsizetype (*CountKernel)(const uchar *data, qsizetype size, uchar byte, qsizetype &pos);
+
+CPU_TARGET("sse2")
+static qsizetype countSse2(const uchar *data, qsizetype size, uchar byte, qsizetype &pos) {
+    const __m128i target = _mm_set1_epi8(char(byte));
+    const __m128i zero = _mm_setzero_si128();
+    __m128i total = zero;
+    qsizetype i = 0;
+    while (i + 16 <= size) {
+        __m128i lanes = zero;
+        const qsizetype rounds = qMin<qsizetype>(255, (size - i) / 16);
+        for (qsizetype r = 0; r < rounds; ++r, i += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            lanes = _mm_sub_epi8(lanes, _mm_cmpeq_epi8(v, target));
+        }
+        total = _mm_add_epi64(total, _mm_sad_epu8(lanes, zero));
+    }
+    pos = i;
+    alignas(16) quint64 sums[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(sums), total);
+    return qsizetype(sums[0] + sums[1]);
+}
+
+CPU_TARGET("avx2")
+static qsizetype countAvx2(const uchar *data, qsizetype size, uchar byte, qsizetype &pos) {
+    const __m256i target = _mm256_set1_epi8(char(byte));
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i total = zero;
+    qsizetype i = 0;
+    while (i + 32 <= size) {
+        __m256i lanes = zero;
+        const qsizetype rounds = qMin<qsizetype>(255, (size - i) / 32);
+        for (qsizetype r = 0; r < rounds; ++r, i += 32) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            lanes = _mm256_sub_epi8(lanes, _mm256_cmpeq_epi8(v, target));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(lanes, zero));
+    }
+    pos = i;
+    alignas(32) quint64 sums[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(sums), total);
+    return qsizetype(sums[0] + sums[1] + sums[2] + sums[3]);
+}
+
+// ---------------------------------
+// Kernel Selection
+// ---------------------------------
+
+enum KernelId { KernelScalar, KernelSse2, KernelAvx2 };
+
+static KernelId activeKernelId() {
+    static const KernelId kernel = CpuFeatures::hasAvx2() ? KernelAvx2
+                                 : CpuFeatures::hasSse2() ? KernelSse2 : KernelScalar;
+    return kernel;
+}
+
+static Kernel<uchar> kernelFor(const uchar *) {
+    switch (activeKernelId()) {
+        case KernelAvx2: return findAvx2_8;
+        case KernelSse2: return findSse2_8;
+        default: return nullptr;
+    }
+}
+
+static Kernel<char16_t> kernelFor(const char16_t *) {
+    switch (activeKernelId()) {
+        case KernelAvx2: return findAvx2_16;
+        case KernelSse2: return findSse2_16;
+        default: return nullptr;
+    }
+}
+
+static CountKernel countKernel() {
+    switch (activeKernelId()) {
+        case KernelAvx2: return countAvx2;
+        case KernelSse2: return countSse2;
+        default: return nullptr;
+    }
+}
+
+const char *activeKernel() {
+    switch (activeKernelId()) {
+        case KernelAvx2: return "avx2";
+        case KernelSse2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+#else // !CPU_FEATURES_X86
+
+static Kernel<uchar> kernelFor(const uchar *) { return nullptr; }
+static Kernel<char16_t> kernelFor(const char16_t *) { return nullptr; }
+typedef qsizetype (*CountKernel)(const uchar *data, qsizetype size, uchar byte, qsizetype &pos);
+static CountKernel countKernel() { return nullptr; }
+const char *activeKernel() { return "scalar"; }
+
+#endif
+
+// =========================================================
+// Public API
+// =========================================================
+
+template <typename T>
+static qsizetype find(const T *haystack, qsizetype size, const Needle<T> &needle, qsizetype pos) {
+    static const Kernel<T> kernel = kernelFor(static_cast<const T *>(nullptr));
+    if (kernel && kernel(haystack, size, needle, pos)) return pos;
+    return findScalar(haystack, size, needle, pos);
+}
+
+// Qt's case-insensitive search knows all of Unicode; ours only folds ASCII
+static bool needsUnicodeFolding(QStringView needle) {
+    for (QChar c : needle) {
+        if (c.unicode() >= 0x80 && (c.isLower() || c.isUpper() || c.isTitleCase())) return true;
+    }
+    return false;
+}
+
+qsizetype indexOf(QStringView haystack, QStringView needle, qsizetype from, Qt::CaseSensitivity cs) {
+    if (from < 0) from = qMax<qsizetype>(0, from + haystack.size());
+    if (needle.isEmpty()) return from <= haystack.size() ? from : -1;
+    if (needle.size() > haystack.size() - from) return -1;
+
+    const bool fold = cs == Qt::CaseInsensitive;
+    if (fold && needsUnicodeFolding(needle)) return haystack.indexOf(needle, from, cs);
+
+    const Needle<char16_t> n = makeNeedle(needle.utf16(), needle.size(), fold);
+    return find(haystack.utf16(), haystack.size(), n, from);
+}
+
+qsizetype indexOf(QByteArrayView haystack, QByteArrayView needle, qsizetype from, Qt::CaseSensitivity cs) {
+    if (from < 0) from = qMax<qsizetype>(0, from + haystack.size());
+    if (needle.isEmpty()) return from <= haystack.size() ? from : -1;
+    if (needle.size() > haystack.size() - from) return -1;
+
+    const auto *text = reinterpret_cast<const uchar *>(haystack.data());
+    const Needle<uchar> n =
+        makeNeedle(reinterpret_cast<const uchar *>(needle.data()), needle.size(), cs == Qt::CaseInsensitive);
+    return find(text, haystack.size(), n, from);
+}
+
+qsizetype findAll(QStringView haystack, QStringView needle, qsizetype from, qsizetype to,
+                  Qt::CaseSensitivity cs, QVector<int> *positions) {
+    if (needle.isEmpty() || from >= to) return 0;
+
+    // A match starting before 'to' may run past it, but nothing beyond that
+    // has to be looked at
+    const QStringView window = haystack.first(qMin(haystack.size(), to + needle.size() - 1));
+
+    qsizetype found = 0;
+    qsizetype pos = qMax<qsizetype>(0, from);
+    while ((pos = indexOf(window, needle, pos, cs)) >= 0) {
+        if (positions) positions->append(int(pos));
+        ++found;
+        pos += needle.size();
+    }
+    return found;
+}
+
+qsizetype count(QByteArrayView haystack, QByteArrayView needle, Qt::CaseSensitivity cs) {
+    if (needle.isEmpty()) return 0;
+
+    qsizetype found = 0;
+    qsizetype pos = 0;
+    while ((pos = indexOf(haystack, needle, pos, cs)) >= 0) {
+        ++found;
+        pos += needle.size();
+    }
+    return found;
+}
+
+qsizetype count(QByteArrayView haystack, char byte) {
+    static const CountKernel kernel = countKernel();
+    const auto *data = reinterpret_cast<const uchar *>(haystack.data());
+    const qsizetype size = haystack.size();
+
+    qsizetype pos = 0;
+    qsizetype found = kernel ? kernel(data, size, uchar(byte), pos) : 0;
+    for (; pos < size; ++pos) found += data[pos] == uchar(byte);
+    return found;
+}
+
+bool canSelfOverlap(QStringView needle, Qt::CaseSensitivity cs) {
+    // Matches can overlap exactly when the needle has a border: a proper
+    // prefix that is also a suffix ("abcab"). That's the last entry of the
+    // KMP failure table.
+    auto same = [cs](QChar a, QChar b) {
+        return cs == Qt::CaseSensitive ? a == b : a.toCaseFolded() == b.toCaseFolded();
+    };
+
+    QVector<qsizetype> border(needle.size(), 0);
+    for (qsizetype i = 1; i < needle.size(); ++i) {
+        qsizetype k = border[i - 1];
+        while (k > 0 && !same(needle[i], needle[k])) k = border[k - 1];
+        if (same(needle[i], needle[k])) ++k;
+        border[i] = k;
+    }
+    return !needle.isEmpty() && border.last() > 0;
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <QStringView>
+#include <QByteArrayView>
+#include <QVector>
+
+namespace TextSearch {
+
+// Vectorized literal substring search for UTF-16 text (QString, documents)
+// and 8-bit text (memory-mapped files).
+//
+// Candidates are found 16/32 bytes at a time by comparing the needle's first
+// and last character against the text at once (AVX2 or SSE2, picked at
+// runtime like Base64), and only candidates are verified with a full compare.
+// Case-insensitive search folds ASCII letters in the kernel; UTF-16 needles
+// with other cased letters go through Qt's own search.
+
+// Index of the first match at or after 'from', or -1
+qsizetype indexOf(QStringView haystack, QStringView needle, qsizetype from = 0,
+                  Qt::CaseSensitivity cs = Qt::CaseSensitive);
+qsizetype indexOf(QByteArrayView haystack, QByteArrayView needle, qsizetype from = 0,
+                  Qt::CaseSensitivity cs = Qt::CaseSensitive);
+
+// Non-overlapping matches starting in [from, to), scanning left to right.
+// Start offsets are appended to 'positions' if it's not null. Returns the count.
+qsizetype findAll(QStringView haystack, QStringView needle, qsizetype from, qsizetype to,
+                  Qt::CaseSensitivity cs, QVector<int> *positions);
+qsizetype count(QByteArrayView haystack, QByteArrayView needle,
+                Qt::CaseSensitivity cs = Qt::CaseSensitive);
+
+// Occurrences of one byte ('\n' for line counting), at memory bandwidth
+qsizetype count(QByteArrayView haystack, char byte);
+
+// True if two matches of 'needle' can overlap ("aa" in "aaa"). Only needles
+// that can't may be searched in independent chunks: then every match lies in
+// exactly one chunk no matter where the chunks are cut.
+bool canSelfOverlap(QStringView needle, Qt::CaseSensitivity cs);
+
+// Name of the kernel selected for this CPU ("avx2", "sse2" or "scalar").
+const char *activeKernel();
+
+}
@@ -0,0 +1,69 @@
+// Base64 against QByteArray's own encoder and decoder, at every size around
+// the kernels' block lengths so the vector loops and the scalar tails both run.
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include "utils/Base64.h"
+
+class Base64Test : public QObject {
+    Q_OBJECT
+
+private slots:
+    void matchesQt();
+    void skipsCharactersOutsideTheAlphabet();
+    void stopsAtPadding();
+    void staysWithinDecodedSizeBound();
+};
+
+static QByteArray randomBytes(int size, quint32 seed) {
+    QByteArray bytes(size, Qt::Uninitialized);
+    QRandomGenerator rng(seed);
+    for (char &byte : bytes) byte = char(rng.bounded(256));
+    return bytes;
+}
+
+void Base64Test::matchesQt() {
+    for (int size = 0; size <= 300; ++size) {
+        const QByteArray raw = randomBytes(size, quint32(size));
+        const QByteArray encoded = Base64::encode(raw);
+        QCOMPARE(encoded, raw.toBase64());
+        QCOMPARE(qsizetype(Base64::encodedSize(size)), encoded.size());
+        QCOMPARE(Base64::decode(encoded), raw);
+    }
+    const QByteArray large = randomBytes(1 << 20, 42);
+    QCOMPARE(Base64::encode(large), large.toBase64());
+    QCOMPARE(Base64::decode(large.toBase64()), large);
+}
+
+void Base64Test::skipsCharactersOutsideTheAlphabet() {
+    QCOMPARE(Base64::decode(QByteArray("SGVs\nbG8g\r\nd29y bGQ=")), QByteArray("Hello world"));
+
+    // Line-wrapped like a MIME body, long enough for the vector loops
+    const QByteArray raw = randomBytes(4096, 7);
+    QByteArray wrapped;
+    const QByteArray encoded = raw.toBase64();
+    for (qsizetype at = 0; at < encoded.size(); at += 76) wrapped += encoded.mid(at, 76) + "\r\n";
+    QCOMPARE(Base64::decode(wrapped), raw);
+}
+
+void Base64Test::stopsAtPadding() {
+    QCOMPARE(Base64::decode(QByteArray("SGk=SGk=")), QByteArray("Hi"));
+    QCOMPARE(Base64::decode(QByteArray("=")), QByteArray());
+}
+
+void Base64Test::staysWithinDecodedSizeBound() {
+    const char kGuard = char(0x5a);
+    for (int size = 0; size <= 200; ++size) {
+        const QByteArray encoded = randomBytes(size, quint32(size) + 1000).toBase64().left(size);
+        const size_t bound = Base64::decodedSizeBound(size_t(encoded.size()));
+
+        QByteArray out(qsizetype(bound) + 64, kGuard);
+        const size_t written = Base64::decode(encoded.constData(), size_t(encoded.size()), out.data());
+        QVERIFY(written <= bound);
+        for (qsizetype i = qsizetype(bound); i < out.size(); ++i) QCOMPARE(out.at(i), kGuard);
+    }
+}
+
+QObject *createBase64Test() { return new Base64Test; }
+
+#include "Base64Test.moc"
@@ -0,0 +1,124 @@
+// The LCS diff of the diff view and the Myers hunks used to reload files.
+#include <QRandomGenerator>
+#include <QtTest>
+
+#include "utils/DiffHelpers.h"
+
+using namespace DiffHelpers;
+
+class DiffHelpersTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void diffIgnoresWhitespace();
+    void diffListsDeletionsBeforeInsertions();
+    void hunksOfSimpleEdits();
+    void hunksRebuildTheNewText();
+    void tooManyEditsBecomeOneHunk();
+};
+
+// Applies hunks to 'oldLines'; the result must be 'newLines'
+static QStringList applyHunks(QStringList lines, const QVector<LineHunk> &hunks, const QStringList &newLines) {
+    // Back to front, so earlier positions stay valid
+    for (int i = hunks.size() - 1; i >= 0; --i) {
+        const LineHunk &hunk = hunks[i];
+        lines.remove(hunk.oldStart, hunk.oldCount);
+        for (int k = 0; k < hunk.newCount; ++k) lines.insert(hunk.oldStart + k, newLines[hunk.newStart + k]);
+    }
+    return lines;
+}
+
+void DiffHelpersTest::diffIgnoresWhitespace() {
+    const QVector<DiffHunk> diff = computeDiff({"a", "b"}, {"a", "  b", "c"});
+    QCOMPARE(diff.size(), 3);
+    QCOMPARE(diff[0].type, NoChange);
+    QCOMPARE(diff[1].type, NoChange);
+    QCOMPARE(diff[1].line, QString("b"));
+    QCOMPARE(diff[2].type, Inserted);
+    QCOMPARE(diff[2].line, QString("c"));
+}
+
+void DiffHelpersTest::diffListsDeletionsBeforeInsertions() {
+    const QVector<DiffHunk> diff = computeDiff({"x"}, {"y"});
+    QCOMPARE(diff.size(), 2);
+    QCOMPARE(diff[0].type, Deleted);
+    QCOMPARE(diff[0].line, QString("x"));
+    QCOMPARE(diff[1].type, Inserted);
+    QCOMPARE(diff[1].line, QString("y"));
+}
+
+void DiffHelpersTest::hunksOfSimpleEdits() {
+    QVERIFY(computeHunks({"a", "b", "c"}, {"a", "b", "c"}).isEmpty());
+
+    QVector<LineHunk> hunks = computeHunks({"a", "b", "c"}, {"a", "x", "c"});
+    QCOMPARE(hunks.size(), 1);
+    QCOMPARE(hunks[0].oldStart, 1);
+    QCOMPARE(hunks[0].oldCount, 1);
+    QCOMPARE(hunks[0].newStart, 1);
+    QCOMPARE(hunks[0].newCount, 1);
+
+    hunks = computeHunks({"a"}, {"a", "b"});
+    QCOMPARE(hunks.size(), 1);
+    QCOMPARE(hunks[0].oldStart, 1);
+    QCOMPARE(hunks[0].oldCount, 0);
+    QCOMPARE(hunks[0].newCount, 1);
+
+    hunks = computeHunks({"a", "b", "c"}, {"a", "c"});
+    QCOMPARE(hunks.size(), 1);
+    QCOMPARE(hunks[0].oldStart, 1);
+    QCOMPARE(hunks[0].oldCount, 1);
+    QCOMPARE(hunks[0].newCount, 0);
+
+    // Whitespace counts here: reloading must reproduce the file exactly
+    QCOMPARE(computeHunks({"a"}, {" a"}).size(), 1);
+}
+
+void DiffHelpersTest::hunksRebuildTheNewText() {
+    QRandomGenerator rng(1);
+    for (int round = 0; round < 200; ++round) {
+        QStringList oldLines;
+        for (int i = 0; i < 60; ++i) oldLines << QString::number(rng.bounded(8));
+
+        // Random line edits on a copy (small alphabet, so lines repeat)
+        QStringList newLines = oldLines;
+        const int edits = rng.bounded(12);
+        for (int e = 0; e < edits; ++e) {
+            const int at = rng.bounded(newLines.size() + 1);
+            switch (rng.bounded(3)) {
+            case 0: newLines.insert(at, QString::number(rng.bounded(8))); break;
+            case 1: if (at < newLines.size()) newLines.removeAt(at); break;
+            default: if (at < newLines.size()) newLines[at] = "changed"; break;
+            }
+        }
+
+        const QVector<LineHunk> hunks = computeHunks(oldLines, newLines);
+        QCOMPARE(applyHunks(oldLines, hunks, newLines), newLines);
+        for (int i = 1; i < hunks.size(); ++i) {
+            QVERIFY(hunks[i].oldStart >= hunks[i - 1].oldStart + hunks[i - 1].oldCount);
+        }
+    }
+}
+
+void DiffHelpersTest::tooManyEditsBecomeOneHunk() {
+    QStringList oldLines, newLines;
+    oldLines << "same";
+    newLines << "same";
+    for (int i = 0; i < 10; ++i) {
+        oldLines << QString("old %1").arg(i);
+        newLines << QString("new %1").arg(i);
+    }
+    oldLines << "end";
+    newLines << "end";
+
+    const QVector<LineHunk> hunks = computeHunks(oldLines, newLines, 3);
+    QCOMPARE(hunks.size(), 1);
+    QCOMPARE(hunks[0].oldStart, 1);
+    QCOMPARE(hunks[0].oldCount, 10);
+    QCOMPARE(hunks[0].newStart, 1);
+    QCOMPARE(hunks[0].newCount, 10);
+    QCOMPARE(applyHunks(oldLines, hunks, newLines), newLines);
+}
+
+QObject *createDiffHelpersTest() { return new DiffHelpersTest; }
+
+#include "DiffHelpersTest.moc"
@@ -0,0 +1,130 @@
+// The regex-to-DFA compiler and the line lexer, on a small C-like grammar.
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtTest>
+#include <memory>
+
+#include "Grammar.h"
+
+class GrammarTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void tokenizesScopesAndKeywords();
+    void longestMatchWins();
+    void regionsContinueOnTheNextLine();
+    void rawStringsEndAtTheirDelimiter();
+    void reportsInvalidPatterns();
+
+private:
+    // "keyword", "constant.numeric", ... -> index into scopeNames()
+    int scope(const char *name) const { return int(m_grammar->scopeNames().indexOf(QString::fromLatin1(name))); }
+
+    std::unique_ptr<Grammar> m_grammar;
+};
+
+void GrammarTest::initTestCase() {
+    const QJsonObject definition{
+        {"name", "Test"},
+        {"regions", QJsonArray{
+            QJsonObject{{"begin", "/\\*"}, {"end", "*/"}, {"scope", "comment"}},
+            QJsonObject{{"begin", "R\"[^ ()\\\\]{0,16}\\("}, {"end", ")${delim}\""},
+                        {"delimiterAfter", "\""}, {"delimiterBefore", "("}, {"scope", "string"}}}},
+        {"tokens", QJsonArray{
+            QJsonObject{{"match", "//.*"}, {"scope", "comment"}},
+            QJsonObject{{"match", "[0-9]+"}, {"scope", "constant.numeric"}},
+            QJsonObject{{"match", "[A-Za-z_][A-Za-z0-9_]*"}, {"keywords", true}}}},
+        {"keywords", QJsonObject{{"keyword", QJsonArray{"int", "return"}}}}};
+
+    QString error;
+    m_grammar.reset(Grammar::compile(definition, &error));
+    QVERIFY2(m_grammar, qPrintable(error));
+    QCOMPARE(m_grammar->name(), QString("Test"));
+}
+
+void GrammarTest::tokenizesScopesAndKeywords() {
+    QVector<Grammar::Token> tokens;
+    const Grammar::LexState out = m_grammar->tokenize("int x = 42; // note", Grammar::LexState(), &tokens);
+    QCOMPARE(out.region, -1);
+
+    // Plain identifiers and punctuation get no token
+    QCOMPARE(tokens.size(), 3);
+    QCOMPARE(tokens[0].start, 0);
+    QCOMPARE(tokens[0].length, 3);
+    QCOMPARE(tokens[0].scope, scope("keyword"));
+    QVERIFY(m_grammar->isKeywordScope(tokens[0].scope));
+    QCOMPARE(tokens[1].start, 8);
+    QCOMPARE(tokens[1].length, 2);
+    QCOMPARE(tokens[1].scope, scope("constant.numeric"));
+    QCOMPARE(tokens[2].start, 12);
+    QCOMPARE(tokens[2].length, 7);
+    QCOMPARE(tokens[2].scope, scope("comment"));
+}
+
+void GrammarTest::longestMatchWins() {
+    // "integer" is one identifier, not the keyword "int" and "eger"
+    QVector<Grammar::Token> tokens;
+    m_grammar->tokenize("integer returned return", Grammar::LexState(), &tokens);
+    QCOMPARE(tokens.size(), 1);
+    QCOMPARE(tokens[0].start, 17);
+    QCOMPARE(tokens[0].length, 6);
+}
+
+void GrammarTest::regionsContinueOnTheNextLine() {
+    QVector<Grammar::Token> tokens;
+    Grammar::LexState state = m_grammar->tokenize("int a; /* open", Grammar::LexState(), &tokens);
+    QCOMPARE(state.region, 0);
+    QCOMPARE(tokens.last().start, 7);
+    QCOMPARE(tokens.last().length, 7);
+    QCOMPARE(tokens.last().scope, scope("comment"));
+
+    state = m_grammar->tokenize("still inside", state, &tokens);
+    QCOMPARE(state.region, 0);
+    QCOMPARE(tokens.size(), 1);
+    QCOMPARE(tokens[0].length, 12);
+
+    state = m_grammar->tokenize("done */ return 1", state, &tokens);
+    QCOMPARE(state.region, -1);
+    QCOMPARE(tokens.size(), 3);
+    QCOMPARE(tokens[0].start, 0);
+    QCOMPARE(tokens[0].length, 7);
+    QCOMPARE(tokens[1].scope, scope("keyword"));
+    QCOMPARE(tokens[2].scope, scope("constant.numeric"));
+}
+
+void GrammarTest::rawStringsEndAtTheirDelimiter() {
+    QVector<Grammar::Token> tokens;
+    Grammar::LexState state = m_grammar->tokenize("R\"xy(a )\" b", Grammar::LexState(), &tokens);
+    QCOMPARE(state.region, 1);
+    QCOMPARE(state.delimiter, QString("xy"));
+
+    // ')"' alone doesn't close it, ')xy"' does
+    state = m_grammar->tokenize(")\" still )xy\" 7", state, &tokens);
+    QCOMPARE(state.region, -1);
+    QCOMPARE(tokens.size(), 2);
+    QCOMPARE(tokens[0].length, 13);
+    QCOMPARE(tokens[0].scope, scope("string"));
+    QCOMPARE(tokens[1].scope, scope("constant.numeric"));
+}
+
+void GrammarTest::reportsInvalidPatterns() {
+    QString error;
+    const QJsonObject definition{
+        {"name", "Broken"},
+        {"tokens", QJsonArray{QJsonObject{{"match", "(abc"}, {"scope", "x"}}}}};
+    std::unique_ptr<Grammar> grammar(Grammar::compile(definition, &error));
+    QVERIFY(!grammar);
+    QVERIFY(error.contains("missing ')'"));
+
+    const QJsonObject noEnd{
+        {"name", "Broken"},
+        {"regions", QJsonArray{QJsonObject{{"begin", "/\\*"}, {"scope", "comment"}}}}};
+    grammar.reset(Grammar::compile(noEnd, &error));
+    QVERIFY(!grammar);
+    QVERIFY(error.contains("no end marker"));
+}
+
+QObject *createGrammarTest() { return new GrammarTest; }
+
+#include "GrammarTest.moc"
@@ -0,0 +1,165 @@
+// The sparse line index of the log viewer: scanning, batches and the cache format.
+#include <QBuffer>
+#include <QDataStream>
+#include <QtTest>
+
+#include "LineIndex.h"
+
+class LineIndexTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void countsLines();
+    void checkpointsPointAtLineStarts();
+    void batchesAddUp();
+    void roundTripsThroughTheCache();
+    void rejectsDamagedCacheData();
+};
+
+// "line 0\nline 1\n..." with the offset of every line start
+static QByteArray makeLines(int count, QVector<qint64> *starts) {
+    QByteArray text;
+    for (int i = 0; i < count; ++i) {
+        if (starts) starts->append(text.size());
+        text += "line " + QByteArray::number(i) + '\n';
+    }
+    return text;
+}
+
+static LineIndex indexText(const QByteArray &text) {
+    QBuffer buffer;
+    buffer.setData(text);
+    buffer.open(QIODevice::ReadOnly);
+
+    LineIndex::Batch batch;
+    LineIndex index;
+    if (LineIndex::scan(&buffer, 0, text.size(), 0, &batch, nullptr)) index.append(batch);
+    return index;
+}
+
+void LineIndexTest::countsLines() {
+    QCOMPARE(indexText(QByteArray()).lineCount(), 0);
+    QCOMPARE(indexText("a\n").lineCount(), 1);
+    QCOMPARE(indexText("a\nb").lineCount(), 2);
+    QCOMPARE(indexText("\n\n\n").lineCount(), 3);
+
+    const LineIndex index = indexText(makeLines(5000, nullptr));
+    QCOMPARE(index.newlineCount(), 5000);
+    QCOMPARE(index.lineCount(), 5000);
+}
+
+void LineIndexTest::checkpointsPointAtLineStarts() {
+    QVector<qint64> starts;
+    const QByteArray text = makeLines(5000, &starts);
+    const LineIndex index = indexText(text);
+    QCOMPARE(index.indexedBytes(), qint64(text.size()));
+
+    for (qint64 line : {0, 1, 1023, 1024, 2500, 4096, 4999}) {
+        qint64 checkpointLine = -1;
+        qint64 offset = -1;
+        index.checkpointFor(line, &checkpointLine, &offset);
+        QCOMPARE(checkpointLine, line / LineIndex::kStride * LineIndex::kStride);
+        QCOMPARE(offset, starts[checkpointLine]);
+    }
+}
+
+void LineIndexTest::batchesAddUp() {
+    const QByteArray text = makeLines(3000, nullptr);
+    const LineIndex whole = indexText(text);
+
+    // Cut in the middle of a line, like a worker's read size would
+    QBuffer buffer;
+    buffer.setData(text);
+    buffer.open(QIODevice::ReadOnly);
+    const qint64 cut = text.size() / 2 + 3;
+
+    LineIndex index;
+    LineIndex::Batch first, second;
+    QVERIFY(LineIndex::scan(&buffer, 0, cut, 0, &first, nullptr));
+    index.append(first);
+    QVERIFY(LineIndex::scan(&buffer, cut, text.size(), index.newlineCount(), &second, nullptr));
+    index.append(second);
+
+    // A batch that doesn't continue where the index ends is ignored
+    index.append(first);
+
+    QCOMPARE(index.newlineCount(), whole.newlineCount());
+    QCOMPARE(index.indexedBytes(), whole.indexedBytes());
+    for (qint64 line = 0; line < 3000; line += 700) {
+        qint64 a, b, c, d;
+        index.checkpointFor(line, &a, &b);
+        whole.checkpointFor(line, &c, &d);
+        QCOMPARE(a, c);
+        QCOMPARE(b, d);
+    }
+}
+
+void LineIndexTest::roundTripsThroughTheCache() {
+    const LineIndex index = indexText(makeLines(3000, nullptr) + "tail");
+
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        index.write(out);
+    }
+    LineIndex copy;
+    QDataStream in(data);
+    QVERIFY(copy.read(in));
+    QCOMPARE(copy.lineCount(), index.lineCount());
+    QCOMPARE(copy.indexedBytes(), index.indexedBytes());
+
+    qint64 a, b, c, d;
+    copy.checkpointFor(2999, &a, &b);
+    index.checkpointFor(2999, &c, &d);
+    QCOMPARE(a, c);
+    QCOMPARE(b, d);
+}
+
+void LineIndexTest::rejectsDamagedCacheData() {
+    const LineIndex original = indexText(makeLines(3000, nullptr));
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        original.write(out);
+    }
+
+    // Truncated
+    LineIndex index = indexText("a\nb\n");
+    QDataStream truncated(data.left(data.size() - 3));
+    QVERIFY(!index.read(truncated));
+    QCOMPARE(index.lineCount(), 2); // Untouched
+
+    // Checkpoints that don't fit the newline count, or leave the file
+    auto encode = [](const QVector<qint64> &checkpoints, qint64 newlines, qint64 bytes) {
+        QByteArray bad;
+        QDataStream out(&bad, QIODevice::WriteOnly);
+        out << checkpoints << newlines << bytes << true;
+        return bad;
+    };
+    const QByteArray cases[] = {
+        encode({0, 100}, 10, 1000),                  // Too many checkpoints
+        encode({0}, 5000, 100000),                   // Too few
+        encode({0}, -1, 10),                         // Negative count
+        encode({0, 5000}, LineIndex::kStride, 4000), // Past the end
+        encode({0, 900, 800}, 2 * LineIndex::kStride, 5000), // Not ascending
+    };
+    for (const QByteArray &bad : cases) {
+        QDataStream in(bad);
+        QVERIFY(!index.read(in));
+        QCOMPARE(index.lineCount(), 2);
+    }
+
+    // A count far beyond the data is refused before anything is allocated
+    QByteArray huge;
+    {
+        QDataStream out(&huge, QIODevice::WriteOnly);
+        out << quint32(0xfffffff0) << qint64(0);
+    }
+    QDataStream in(huge);
+    QVERIFY(!index.read(in));
+    QCOMPARE(index.lineCount(), 2);
+}
+
+QObject *createLineIndexTest() { return new LineIndexTest; }
+
+#include "LineIndexTest.moc"
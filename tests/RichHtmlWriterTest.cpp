@@ -0,0 +1,140 @@
+// The streaming HTML writer: what it writes must load back with setHtml() as
+// the same document structure.
+#include <QBuffer>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextList>
+#include <QtTest>
+
+#include "RichHtmlWriter.h"
+
+class RichHtmlWriterTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void nestedAndNumberedListsRoundTrip();
+    void blockFormatsRoundTrip();
+    void pixelSizedFontsHaveNoPointSize();
+};
+
+static QByteArray writeHtml(const QTextDocument &document) {
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    RichHtmlWriter writer(&document);
+    if (!writer.write(&buffer)) return QByteArray();
+    return buffer.data();
+}
+
+static QTextListFormat listFormat(QTextListFormat::Style style, int indent) {
+    QTextListFormat format;
+    format.setStyle(style);
+    format.setIndent(indent);
+    return format;
+}
+
+void RichHtmlWriterTest::nestedAndNumberedListsRoundTrip() {
+    // before
+    // 1. first
+    // 2. second
+    //    o nested a
+    //    o nested b
+    // 3. third
+    //    i. roman
+    // after
+    QTextDocument document;
+    QTextCursor cursor(&document);
+    cursor.insertText("before");
+    cursor.insertBlock();
+    QTextList *outer = cursor.createList(listFormat(QTextListFormat::ListDecimal, 1));
+    cursor.insertText("first");
+    cursor.insertBlock();
+    cursor.insertText("second");
+    cursor.insertBlock();
+    cursor.createList(listFormat(QTextListFormat::ListCircle, 2));
+    cursor.insertText("nested a");
+    cursor.insertBlock();
+    cursor.insertText("nested b");
+    cursor.insertBlock();
+    outer->add(cursor.block());
+    cursor.insertText("third");
+    cursor.insertBlock();
+    cursor.createList(listFormat(QTextListFormat::ListLowerRoman, 2));
+    cursor.insertText("roman");
+    cursor.insertBlock();
+    cursor.setBlockFormat(QTextBlockFormat());
+    cursor.insertText("after");
+
+    const QByteArray html = writeHtml(document);
+    QVERIFY(!html.isEmpty());
+    QTextDocument copy;
+    copy.setHtml(QString::fromUtf8(html));
+    QCOMPARE(copy.blockCount(), document.blockCount());
+
+    for (QTextBlock a = document.begin(), b = copy.begin(); a.isValid(); a = a.next(), b = b.next()) {
+        QCOMPARE(b.text(), a.text());
+        QCOMPARE(bool(b.textList()), bool(a.textList()));
+        if (!a.textList()) continue;
+        QCOMPARE(b.textList()->format().style(), a.textList()->format().style());
+        QCOMPARE(b.textList()->format().indent(), a.textList()->format().indent());
+        QCOMPARE(b.textList()->itemNumber(b), a.textList()->itemNumber(a));
+    }
+
+    // "third" continues the numbering of "first" and "second" after the nested list
+    const QTextBlock first = copy.findBlockByNumber(1);
+    const QTextBlock third = copy.findBlockByNumber(5);
+    QCOMPARE(third.textList(), first.textList());
+    QCOMPARE(third.textList()->itemText(third), QString("3."));
+}
+
+void RichHtmlWriterTest::blockFormatsRoundTrip() {
+    QTextDocument document;
+    QTextCursor cursor(&document);
+
+    QTextBlockFormat centered;
+    centered.setAlignment(Qt::AlignHCenter);
+    cursor.setBlockFormat(centered);
+    cursor.insertText("centered");
+
+    QTextBlockFormat indented;
+    indented.setIndent(2);
+    indented.setTopMargin(12);
+    indented.setLeftMargin(30);
+    indented.setTextIndent(10);
+    cursor.insertBlock(indented);
+    cursor.insertText("indented");
+
+    QTextDocument copy;
+    copy.setHtml(QString::fromUtf8(writeHtml(document)));
+    QCOMPARE(copy.blockCount(), 2);
+
+    const QTextBlockFormat a = copy.firstBlock().blockFormat();
+    QCOMPARE(Qt::Alignment(a.alignment() & Qt::AlignHorizontal_Mask), Qt::Alignment(Qt::AlignHCenter));
+
+    const QTextBlockFormat b = copy.lastBlock().blockFormat();
+    QCOMPARE(b.indent(), 2);
+    QCOMPARE(b.topMargin(), 12.0);
+    QCOMPARE(b.leftMargin(), 30.0);
+    QCOMPARE(b.textIndent(), 10.0);
+}
+
+void RichHtmlWriterTest::pixelSizedFontsHaveNoPointSize() {
+    QTextDocument document;
+    QFont font = document.defaultFont();
+    font.setPixelSize(14);
+    document.setDefaultFont(font);
+
+    QTextCursor cursor(&document);
+    QTextCharFormat pixels;
+    pixels.setProperty(QTextFormat::FontPixelSize, 20);
+    cursor.insertText("text", pixels);
+
+    const QByteArray html = writeHtml(document);
+    QVERIFY(!html.contains("font-size:-1pt"));
+    QVERIFY(html.contains("font-size:14px"));
+    QVERIFY(html.contains("font-size:20px"));
+}
+
+QObject *createRichHtmlWriterTest() { return new RichHtmlWriterTest; }
+
+#include "RichHtmlWriterTest.moc"
@@ -0,0 +1,38 @@
+// Unit tests for editor_core. Built by default; run them with ctest, or
+// ./core_tests for the full QtTest output (QtTest options apply to every class).
+#include <QGuiApplication>
+#include <QtTest>
+#include <memory>
+
+QObject *createBase64Test();
+QObject *createDiffHelpersTest();
+QObject *createGrammarTest();
+QObject *createLineIndexTest();
+QObject *createRichHtmlWriterTest();
+QObject *createTextCodecTest();
+QObject *createTextSearchTest();
+QObject *createUndoHistoryTest();
+
+int main(int argc, char *argv[]) {
+    // Documents need a GUI application for their layout, not a display
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    QObject *(*const tests[])() = {
+        createBase64Test,
+        createDiffHelpersTest,
+        createGrammarTest,
+        createLineIndexTest,
+        createRichHtmlWriterTest,
+        createTextCodecTest,
+        createTextSearchTest,
+        createUndoHistoryTest,
+    };
+
+    int failed = 0;
+    for (auto create : tests) {
+        std::unique_ptr<QObject> test(create());
+        failed += QTest::qExec(test.get(), argc, argv);
+    }
+    return failed == 0 ? 0 : 1;
+}
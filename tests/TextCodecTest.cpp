@@ -0,0 +1,114 @@
+// Encoding and line ending detection, the round trip back to the same bytes,
+// and the ASCII kernels against plain loops.
+#include <QtTest>
+
+#include "utils/TextCodec.h"
+
+using namespace TextCodec;
+
+class TextCodecTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void detects_data();
+    void detects();
+    void mixedLineEndings();
+    void latin1CantHoldEverything();
+    void asciiKernelsMatchScalar();
+    void validatesUtf8();
+};
+
+void TextCodecTest::detects_data() {
+    QTest::addColumn<QByteArray>("bytes");
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<int>("encoding");
+    QTest::addColumn<bool>("bom");
+    QTest::addColumn<int>("lineEnding");
+
+    QTest::newRow("ascii") << QByteArray("a\nb\n") << QString("a\nb\n") << int(Utf8) << false << int(LF);
+    QTest::newRow("empty") << QByteArray() << QString() << int(Utf8) << false << int(LF);
+    QTest::newRow("crlf") << QByteArray("a\r\nb\r\n") << QString("a\nb\n") << int(Utf8) << false << int(CRLF);
+    QTest::newRow("cr") << QByteArray("a\rb\r") << QString("a\nb\n") << int(Utf8) << false << int(CR);
+    QTest::newRow("utf8") << QByteArray("h\xc3\xa9!") << QString::fromUtf8("h\xc3\xa9!") << int(Utf8) << false << int(LF);
+    QTest::newRow("utf8 bom") << QByteArray("\xef\xbb\xbfhi") << QString("hi") << int(Utf8) << true << int(LF);
+    QTest::newRow("latin1") << QByteArray("caf\xe9\n") << QString::fromLatin1("caf\xe9\n") << int(Latin1) << false << int(LF);
+    QTest::newRow("utf16le bom") << QByteArray("\xff\xfeh\0i\0", 6) << QString("hi") << int(Utf16LE) << true << int(LF);
+    QTest::newRow("utf16be bom") << QByteArray("\xfe\xff\0h\0i", 6) << QString("hi") << int(Utf16BE) << true << int(LF);
+    QTest::newRow("utf16le") << QByteArray("h\0e\0l\0l\0o\0\r\0\n\0", 14) << QString("hello\n") << int(Utf16LE)
+                             << false << int(CRLF);
+}
+
+void TextCodecTest::detects() {
+    QFETCH(QByteArray, bytes);
+    QFETCH(QString, text);
+    QFETCH(int, encoding);
+    QFETCH(bool, bom);
+    QFETCH(int, lineEnding);
+
+    Format format;
+    QCOMPARE(decode(bytes, &format), text);
+    QCOMPARE(int(format.encoding), encoding);
+    QCOMPARE(format.bom, bom);
+    QCOMPARE(int(format.lineEnding), lineEnding);
+    QVERIFY(!format.mixedLineEndings);
+
+    // Saving writes back exactly what was read
+    bool ok = false;
+    QCOMPARE(encode(text, format, &ok), bytes);
+    QVERIFY(ok);
+}
+
+void TextCodecTest::mixedLineEndings() {
+    Format format;
+    QCOMPARE(decode("a\r\nb\nc\r\n", &format), QString("a\nb\nc\n"));
+    QVERIFY(format.mixedLineEndings);
+}
+
+void TextCodecTest::latin1CantHoldEverything() {
+    Format format;
+    format.encoding = Latin1;
+    bool ok = true;
+    QCOMPARE(encode(QString::fromUtf8("\xe2\x82\xac"), format, &ok), QByteArray("?"));
+    QVERIFY(!ok);
+}
+
+void TextCodecTest::asciiKernelsMatchScalar() {
+    // Every position of the first non-ASCII byte, and every length, around
+    // the 16/32-byte vector widths
+    QByteArray data(300, 'a');
+    for (int i = 0; i < data.size(); ++i) data[i] = char(' ' + i % 90);
+
+    for (int stop = 0; stop <= data.size(); ++stop) {
+        QByteArray bytes = data;
+        if (stop < bytes.size()) bytes[stop] = char(0x80 + stop % 64);
+
+        for (int size : {stop, int(bytes.size())}) {
+            const qsizetype expected = qMin(stop, size);
+            QCOMPARE(asciiPrefixLength(bytes.constData(), size), expected);
+
+            QVector<char16_t> out(size + 1, u'#');
+            const qsizetype widened = widenAscii(bytes.constData(), size, out.data());
+            QCOMPARE(widened, expected);
+            for (qsizetype i = 0; i < widened; ++i) QCOMPARE(int(out[i]), int(uchar(bytes[i])));
+        }
+    }
+}
+
+void TextCodecTest::validatesUtf8() {
+    QVERIFY(isValidUtf8("plain", 5));
+    QVERIFY(isValidUtf8("h\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80", 12));
+    QVERIFY(!isValidUtf8("\xc3(", 2));          // Bad continuation
+    QVERIFY(!isValidUtf8("\xe2\x82", 2));       // Truncated
+    QVERIFY(!isValidUtf8("\xc0\xaf", 2));       // Overlong
+    QVERIFY(!isValidUtf8("\xed\xa0\x80", 3));   // Surrogate
+
+    // A bad byte after a long ASCII run (past the vector kernels)
+    QByteArray long_(1000, 'x');
+    QVERIFY(isValidUtf8(long_.constData(), long_.size()));
+    long_[999] = char(0xff);
+    QVERIFY(!isValidUtf8(long_.constData(), long_.size()));
+}
+
+QObject *createTextCodecTest() { return new TextCodecTest; }
+
+#include "TextCodecTest.moc"
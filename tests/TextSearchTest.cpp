@@ -0,0 +1,109 @@
+// The vectorized search against Qt's own, with matches at every offset
+// around the vector widths and near the end of the text.
+#include <QRandomGenerator>
+#include <QtTest>
+#include <algorithm>
+
+#include "utils/TextSearch.h"
+
+class TextSearchTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void matchesQtAtEveryOffset();
+    void foldsAsciiCase();
+    void fallsBackForUnicodeCase();
+    void bytesMatchQt();
+    void findAllIsNonOverlapping();
+    void countsBytes();
+    void selfOverlap();
+};
+
+// Random text over a small alphabet, so partial matches are frequent
+static QString randomText(int size, quint32 seed) {
+    QRandomGenerator rng(seed);
+    QString text(size, Qt::Uninitialized);
+    for (QChar &c : text) c = QLatin1Char("abcAB \n"[rng.bounded(7)]);
+    return text;
+}
+
+void TextSearchTest::matchesQtAtEveryOffset() {
+    const QString haystack = randomText(300, 1);
+    for (const QString needle : {"a", "ab", "abc", "cab", "a b", "aaaa", "bcAB a"}) {
+        for (qsizetype from = 0; from <= haystack.size(); ++from) {
+            QCOMPARE(TextSearch::indexOf(haystack, needle, from), haystack.indexOf(needle, from));
+        }
+    }
+
+    // A match that ends on the very last character
+    const QString text = QString(100, QLatin1Char('x')) + "needle";
+    for (int cut = 0; cut < 40; ++cut) {
+        const QStringView view = QStringView(text).mid(cut);
+        QCOMPARE(TextSearch::indexOf(view, u"needle"), view.indexOf(u"needle"));
+    }
+    QCOMPARE(TextSearch::indexOf(u"short", u"longer needle"), -1);
+    QCOMPARE(TextSearch::indexOf(u"abc", u"", 1), 1);
+}
+
+void TextSearchTest::foldsAsciiCase() {
+    const QString haystack = randomText(300, 2);
+    for (const QString needle : {"A", "aB", "ABC", "cAb", "Ab a"}) {
+        for (qsizetype from = 0; from < haystack.size(); from += 7) {
+            QCOMPARE(TextSearch::indexOf(haystack, needle, from, Qt::CaseInsensitive),
+                     haystack.indexOf(needle, from, Qt::CaseInsensitive));
+        }
+    }
+}
+
+void TextSearchTest::fallsBackForUnicodeCase() {
+    const QString haystack = QString::fromUtf8("Stra\xc3\x9f" "e \xc3\x84rger");
+    QCOMPARE(TextSearch::indexOf(haystack, QString::fromUtf8("\xc3\xa4rger"), 0, Qt::CaseInsensitive), 7);
+    QCOMPARE(TextSearch::indexOf(haystack, QString::fromUtf8("\xc3\xa4rger"), 0, Qt::CaseSensitive), -1);
+}
+
+void TextSearchTest::bytesMatchQt() {
+    const QByteArray haystack = randomText(300, 3).toLatin1();
+    for (const QByteArray needle : {QByteArray("a"), QByteArray("ab"), QByteArray("cab"), QByteArray("a\nb")}) {
+        for (qsizetype from = 0; from <= haystack.size(); ++from) {
+            QCOMPARE(TextSearch::indexOf(haystack, needle, from), haystack.indexOf(needle, from));
+        }
+        QCOMPARE(TextSearch::count(haystack, needle), haystack.count(needle));
+    }
+    QCOMPARE(TextSearch::indexOf(QByteArrayView("Hello World"), QByteArrayView("WORLD"), 0, Qt::CaseInsensitive), 6);
+}
+
+void TextSearchTest::findAllIsNonOverlapping() {
+    QVector<int> positions;
+    QCOMPARE(TextSearch::findAll(u"aaaaa", u"aa", 0, 5, Qt::CaseSensitive, &positions), 2);
+    QCOMPARE(positions, QVector<int>({0, 2}));
+
+    // Only matches starting in [from, to) count, even if they end past 'to'
+    positions.clear();
+    QCOMPARE(TextSearch::findAll(u"ab ab ab ab", u"ab", 2, 7, Qt::CaseSensitive, &positions), 2);
+    QCOMPARE(positions, QVector<int>({3, 6}));
+    QCOMPARE(TextSearch::findAll(u"ab ab", u"ab", 0, 5, Qt::CaseSensitive, nullptr), 2);
+}
+
+void TextSearchTest::countsBytes() {
+    const QByteArray text = randomText(5000, 4).toLatin1();
+    for (int size : {0, 1, 15, 16, 17, 31, 32, 33, 255, 256, 257, 5000}) {
+        const QByteArrayView view(text.constData(), size);
+        QCOMPARE(TextSearch::count(view, '\n'), qsizetype(std::count(view.begin(), view.end(), '\n')));
+    }
+    // More than 255 hits in one run of the counting loop
+    const QByteArray newlines(100000, '\n');
+    QCOMPARE(TextSearch::count(newlines, '\n'), newlines.size());
+}
+
+void TextSearchTest::selfOverlap() {
+    QVERIFY(TextSearch::canSelfOverlap(u"aa", Qt::CaseSensitive));
+    QVERIFY(TextSearch::canSelfOverlap(u"abcab", Qt::CaseSensitive));
+    QVERIFY(!TextSearch::canSelfOverlap(u"ab", Qt::CaseSensitive));
+    QVERIFY(!TextSearch::canSelfOverlap(u"aA", Qt::CaseSensitive));
+    QVERIFY(TextSearch::canSelfOverlap(u"aA", Qt::CaseInsensitive));
+    QVERIFY(!TextSearch::canSelfOverlap(u"", Qt::CaseSensitive));
+}
+
+QObject *createTextSearchTest() { return new TextSearchTest; }
+
+#include "TextSearchTest.moc"
@@ -0,0 +1,174 @@
+// Undo/redo on a real QTextDocument: what becomes a step, spilling to disk,
+// and the history saved between sessions.
+#include <QTemporaryDir>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QtTest>
+
+#include "DocumentMirror.h"
+#include "UndoHistory.h"
+
+class UndoHistoryTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void typingIsOneStepPerWord();
+    void undoAndRedo();
+    void newEditDropsRedo();
+    void formatChangesAreNotSteps();
+    void mirrorFollowsTheDocument();
+    void spillsOldStepsAndBringsThemBack();
+    void restoresOnlyForTheSameText();
+};
+
+static void type(QTextDocument *document, int position, const QString &text) {
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    for (QChar c : text) cursor.insertText(QString(c));
+}
+
+static void replace(QTextDocument *document, int position, int length, const QString &text) {
+    QTextCursor cursor(document);
+    cursor.setPosition(position);
+    cursor.setPosition(position + length, QTextCursor::KeepAnchor);
+    cursor.insertText(text);
+}
+
+void UndoHistoryTest::typingIsOneStepPerWord() {
+    QTextDocument document;
+    document.setPlainText("x");
+    UndoHistory history(&document);
+    QVERIFY(!history.canUndo());
+
+    type(&document, 1, "ab cd");
+    QCOMPARE(document.toPlainText(), QString("xab cd"));
+
+    // "cd" started a new step after the space
+    QCOMPARE(history.undo(), 4);
+    QCOMPARE(document.toPlainText(), QString("xab "));
+    QCOMPARE(history.undo(), 1);
+    QCOMPARE(document.toPlainText(), QString("x"));
+    QVERIFY(!history.canUndo());
+}
+
+void UndoHistoryTest::undoAndRedo() {
+    QTextDocument document;
+    document.setPlainText("first line\nsecond line");
+    UndoHistory history(&document);
+
+    replace(&document, 6, 4, "row\nmore");
+    history.breakCoalescing();
+    replace(&document, 0, 5, "1st");
+    const QString edited = document.toPlainText();
+
+    QVERIFY(history.undo() >= 0);
+    QVERIFY(history.undo() >= 0);
+    QCOMPARE(document.toPlainText(), QString("first line\nsecond line"));
+    QCOMPARE(history.undo(), -1);
+
+    QVERIFY(history.canRedo());
+    QVERIFY(history.redo() >= 0);
+    QVERIFY(history.redo() >= 0);
+    QCOMPARE(document.toPlainText(), edited);
+    QCOMPARE(history.redo(), -1);
+}
+
+void UndoHistoryTest::newEditDropsRedo() {
+    QTextDocument document;
+    document.setPlainText("abc");
+    UndoHistory history(&document);
+
+    replace(&document, 0, 1, "X");
+    history.undo();
+    QVERIFY(history.canRedo());
+    replace(&document, 2, 1, "Y");
+    QVERIFY(!history.canRedo());
+    history.undo();
+    QCOMPARE(document.toPlainText(), QString("abc"));
+}
+
+void UndoHistoryTest::formatChangesAreNotSteps() {
+    QTextDocument document;
+    document.setPlainText("some text\nmore text");
+    UndoHistory history(&document);
+
+    QTextCursor cursor(&document);
+    cursor.select(QTextCursor::Document);
+    QTextCharFormat bold;
+    bold.setFontWeight(QFont::Bold);
+    cursor.mergeCharFormat(bold);
+    QVERIFY(!history.canUndo());
+
+    // Replacing text with the same text changes nothing either
+    replace(&document, 0, 4, "some");
+    QVERIFY(!history.canUndo());
+}
+
+void UndoHistoryTest::mirrorFollowsTheDocument() {
+    QTextDocument document;
+    document.setPlainText("one\ntwo\nthree");
+    UndoHistory history(&document);
+    const DocumentMirror *mirror = DocumentMirror::forDocument(&document);
+
+    type(&document, 3, " and a half");
+    replace(&document, 0, 8, "a\nb\nc");
+    replace(&document, 2, 0, "\n\n");
+    QCOMPARE(mirror->text(), document.toRawText());
+
+    while (history.undo() >= 0) {}
+    QCOMPARE(mirror->text(), document.toRawText());
+    QCOMPARE(document.toPlainText(), QString("one\ntwo\nthree"));
+}
+
+void UndoHistoryTest::spillsOldStepsAndBringsThemBack() {
+    QTextDocument document;
+    document.setPlainText("start");
+    UndoHistory history(&document);
+    history.setMemoryBudget(0); // The minimum
+
+    // 200 steps of 1000 characters each, well over the budget
+    for (int i = 0; i < 200; ++i) {
+        replace(&document, 0, 0, QString(1000, QLatin1Char('a' + i % 26)));
+    }
+    QVERIFY(history.memoryUsage() <= history.memoryBudget());
+
+    int steps = 0;
+    while (history.undo() >= 0) ++steps;
+    QCOMPARE(steps, 200);
+    QCOMPARE(document.toPlainText(), QString("start"));
+}
+
+void UndoHistoryTest::restoresOnlyForTheSameText() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("history");
+
+    QString saved;
+    {
+        QTextDocument document;
+        document.setPlainText("base");
+        UndoHistory history(&document);
+        replace(&document, 4, 0, " plus");
+        QVERIFY(history.save(path));
+        saved = document.toPlainText();
+    }
+
+    // Same text: the step is back
+    QTextDocument document;
+    document.setPlainText(saved);
+    UndoHistory history(&document);
+    QVERIFY(history.load(path));
+    QVERIFY(history.undo() >= 0);
+    QCOMPARE(document.toPlainText(), QString("base"));
+
+    // Different text: refused
+    QTextDocument other;
+    other.setPlainText(saved + "!");
+    UndoHistory otherHistory(&other);
+    QVERIFY(!otherHistory.load(path));
+    QVERIFY(!otherHistory.canUndo());
+}
+
+QObject *createUndoHistoryTest() { return new UndoHistoryTest; }
+
+#include "UndoHistoryTest.moc"